@@ -1,6 +1,6 @@
 from PySide2.QtWidgets import QWidget, QFrame
 from PySide2.QtGui import QColor
-from PySide2.QtCore import QPoint, QSize
+from PySide2.QtCore import QPoint, QSize, Signal
 
 from DisplayWidgetGroup import DisplayWidgetGroup
 
@@ -12,6 +12,9 @@ from DisplayWidgetGroup import DisplayWidgetGroup
 
 '''
 class DisplayWidgetArea(QFrame):
+    # emitted with the group when the user finishes dragging it
+    groupMoved = Signal(object)
+
     def __init__(self, parent):
         super().__init__(parent)
 
@@ -28,6 +31,8 @@ class DisplayWidgetArea(QFrame):
         self.globalBounds = bounds.copy()
         for group in self.displaysGroups:
             group.UpdateGlobalBounds(self.globalBounds)
+            group.SetWidgetBounds([0, 0, self.width(), self.height()])
+            group.UpdateGeometry()
 
     def GetAllGlobalOffsets(self):
         offsets = {}
@@ -60,4 +65,28 @@ class DisplayWidgetArea(QFrame):
             displayGroup.AddDisplay(display)
             
         self.displaysGroups.append(displayGroup)
+        displayGroup.UpdateGlobalBounds(self.globalBounds)
+        displayGroup.show()
+
+    def FindDisplayGroup(self, groupID):
+        for group in self.displaysGroups:
+            if group.groupID == groupID:
+                return group
+        return None
+
+    # replaces the group with {groupID} or adds it if it is new
+    def SetDisplayGroup(self, displays, groupID):
+        self.RemoveDisplayGroup(groupID)
+        self.AddDisplayGroup(displays, groupID)
+
+    def RemoveDisplayGroup(self, groupID):
+        group = self.FindDisplayGroup(groupID)
+        if group:
+            self.displaysGroups.remove(group)
+            group.deleteLater()
+
+    def RemoveAllDisplayGroups(self):
+        for group in self.displaysGroups:
+            group.deleteLater()
+        self.displaysGroups = []
 
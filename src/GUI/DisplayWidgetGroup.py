@@ -154,4 +154,5 @@ class DisplayWidgetGroup(QWidget):
 
     def mouseReleaseEvent(self, event):
         self.oldPos = None
+        self.displayArea.groupMoved.emit(self)
         return super().mouseReleaseEvent(event)
\ No newline at end of file
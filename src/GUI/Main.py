@@ -1,10 +1,10 @@
 from PySide2.QtWidgets import QApplication, QErrorMessage
 
 import sys
-import json
 import socket
 
 from MainWindow import MainWindow
+from ServiceConnection import ServiceConnection
 
 if __name__ == "__main__":
 
@@ -22,8 +22,8 @@ if __name__ == "__main__":
     try:
         s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         s.connect((socketIP, socketPort))
-        data = s.recv(1024)
-        values = json.loads(data)
+        connection = ServiceConnection(s)
+        values = connection.ReadMessage()
     except socket.error as e:
         errorDialog = QErrorMessage()
         errorDialog.showMessage(f"CC Service appears to not be running.\
@@ -33,8 +33,8 @@ if __name__ == "__main__":
         sys.exit(0)
     
     window = MainWindow()
-    window.SetServiceSocket(s)
     window.SetupDisplaysWithEntityData(values)
+    window.SetServiceConnection(connection)
     #window.testSetupDisplays()
 
     window.show()
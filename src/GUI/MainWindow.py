@@ -3,7 +3,6 @@ from PySide2.QtGui import QColor
 from PySide2.QtCore import Qt, Signal
 
 import sys
-import json
 
 from DisplayWidgetArea import DisplayWidgetArea
 
@@ -11,7 +10,8 @@ class MainWindow(QWidget):
     def __init__(self):
         super().__init__()
 
-        self.socket = None
+        self.connection = None
+        self.version = 0
 
         self.setWindowTitle("CommunistCursor Display Setup")
         p = self.palette()
@@ -38,15 +38,48 @@ class MainWindow(QWidget):
 
     def OkPressed(self):
         offsets = self.displayArea.GetAllGlobalOffsets()
-        if self.socket:
-            self.socket.sendall(json.dumps(offsets).encode())
+        if self.connection:
+            self.connection.SendOffsets(offsets, True)
 
         sys.exit(0)
 
-    def SetServiceSocket(self, socket):
-        self.socket = socket
+    def SetServiceConnection(self, connection):
+        self.connection = connection
+        self.connection.messageReceived.connect(self.ServiceMessageReceived)
+        self.connection.disconnected.connect(self.ServiceDisconnected)
+        self.displayArea.groupMoved.connect(self.GroupMoved)
+        self.connection.StartReading()
+
+    # only the group that was dragged is sent, the service applies it live
+    def GroupMoved(self, group):
+        if self.connection:
+            self.connection.SendOffsets({group.groupID: group.GetGlobalOffset()}, False)
+
+    def ServiceDisconnected(self):
+        self.setWindowTitle("CommunistCursor Display Setup (disconnected)")
+
+    def ServiceMessageReceived(self, message):
+        messageType = message.get("type")
+        self.version = message.get("version", self.version)
+
+        if messageType == "snapshot":
+            self.displayArea.RemoveAllDisplayGroups()
+            self.SetupDisplaysWithEntityData(message)
+            return
+
+        if messageType == "entityJoined" or messageType == "displayChanged":
+            self.displayArea.SetDisplayGroup(message["entity"]["displays"], message["entity"]["id"])
+        elif messageType == "entityLost":
+            self.displayArea.RemoveDisplayGroup(message["id"])
+        elif messageType == "offsetsChanged":
+            for entity in message["entites"]:
+                self.displayArea.SetDisplayGroup(entity["displays"], entity["id"])
+
+        if "globalBounds" in message:
+            self.displayArea.SetGlobalBounds(message["globalBounds"])
 
     def SetupDisplaysWithEntityData(self, entityData):
+        self.version = entityData.get("version", 0)
         entityArray = entityData["entites"]
         for entity in entityArray:
             self.displayArea.AddDisplayGroup(entity["displays"], entity["id"])
@@ -0,0 +1,63 @@
+from PySide2.QtCore import QObject, Signal
+
+import json
+import struct
+import threading
+
+'''
+
+    ServiceConnection
+
+    Long lived connection to the CC Service. Every message is a frame, a little endian
+    uint32 length followed by that many bytes of JSON (see CCGuiSession.h in the service).
+
+    The first frame is always a snapshot of the layout, after that the service sends a delta
+    whenever something changes. Deltas are read on a background thread and handed to the
+    Qt thread through the messageReceived signal.
+
+'''
+class ServiceConnection(QObject):
+    messageReceived = Signal(dict)
+    disconnected = Signal()
+
+    def __init__(self, sock):
+        super().__init__()
+        self.socket = sock
+        self.sendLock = threading.Lock()
+        self.readThread = None
+
+    def ReadExactly(self, length):
+        data = bytearray()
+        while len(data) < length:
+            chunk = self.socket.recv(length - len(data))
+            if not chunk:
+                raise ConnectionError("service closed the connection")
+            data += chunk
+        return data
+
+    def ReadMessage(self):
+        length = struct.unpack("<I", self.ReadExactly(4))[0]
+        return json.loads(self.ReadExactly(length))
+
+    def Send(self, message):
+        payload = json.dumps(message).encode()
+        with self.sendLock:
+            self.socket.sendall(struct.pack("<I", len(payload)) + payload)
+
+    def SendOffsets(self, offsets, final):
+        self.Send({"type": "setOffsets", "offsets": offsets, "final": final})
+
+    # the answer is a "latency" message, withinUs adds the fraction of each stage at or below it
+    def RequestLatency(self, withinUs=0, reset=False):
+        self.Send({"type": "getLatency", "withinUs": withinUs, "reset": reset})
+
+    def StartReading(self):
+        self.readThread = threading.Thread(target=self.ReadLoop, daemon=True)
+        self.readThread.start()
+
+    def ReadLoop(self):
+        try:
+            while True:
+                self.messageReceived.emit(self.ReadMessage())
+        except (OSError, ConnectionError, ValueError):
+            self.disconnected.emit()
@@ -0,0 +1,104 @@
+#include "CCAcceleration.h"
+#include "CCConfigurationManager.h"
+#include "CCLogger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+CCAcceleration::CCAcceleration() : _remainderX(0), _remainderY(0), _curvePath({ "Acceleration", "curve" })
+{
+	_table.reset(Compile(nlohmann::json::array()));
+}
+
+void CCAcceleration::Apply(int& deltaX, int& deltaY)
+{
+	_pendingTable.Take(_table);
+
+	int magnitude = std::min(std::max(std::abs(deltaX), std::abs(deltaY)), CC_ACCELERATION_LUT_SIZE - 1);
+	float gain = _table->gains[magnitude];
+
+	float x = deltaX * gain + _remainderX;
+	float y = deltaY * gain + _remainderY;
+
+	deltaX = (int)std::floor(x);
+	deltaY = (int)std::floor(y);
+
+	_remainderX = x - deltaX;
+	_remainderY = y - deltaY;
+}
+
+void CCAcceleration::Reset()
+{
+	_remainderX = 0;
+	_remainderY = 0;
+}
+
+CCAcceleration::Table* CCAcceleration::Compile(const nlohmann::json& curve)
+{
+	std::vector<std::pair<float, float>> points;
+
+	try
+	{
+		for (auto& jPoint : curve)
+		{
+			points.emplace_back(jPoint.at(0).get<float>(), jPoint.at(1).get<float>());
+		}
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR << "Invalid acceleration curve: " << e.what() << std::endl;
+		return NULL;
+	}
+
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		if (points[i].second <= 0 || (i > 0 && points[i].first <= points[i - 1].first))
+		{
+			LOG_ERROR << "Invalid acceleration curve: point " << i << " needs a positive gain and a larger delta than the one before it" << std::endl;
+			return NULL;
+		}
+	}
+
+	std::unique_ptr<Table> table(new Table());
+	size_t next = 0; // the first point past the delta
+
+	for (int delta = 0; delta < CC_ACCELERATION_LUT_SIZE; delta++)
+	{
+		while (next < points.size() && points[next].first <= delta)
+			next++;
+
+		float gain = 1.0f;
+		if (points.empty() == false)
+		{
+			if (next == 0)
+				gain = points.front().second;
+			else if (next == points.size())
+				gain = points.back().second;
+			else
+			{
+				auto& lower = points[next - 1];
+				auto& upper = points[next];
+				gain = lower.second + (upper.second - lower.second) * (delta - lower.first) / (upper.first - lower.first);
+			}
+		}
+
+		table->gains[delta] = gain;
+	}
+
+	return table.release();
+}
+
+void CCAcceleration::LoadFrom(const CCConfigurationManager& manager)
+{
+	nlohmann::json curve = nlohmann::json::array();
+	manager.GetValue(_curvePath, curve);
+
+	Table* table = Compile(curve);
+	if (table == NULL)
+		return;
+
+	_pendingTable.Offer(table);
+}
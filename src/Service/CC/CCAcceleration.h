@@ -0,0 +1,65 @@
+#ifndef CC_ACCELERATION_H
+#define CC_ACCELERATION_H
+
+#include <memory>
+
+#include "CCConfigPath.h"
+#include "CCPendingSwap.h"
+
+class CCConfigurationManager;
+
+/*
+*	CCAcceleration gives the cursor on remote entities the same feel on every computer. Remote
+*	entities inject absolute positions, so their own pointer acceleration never applies, the moves
+*	CCMain forwards are scaled by the curve in the "Acceleration" section of the config file instead, i.e.
+*
+*		"Acceleration": {
+*			"curve": [[0, 1.0], [4, 1.0], [24, 2.0], [64, 3.0]]
+*		}
+*
+*	Each point is the delta of a move, the larger of |deltaX| and |deltaY| in pixels, and the gain
+*	a move that size gets. Gains between points are interpolated, before the first and past the last
+*	point they stay flat. Without a curve moves are forwarded as they were captured. While the mouse
+*	is captured (see CCMain::UpdateMouseCapture) that is the mouse's own motion, without this
+*	computer's acceleration either.
+*
+*	The curve is evaluated once into a table of CC_ACCELERATION_LUT_SIZE gains, a move costs a table
+*	read and a multiply. The fractions a gain leaves are carried to the next move so slow moves
+*	aren't rounded away. Only used from the thread delivering input, LoadFrom can be called from any
+*	thread, the new curve is picked up by the next move.
+*/
+
+#define CC_ACCELERATION_LUT_SIZE 256
+
+class CCAcceleration
+{
+private:
+	struct Table
+	{
+		float	gains[CC_ACCELERATION_LUT_SIZE]; // by the larger of |deltaX| and |deltaY|
+	};
+
+	std::unique_ptr<Table>	_table;
+	CCPendingSwap<Table>	_pendingTable; // compiled by LoadFrom, swapped in by the input thread
+
+	// what the last moves were short of a whole pixel
+	float					_remainderX;
+	float					_remainderY;
+
+	CCConfigPath			_curvePath;
+
+	// returns NULL and logs if {curve} isn't a valid "curve" array
+	static Table* Compile(const nlohmann::json& curve);
+
+public:
+	CCAcceleration();
+
+	// scales a move by {deltaX}, {deltaY} by the curve
+	void Apply(int& deltaX, int& deltaY);
+	// forgets the carried fractions, i.e. when the cursor jumped
+	void Reset();
+
+	void LoadFrom(const CCConfigurationManager& manager);
+};
+
+#endif
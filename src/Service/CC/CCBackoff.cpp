@@ -0,0 +1,26 @@
+#include "CCBackoff.h"
+
+#include <algorithm>
+
+CCBackoff::CCBackoff(std::chrono::milliseconds base, std::chrono::milliseconds cap) : _base(base), _cap(std::max(base, cap)), \
+_attempts(0), _random(std::random_device()())
+{
+}
+
+std::chrono::milliseconds CCBackoff::Next()
+{
+	// past 2^16 the cap has long been reached
+	uint32_t shift = std::min<uint32_t>(_attempts, 16);
+	_attempts++;
+
+	int64_t ceiling = std::min<int64_t>(_base.count() << shift, _cap.count());
+	int64_t half = ceiling / 2;
+
+	std::uniform_int_distribution<int64_t> jitter(0, ceiling - half);
+	return std::chrono::milliseconds(half + jitter(_random));
+}
+
+void CCBackoff::Reset()
+{
+	_attempts = 0;
+}
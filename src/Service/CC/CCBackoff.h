@@ -0,0 +1,34 @@
+#ifndef CC_BACKOFF_H
+#define CC_BACKOFF_H
+
+#include <chrono>
+#include <random>
+#include <stdint.h>
+
+/*
+*	CCBackoff spaces out reconnect attempts. Every call to Next doubles the delay, starting at {base}
+*	and capped at {cap}, and picks a random delay between half of it and all of it. The random half
+*	keeps entities that dropped at the same time (i.e. the server's Wi-Fi) from reconnecting in step.
+*
+*	Not thread safe, each reconnect loop owns one.
+*/
+class CCBackoff
+{
+private:
+	std::chrono::milliseconds	_base;
+	std::chrono::milliseconds	_cap;
+	uint32_t					_attempts;
+	std::minstd_rand			_random;
+
+public:
+	CCBackoff(std::chrono::milliseconds base, std::chrono::milliseconds cap);
+
+	// the delay before the next attempt
+	std::chrono::milliseconds Next();
+	// the connection is back, the next failure starts from {base} again
+	void Reset();
+
+	inline uint32_t GetAttempts()const { return _attempts; }
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "CCBroadcastManager.h"
 
+#include <string.h>
+
 #include "CCLogger.h"
 
 #include "../Socket/SocketError.h"
@@ -4,20 +4,35 @@
 #include "../OSInterface/PacketTypes.h"
 
 #include "CCPacketTypes.h"
+#include "CCDisplay.h"
 #include "CCLogger.h"
 
-CCClient::CCClient(int listenPort) : _serverAddress("0.0.0.0"), _listenPort(listenPort), _needsNewServer(true)
+#include <stdexcept>
+
+// the server answers the resume packet as soon as it reads it
+#define CC_SESSION_REPLY_TIMEOUT_MS 5000
+
+CCClient::CCClient(int listenPort, const std::string& entityID, const std::string& localAddress) : _serverAddress("0.0.0.0"), \
+_serverPort(0), _entityID(entityID), _localAddress(localAddress), _listenPort(listenPort), _sessionToken(0), _needsNewServer(true)
 {
 	auto error = OSInterface::SharedInterface().GetNativeDisplayList(_displayList);
 	if (error != OSInterfaceError::OS_E_SUCCESS)
 	{
 		std::string errorMessage = "Error Getting Display List " + OSInterfaceErrorToString(error);
-		throw std::exception(errorMessage.c_str());
+		throw std::runtime_error(errorMessage.c_str());
 	}
 }
 
 void CCClient::ConnectToServer(std::string address, int port)
 {
+	_serverAddress = address;
+	_serverPort = port;
+
+	// displays may have been plugged in or out since the last handshake
+	std::vector<NativeDisplay> displayList;
+	if (OSInterface::SharedInterface().GetNativeDisplayList(displayList) == OSInterfaceError::OS_E_SUCCESS)
+		_displayList = displayList;
+
 	Socket servSocket(address, port, false, SocketProtocol::SOCKET_P_TCP);
 
 	SocketError error = servSocket.Connect();
@@ -27,18 +42,7 @@ void CCClient::ConnectToServer(std::string address, int port)
 		return;
 	}
 
-	DisplayListHeaderPacket listHeader;
-	listHeader.NumberOfDisplays = (int)_displayList.size();
-
-	std::string hostName;
-	OSInterfaceError osError = OSInterface::SharedInterface().GetLocalHostName(hostName);
-	if (osError != OSInterfaceError::OS_E_SUCCESS)
-	{
-		LOG_ERROR << "Error Trying to get Local Host Name\n";
-		return;
-	}
-
-	EntityIDPacket idPacket(hostName);
+	EntityIDPacket idPacket(_entityID);
 
 	error = servSocket.Send((char*)&idPacket, sizeof(EntityIDPacket));
 	if (error != SocketError::SOCKET_E_SUCCESS)
@@ -48,8 +52,17 @@ void CCClient::ConnectToServer(std::string address, int port)
 	}
 
 	AddressPacket addPacket;
-	memcpy(addPacket.Address, INVALID_PACKET_ADDRESS, INVALID_PACKET_ADDRESS_SIZE);
-	addPacket.Address[8] = 0;
+	if (_localAddress != SOCKET_ANY_ADDRESS && _localAddress.size() < sizeof(addPacket.Address))
+	{
+		// the server reaches us here instead of the address the connection came from
+		memcpy(addPacket.Address, _localAddress.c_str(), _localAddress.size());
+		addPacket.Address[_localAddress.size()] = 0;
+	}
+	else
+	{
+		memcpy(addPacket.Address, INVALID_PACKET_ADDRESS, INVALID_PACKET_ADDRESS_SIZE);
+		addPacket.Address[8] = 0;
+	}
 	// this port will eventually be configurable but for now, random numbers
 	addPacket.Port = _listenPort;
 
@@ -60,13 +73,62 @@ void CCClient::ConnectToServer(std::string address, int port)
 		return;
 	}
 
-	error = servSocket.Send((char*)&listHeader, sizeof(DisplayListHeaderPacket));
+	SessionResumePacket resumePacket(_sessionToken, CCDisplay::HashNativeDisplays(_displayList));
+
+	error = servSocket.Send((char*)&resumePacket, sizeof(SessionResumePacket));
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Trying To Send Session To Server: " << SOCK_ERR_STR(&servSocket, error) << std::endl;
+		return;
+	}
+
+	SessionReplyPacket replyPacket;
+	size_t received = 0;
+
+	error = servSocket.SetReceiveTimeout(CC_SESSION_REPLY_TIMEOUT_MS);
+	if (error == SocketError::SOCKET_E_SUCCESS)
+		error = servSocket.Recv((char*)&replyPacket, sizeof(SessionReplyPacket), &received);
+	if (error == SocketError::SOCKET_E_SUCCESS && (received != sizeof(SessionReplyPacket) || replyPacket.MagicNumber != P_MAGIC_NUMBER))
+		error = SocketError::SOCKET_E_INVALID_PACKET;
+
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Trying To Receive Session From Server: " << SOCK_ERR_STR(&servSocket, error) << std::endl;
+		return;
+	}
+
+	_sessionToken = replyPacket.Token;
+
+	// the server already has our displays
+	if (replyPacket.Resumed)
+		LOG_INFO << "Resumed session with server " << address << std::endl;
+	else if (SendDisplayList(&servSocket) == false)
+		return;
+
+	// server will close socket on it's end when it receives everything
+	// we wait for it here
+	error = servSocket.WaitForServer();
 	if (error != SocketError::SOCKET_E_SUCCESS)
 	{
-		LOG_ERROR << "Error Trying To Send List Header To Server: " << SOCK_ERR_STR(&servSocket, error) << std::endl;
+		LOG_ERROR << "Error Trying To Wait For Server: " << SOCK_ERR_STR(&servSocket, error) << std::endl;
 		return;
 	}
 
+	_needsNewServer = false;
+}
+
+bool CCClient::SendDisplayList(Socket* servSocket)
+{
+	DisplayListHeaderPacket listHeader;
+	listHeader.NumberOfDisplays = (int)_displayList.size();
+
+	SocketError error = servSocket->Send((char*)&listHeader, sizeof(DisplayListHeaderPacket));
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Trying To Send List Header To Server: " << SOCK_ERR_STR(servSocket, error) << std::endl;
+		return false;
+	}
+
 	for (auto display : _displayList)
 	{
 		DisplayListDisplayPacket displayPacket;
@@ -77,25 +139,15 @@ void CCClient::ConnectToServer(std::string address, int port)
 		displayPacket.Height = display.height;
 		displayPacket.NativeDisplayID = display.nativeScreenID;
 
-		error = servSocket.Send((char*)&displayPacket, sizeof(DisplayListDisplayPacket));
+		error = servSocket->Send((char*)&displayPacket, sizeof(DisplayListDisplayPacket));
 		if (error != SocketError::SOCKET_E_SUCCESS)
 		{
-			LOG_ERROR << "Error Trying To Send Display Info To Server: " << SOCK_ERR_STR(&servSocket, error) << std::endl;
-			return;
+			LOG_ERROR << "Error Trying To Send Display Info To Server: " << SOCK_ERR_STR(servSocket, error) << std::endl;
+			return false;
 		}
 	}
 
-	// server will close socket on it's end when it receives everything
-	// we wait for it here
-	error = servSocket.WaitForServer();
-	if (error != SocketError::SOCKET_E_SUCCESS)
-	{
-		LOG_ERROR << "Error Trying To Wait For Server: " << SOCK_ERR_STR(&servSocket, error) << std::endl;
-		return;
-	}
-
-	_serverAddress = address;
-	_needsNewServer = false;
+	return true;
 }
 
 void CCClient::StopClientSocket()
@@ -1,9 +1,11 @@
 #ifndef CC_CLIENT_H
 #define CC_CLIENT_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 #include "../OSInterface/OSTypes.h"
 
@@ -15,14 +17,24 @@ private:
     std::vector<NativeDisplay> _displayList;
 
     std::string _serverAddress;
+    int _serverPort;
+    std::string _entityID;
+    std::string _localAddress; // sent to the server when it isn't SOCKET_ANY_ADDRESS
     int _listenPort;
 
-    bool _needsNewServer;
+    uint64_t _sessionToken; // from the last handshake, 0 before the first one
+
+    std::atomic<bool> _needsNewServer;
+
+    // the list header and every display, returns false if the server couldn't be sent one of them
+    bool SendDisplayList(Socket* servSocket);
 
 public:
-    CCClient(int listenPort);
+    CCClient(int listenPort, const std::string& entityID, const std::string& localAddress);
     // connects to and performs handshake with server.
-    // gives list of native display and local address to server
+    // gives list of native display and local address to server, the display list is skipped
+    // if the server still has them from our last session. {address} and {port} are remembered
+    // for reconnecting even if this fails
     void ConnectToServer(std::string address, int port);
     // Waits for a single OS event from the server on {port}
     // {port} is cached in the internal socket and for a new value to be used ResetSocket
@@ -38,6 +50,8 @@ public:
     // Getters
     inline std::vector<NativeDisplay> GetDisplayList()const { return _displayList; };
     inline bool GetNeedsNewServer()const {return _needsNewServer;}
+    inline const std::string& GetServerAddress()const { return _serverAddress; }
+    inline int GetServerPort()const { return _serverPort; }
 };
 
 #endif
\ No newline at end of file
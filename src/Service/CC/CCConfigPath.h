@@ -0,0 +1,50 @@
+#ifndef CC_CONFIG_PATH_H
+#define CC_CONFIG_PATH_H
+
+#include <nlohmann/json_fwd.hpp>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class CCConfigurationManager;
+
+/*
+*	CCConfigPath is a precompiled key path into a CCConfigurationManager document.
+*	Keys are interned once when the path is built and the node the path points to is cached
+*	the first time it is resolved, so repeated lookups walk nothing and copy nothing.
+*
+*	The cache is tied to the manager that resolved it and to that manager's generation, which changes
+*	whenever a load or a write could have moved nodes. Build paths once and keep them (i.e. as members),
+*	a temporary path still works but pays for interning on every call.
+*
+*	Resolving writes the cache even through the const GetValue, so a path shared between threads must
+*	only be resolved while the caller holds the lock that guards its configuration manager.
+*/
+class CCConfigPath
+{
+private:
+	std::vector<const std::string*>	_keys;
+
+	// resolve cache, not part of the path's value
+	mutable const CCConfigurationManager*	_resolvedManager;
+	mutable uint64_t						_resolvedGeneration;
+	mutable nlohmann::json*					_resolvedNode;
+
+	friend class CCConfigurationManager;
+
+public:
+	CCConfigPath(std::initializer_list<std::string> keys);
+	CCConfigPath(const std::vector<std::string>& keys);
+
+	// returns the path with {key} appended
+	CCConfigPath Append(const std::string& key)const;
+
+	inline size_t GetSize()const { return _keys.size(); }
+	inline const std::string& GetKey(size_t index)const { return *_keys[index]; }
+
+	// returns a stable pointer for {key}, equal keys always return the same pointer
+	static const std::string* InternKey(const std::string& key);
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "CCConfigPersister.h"
+#include "CCLogger.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+CCConfigPersister::CCConfigPersister(std::string filePath, SnapshotCallback snapshot, int debounceMS, int maxDelayMS) : \
+_filePath(filePath), _snapshot(snapshot), _debounce(debounceMS), _maxDelay(maxDelayMS), _isDirty(false), _shouldRun(true), \
+_requestedSaves(0), _completedSaves(0), _writes(0), _lastWrittenHash(0)
+{
+	_persistThread = std::thread(&CCConfigPersister::PersistThread, this);
+}
+
+CCConfigPersister::~CCConfigPersister()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_shouldRun = false;
+	}
+	_condition.notify_all();
+
+	if (_persistThread.joinable())
+		_persistThread.join();
+}
+
+void CCConfigPersister::MarkDirty()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto now = std::chrono::steady_clock::now();
+		if (_isDirty == false)
+			_firstDirtyTime = now;
+
+		_lastDirtyTime = now;
+		_isDirty = true;
+	}
+	_condition.notify_all();
+}
+
+void CCConfigPersister::Flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	uint64_t request = ++_requestedSaves;
+
+	_condition.notify_all();
+	_condition.wait(lock, [this, request]() { return _completedSaves >= request || _shouldRun == false; });
+}
+
+void CCConfigPersister::SetFilePath(const std::string& filePath)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_filePath = filePath;
+}
+
+void CCConfigPersister::PersistThread()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		if (_isDirty)
+		{
+			auto deadline = _lastDirtyTime + _debounce;
+			if (_firstDirtyTime + _maxDelay < deadline)
+				deadline = _firstDirtyTime + _maxDelay;
+
+			bool flushRequested = _requestedSaves != _completedSaves;
+
+			if (flushRequested || _shouldRun == false || std::chrono::steady_clock::now() >= deadline)
+			{
+				uint64_t request = _requestedSaves;
+				_isDirty = false;
+
+				lock.unlock();
+				bool saved = Persist();
+				lock.lock();
+
+				// try again after another debounce window unless something newer is already pending
+				if (saved == false && _shouldRun && _isDirty == false)
+				{
+					_isDirty = true;
+					_firstDirtyTime = _lastDirtyTime = std::chrono::steady_clock::now();
+				}
+
+				_completedSaves = request;
+				_condition.notify_all();
+				continue;
+			}
+
+			_condition.wait_until(lock, deadline);
+		}
+		else
+		{
+			// nothing pending, any write in flight when a flush came in has finished
+			_completedSaves = _requestedSaves;
+			_condition.notify_all();
+
+			if (_shouldRun == false)
+				break;
+
+			_condition.wait(lock);
+		}
+	}
+}
+
+bool CCConfigPersister::Persist()
+{
+	std::string filePath;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		filePath = _filePath;
+	}
+
+	std::string contents;
+	try
+	{
+		contents = _snapshot().dump();
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR << "Error serializing config: " << e.what() << std::endl;
+		return false;
+	}
+
+	// published before the rename so a watcher woken by it already sees the hash
+	size_t previousHash = _lastWrittenHash.exchange(std::hash<std::string>()(contents), std::memory_order_release);
+
+	if (WriteFileAtomic(filePath, contents) == false)
+	{
+		LOG_ERROR << "Error writing config to " << filePath << std::endl;
+		_lastWrittenHash.store(previousHash, std::memory_order_release);
+		return false;
+	}
+
+	_writes.fetch_add(1, std::memory_order_relaxed);
+	LOG_DEBUG << "Saved config to " << filePath << std::endl;
+
+	return true;
+}
+
+bool CCConfigPersister::WriteFileAtomic(const std::string& filePath, const std::string& contents)
+{
+	std::string tempPath = filePath + ".tmp";
+
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+
+	bool success = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	success = fflush(file) == 0 && success;
+
+	// make sure the data is on disk before the rename makes it visible
+#ifdef _WIN32
+	success = _commit(_fileno(file)) == 0 && success;
+#else
+	success = fsync(fileno(file)) == 0 && success;
+#endif
+
+	success = fclose(file) == 0 && success;
+
+	if (success == false)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	if (MoveFileExA(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == FALSE)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+#else
+	if (rename(tempPath.c_str(), filePath.c_str()) != 0)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+
+	// persist the rename itself
+	size_t slash = filePath.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : filePath.substr(0, slash == 0 ? 1 : slash);
+	int directoryFD = open(directory.c_str(), O_RDONLY);
+	if (directoryFD >= 0)
+	{
+		fsync(directoryFD);
+		close(directoryFD);
+	}
+#endif
+
+	return true;
+}
@@ -0,0 +1,72 @@
+#ifndef CC_CONFIG_PERSISTER_H
+#define CC_CONFIG_PERSISTER_H
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+*	CCConfigPersister writes the configuration to disk off the calling thread.
+*
+*	MarkDirty only sets a flag and a deadline. Once no new change has come in for the debounce
+*	window the persister thread takes a snapshot through the snapshot callback, serializes it and
+*	writes it atomically (temp file, flush to disk, rename over the old file), so a crash mid write
+*	leaves either the old or the new file and never a partial one.
+*
+*	A burst of edits inside the window turns into a single write. A steady stream of edits is
+*	still written at least every max delay.
+*/
+class CCConfigPersister
+{
+public:
+	// called on the persister thread, must return a copy of the document to write
+	typedef std::function<nlohmann::json()> SnapshotCallback;
+
+private:
+	std::string					_filePath;
+	SnapshotCallback			_snapshot;
+	std::chrono::milliseconds	_debounce;
+	std::chrono::milliseconds	_maxDelay;
+
+	std::mutex					_mutex;
+	std::condition_variable		_condition;
+	bool						_isDirty;
+	bool						_shouldRun;
+	uint64_t					_requestedSaves; // guarded by _mutex
+	uint64_t					_completedSaves; // guarded by _mutex
+	std::chrono::steady_clock::time_point	_firstDirtyTime;
+	std::chrono::steady_clock::time_point	_lastDirtyTime;
+
+	std::atomic<uint64_t>		_writes;
+	std::atomic<size_t>			_lastWrittenHash;
+	std::thread					_persistThread;
+
+	void PersistThread();
+	bool Persist();
+
+public:
+	CCConfigPersister(std::string filePath, SnapshotCallback snapshot, int debounceMS = 250, int maxDelayMS = 2000);
+	~CCConfigPersister();
+
+	// schedules a save, never blocks on I/O
+	void MarkDirty();
+	// writes any pending change now and waits for it, used on shutdown
+	void Flush();
+
+	void SetFilePath(const std::string& filePath);
+
+	// number of files written so far
+	inline uint64_t GetWriteCount()const { return _writes.load(std::memory_order_relaxed); }
+	// std::hash of the last contents written, lets a file watcher skip our own writes
+	inline size_t GetLastWrittenHash()const { return _lastWrittenHash.load(std::memory_order_acquire); }
+
+	// writes {contents} to {filePath} through a temp file and a rename
+	static bool WriteFileAtomic(const std::string& filePath, const std::string& contents);
+};
+
+#endif
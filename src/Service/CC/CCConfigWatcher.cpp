@@ -0,0 +1,143 @@
+#include "CCConfigWatcher.h"
+#include "CCLogger.h"
+
+#include <chrono>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define WATCH_SETTLE_MS 100
+#define WATCH_POLL_MS 1000
+
+CCConfigWatcher::CCConfigWatcher(ChangeCallback onChange) : _onChange(onChange), _shouldRun(false)
+{
+}
+
+CCConfigWatcher::~CCConfigWatcher()
+{
+	Stop();
+}
+
+bool CCConfigWatcher::Start(const std::string& filePath)
+{
+	Stop();
+
+	_filePath = filePath;
+	_shouldRun = true;
+
+#ifdef __linux__
+	_watchThread = std::thread(&CCConfigWatcher::WatchThread, this);
+#else
+	_watchThread = std::thread(&CCConfigWatcher::PollThread, this);
+#endif
+
+	return true;
+}
+
+void CCConfigWatcher::Stop()
+{
+	_shouldRun = false;
+
+	if (_watchThread.joinable())
+		_watchThread.join();
+}
+
+#ifdef __linux__
+void CCConfigWatcher::WatchThread()
+{
+	size_t slash = _filePath.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : _filePath.substr(0, slash == 0 ? 1 : slash);
+	std::string fileName = slash == std::string::npos ? _filePath : _filePath.substr(slash + 1);
+
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+	{
+		LOG_ERROR << "Could not start inotify for " << _filePath << ", falling back to polling" << std::endl;
+		PollThread();
+		return;
+	}
+
+	if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		LOG_ERROR << "Could not watch " << directory << ", falling back to polling" << std::endl;
+		close(fd);
+		PollThread();
+		return;
+	}
+
+	LOG_INFO << "Watching " << _filePath << " for changes" << std::endl;
+
+	alignas(struct inotify_event) char buffer[4096];
+	bool isPending = false;
+
+	while (_shouldRun)
+	{
+		// wake up regularly to notice Stop, and settle pending changes before calling back
+		pollfd pfd = { fd, POLLIN, 0 };
+		int ready = poll(&pfd, 1, isPending ? WATCH_SETTLE_MS : 250);
+
+		if (ready <= 0)
+		{
+			if (isPending && _shouldRun)
+			{
+				isPending = false;
+				_onChange();
+			}
+			continue;
+		}
+
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+
+			if (event->len > 0 && fileName == event->name)
+				isPending = true;
+
+			offset += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	close(fd);
+}
+#else
+void CCConfigWatcher::WatchThread()
+{
+	PollThread();
+}
+#endif
+
+void CCConfigWatcher::PollThread()
+{
+	struct stat lastStat = {};
+	bool hadFile = stat(_filePath.c_str(), &lastStat) == 0;
+
+	while (_shouldRun)
+	{
+		for (int waited = 0; waited < WATCH_POLL_MS && _shouldRun; waited += 50)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+
+		struct stat current = {};
+		bool hasFile = stat(_filePath.c_str(), &current) == 0;
+
+		if (hasFile && (hadFile == false || current.st_mtime != lastStat.st_mtime || current.st_size != lastStat.st_size))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_SETTLE_MS));
+
+			if (_shouldRun)
+				_onChange();
+
+			stat(_filePath.c_str(), &current);
+		}
+
+		lastStat = current;
+		hadFile = hasFile;
+	}
+}
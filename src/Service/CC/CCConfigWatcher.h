@@ -0,0 +1,44 @@
+#ifndef CC_CONFIG_WATCHER_H
+#define CC_CONFIG_WATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/*
+*	CCConfigWatcher calls back when the config file changes on disk.
+*
+*	On Linux the file's directory is watched with inotify, the directory and not the file because
+*	editors and CCConfigPersister replace the file with a rename which would drop a watch on the file.
+*	Elsewhere the file's modification time and size are polled.
+*
+*	Changes are settled for a short window before the callback so an editor writing in several
+*	steps only causes one reload. The callback runs on the watcher thread.
+*/
+class CCConfigWatcher
+{
+public:
+	typedef std::function<void()> ChangeCallback;
+
+private:
+	std::string			_filePath;
+	ChangeCallback		_onChange;
+	std::atomic<bool>	_shouldRun;
+	std::thread			_watchThread;
+
+	void WatchThread();
+	void PollThread();
+
+public:
+	CCConfigWatcher(ChangeCallback onChange);
+	~CCConfigWatcher();
+
+	// starts watching {filePath}, returns false if the watch could not be set up
+	bool Start(const std::string& filePath);
+	void Stop();
+
+	inline bool GetIsRunning()const { return _shouldRun; }
+};
+
+#endif
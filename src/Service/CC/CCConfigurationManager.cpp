@@ -1,22 +1,132 @@
 #include "CCConfigurationManager.h"
 #include "CCLogger.h"
+#include "CCConfigPersister.h"
+#include <atomic>
 #include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
 
 using namespace std;
 using namespace nlohmann;
 
-CCConfigurationManager::CCConfigurationManager() : _isLoaded(false)
+// CCConfigPath
+
+const std::string* CCConfigPath::InternKey(const std::string& key)
 {
+	// node based so pointers stay valid as keys are added, keys are never removed
+	static std::mutex keysMutex;
+	static std::unordered_set<std::string> keys;
+
+	std::lock_guard<std::mutex> lock(keysMutex);
+	return &*keys.insert(key).first;
 }
 
-CCConfigurationManager::CCConfigurationManager(string configFilePath) : _isLoaded(false)
+CCConfigPath::CCConfigPath(std::initializer_list<std::string> keys) : _resolvedManager(NULL), _resolvedGeneration(0), _resolvedNode(NULL)
+{
+	_keys.reserve(keys.size());
+	for (auto& key : keys)
+	{
+		_keys.push_back(InternKey(key));
+	}
+}
+
+CCConfigPath::CCConfigPath(const std::vector<std::string>& keys) : _resolvedManager(NULL), _resolvedGeneration(0), _resolvedNode(NULL)
+{
+	_keys.reserve(keys.size());
+	for (auto& key : keys)
+	{
+		_keys.push_back(InternKey(key));
+	}
+}
+
+CCConfigPath CCConfigPath::Append(const std::string& key)const
+{
+	CCConfigPath path(*this);
+	path._keys.push_back(InternKey(key));
+	path._resolvedManager = NULL;
+	path._resolvedNode = NULL;
+
+	return path;
+}
+
+// CCConfigurationManager
+
+CCConfigurationManager::CCConfigurationManager() : _isLoaded(false), _generation(NextGeneration())
+{
+}
+
+CCConfigurationManager::CCConfigurationManager(string configFilePath) : _isLoaded(false), _generation(NextGeneration())
 {
 	if (LoadFromFile(configFilePath) == false)
 	{
-		throw std::exception(("Failed to load from file " + configFilePath).c_str());
+		throw std::runtime_error(("Failed to load from file " + configFilePath).c_str());
 	}
 }
 
+uint64_t CCConfigurationManager::NextGeneration()
+{
+	// 0 is never handed out, it is the generation of a path that was never resolved
+	static std::atomic<uint64_t> generation(1);
+	return generation++;
+}
+
+json* CCConfigurationManager::Resolve(const CCConfigPath& path)const
+{
+	if (path._resolvedManager == this && path._resolvedGeneration == _generation)
+		return path._resolvedNode;
+
+	// the cache hands out mutable nodes for SetValue, the const walk is only to keep Resolve usable from GetValue
+	json* node = const_cast<json*>(&_jsonData);
+
+	for (auto key : path._keys)
+	{
+		if (node->is_object() == false)
+			return NULL;
+
+		auto itr = node->find(*key);
+		if (itr == node->end())
+			return NULL;
+
+		node = &*itr;
+	}
+
+	path._resolvedManager = this;
+	path._resolvedGeneration = _generation;
+	path._resolvedNode = node;
+
+	return node;
+}
+
+json& CCConfigurationManager::ResolveOrCreate(const CCConfigPath& path)
+{
+	json* node = Resolve(path);
+	if (node)
+		return *node;
+
+	node = &_jsonData;
+
+	for (auto key : path._keys)
+	{
+		// a value in the way is replaced by an object, anything cached below it is gone
+		if (node->is_object() == false)
+		{
+			if (node->is_null() == false)
+				_generation = NextGeneration();
+
+			*node = json::object();
+		}
+
+		node = &(*node)[*key];
+	}
+
+	path._resolvedManager = this;
+	path._resolvedGeneration = _generation;
+	path._resolvedNode = node;
+
+	return *node;
+}
+
 bool CCConfigurationManager::LoadFromFile(string filePath)
 {
 	ifstream inFile(filePath);
@@ -25,6 +135,7 @@ bool CCConfigurationManager::LoadFromFile(string filePath)
 		try 
 		{
 			_jsonData = json::parse(inFile);
+			_generation = NextGeneration();
 
 			return true;
 		}
@@ -36,23 +147,31 @@ bool CCConfigurationManager::LoadFromFile(string filePath)
 	return false;
 }
 
-bool CCConfigurationManager::SaveToFile(string filePath)const
+bool CCConfigurationManager::LoadFromString(const string& contents)
 {
-	ofstream outFile(filePath);
-	if (outFile.good())
+	try
 	{
-		try
-		{
-			outFile.clear();
-			outFile << _jsonData;
-			outFile.close();
+		_jsonData = json::parse(contents);
+		_generation = NextGeneration();
 
-			return true;
-		}
-		catch (const exception& e)
-		{
-			LOG_ERROR << "Error writing to file " << e.what() << endl;
-		}
+		return true;
+	}
+	catch (const exception& e)
+	{
+		LOG_ERROR << "Error Parsing json: " << e.what() << endl;
+	}
+	return false;
+}
+
+bool CCConfigurationManager::SaveToFile(string filePath)const
+{
+	try
+	{
+		return CCConfigPersister::WriteFileAtomic(filePath, _jsonData.dump());
+	}
+	catch (const exception& e)
+	{
+		LOG_ERROR << "Error writing to file " << e.what() << endl;
 	}
 	return false;
 }
@@ -5,6 +5,9 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <stdint.h>
+
+#include "CCConfigPath.h"
 
 class CCConfigurationManager
 {
@@ -13,57 +16,56 @@ private:
 	bool			_isLoaded;
 
 	nlohmann::json  _jsonData;
+	uint64_t		_generation; // replaced whenever cached CCConfigPath nodes may be invalid, see NextGeneration
+
+	// returns the node at {path} or NULL, walks by reference and caches the result in {path}
+	nlohmann::json* Resolve(const CCConfigPath& path)const;
+	// like Resolve but creates missing objects along the way
+	nlohmann::json& ResolveOrCreate(const CCConfigPath& path);
+
+	// generations come from one process wide counter, a manager allocated where a destroyed one was
+	// can never match a path the old one cached
+	static uint64_t NextGeneration();
 
 public:
 	CCConfigurationManager();
 	CCConfigurationManager(std::string configFilePath);
 
 	template<typename t>
-	bool GetValue(std::vector<std::string> keys, t& outValue)const
+	bool GetValue(const CCConfigPath& path, t& outValue)const
 	{
-		nlohmann::json currentObj = _jsonData;
+		const nlohmann::json* node = Resolve(path);
+		if (node == NULL)
+			return false;
 
-		for (auto key : keys)
-		{
-			if (currentObj.contains(key))
-			{
-				currentObj = currentObj[key];
-			}
-			else return false;
-		}
-
-		outValue = currentObj.get<t>();
+		node->get_to(outValue);
 
 		return true;
 	}
 
 	template<typename t>
-	bool SetValue(std::vector<std::string> keys, const t& value)
+	bool SetValue(const CCConfigPath& path, const t& value)
 	{
-		std::string lastKey = *(keys.end() - 1);
-		nlohmann::json* currentObj = &_jsonData;
+		nlohmann::json& node = ResolveOrCreate(path);
 
-		for (auto key : keys)
+		// replacing an object or array frees its children, paths below this one must resolve again
+		if (node.is_structured())
 		{
-			if (key == lastKey)break;
-			if (currentObj->contains(key))
-			{
-				currentObj = &(*currentObj)[key];
-			}
-			else
-			{
-				(*currentObj)[key] = nlohmann::json();
-				currentObj = &(*currentObj)[key];
-			}
+			_generation = NextGeneration();
+			path._resolvedGeneration = _generation;
 		}
 
-		(*currentObj)[lastKey] = value;
+		node = value;
 
 		return true;
 	}
 
+	inline uint64_t GetGeneration()const { return _generation; }
+	inline const nlohmann::json& GetDocument()const { return _jsonData; }
+
 	bool LoadFromFile(std::string filePath);
+	bool LoadFromString(const std::string& contents);
 	bool SaveToFile(std::string filePath)const;
 };
 
-#endif
\ No newline at end of file
+#endif
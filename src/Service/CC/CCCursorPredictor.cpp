@@ -0,0 +1,50 @@
+#include "CCCursorPredictor.h"
+
+#include <algorithm>
+
+// how much each move counts towards the velocity
+#define CC_PREDICTION_WEIGHT 0.3
+// moves delivered together would look infinitely fast
+#define CC_PREDICTION_MIN_INTERVAL_US 1000
+
+CCCursorPredictor::CCCursorPredictor() : _velocityX(0), _velocityY(0), _lastMoveAt(0)
+{
+}
+
+void CCCursorPredictor::AddMove(int deltaX, int deltaY, int64_t now)
+{
+	int64_t interval = now - _lastMoveAt;
+	bool wasStopped = _lastMoveAt == 0 || interval >= CC_PREDICTION_STALE_MS * 1000;
+
+	_lastMoveAt = now;
+
+	// the first move after a pause says nothing about how fast the cursor goes
+	if (wasStopped)
+	{
+		_velocityX = 0;
+		_velocityY = 0;
+		return;
+	}
+
+	double seconds = std::max<int64_t>(interval, CC_PREDICTION_MIN_INTERVAL_US) / 1000000.0;
+
+	_velocityX += (deltaX / seconds - _velocityX) * CC_PREDICTION_WEIGHT;
+	_velocityY += (deltaY / seconds - _velocityY) * CC_PREDICTION_WEIGHT;
+}
+
+Point CCCursorPredictor::Predict(const Point& position, int64_t now, int64_t horizonUs)const
+{
+	if (_lastMoveAt == 0 || now - _lastMoveAt >= CC_PREDICTION_STALE_MS * 1000)
+		return position;
+
+	double seconds = horizonUs / 1000000.0;
+
+	return Point(position.x + (int)(_velocityX * seconds), position.y + (int)(_velocityY * seconds));
+}
+
+void CCCursorPredictor::Reset()
+{
+	_velocityX = 0;
+	_velocityY = 0;
+	_lastMoveAt = 0;
+}
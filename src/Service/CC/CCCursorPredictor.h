@@ -0,0 +1,39 @@
+#ifndef CC_CURSOR_PREDICTOR_H
+#define CC_CURSOR_PREDICTOR_H
+
+#include <stdint.h>
+
+#include "BasicTypes.h"
+
+/*
+*	CCCursorPredictor estimates the cursor's velocity from the mouse moves CCMain routes, so it can
+*	tell which jump zone the cursor is heading for before it gets there. The velocity is an
+*	exponentially weighted average of each move's delta over the time since the one before it,
+*	a cursor that hasn't moved for CC_PREDICTION_STALE_MS is treated as stopped.
+*
+*	Only used from the thread delivering input.
+*/
+
+#define CC_PREDICTION_STALE_MS 100
+
+class CCCursorPredictor
+{
+private:
+	// pixels per second
+	double	_velocityX;
+	double	_velocityY;
+	int64_t	_lastMoveAt; // CCLatencyNow(), 0 before the first move
+
+public:
+	CCCursorPredictor();
+
+	// the cursor moved by {deltaX}, {deltaY} at {now}
+	void AddMove(int deltaX, int deltaY, int64_t now);
+	// where the cursor at {position} will be {horizonUs} after {now} if it keeps going,
+	// {position} if it stopped
+	Point Predict(const Point& position, int64_t now, int64_t horizonUs)const;
+
+	void Reset();
+};
+
+#endif
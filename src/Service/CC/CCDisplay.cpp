@@ -34,3 +34,24 @@ void CCDisplay::SetOffsets(int offsetX, int offsetY)
     _bounds.topLeft = {_display.posX + offsetX, _display.posY + offsetY};
     _bounds.bottomRight = { _bounds.topLeft.x + _display.width, _bounds.topLeft.y + _display.height };
 }
+
+uint64_t CCDisplay::HashNativeDisplays(const std::vector<NativeDisplay>& displays)
+{
+    // FNV-1a over the fields, they are ints on every platform we build for
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const NativeDisplay& display : displays)
+    {
+        for (int value : { display.nativeScreenID, display.posX, display.posY, display.width, display.height })
+        {
+            uint32_t bits = (uint32_t)value;
+            for (int i = 0; i < 4; i++)
+            {
+                hash ^= (bits >> (i * 8)) & 0xff;
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+
+    return hash;
+}
@@ -4,6 +4,9 @@
 #include "BasicTypes.h"
 #include "../OSInterface/OSTypes.h"
 
+#include <stdint.h>
+#include <vector>
+
 struct NativeDisplay;
 class CCDisplay
 {
@@ -35,6 +38,10 @@ public:
     // Getter fir Assigned ID. Can be used to id displays server side
     const unsigned int GetAssignedID()const { return _assignedID; }
 
+    // a hash of everything a client tells the server about {displays}, in order,
+    // the same on both ends so a resumed session can tell if the displays changed
+    static uint64_t HashNativeDisplays(const std::vector<NativeDisplay>& displays);
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,454 @@
+#include "CCExecutor.h"
+#include "CCLogger.h"
+
+#include <exception>
+
+// a serial queue gives its worker back after this many tasks so a busy queue can't starve the pool
+#define CC_SERIAL_QUEUE_BATCH 32
+// a timer whose task the pool rejected is tried again this much later
+#define CC_EXECUTOR_TIMER_RETRY_MS 10
+
+static thread_local CCExecutor* t_executor = 0;
+static thread_local size_t t_workerIndex = 0;
+
+// CCTaskStats
+
+CCTaskStats::CCTaskStats() : _executed(0), _rejected(0), _totalLatencyUs(0), _maxLatencyUs(0)
+{
+}
+
+void CCTaskStats::RecordStart(CCExecutorClock::time_point enqueued)
+{
+	uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(CCExecutorClock::now() - enqueued).count();
+
+	_executed++;
+	_totalLatencyUs += latency;
+
+	uint64_t max = _maxLatencyUs.load();
+	while (latency > max && _maxLatencyUs.compare_exchange_weak(max, latency) == false);
+}
+
+void CCTaskStats::RecordRejected()
+{
+	_rejected++;
+}
+
+void CCTaskStats::Fill(CCExecutorMetrics& metrics)const
+{
+	metrics.tasksExecuted = _executed;
+	metrics.tasksRejected = _rejected;
+	metrics.averageLatencyUs = metrics.tasksExecuted ? _totalLatencyUs / metrics.tasksExecuted : 0;
+	metrics.maxLatencyUs = _maxLatencyUs;
+}
+
+// CCSerialQueue
+
+CCSerialQueue::CCSerialQueue(CCExecutor* executor, const std::string& name, size_t maxDepth) : _executor(executor), _name(name), \
+_maxDepth(maxDepth), _isScheduled(false), _isRunningTask(false), _isClosed(false)
+{
+}
+
+bool CCSerialQueue::Submit(CCTask task)
+{
+	bool shouldSchedule = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_isClosed || (_maxDepth && _tasks.size() >= _maxDepth))
+		{
+			_stats.RecordRejected();
+			return false;
+		}
+
+		_tasks.push_back({ std::move(task), CCExecutorClock::now() });
+
+		if (_isScheduled == false)
+		{
+			_isScheduled = true;
+			shouldSchedule = true;
+		}
+	}
+
+	if (shouldSchedule)
+		Schedule(false);
+
+	return true;
+}
+
+void CCSerialQueue::Schedule(bool isYielding)
+{
+	std::shared_ptr<CCSerialQueue> self = shared_from_this();
+	CCTask drain = [self]() { self->Drain(); };
+
+	if (_executor->Enqueue(drain, isYielding) == false)
+	{
+		// the pool is full or stopped, the next submit tries again
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isScheduled = false;
+		_idleCondition.notify_all();
+	}
+}
+
+void CCSerialQueue::Drain()
+{
+	for (int i = 0; i < CC_SERIAL_QUEUE_BATCH; i++)
+	{
+		Entry entry;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (_tasks.empty())
+			{
+				_isScheduled = false;
+				_idleCondition.notify_all();
+				return;
+			}
+
+			entry = std::move(_tasks.front());
+			_tasks.pop_front();
+
+			_isRunningTask = true;
+			_runningThread = std::this_thread::get_id();
+		}
+
+		_stats.RecordStart(entry.enqueued);
+		CCExecutor::RunTask(entry.task, _name);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_isRunningTask = false;
+			_runningThread = std::thread::id();
+		}
+		_idleCondition.notify_all();
+	}
+
+	// still busy, the worker's other tasks run first and an idle worker can steal the rest
+	Schedule(true);
+}
+
+void CCSerialQueue::Close()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	_isClosed = true;
+	_tasks.clear();
+
+	// a task closing its own queue can't wait for itself
+	if (_runningThread == std::this_thread::get_id())
+		return;
+
+	_idleCondition.wait(lock, [this]() { return _isRunningTask == false; });
+}
+
+CCExecutorMetrics CCSerialQueue::GetMetrics()
+{
+	CCExecutorMetrics metrics;
+	metrics.name = _name;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		metrics.queueDepth = _tasks.size();
+	}
+	_stats.Fill(metrics);
+
+	return metrics;
+}
+
+// CCExecutor
+
+CCExecutor::CCExecutor(size_t workerCount, size_t maxPendingTasks) : _nextWorker(0), _pendingTasks(0), \
+_maxPendingTasks(maxPendingTasks), _isRunning(true)
+{
+	if (workerCount == 0)
+		workerCount = 1;
+
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		_workers.push_back(std::make_unique<Worker>());
+	}
+
+	// started after the vector is complete, workers steal from each other
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		_workers[i]->thread = std::thread(&CCExecutor::WorkerThread, this, i);
+	}
+
+	_timerThread = std::thread(&CCExecutor::TimerThread, this);
+}
+
+CCExecutor::~CCExecutor()
+{
+	Shutdown();
+}
+
+CCExecutor& CCExecutor::SharedExecutor()
+{
+	static CCExecutor executor([]() {
+		// leave room for the threads that block on sockets, but always allow a task to run
+		// while another one waits
+		size_t count = std::thread::hardware_concurrency();
+		if (count < 2)
+			count = 2;
+		if (count > 8)
+			count = 8;
+		return count;
+	}());
+
+	return executor;
+}
+
+bool CCExecutor::Submit(CCTask task)
+{
+	return Enqueue(task, false);
+}
+
+bool CCExecutor::Enqueue(CCTask& task, bool isYielding)
+{
+	// the slot is taken before the task can be seen, a worker may pop it before we return
+	bool isAccepted = false;
+	if (_isRunning)
+	{
+		isAccepted = _pendingTasks.fetch_add(1) < _maxPendingTasks;
+		if (isAccepted == false)
+			_pendingTasks--;
+	}
+
+	if (isAccepted == false)
+	{
+		LOG_ERROR << "Executor rejected a task, " << _pendingTasks << " tasks waiting" << std::endl;
+		_stats.RecordRejected();
+		return false;
+	}
+
+	// tasks submitted by a task stay on the same worker, others are spread out
+	bool isWorker = t_executor == this;
+	size_t index = isWorker ? t_workerIndex : _nextWorker++ % _workers.size();
+	{
+		Worker& worker = *_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+
+		if (isWorker && isYielding)
+			worker.tasks.push_front({ std::move(task), CCExecutorClock::now() });
+		else
+			worker.tasks.push_back({ std::move(task), CCExecutorClock::now() });
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_sleepCondition.notify_one();
+
+	return true;
+}
+
+bool CCExecutor::SubmitAfter(std::chrono::milliseconds delay, CCTask task)
+{
+	return SubmitAt(CCExecutorClock::now() + delay, std::move(task));
+}
+
+bool CCExecutor::SubmitAt(CCExecutorClock::time_point at, CCTask task)
+{
+	if (_isRunning == false)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(_timerMutex);
+		_timers.insert(std::make_pair(at, std::move(task)));
+	}
+	_timerCondition.notify_one();
+
+	return true;
+}
+
+bool CCExecutor::PopTask(size_t index, Entry& entry)
+{
+	{
+		Worker& worker = *_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (worker.tasks.empty() == false)
+		{
+			entry = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			_pendingTasks--;
+			return true;
+		}
+	}
+
+	// steal the oldest task of another worker
+	for (size_t i = 1; i < _workers.size(); i++)
+	{
+		Worker& victim = *_workers[(index + i) % _workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.tasks.empty() == false)
+		{
+			entry = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			_pendingTasks--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CCExecutor::RunTask(const CCTask& task, const std::string& queueName)
+{
+	try
+	{
+		task();
+	}
+	catch (std::exception& e)
+	{
+		LOG_ERROR << "Task on " << queueName << " threw: " << e.what() << std::endl;
+	}
+}
+
+void CCExecutor::Run(Entry& entry)
+{
+	_stats.RecordStart(entry.enqueued);
+	RunTask(entry.task, "executor");
+}
+
+void CCExecutor::WorkerThread(size_t index)
+{
+	t_executor = this;
+	t_workerIndex = index;
+
+	while (_isRunning)
+	{
+		Entry entry;
+		if (PopTask(index, entry))
+		{
+			Run(entry);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_sleepCondition.wait(lock, [this]() { return _pendingTasks > 0 || _isRunning == false; });
+	}
+}
+
+void CCExecutor::TimerThread()
+{
+	std::unique_lock<std::mutex> lock(_timerMutex);
+
+	while (_isRunning)
+	{
+		if (_timers.empty())
+		{
+			_timerCondition.wait(lock);
+			continue;
+		}
+
+		auto next = _timers.begin();
+		if (next->first > CCExecutorClock::now())
+		{
+			_timerCondition.wait_until(lock, next->first);
+			continue;
+		}
+
+		CCTask task = std::move(next->second);
+		_timers.erase(next);
+
+		lock.unlock();
+		bool isSubmitted = Enqueue(task, false);
+		lock.lock();
+
+		// dropping it would end whatever chain of timers it belongs to, i.e. an entity's heartbeats
+		if (isSubmitted == false && _isRunning)
+		{
+			LOG_ERROR << "Retrying a timer in " << CC_EXECUTOR_TIMER_RETRY_MS << "ms" << std::endl;
+			_timers.insert(std::make_pair(CCExecutorClock::now() + std::chrono::milliseconds(CC_EXECUTOR_TIMER_RETRY_MS), std::move(task)));
+		}
+	}
+}
+
+std::shared_ptr<CCSerialQueue> CCExecutor::GetQueue(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(_queuesMutex);
+
+	std::shared_ptr<CCSerialQueue>& queue = _namedQueues[name];
+	if (queue.get() == 0)
+	{
+		queue = std::make_shared<CCSerialQueue>(this, name, 0);
+		_queues.push_back(queue);
+	}
+
+	return queue;
+}
+
+std::shared_ptr<CCSerialQueue> CCExecutor::MakeQueue(const std::string& name, size_t maxDepth)
+{
+	std::shared_ptr<CCSerialQueue> queue = std::make_shared<CCSerialQueue>(this, name, maxDepth);
+
+	std::lock_guard<std::mutex> lock(_queuesMutex);
+	_queues.push_back(queue);
+
+	return queue;
+}
+
+void CCExecutor::Shutdown()
+{
+	if (_isRunning.exchange(false) == false)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_sleepCondition.notify_all();
+	{
+		std::lock_guard<std::mutex> lock(_timerMutex);
+	}
+	_timerCondition.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		if (worker->thread.joinable())
+			worker->thread.join();
+	}
+
+	if (_timerThread.joinable())
+		_timerThread.join();
+
+	for (auto& worker : _workers)
+	{
+		_pendingTasks -= worker->tasks.size();
+		worker->tasks.clear();
+	}
+
+	_timers.clear();
+}
+
+std::vector<CCExecutorMetrics> CCExecutor::GetMetrics()
+{
+	std::vector<CCExecutorMetrics> metrics;
+
+	CCExecutorMetrics poolMetrics;
+	poolMetrics.name = "executor";
+	poolMetrics.queueDepth = _pendingTasks;
+	_stats.Fill(poolMetrics);
+	metrics.push_back(poolMetrics);
+
+	std::vector<std::shared_ptr<CCSerialQueue>> queues;
+	{
+		std::lock_guard<std::mutex> lock(_queuesMutex);
+		for (auto itr = _queues.begin(); itr != _queues.end();)
+		{
+			std::shared_ptr<CCSerialQueue> queue = itr->lock();
+			if (queue.get() == 0)
+			{
+				itr = _queues.erase(itr);
+				continue;
+			}
+
+			queues.push_back(queue);
+			itr++;
+		}
+	}
+
+	for (auto& queue : queues)
+	{
+		metrics.push_back(queue->GetMetrics());
+	}
+
+	return metrics;
+}
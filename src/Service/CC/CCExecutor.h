@@ -0,0 +1,177 @@
+#ifndef CC_EXECUTOR_H
+#define CC_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+typedef std::function<void()> CCTask;
+typedef std::chrono::steady_clock CCExecutorClock;
+
+struct CCExecutorMetrics
+{
+	std::string	name;
+	size_t		queueDepth; // tasks waiting to start
+	uint64_t	tasksExecuted;
+	uint64_t	tasksRejected;
+	uint64_t	averageLatencyUs; // enqueue to start
+	uint64_t	maxLatencyUs;
+};
+
+// counters shared by the pool and the serial queues
+class CCTaskStats
+{
+private:
+	std::atomic<uint64_t>	_executed;
+	std::atomic<uint64_t>	_rejected;
+	std::atomic<uint64_t>	_totalLatencyUs;
+	std::atomic<uint64_t>	_maxLatencyUs;
+
+public:
+	CCTaskStats();
+
+	void RecordStart(CCExecutorClock::time_point enqueued);
+	void RecordRejected();
+
+	void Fill(CCExecutorMetrics& metrics)const;
+};
+
+class CCExecutor;
+
+/*
+*	A CCSerialQueue runs its tasks one at a time in the order they were submitted, on whichever
+*	worker of the executor is free. It only holds a worker while it has tasks, so any number of
+*	queues can share a small pool.
+*/
+class CCSerialQueue : public std::enable_shared_from_this<CCSerialQueue>
+{
+	friend class CCExecutor;
+private:
+	struct Entry
+	{
+		CCTask						task;
+		CCExecutorClock::time_point	enqueued;
+	};
+
+	CCExecutor*				_executor;
+	std::string				_name;
+	size_t					_maxDepth; // 0 is unbounded
+
+	std::mutex				_mutex;
+	std::condition_variable	_idleCondition;
+	std::deque<Entry>		_tasks;
+	bool					_isScheduled; // a drain is waiting in or running on the pool
+	bool					_isRunningTask;
+	bool					_isClosed;
+	std::thread::id			_runningThread;
+
+	CCTaskStats				_stats;
+
+	// {isYielding} if the drain ran a full batch and gives its worker to the worker's other tasks first
+	void Schedule(bool isYielding);
+	void Drain();
+
+public:
+	CCSerialQueue(CCExecutor* executor, const std::string& name, size_t maxDepth);
+
+	// returns false if the queue is closed or full
+	bool Submit(CCTask task);
+	// drops the waiting tasks and waits for the running one, later submits are rejected
+	void Close();
+
+	CCExecutorMetrics GetMetrics();
+	inline const std::string& GetName()const { return _name; }
+};
+
+/*
+*	CCExecutor is a fixed size pool of workers shared by the whole service, short tasks are submitted
+*	to it instead of spawning a thread for each one.
+*
+*	Every worker has its own deque. A task submitted from a worker goes on that worker's deque and
+*	is popped from the back, tasks from other threads are spread round robin. A worker that runs out
+*	steals from the front of the others. The number of waiting tasks is bounded, Submit fails once
+*	it is reached.
+*/
+class CCExecutor
+{
+	friend class CCSerialQueue;
+private:
+	struct Entry
+	{
+		CCTask						task;
+		CCExecutorClock::time_point	enqueued;
+	};
+
+	struct Worker
+	{
+		std::mutex			mutex;
+		std::deque<Entry>	tasks;
+		std::thread			thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>>	_workers;
+	std::atomic<size_t>						_nextWorker;
+	std::atomic<size_t>						_pendingTasks;
+	size_t									_maxPendingTasks;
+	std::atomic<bool>						_isRunning;
+
+	std::mutex								_sleepMutex;
+	std::condition_variable					_sleepCondition;
+
+	std::mutex										_timerMutex;
+	std::condition_variable							_timerCondition;
+	std::multimap<CCExecutorClock::time_point, CCTask>	_timers;
+	std::thread										_timerThread;
+
+	std::mutex										_queuesMutex;
+	std::map<std::string, std::shared_ptr<CCSerialQueue>>	_namedQueues;
+	std::vector<std::weak_ptr<CCSerialQueue>>		_queues;
+
+	CCTaskStats								_stats;
+
+	void WorkerThread(size_t index);
+	void TimerThread();
+	// Submit, but {task} is only moved from if it was accepted. From a worker {isYielding} puts it
+	// at the front of the worker's deque, behind its other tasks and first to be stolen
+	bool Enqueue(CCTask& task, bool isYielding);
+	bool PopTask(size_t index, Entry& entry);
+	void Run(Entry& entry);
+
+	static void RunTask(const CCTask& task, const std::string& queueName);
+
+public:
+	CCExecutor(size_t workerCount, size_t maxPendingTasks = 4096);
+	~CCExecutor();
+
+	static CCExecutor& SharedExecutor();
+
+	// returns false if the executor is stopped or too many tasks are waiting
+	bool Submit(CCTask task);
+	// submits {task} once {delay} has passed
+	bool SubmitAfter(std::chrono::milliseconds delay, CCTask task);
+	// submits {task} at {at}, tasks due at the same time point are submitted on one wake up of the timer
+	bool SubmitAt(CCExecutorClock::time_point at, CCTask task);
+
+	// returns the queue called {name}, creating it on first use
+	std::shared_ptr<CCSerialQueue> GetQueue(const std::string& name);
+	// creates a queue owned by the caller, it is only listed in the metrics while it is alive
+	std::shared_ptr<CCSerialQueue> MakeQueue(const std::string& name, size_t maxDepth = 0);
+
+	// stops the workers and the timer, waiting tasks are dropped
+	void Shutdown();
+
+	// the pool first, then every live queue
+	std::vector<CCExecutorMetrics> GetMetrics();
+	inline size_t GetWorkerCount()const { return _workers.size(); }
+};
+
+#endif
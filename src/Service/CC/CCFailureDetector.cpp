@@ -0,0 +1,95 @@
+#include "CCFailureDetector.h"
+#include "CCConfigurationManager.h"
+#include "CCLatencyTrace.h"
+
+#include <algorithm>
+
+CCFailureDetector::CCFailureDetector() : _smoothedRTT(0), _rttVariance(0), _lastHeardAt(0), _isSuspect(false), _misses(0), \
+_probeIntervalPath({ "FailureDetector", "probeIntervalMs" }), _minTimeoutPath({ "FailureDetector", "minTimeoutMs" }), \
+_maxTimeoutPath({ "FailureDetector", "maxTimeoutMs" }), _reconnectWindowPath({ "FailureDetector", "reconnectWindowMs" }), \
+_suspectAfterMissesPath({ "FailureDetector", "suspectAfterMisses" })
+{
+}
+
+void CCFailureDetector::Heard(int64_t now, int64_t rtt)
+{
+	_lastHeardAt.store(now, std::memory_order_relaxed);
+	_isSuspect.store(false, std::memory_order_relaxed);
+	_misses.store(0, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_smoothedRTT == 0)
+	{
+		_smoothedRTT = std::max<int64_t>(rtt, 1);
+		_rttVariance = rtt / 2;
+		return;
+	}
+
+	// alpha 1/8, beta 1/4
+	int64_t error = rtt - _smoothedRTT;
+	_rttVariance += ((error < 0 ? -error : error) - _rttVariance) / 4;
+	_smoothedRTT = std::max<int64_t>(_smoothedRTT + error / 8, 1);
+}
+
+bool CCFailureDetector::Missed()
+{
+	uint32_t misses = _misses.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	return misses >= _config.suspectAfterMisses;
+}
+
+bool CCFailureDetector::ShouldProbe(int64_t now)
+{
+	if (_isSuspect.load(std::memory_order_relaxed))
+		return true;
+
+	return now - _lastHeardAt.load(std::memory_order_relaxed) >= (int64_t)GetProbeIntervalMs() * 1000;
+}
+
+uint32_t CCFailureDetector::GetTimeoutMs()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	int64_t timeoutUs = _smoothedRTT + 4 * _rttVariance;
+	uint32_t timeoutMs = (uint32_t)((timeoutUs + 999) / 1000);
+
+	return std::min(std::max(timeoutMs, _config.minTimeoutMs), std::max(_config.maxTimeoutMs, _config.minTimeoutMs));
+}
+
+int64_t CCFailureDetector::GetSmoothedRTT()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _smoothedRTT;
+}
+
+uint32_t CCFailureDetector::GetProbeIntervalMs()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _config.probeIntervalMs;
+}
+
+uint32_t CCFailureDetector::GetReconnectWindowMs()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _config.reconnectWindowMs;
+}
+
+void CCFailureDetector::LoadFrom(const CCConfigurationManager& manager)
+{
+	CCFailureDetectorConfig config;
+
+	manager.GetValue(_probeIntervalPath, config.probeIntervalMs);
+	manager.GetValue(_minTimeoutPath, config.minTimeoutMs);
+	manager.GetValue(_maxTimeoutPath, config.maxTimeoutMs);
+	manager.GetValue(_reconnectWindowPath, config.reconnectWindowMs);
+	manager.GetValue(_suspectAfterMissesPath, config.suspectAfterMisses);
+
+	// a probe interval of 0 would probe on every executor tick
+	config.probeIntervalMs = std::max<uint32_t>(config.probeIntervalMs, 10);
+	config.suspectAfterMisses = std::max<uint32_t>(config.suspectAfterMisses, 1);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_config = config;
+}
@@ -0,0 +1,90 @@
+#ifndef CC_FAILURE_DETECTOR_H
+#define CC_FAILURE_DETECTOR_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#include "CCConfigPath.h"
+
+class CCConfigurationManager;
+
+/*
+*	CCFailureDetector decides how long an entity may stay quiet before it is given up on. Every awk
+*	(event, RPC or probe) counts as hearing from the entity and is an RTT sample. A connection that
+*	has been quiet for probeIntervalMs is probed with a heartbeat, while events are flowing their awks
+*	prove the entity is there and no probe is sent.
+*
+*	Probes and event awks wait at most GetTimeoutMs(), the smoothed RTT plus four deviations (like a
+*	tcp retransmission timeout) clamped to [minTimeoutMs, maxTimeoutMs]. An event awk that is late is
+*	a miss, the connection is kept and the awk is read before the next one. Only suspectAfterMisses
+*	misses in a row mark the entity as suspect, so a jitter spike doesn't, the next probe then decides. A failed probe starts reconnecting
+*	(see CCNetworkEntity::Heartbeat), the entity is only lost once it couldn't be reached again for
+*	reconnectWindowMs.
+*
+*	Configured in the "FailureDetector" object of the config file, changes apply on reload.
+*/
+
+#define CC_FAILURE_PROBE_INTERVAL_MS 100
+#define CC_FAILURE_MIN_TIMEOUT_MS 150
+#define CC_FAILURE_MAX_TIMEOUT_MS 2000
+#define CC_FAILURE_RECONNECT_WINDOW_MS 2000
+#define CC_FAILURE_SUSPECT_AFTER_MISSES 3
+
+struct CCFailureDetectorConfig
+{
+	uint32_t	probeIntervalMs;
+	uint32_t	minTimeoutMs;
+	uint32_t	maxTimeoutMs;
+	uint32_t	reconnectWindowMs;
+	uint32_t	suspectAfterMisses;
+
+	CCFailureDetectorConfig() : probeIntervalMs(CC_FAILURE_PROBE_INTERVAL_MS), minTimeoutMs(CC_FAILURE_MIN_TIMEOUT_MS), \
+		maxTimeoutMs(CC_FAILURE_MAX_TIMEOUT_MS), reconnectWindowMs(CC_FAILURE_RECONNECT_WINDOW_MS), \
+		suspectAfterMisses(CC_FAILURE_SUSPECT_AFTER_MISSES)
+	{}
+};
+
+class CCFailureDetector
+{
+private:
+	std::mutex				_mutex;
+	CCFailureDetectorConfig	_config;
+
+	// RFC 6298 estimates in microseconds, 0 until the first sample
+	int64_t					_smoothedRTT;
+	int64_t					_rttVariance;
+
+	std::atomic<int64_t>	_lastHeardAt; // CCLatencyNow(), 0 so the first heartbeat always probes
+	std::atomic<bool>		_isSuspect;
+	std::atomic<uint32_t>	_misses; // late event awks in a row
+
+	CCConfigPath			_probeIntervalPath;
+	CCConfigPath			_minTimeoutPath;
+	CCConfigPath			_maxTimeoutPath;
+	CCConfigPath			_reconnectWindowPath;
+	CCConfigPath			_suspectAfterMissesPath;
+
+public:
+	CCFailureDetector();
+
+	// an awk came back {rtt} us after its request was sent, at {now}
+	void Heard(int64_t now, int64_t rtt);
+	// an event wasn't awked in time, returns true once that happened often enough in a row that the
+	// entity should be suspected. The caller calls Suspect then
+	bool Missed();
+	// the connection failed, probe before sending to the entity again
+	inline void Suspect() { _isSuspect.store(true, std::memory_order_relaxed); }
+	// the connection was quiet long enough, or the entity is suspect
+	bool ShouldProbe(int64_t now);
+
+	uint32_t GetTimeoutMs();
+	int64_t GetSmoothedRTT();
+	inline bool GetIsSuspect()const { return _isSuspect.load(std::memory_order_relaxed); }
+	uint32_t GetProbeIntervalMs();
+	uint32_t GetReconnectWindowMs();
+
+	void LoadFrom(const CCConfigurationManager& manager);
+};
+
+#endif
@@ -5,6 +5,9 @@
 #include "CCLogger.h"
 #include "CCDisplay.h"
 #include "CCNetworkEntity.h"
+#include "CCGuiFrameReader.h"
+#include "CCLatencyTrace.h"
+#include "CCTrace.h"
 
 #include "IGuiServiceInterface.h"
 
@@ -16,11 +19,16 @@
 #include <thread>
 
 #include <algorithm>
+#include <unordered_map>
 
 #ifdef _WIN32
 
 #define GUI_PROGRAM_PATH "bin/CCGui.exe"
 
+#else
+
+#define GUI_PROGRAM_PATH "bin/CCGui"
+
 #endif
 
 void CCGuiService::SocketAcceptThread()
@@ -35,90 +43,273 @@ void CCGuiService::SocketAcceptThread()
 			if (error == SocketError::SOCKET_E_BROKEN_PIPE)continue;
 			else break;
 		}
-	
-		auto workerThread = std::thread([acceptedSocket, this]() {
-			using namespace nlohmann;
 
-			json entites;
-			std::vector<json> entityJsons;
+		RemoveClosedSessions();
+
+		std::lock_guard<std::mutex> lock(_sessionsMutex);
+
+		// every session has a read thread, don't let a misbehaving gui open them without limit
+		if (_sessions.size() >= CC_GUI_MAX_SESSIONS)
+		{
+			LOG_ERROR << "Refusing GUI connection, " << _sessions.size() << " sessions already open" << std::endl;
+			delete acceptedSocket;
+			continue;
+		}
 
-			const std::vector<std::shared_ptr<CCNetworkEntity>>& entitesToConfigure = _delegate->GetEntitiesToConfigure();
-			const std::vector<int>& globalBounds = _delegate->GetGlobalBounds();
+		LOG_INFO << "GUI connected" << std::endl;
 
-			for (auto entity : entitesToConfigure)
+		// started under the lock so no delta can be queued before the snapshot
+		_sessions.push_back(std::make_unique<CCGuiSession>(acceptedSocket, this));
+		_sessions.back()->Start();
+	}
+}
+
+void CCGuiService::RemoveClosedSessions()
+{
+	std::vector<std::unique_ptr<CCGuiSession>> closed;
+	{
+		std::lock_guard<std::mutex> lock(_sessionsMutex);
+		for (auto itr = _sessions.begin(); itr != _sessions.end();)
+		{
+			if ((*itr)->GetIsOpen() == false)
 			{
-				json entityJson;
+				closed.push_back(std::move(*itr));
+				itr = _sessions.erase(itr);
+			}
+			else itr++;
+		}
+	}
 
-				entityJson["id"] = entity->GetID();
+	// joins the session threads outside the lock
+	closed.clear();
+}
 
-				std::vector<json> displays;
+nlohmann::json CCGuiService::EntityToJson(const CCNetworkEntity* entity)const
+{
+	using namespace nlohmann;
 
-				for (auto display : entity->GetAllDisplays())
-				{
-					json jDisplay;
-					const Rect& dBounds = display->GetCollision();
-					const NativeDisplay& nDisplay = display->GetNativeDisplay();
+	json entityJson;
+	entityJson["id"] = entity->GetID();
 
-					jDisplay["bounds"] = { dBounds.topLeft.x, dBounds.topLeft.y, nDisplay.width, nDisplay.height };
-					jDisplay["id"] = display->GetAssignedID();
+	json displays = json::array();
 
-					displays.push_back(jDisplay);
-				}
+	for (auto display : entity->GetAllDisplays())
+	{
+		json jDisplay;
+		const Rect& dBounds = display->GetCollision();
+		const NativeDisplay& nDisplay = display->GetNativeDisplay();
 
-				entityJson["displays"] = displays;
-				entityJsons.push_back(entityJson);
-			}
+		jDisplay["bounds"] = { dBounds.topLeft.x, dBounds.topLeft.y, nDisplay.width, nDisplay.height };
+		jDisplay["id"] = display->GetAssignedID();
 
-			entites["entites"] = entityJsons;
-			entites["globalBounds"] = globalBounds;
+		displays.push_back(std::move(jDisplay));
+	}
 
-			SocketError error = acceptedSocket->Send(entites.dump());
-			if (error != SocketError::SOCKET_E_SUCCESS)
-			{
-				LOG_ERROR << "Error sending json packet " << SOCK_ERR_STR(_serverSocket.get(), error) << std::endl;
-				return;
-			}
+	entityJson["displays"] = std::move(displays);
 
-			char buff[1024] = { 0 };
-			size_t received = 0;
-			error = acceptedSocket->Recv(buff, 1024, &received);
-			if (error != SocketError::SOCKET_E_SUCCESS)
-			{
-				LOG_ERROR << "Error receiving json packet " << SOCK_ERR_STR(_serverSocket.get(), error) << std::endl;
-				return;
-			}
+	return entityJson;
+}
 
-			// app was closed before we finished
-			if (received == 0)
-			{
-				// clearly we don't want to confiure to we just return success
-				return;
-			}
+std::string CCGuiService::BuildSnapshot()
+{
+	using namespace nlohmann;
 
-			json offsets = json::parse(buff);
+	json entites = json::array();
+	for (auto& entity : _delegate->GetEntitiesToConfigure())
+	{
+		entites.push_back(EntityToJson(entity.get()));
+	}
 
-			for (auto entity : entitesToConfigure)
-			{
-				auto itr = offsets.find(entity->GetID());
-				if (itr != offsets.end())
-				{
-					auto offset = itr.value();
-					entity->SetDisplayOffsets({ offset[0],offset[1] });
-				}
-			}
+	json snapshot;
+	snapshot["type"] = "snapshot";
+	snapshot["version"] = _version.load();
+	snapshot["entites"] = std::move(entites);
+	snapshot["globalBounds"] = _delegate->GetGlobalBounds();
 
-			delete acceptedSocket;
+	return snapshot.dump();
+}
+
+void CCGuiService::Broadcast(nlohmann::json& message)
+{
+	std::lock_guard<std::mutex> lock(_sessionsMutex);
+
+	if (_sessions.empty())
+		return;
 
-			_delegate->EntitiesFinishedConfiguration();
-		});
+	message["version"] = ++_version;
+	message["globalBounds"] = _delegate->GetGlobalBounds();
 
-		workerThread.detach();
+	std::string payload = message.dump();
+
+	for (auto& session : _sessions)
+	{
+		if (session->GetIsOpen())
+			session->Send(payload);
 	}
 }
 
+std::string CCGuiService::BuildLatencyReport(uint64_t withinUs, bool reset)
+{
+	using namespace nlohmann;
+
+	std::vector<CCLatencyHistogram> all((int)LatencyStage::COUNT);
+	json entities = json::object();
+
+	for (auto& entity : _delegate->GetEntitiesToConfigure())
+	{
+		if (entity->GetIsLocal())
+			continue;
+
+		CCLatencyTrace& trace = entity->GetLatencyTrace();
+		entities[entity->GetID()] = trace.ToJson(withinUs);
+		trace.AddStagesTo(all);
+
+		if (reset)
+			trace.Reset();
+	}
+
+	json report;
+	report["type"] = "latency";
+	report["entities"] = std::move(entities);
+	report["all"] = CCLatencyTrace::StagesToJson(all, withinUs);
+	report["withinUs"] = withinUs;
+
+	return report.dump();
+}
+
+void CCGuiService::HandleFrame(CCGuiSession* session, const char* data, size_t length)
+{
+	std::unordered_map<std::string, CCNetworkEntity*> entities;
+	for (auto& entity : _delegate->GetEntitiesToConfigure())
+	{
+		entities[entity->GetID()] = entity.get();
+	}
+
+	std::vector<CCNetworkEntity*> changed;
+
+	// offsets are applied while the frame is parsed, no document is built
+	CCGuiOffsetsSax sax([&entities, &changed](const std::string& entityID, const Point& offset) {
+		auto itr = entities.find(entityID);
+		if (itr == entities.end())
+			return;
+
+		CCNetworkEntity* entity = itr->second;
+		if (offset.x == entity->GetOffsets().x && offset.y == entity->GetOffsets().y)
+			return;
+
+		entity->SetDisplayOffsets(offset);
+		changed.push_back(entity);
+	});
+
+	bool parsed = nlohmann::json::sax_parse(data, data + length, &sax);
+
+	// a small request, it is fine to build the document
+	if (sax.type == "getLatency" && parsed)
+	{
+		nlohmann::json request = nlohmann::json::parse(data, data + length, nullptr, false);
+		uint64_t withinUs = request.value("withinUs", (uint64_t)0);
+		bool reset = request.value("reset", false);
+
+		session->Send(BuildLatencyReport(withinUs, reset));
+		return;
+	}
+
+	if (sax.type == "startTrace" || sax.type == "stopTrace")
+	{
+		nlohmann::json reply;
+		reply["type"] = "trace";
+
+		if (sax.type == "startTrace")
+		{
+			reply["enabled"] = CCTracer::tracer.Start();
+		}
+		else
+		{
+			CCTracer::tracer.Stop();
+			reply["enabled"] = false;
+			reply["trace"] = CCTracer::tracer.ToChromeTrace();
+		}
+
+		session->Send(reply.dump());
+		return;
+	}
+
+	if (sax.type != "setOffsets")
+	{
+		LOG_ERROR << "Unknown GUI message type {" << sax.type << "}" << std::endl;
+		return;
+	}
+
+	// whatever was applied before a parse error still has to reach the rest of the service
+	bool isFinal = sax.isFinal && parsed;
+
+	if (isFinal)
+	{
+		_delegate->EntitiesFinishedConfiguration();
+	}
+	else if (changed.empty() == false)
+	{
+		_delegate->EntityOffsetsChanged(changed);
+	}
+
+	// every session, including the one that sent this, sees the applied layout
+	OffsetsChanged(changed);
+}
+
+void CCGuiService::EntityJoined(const CCNetworkEntity* entity)
+{
+	nlohmann::json message;
+	message["type"] = "entityJoined";
+	message["entity"] = EntityToJson(entity);
+
+	Broadcast(message);
+}
+
+void CCGuiService::EntityLost(const std::string& entityID)
+{
+	nlohmann::json message;
+	message["type"] = "entityLost";
+	message["id"] = entityID;
+
+	Broadcast(message);
+}
+
+void CCGuiService::DisplaysChanged(const CCNetworkEntity* entity)
+{
+	nlohmann::json message;
+	message["type"] = "displayChanged";
+	message["entity"] = EntityToJson(entity);
+
+	Broadcast(message);
+}
+
+void CCGuiService::OffsetsChanged(const std::vector<CCNetworkEntity*>& entities)
+{
+	if (entities.empty())
+		return;
+
+	nlohmann::json entityJsons = nlohmann::json::array();
+	for (auto entity : entities)
+	{
+		entityJsons.push_back(EntityToJson(entity));
+	}
+
+	nlohmann::json message;
+	message["type"] = "offsetsChanged";
+	message["entites"] = std::move(entityJsons);
+
+	Broadcast(message);
+}
+
 CCGuiService::CCGuiService(IGuiServiceInterface* _delegate, int guiPort, std::string address) : _shouldRunServer(false), _delegate(_delegate), \
-_serverSocket(new Socket(address, guiPort, false, SocketProtocol::SOCKET_P_TCP)), _guiServerPort(guiPort), _guiServerAddress(address)
+_serverSocket(new Socket(address, guiPort, false, SocketProtocol::SOCKET_P_TCP)), _guiServerPort(guiPort), _guiServerAddress(address), \
+_version(0)
+{
+}
+
+CCGuiService::~CCGuiService()
 {
+	StopGUIServer();
 }
 
 bool CCGuiService::StartGUIServer()
@@ -147,8 +338,25 @@ bool CCGuiService::StartGUIServer()
 
 bool CCGuiService::StopGUIServer()
 {
-	_serverSocket->Disconnect();
 	_shouldRunServer = false;
+	_serverSocket->Disconnect();
+	// closing is what wakes a blocked Accept on every platform
+	_serverSocket->Close();
+
+	if (_serverSocketThread.joinable())
+		_serverSocketThread.join();
+
+	std::vector<std::unique_ptr<CCGuiSession>> sessions;
+	{
+		std::lock_guard<std::mutex> lock(_sessionsMutex);
+		sessions.swap(_sessions);
+	}
+
+	for (auto& session : sessions)
+	{
+		session->Close();
+	}
+
 	return false;
 }
 
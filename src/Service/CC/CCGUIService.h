@@ -1,13 +1,25 @@
 #ifndef CC_GUI_INTERFACE_H
 #define CC_GUI_INTERFACE_H
 
+#include <nlohmann/json.hpp>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <thread>
 
+#include "CCGuiSession.h"
+
 class Socket;
+class CCNetworkEntity;
 class IGuiServiceInterface;
+
+/*
+*	CCGuiService keeps a long lived session per connected GUI (see CCGuiSession.h for the protocol).
+*	A session starts with a snapshot and then receives a versioned delta for every change, so the
+*	editor stays live and nothing is rebuilt per connection.
+*/
 class CCGuiService
 {
 private:
@@ -20,16 +32,40 @@ private:
 
 	int						_guiServerPort;
 	std::string				_guiServerAddress;
+
+	std::mutex									_sessionsMutex;
+	std::vector<std::unique_ptr<CCGuiSession>>	_sessions;
+	std::atomic<uint64_t>						_version;
 private:
 	void SocketAcceptThread();
+	// drops sessions whose GUI went away, never call from a session thread
+	void RemoveClosedSessions();
+
+	nlohmann::json EntityToJson(const CCNetworkEntity* entity)const;
+	// stamps {message} with the next version and queues it on every session
+	void Broadcast(nlohmann::json& message);
 
 public:
 	CCGuiService(IGuiServiceInterface* _delegate, int guiPort = 1049, std::string address = "127.0.0.1");
+	~CCGuiService();
 
 	bool StartGUIServer();
 	bool StopGUIServer();
 
 	bool StartGuiClient()const;
+
+	// the full layout, sent when a session starts
+	std::string BuildSnapshot();
+	// called on {session}'s thread for every frame from a GUI, {data} points into the session's read buffer
+	void HandleFrame(CCGuiSession* session, const char* data, size_t length);
+	// the latency message for getLatency
+	std::string BuildLatencyReport(uint64_t withinUs, bool reset);
+
+	// deltas, safe to call from any thread
+	void EntityJoined(const CCNetworkEntity* entity);
+	void EntityLost(const std::string& entityID);
+	void DisplaysChanged(const CCNetworkEntity* entity);
+	void OffsetsChanged(const std::vector<CCNetworkEntity*>& entities);
 };
 
 #endif
\ No newline at end of file
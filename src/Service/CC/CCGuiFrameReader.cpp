@@ -0,0 +1,206 @@
+#include "CCGuiFrameReader.h"
+#include "CCLogger.h"
+
+#include <string.h>
+
+// CCGuiFrameReader
+
+CCGuiFrameReader::CCGuiFrameReader(size_t maxFrameSize, size_t initialCapacity) : _buffer(initialCapacity), _readOffset(0), \
+_writeOffset(0), _frameLength(0), _maxFrameSize(maxFrameSize)
+{
+}
+
+uint32_t CCGuiFrameReader::PeekLength()const
+{
+	const unsigned char* header = (const unsigned char*)&_buffer[_readOffset];
+	return header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+}
+
+void CCGuiFrameReader::Reserve(size_t needed)
+{
+	// move the unconsumed bytes to the front before growing
+	if (_readOffset > 0 && _writeOffset + needed > _buffer.size())
+	{
+		memmove(_buffer.data(), _buffer.data() + _readOffset, _writeOffset - _readOffset);
+		_writeOffset -= _readOffset;
+		_readOffset = 0;
+	}
+
+	if (_writeOffset + needed > _buffer.size())
+	{
+		size_t capacity = _buffer.size() * 2;
+		while (capacity < _writeOffset + needed)
+		{
+			capacity *= 2;
+		}
+		_buffer.resize(capacity);
+	}
+}
+
+char* CCGuiFrameReader::GetWriteBuffer(size_t& available)
+{
+	// a frame handed out by NextFrame is done with once more data is wanted
+	ConsumeFrame();
+
+	size_t buffered = _writeOffset - _readOffset;
+	size_t needed = 1;
+
+	// make room for the whole frame so it can be received in as few reads as possible
+	if (buffered >= 4 && PeekLength() <= _maxFrameSize)
+		needed = (4 + (size_t)PeekLength()) > buffered ? (4 + (size_t)PeekLength()) - buffered : 1;
+
+	Reserve(needed);
+
+	available = _buffer.size() - _writeOffset;
+	return &_buffer[_writeOffset];
+}
+
+void CCGuiFrameReader::CommitWrite(size_t length)
+{
+	_writeOffset += length;
+}
+
+CCGuiFrameResult CCGuiFrameReader::NextFrame(const char*& payload, size_t& length)
+{
+	ConsumeFrame();
+
+	size_t buffered = _writeOffset - _readOffset;
+	if (buffered < 4)
+		return CCGuiFrameResult::FRAME_NEEDS_MORE;
+
+	uint32_t frameLength = PeekLength();
+	if (frameLength > _maxFrameSize)
+		return CCGuiFrameResult::FRAME_TOO_LARGE;
+
+	if (buffered < 4 + (size_t)frameLength)
+		return CCGuiFrameResult::FRAME_NEEDS_MORE;
+
+	payload = &_buffer[_readOffset + 4];
+	length = frameLength;
+	_frameLength = 4 + (size_t)frameLength;
+
+	return CCGuiFrameResult::FRAME_READY;
+}
+
+void CCGuiFrameReader::ConsumeFrame()
+{
+	_readOffset += _frameLength;
+	_frameLength = 0;
+
+	if (_readOffset == _writeOffset)
+		_readOffset = _writeOffset = 0;
+}
+
+// CCGuiOffsetsSax
+
+CCGuiOffsetsSax::CCGuiOffsetsSax(OffsetCallback onOffset) : _onOffset(onOffset), _depth(0), _inOffsets(false), \
+_offsetCount(0), isFinal(false), offsetCount(0)
+{
+}
+
+bool CCGuiOffsetsSax::Number(double value)
+{
+	// depth 3 is inside an offsets pair {offsets: {id: [x, y]}}
+	if (_inOffsets && _depth == 3 && _offsetCount < 2)
+		_offsetValues[_offsetCount++] = (int)value;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::null()
+{
+	return true;
+}
+
+bool CCGuiOffsetsSax::boolean(bool val)
+{
+	if (_depth == 1 && _key == "final")
+		isFinal = val;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::number_integer(number_integer_t val)
+{
+	return Number((double)val);
+}
+
+bool CCGuiOffsetsSax::number_unsigned(number_unsigned_t val)
+{
+	return Number((double)val);
+}
+
+bool CCGuiOffsetsSax::number_float(number_float_t val, const string_t& s)
+{
+	return Number(val);
+}
+
+bool CCGuiOffsetsSax::string(string_t& val)
+{
+	if (_depth == 1 && _key == "type")
+		type = val;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::binary(binary_t& val)
+{
+	return true;
+}
+
+bool CCGuiOffsetsSax::start_object(std::size_t elements)
+{
+	_depth++;
+
+	if (_depth == 2 && _key == "offsets")
+		_inOffsets = true;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::key(string_t& val)
+{
+	if (_depth == 1)
+		_key = val;
+	else if (_inOffsets && _depth == 2)
+		_entityID = val;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::end_object()
+{
+	if (_depth == 2)
+		_inOffsets = false;
+
+	_depth--;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::start_array(std::size_t elements)
+{
+	_depth++;
+	_offsetCount = 0;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::end_array()
+{
+	if (_inOffsets && _depth == 3 && _offsetCount == 2)
+	{
+		offsetCount++;
+		_onOffset(_entityID, Point(_offsetValues[0], _offsetValues[1]));
+	}
+
+	_depth--;
+
+	return true;
+}
+
+bool CCGuiOffsetsSax::parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex)
+{
+	LOG_ERROR << "Error parsing GUI message at " << position << ": " << ex.what() << std::endl;
+	return false;
+}
@@ -0,0 +1,95 @@
+#ifndef CC_GUI_FRAME_READER_H
+#define CC_GUI_FRAME_READER_H
+
+#include <nlohmann/json.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "BasicTypes.h"
+
+enum class CCGuiFrameResult
+{
+	FRAME_READY,
+	FRAME_NEEDS_MORE,
+	FRAME_TOO_LARGE
+};
+
+/*
+*	CCGuiFrameReader collects length framed messages (see CCGuiSession.h) from any number of reads.
+*
+*	Data is received straight into the reader's buffer with GetWriteBuffer / CommitWrite. The buffer
+*	grows to fit the largest frame seen and is compacted instead of reallocated when possible, so a
+*	frame is never copied out before it is parsed, NextFrame hands out a pointer into the buffer.
+*/
+class CCGuiFrameReader
+{
+private:
+	std::vector<char>	_buffer;
+	size_t				_readOffset; // start of the first unconsumed byte
+	size_t				_writeOffset; // end of the received data
+	size_t				_frameLength; // length of the frame returned by the last NextFrame, 0 if none
+	size_t				_maxFrameSize;
+
+	uint32_t PeekLength()const;
+	void Reserve(size_t needed);
+
+public:
+	CCGuiFrameReader(size_t maxFrameSize, size_t initialCapacity = 4096);
+
+	// returns where the next read should go, at least one byte and enough for the current frame if it is known
+	char* GetWriteBuffer(size_t& available);
+	void CommitWrite(size_t length);
+
+	// points {payload} at the next complete frame, it stays valid until ConsumeFrame or GetWriteBuffer
+	CCGuiFrameResult NextFrame(const char*& payload, size_t& length);
+	void ConsumeFrame();
+
+	inline size_t GetCapacity()const { return _buffer.size(); }
+};
+
+/*
+*	SAX handler for setOffsets messages. Offsets are handed to {onOffset} as each [x, y] pair is
+*	parsed so no document is built, even for thousands of entities.
+*/
+class CCGuiOffsetsSax : public nlohmann::json::json_sax_t
+{
+public:
+	typedef std::function<void(const std::string& entityID, const Point& offset)> OffsetCallback;
+
+private:
+	OffsetCallback		_onOffset;
+
+	int					_depth;
+	std::string			_key; // last key at depth 1
+	std::string			_entityID; // key inside "offsets"
+	bool				_inOffsets;
+	int					_offsetValues[2];
+	int					_offsetCount;
+
+	bool Number(double value);
+
+public:
+	std::string			type;
+	bool				isFinal;
+	size_t				offsetCount;
+
+	CCGuiOffsetsSax(OffsetCallback onOffset);
+
+	virtual bool null()override;
+	virtual bool boolean(bool val)override;
+	virtual bool number_integer(number_integer_t val)override;
+	virtual bool number_unsigned(number_unsigned_t val)override;
+	virtual bool number_float(number_float_t val, const string_t& s)override;
+	virtual bool string(string_t& val)override;
+	virtual bool binary(binary_t& val)override;
+	virtual bool start_object(std::size_t elements)override;
+	virtual bool key(string_t& val)override;
+	virtual bool end_object()override;
+	virtual bool start_array(std::size_t elements)override;
+	virtual bool end_array()override;
+	virtual bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex)override;
+};
+
+#endif
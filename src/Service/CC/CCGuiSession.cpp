@@ -0,0 +1,193 @@
+#include "CCGuiSession.h"
+#include "CCGUIService.h"
+#include "CCLogger.h"
+#include "CCGuiFrameReader.h"
+#include "CCExecutor.h"
+
+#include "../Socket/Socket.h"
+
+// frames sent per task before the worker is given back
+#define CC_GUI_WRITE_BATCH 16
+
+CCGuiSession::CCGuiSession(Socket* socket, CCGuiService* service) : _socket(socket), _service(service), \
+_needsSnapshot(false), _isWriting(false), _isOpen(false)
+{
+}
+
+CCGuiSession::~CCGuiSession()
+{
+	Close();
+
+	if (_readThread.joinable())
+		_readThread.join();
+
+	// the write task holds {this}
+	std::unique_lock<std::mutex> lock(_queueMutex);
+	_queueCondition.wait(lock, [this]() { return _isWriting == false; });
+}
+
+void CCGuiSession::Start()
+{
+	_isOpen = true;
+
+	// the snapshot goes out before anything else can be queued by the service
+	Send(_service->BuildSnapshot());
+
+	_readThread = std::thread(&CCGuiSession::ReadThread, this);
+}
+
+void CCGuiSession::Close()
+{
+	bool wasOpen = _isOpen.exchange(false);
+	{
+		std::lock_guard<std::mutex> lock(_queueMutex);
+	}
+	_queueCondition.notify_all();
+
+	if (wasOpen)
+		_socket->Disconnect();
+}
+
+std::string CCGuiSession::Frame(const std::string& payload)
+{
+	uint32_t length = (uint32_t)payload.size();
+
+	std::string frame;
+	frame.reserve(payload.size() + sizeof(length));
+
+	for (int i = 0; i < 4; i++)
+	{
+		frame += (char)((length >> (i * 8)) & 0xFF);
+	}
+	frame += payload;
+
+	return frame;
+}
+
+void CCGuiSession::Send(const std::string& payload)
+{
+	{
+		std::lock_guard<std::mutex> lock(_queueMutex);
+
+		if (_needsSnapshot || _isOpen == false)
+			return;
+
+		// a gui that can't keep up gets a fresh snapshot instead of an ever growing backlog
+		if (_queue.size() >= CC_GUI_MAX_QUEUED_FRAMES)
+		{
+			_queue.clear();
+			_needsSnapshot = true;
+		}
+		else
+		{
+			_queue.push_back(Frame(payload));
+		}
+
+		if (_isWriting)
+			return;
+
+		_isWriting = true;
+	}
+
+	ScheduleWrite();
+}
+
+void CCGuiSession::ScheduleWrite()
+{
+	if (CCExecutor::SharedExecutor().Submit([this]() { WriteQueued(); }) == false)
+	{
+		// nothing can be sent, the gui reconnects for a new snapshot
+		Close();
+
+		std::lock_guard<std::mutex> lock(_queueMutex);
+		_isWriting = false;
+		_queueCondition.notify_all();
+	}
+}
+
+void CCGuiSession::WriteQueued()
+{
+	for (int i = 0; i < CC_GUI_WRITE_BATCH; i++)
+	{
+		std::string frame;
+		bool needsSnapshot = false;
+		{
+			std::lock_guard<std::mutex> lock(_queueMutex);
+
+			if (_isOpen == false || (_queue.empty() && _needsSnapshot == false))
+			{
+				_isWriting = false;
+				_queueCondition.notify_all();
+				return;
+			}
+
+			if (_needsSnapshot)
+			{
+				needsSnapshot = true;
+				_needsSnapshot = false;
+			}
+			else
+			{
+				frame = std::move(_queue.front());
+				_queue.pop_front();
+			}
+		}
+
+		if (needsSnapshot)
+			frame = Frame(_service->BuildSnapshot());
+
+		SocketError error = _socket->Send(frame.data(), frame.size());
+		if (error != SocketError::SOCKET_E_SUCCESS)
+		{
+			LOG_ERROR << "Error sending to GUI " << SOCK_ERR_STR(_socket.get(), error) << std::endl;
+			Close();
+		}
+	}
+
+	// more to send, let other tasks run first
+	ScheduleWrite();
+}
+
+void CCGuiSession::ReadThread()
+{
+	CCGuiFrameReader reader(CC_GUI_MAX_FRAME_SIZE);
+
+	while (_isOpen)
+	{
+		const char* payload = 0;
+		size_t length = 0;
+
+		CCGuiFrameResult result = reader.NextFrame(payload, length);
+		if (result == CCGuiFrameResult::FRAME_READY)
+		{
+			_service->HandleFrame(this, payload, length);
+			continue;
+		}
+
+		if (result == CCGuiFrameResult::FRAME_TOO_LARGE)
+		{
+			LOG_ERROR << "GUI sent a frame larger than " << CC_GUI_MAX_FRAME_SIZE << " bytes, closing session" << std::endl;
+			break;
+		}
+
+		size_t available = 0;
+		char* buffer = reader.GetWriteBuffer(available);
+
+		size_t received = 0;
+		SocketError error = _socket->Recv(buffer, available, &received);
+		if (error != SocketError::SOCKET_E_SUCCESS)
+		{
+			if (_isOpen)
+				LOG_ERROR << "Error receiving from GUI " << SOCK_ERR_STR(_socket.get(), error) << std::endl;
+			break;
+		}
+
+		// closed by the gui
+		if (received == 0)
+			break;
+
+		reader.CommitWrite(received);
+	}
+
+	Close();
+}
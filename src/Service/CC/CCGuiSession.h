@@ -0,0 +1,86 @@
+#ifndef CC_GUI_SESSION_H
+#define CC_GUI_SESSION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Socket/SocketError.h"
+
+/*
+*	GUI protocol
+*
+*	Every message in both directions is a frame, a uint32 little endian payload length followed by
+*	that many bytes of JSON. Every message has a "type".
+*
+*	service -> gui
+*	snapshot			{version, entites: [entity], globalBounds}, always the first frame of a session
+*	entityJoined		{version, entity, globalBounds}
+*	entityLost			{version, id, globalBounds}
+*	displayChanged		{version, entity, globalBounds}
+*	offsetsChanged		{version, entites: [entity], globalBounds}, only the entities that moved
+*	latency				{entities: {id: trace}, all: stages, withinUs}, only to the session that asked, see
+*						CCLatencyTrace.h for what a trace holds. all merges the stages of every entity
+*	trace				{enabled, trace}, only to the session that asked. trace is the Chrome trace (see
+*						CCTrace.h) and only answers stopTrace
+*
+*	gui -> service
+*	setOffsets			{offsets: {id: [x, y]}, final}, any subset of entities. final is set when the user
+*						is done editing and the layout should be treated as configured
+*	getLatency			{withinUs, reset}, both optional. withinUs adds the fraction of each stage at or below it,
+*						reset clears the histograms once they have been reported
+*	startTrace			{}, clears the trace ring and starts tracing
+*	stopTrace			{}, stops tracing and asks for what was recorded
+*
+*	entity is {id, displays: [{id, bounds: [x, y, width, height]}]}. Versions increase by one per
+*	message, a gui that sees a gap can ask for a new snapshot by reconnecting.
+*/
+
+#define CC_GUI_MAX_FRAME_SIZE (16 * 1024 * 1024)
+#define CC_GUI_MAX_QUEUED_FRAMES 256
+#define CC_GUI_MAX_SESSIONS 4
+
+class Socket;
+class CCGuiService;
+class CCGuiSession
+{
+private:
+	std::unique_ptr<Socket>	_socket;
+	CCGuiService*			_service;
+
+	std::mutex				_queueMutex;
+	std::condition_variable	_queueCondition;
+	std::deque<std::string>	_queue; // framed messages waiting to be sent
+	bool					_needsSnapshot; // set when the queue overflowed, the backlog is replaced by a snapshot
+	bool					_isWriting; // a write task is waiting in or running on the executor
+
+	std::atomic<bool>		_isOpen;
+	std::thread				_readThread;
+
+	void ReadThread();
+	// sends queued frames on an executor worker
+	void WriteQueued();
+	void ScheduleWrite();
+
+public:
+	CCGuiSession(Socket* socket, CCGuiService* service);
+	~CCGuiSession();
+
+	void Start();
+	void Close();
+
+	// queues {payload} to be framed and sent, never blocks on the socket
+	void Send(const std::string& payload);
+
+	inline bool GetIsOpen()const { return _isOpen; }
+
+	// prefixes {payload} with its length
+	static std::string Frame(const std::string& payload);
+};
+
+#endif
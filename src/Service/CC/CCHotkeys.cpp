@@ -0,0 +1,214 @@
+#include "CCHotkeys.h"
+#include "CCConfigurationManager.h"
+#include "CCLogger.h"
+
+#include <algorithm>
+
+static bool ParseHotkeyAction(const std::string& name, CCHotkeyAction& action)
+{
+	static const std::pair<const char*, CCHotkeyAction> actions[] = {
+		{ "home", CCHotkeyAction::HOME },
+		{ "jumpTo", CCHotkeyAction::JUMP_TO },
+		{ "lock", CCHotkeyAction::LOCK },
+		{ "toggleForwarding", CCHotkeyAction::TOGGLE_FORWARDING }
+	};
+
+	for (auto& entry : actions)
+	{
+		if (name == entry.first)
+		{
+			action = entry.second;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static nlohmann::json DefaultHotkeys()
+{
+	return nlohmann::json::array({ { {"keys", { CC_HOTKEY_DEFAULT_SCAN_CODE }}, {"action", "home"} } });
+}
+
+CCHotkeys::CCHotkeys() : _modifiers(0), _hotkeysPath({ "Hotkeys" })
+{
+	_table.reset(Compile(DefaultHotkeys()));
+}
+
+bool CCHotkeys::KeyEvent(const OSEvent& event, const CCHotkeyChord** chord)
+{
+	*chord = NULL;
+
+	if (_pendingTable.Take(_table))
+		RemapModifiers();
+
+	int scanCode = event.scanCode;
+	if (scanCode < 0 || scanCode >= CC_HOTKEY_SCAN_CODES)
+		return false;
+
+	const Table& table = *_table;
+	uint64_t bit = table.modifierBit[scanCode] ? (uint64_t)1 << (table.modifierBit[scanCode] - 1) : 0;
+
+	if (event.keyEvent == KEY_EVENT_UP)
+	{
+		_pressed.reset(scanCode);
+		_modifiers &= ~bit;
+
+		if (_takenTriggers[scanCode] == false)
+			return false;
+
+		_takenTriggers.reset(scanCode);
+		return true;
+	}
+
+	bool wasPressed = _pressed[scanCode];
+	_pressed.set(scanCode);
+	_modifiers |= bit;
+
+	// the trigger is repeating, it only fires once
+	if (_takenTriggers[scanCode])
+		return true;
+
+	uint16_t first = table.firstChord[scanCode];
+	if (first == 0 || wasPressed)
+		return false;
+
+	// a key can be the modifier of one chord and the trigger of another
+	uint64_t held = _modifiers & ~bit;
+
+	for (uint16_t i = first - 1; i < first - 1 + table.chordCount[scanCode]; i++)
+	{
+		if (table.chords[i].modifiers == held)
+		{
+			*chord = &table.chords[i];
+			_takenTriggers.set(scanCode);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CCHotkeys::RemapModifiers()
+{
+	// the modifiers have new bits, the keys that are down keep counting
+	_modifiers = 0;
+	for (int scanCode = 0; scanCode < CC_HOTKEY_SCAN_CODES; scanCode++)
+	{
+		if (_pressed[scanCode] && _table->modifierBit[scanCode])
+			_modifiers |= (uint64_t)1 << (_table->modifierBit[scanCode] - 1);
+	}
+}
+
+CCHotkeys::Table* CCHotkeys::Compile(const nlohmann::json& hotkeys)
+{
+	struct Hotkey
+	{
+		std::vector<int>	keys;
+		CCHotkeyAction		action;
+		std::string			entityID;
+	};
+
+	std::vector<Hotkey> parsed;
+
+	try
+	{
+		for (auto& jHotkey : hotkeys)
+		{
+			Hotkey hotkey;
+			hotkey.keys = jHotkey.at("keys").get<std::vector<int>>();
+
+			std::string action = jHotkey.at("action").get<std::string>();
+			if (ParseHotkeyAction(action, hotkey.action) == false)
+			{
+				LOG_ERROR << "Unknown hotkey action " << action << std::endl;
+				return NULL;
+			}
+
+			if (hotkey.action == CCHotkeyAction::JUMP_TO)
+				hotkey.entityID = jHotkey.at("entity").get<std::string>();
+
+			parsed.push_back(std::move(hotkey));
+		}
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR << "Invalid hotkeys: " << e.what() << std::endl;
+		return NULL;
+	}
+
+	std::unique_ptr<Table> table(new Table());
+	uint8_t modifierCount = 0;
+
+	for (auto& hotkey : parsed)
+	{
+		if (hotkey.keys.empty())
+		{
+			LOG_ERROR << "Invalid hotkeys: a chord needs at least one key" << std::endl;
+			return NULL;
+		}
+
+		for (int key : hotkey.keys)
+		{
+			if (key < 0 || key >= CC_HOTKEY_SCAN_CODES)
+			{
+				LOG_ERROR << "Invalid hotkeys: scan code " << key << " is past " << CC_HOTKEY_SCAN_CODES << std::endl;
+				return NULL;
+			}
+		}
+
+		for (size_t i = 0; i + 1 < hotkey.keys.size(); i++)
+		{
+			int key = hotkey.keys[i];
+			if (table->modifierBit[key])
+				continue;
+
+			if (modifierCount == CC_HOTKEY_MAX_MODIFIERS)
+			{
+				LOG_ERROR << "Invalid hotkeys: more than " << CC_HOTKEY_MAX_MODIFIERS << " different modifiers" << std::endl;
+				return NULL;
+			}
+
+			table->modifierBit[key] = ++modifierCount;
+		}
+	}
+
+	// a trigger's chords are next to each other
+	std::stable_sort(parsed.begin(), parsed.end(), [](const Hotkey& lh, const Hotkey& rh) {
+		return lh.keys.back() < rh.keys.back();
+	});
+
+	for (auto& hotkey : parsed)
+	{
+		CCHotkeyChord chord;
+		chord.modifiers = 0;
+		chord.action = hotkey.action;
+		chord.entityID = hotkey.entityID;
+
+		for (size_t i = 0; i + 1 < hotkey.keys.size(); i++)
+		{
+			chord.modifiers |= (uint64_t)1 << (table->modifierBit[hotkey.keys[i]] - 1);
+		}
+
+		int trigger = hotkey.keys.back();
+		if (table->firstChord[trigger] == 0)
+			table->firstChord[trigger] = (uint16_t)(table->chords.size() + 1);
+		table->chordCount[trigger]++;
+
+		table->chords.push_back(std::move(chord));
+	}
+
+	return table.release();
+}
+
+void CCHotkeys::LoadFrom(const CCConfigurationManager& manager)
+{
+	nlohmann::json hotkeys = DefaultHotkeys();
+	manager.GetValue(_hotkeysPath, hotkeys);
+
+	Table* table = Compile(hotkeys);
+	if (table == NULL)
+		return;
+
+	_pendingTable.Offer(table);
+}
@@ -0,0 +1,102 @@
+#ifndef CC_HOTKEYS_H
+#define CC_HOTKEYS_H
+
+#include <bitset>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "CCConfigPath.h"
+#include "CCPendingSwap.h"
+#include "../OSInterface/KeyCodes.h"
+#include "../OSInterface/OSTypes.h"
+
+class CCConfigurationManager;
+
+/*
+*	CCHotkeys matches the key events CCMain routes against the chords in the "Hotkeys" array of the
+*	config file, i.e.
+*
+*		"Hotkeys": [
+*			{ "keys": [72], "action": "home" },
+*			{ "keys": [224, 226, 15], "action": "lock" },
+*			{ "keys": [224, 226, 13], "action": "jumpTo", "entity": "laptop" }
+*		]
+*
+*	Keys are HID usages (see KeyCodes.h) so a config works on every OS: 72 is PAUSE, 224 LEFT
+*	CONTROL, 226 LEFT ALT, 15 L and 13 J. The last key of a chord is its trigger, the ones before it
+*	must be held down when it is pressed, and no other modifier of any chord. Without the array
+*	PAUSE/BREAK returns home.
+*
+*	Chords are compiled into lookup tables indexed by scan code: which bit of a 64 bit mask a key
+*	sets while it is a modifier, and which chords a key triggers. The pressed keys are a bitset, so
+*	an event costs a bit flip and a table read, and a trigger a mask compare per chord it has.
+*	Scan codes past CC_HOTKEY_SCAN_CODES are never part of a chord and aren't tracked.
+*
+*	The trigger's down and its up are taken by the hotkey and not routed, repeats of the trigger
+*	don't fire it again. Only used from the thread delivering input, LoadFrom can be called from any
+*	thread, the new chords are picked up by the next key event.
+*/
+
+#define CC_HOTKEY_SCAN_CODES KEY_CODE_HID_COUNT
+#define CC_HOTKEY_MAX_MODIFIERS 64
+#define CC_HOTKEY_DEFAULT_SCAN_CODE KEY_CODE_HID_PAUSE
+
+enum class CCHotkeyAction : uint8_t
+{
+	// the cursor goes back to this computer
+	HOME,
+	// the cursor goes to the center of entity {entityID}
+	JUMP_TO,
+	// jump zones are ignored until it is pressed again, the cursor stays on its entity
+	LOCK,
+	// input stays on this computer until it is pressed again
+	TOGGLE_FORWARDING
+};
+
+struct CCHotkeyChord
+{
+	uint64_t		modifiers; // bits of the modifiers that must be held, see CCHotkeys
+	CCHotkeyAction	action;
+	std::string		entityID; // JUMP_TO only
+};
+
+class CCHotkeys
+{
+private:
+	struct Table
+	{
+		uint8_t						modifierBit[CC_HOTKEY_SCAN_CODES]; // bit + 1 of a modifier, 0 for other keys
+		uint16_t					firstChord[CC_HOTKEY_SCAN_CODES]; // index + 1 into chords, 0 if the key triggers nothing
+		uint16_t					chordCount[CC_HOTKEY_SCAN_CODES];
+		std::vector<CCHotkeyChord>	chords; // grouped by trigger
+	};
+
+	std::unique_ptr<Table>			_table;
+	CCPendingSwap<Table>			_pendingTable; // compiled by LoadFrom, swapped in by the input thread
+
+	std::bitset<CC_HOTKEY_SCAN_CODES>	_pressed;
+	std::bitset<CC_HOTKEY_SCAN_CODES>	_takenTriggers; // triggers whose up is taken as well
+	uint64_t							_modifiers; // the pressed keys' modifier bits
+
+	CCConfigPath					_hotkeysPath;
+
+	// the modifiers of the keys that are down get the new table's bits
+	void RemapModifiers();
+	// returns NULL and logs if {hotkeys} isn't a valid "Hotkeys" array
+	static Table* Compile(const nlohmann::json& hotkeys);
+
+public:
+	CCHotkeys();
+
+	// updates the pressed keys, returns true if {event} belongs to a hotkey and must not be routed.
+	// *{chord} is the chord it fired or NULL
+	bool KeyEvent(const OSEvent& event, const CCHotkeyChord** chord);
+
+	inline bool GetIsPressed(int scanCode)const { return scanCode >= 0 && scanCode < CC_HOTKEY_SCAN_CODES && _pressed[scanCode]; }
+
+	void LoadFrom(const CCConfigurationManager& manager);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "CCIdleMonitor.h"
+#include "CCConfigurationManager.h"
+#include "CCLatencyTrace.h"
+#include "CCLogger.h"
+#include "CCMetrics.h"
+
+#include <algorithm>
+
+static CCCounter& TransitionCounter(bool toIdle)
+{
+	static CCCounter& idle = CCMetricRegistry::registry.Counter("cc_idle_transitions_total", "Times the session went idle or became active again", { {"to", "idle"} });
+	static CCCounter& active = CCMetricRegistry::registry.Counter("cc_idle_transitions_total", "Times the session went idle or became active again", { {"to", "active"} });
+
+	return toIdle ? idle : active;
+}
+
+CCIdleMonitor::CCIdleMonitor() : _lastInputAt(CCLatencyNow()), _isIdle(false), _afterPath({ "Idle", "afterMs" }), \
+_probeIntervalPath({ "Idle", "probeIntervalMs" }), _broadcastIntervalPath({ "Idle", "broadcastIntervalMs" })
+{
+}
+
+bool CCIdleMonitor::InputReceived(int64_t now)
+{
+	_lastInputAt.store(now);
+
+	// only the event that finds us idle pays for the exchange
+	if (_isIdle.load(std::memory_order_relaxed) == false || _isIdle.exchange(false) == false)
+		return false;
+
+	LOG_INFO << "Input after being idle, waking up" << std::endl;
+	TransitionCounter(false).Add();
+
+	return true;
+}
+
+bool CCIdleMonitor::IsIdle(int64_t now)
+{
+	if (_isIdle.load())
+		return true;
+
+	int64_t lastInputAt = _lastInputAt.load();
+	if (now - lastInputAt < (int64_t)GetAfterMs() * 1000)
+		return false;
+
+	bool wasIdle = false;
+	if (_isIdle.compare_exchange_strong(wasIdle, true) == false)
+		return true;
+
+	// an event that came in since we looked didn't see us idle, so it couldn't wake us
+	if (_lastInputAt.load() != lastInputAt)
+	{
+		_isIdle.store(false);
+		return false;
+	}
+
+	LOG_INFO << "No input for " << (now - lastInputAt) / 1000000 << "s, going idle" << std::endl;
+	TransitionCounter(true).Add();
+
+	return true;
+}
+
+CCExecutorClock::time_point CCIdleMonitor::NextTick()
+{
+	CCExecutorClock::duration interval;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		interval = std::chrono::milliseconds(_config.probeIntervalMs);
+	}
+
+	CCExecutorClock::duration sinceEpoch = CCExecutorClock::now().time_since_epoch();
+	return CCExecutorClock::time_point(interval * (sinceEpoch / interval + 1));
+}
+
+uint32_t CCIdleMonitor::GetAfterMs()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _config.afterMs;
+}
+
+uint32_t CCIdleMonitor::GetBroadcastIntervalMs()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _config.broadcastIntervalMs;
+}
+
+void CCIdleMonitor::LoadFrom(const CCConfigurationManager& manager)
+{
+	CCIdleConfig config;
+
+	manager.GetValue(_afterPath, config.afterMs);
+	manager.GetValue(_probeIntervalPath, config.probeIntervalMs);
+	manager.GetValue(_broadcastIntervalPath, config.broadcastIntervalMs);
+
+	// a tick of 0 would never come
+	config.probeIntervalMs = std::max<uint32_t>(config.probeIntervalMs, 10);
+	config.broadcastIntervalMs = std::max<uint32_t>(config.broadcastIntervalMs, 10);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_config = config;
+}
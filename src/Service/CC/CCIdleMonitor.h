@@ -0,0 +1,73 @@
+#ifndef CC_IDLE_MONITOR_H
+#define CC_IDLE_MONITOR_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#include "CCConfigPath.h"
+#include "CCExecutor.h"
+
+class CCConfigurationManager;
+
+/*
+*	CCIdleMonitor tells CCMain's server side when nobody is using the input. Once no input event
+*	came in for afterMs the session is idle: heartbeats are only sent every probeIntervalMs and all
+*	of them fire on the same tick of the executor's timer (see NextTick), the broadcast loop only
+*	announces the server every broadcastIntervalMs.
+*
+*	The first input event ends it, InputReceived returns true for it so CCMain restarts the heartbeats
+*	at full rate before the event is forwarded. An entity that died while we were idle is noticed by
+*	that event's awk timeout or the heartbeat right after, whichever comes first.
+*
+*	Configured in the "Idle" object of the config file, changes apply on reload.
+*/
+
+#define CC_IDLE_AFTER_MS 30000
+#define CC_IDLE_PROBE_INTERVAL_MS 5000
+#define CC_IDLE_BROADCAST_INTERVAL_MS 30000
+
+struct CCIdleConfig
+{
+	uint32_t	afterMs;
+	uint32_t	probeIntervalMs;
+	uint32_t	broadcastIntervalMs;
+
+	CCIdleConfig() : afterMs(CC_IDLE_AFTER_MS), probeIntervalMs(CC_IDLE_PROBE_INTERVAL_MS), \
+		broadcastIntervalMs(CC_IDLE_BROADCAST_INTERVAL_MS)
+	{}
+};
+
+class CCIdleMonitor
+{
+private:
+	std::mutex				_mutex;
+	CCIdleConfig			_config;
+
+	std::atomic<int64_t>	_lastInputAt; // CCLatencyNow()
+	std::atomic<bool>		_isIdle;
+
+	CCConfigPath			_afterPath;
+	CCConfigPath			_probeIntervalPath;
+	CCConfigPath			_broadcastIntervalPath;
+
+public:
+	CCIdleMonitor();
+
+	// an input event came in at {now}, returns true if it ended the idle state
+	bool InputReceived(int64_t now);
+	// whether the session is idle at {now}, the first call past afterMs makes it so
+	bool IsIdle(int64_t now);
+
+	// the next multiple of probeIntervalMs on the executor's clock, every idle heartbeat is scheduled
+	// there so the timer wakes once for all of them
+	CCExecutorClock::time_point NextTick();
+
+	inline bool GetIsIdle()const { return _isIdle.load(); }
+	uint32_t GetAfterMs();
+	uint32_t GetBroadcastIntervalMs();
+
+	void LoadFrom(const CCConfigurationManager& manager);
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "CCInputRecording.h"
+#include "CCLogger.h"
+
+#include <chrono>
+#include <string.h>
+
+// the writer wakes up at least this often
+#define CC_INPUT_FLUSH_INTERVAL_MS 100
+// and as soon as this much is buffered
+#define CC_INPUT_FLUSH_SIZE (64 * 1024)
+// events are dropped past this, the input thread never waits for the disk
+#define CC_INPUT_MAX_BUFFER (8 * 1024 * 1024)
+
+static size_t PaddedSize(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+void CCInputPackEvent(const OSEvent& event, uint64_t timestamp, CCInputEventEntry& entry)
+{
+	memset(&entry, 0, sizeof(entry));
+
+	entry.header.kind = CC_INPUT_ENTRY_EVENT;
+	entry.header.size = sizeof(entry);
+	entry.timestamp = timestamp;
+	entry.eventType = (int8_t)event.eventType;
+	entry.subType = (int8_t)event.keyEvent;
+	entry.code = event.scanCode;
+	entry.extendButtonInfo = event.extendButtonInfo;
+	entry.x = event.x;
+	entry.y = event.y;
+	entry.deltaX = event.deltaX;
+	entry.deltaY = event.deltaY;
+	entry.nativeScreenID = event.nativeScreenID;
+}
+
+OSEvent CCInputUnpackEvent(const CCInputEventEntry& entry)
+{
+	OSEvent event;
+	event.eventType = (OSEventType)entry.eventType;
+	event.keyEvent = (KeyEventType)entry.subType;
+	event.scanCode = entry.code;
+	event.extendButtonInfo = entry.extendButtonInfo;
+	event.x = entry.x;
+	event.y = entry.y;
+	event.deltaX = entry.deltaX;
+	event.deltaY = entry.deltaY;
+	event.nativeScreenID = entry.nativeScreenID;
+
+	return event;
+}
+
+// CCInputRecorder
+
+CCInputRecorder::CCInputRecorder() : _file(NULL), _steadyStart(0), _shouldRun(false), _eventCount(0), _droppedCount(0)
+{
+}
+
+CCInputRecorder::~CCInputRecorder()
+{
+	Close();
+}
+
+uint64_t CCInputRecorder::Now()const
+{
+	uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return now - _steadyStart;
+}
+
+bool CCInputRecorder::Open(const std::string& path)
+{
+	Close();
+
+	_file = fopen(path.c_str(), "wb");
+	if (_file == NULL)
+		return false;
+
+	CCInputRecordingHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CC_INPUT_MAGIC, sizeof(header.magic));
+	header.version = CC_INPUT_VERSION;
+	header.headerSize = sizeof(header);
+	header.steadyStart = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	header.wallStart = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	if (fwrite(&header, sizeof(header), 1, _file) != 1)
+	{
+		fclose(_file);
+		_file = NULL;
+		return false;
+	}
+
+	_steadyStart = header.steadyStart;
+	_eventCount = 0;
+	_droppedCount = 0;
+	_shouldRun = true;
+	_writeThread = std::thread(&CCInputRecorder::WriteThread, this);
+
+	return true;
+}
+
+void CCInputRecorder::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_shouldRun = false;
+	}
+	_condition.notify_all();
+
+	if (_writeThread.joinable())
+		_writeThread.join();
+
+	if (_file)
+	{
+		fclose(_file);
+		_file = NULL;
+	}
+}
+
+bool CCInputRecorder::Append(const void* data, size_t size, bool isEvent)
+{
+	bool shouldWake = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_shouldRun == false || _buffer.size() + size > CC_INPUT_MAX_BUFFER)
+		{
+			_droppedCount++;
+			return false;
+		}
+
+		_buffer.append((const char*)data, size);
+		shouldWake = _buffer.size() >= CC_INPUT_FLUSH_SIZE;
+
+		if (isEvent)
+			_eventCount++;
+	}
+
+	if (shouldWake)
+		_condition.notify_all();
+
+	return true;
+}
+
+void CCInputRecorder::RecordLayout(const std::string& layout)
+{
+	struct
+	{
+		CCInputEntryHeader	header;
+		uint64_t			timestamp;
+		uint32_t			length;
+		uint32_t			reserved;
+	} prefix;
+
+	size_t size = PaddedSize(sizeof(prefix) + layout.size());
+
+	prefix.header.kind = CC_INPUT_ENTRY_LAYOUT;
+	prefix.header.reserved = 0;
+	prefix.header.size = (uint32_t)size;
+	prefix.timestamp = Now();
+	prefix.length = (uint32_t)layout.size();
+	prefix.reserved = 0;
+
+	std::string entry;
+	entry.reserve(size);
+	entry.append((const char*)&prefix, sizeof(prefix));
+	entry += layout;
+	entry.resize(size, '\0');
+
+	if (Append(entry.data(), entry.size(), false) == false)
+		LOG_ERROR << "Input recorder dropped a layout" << std::endl;
+}
+
+bool CCInputRecorder::ReceivedNewInputEvent(OSEvent event)
+{
+	CCInputEventEntry entry;
+	CCInputPackEvent(event, Now(), entry);
+
+	Append(&entry, sizeof(entry), true);
+
+	return false;
+}
+
+uint64_t CCInputRecorder::GetEventCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _eventCount;
+}
+
+uint64_t CCInputRecorder::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _droppedCount;
+}
+
+void CCInputRecorder::WriteThread()
+{
+	std::string writing;
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_condition.wait_for(lock, std::chrono::milliseconds(CC_INPUT_FLUSH_INTERVAL_MS), [this]() {
+			return _shouldRun == false || _buffer.size() >= CC_INPUT_FLUSH_SIZE;
+		});
+
+		bool shouldRun = _shouldRun;
+		writing.swap(_buffer);
+		lock.unlock();
+
+		if (writing.empty() == false)
+		{
+			if (fwrite(writing.data(), 1, writing.size(), _file) != writing.size())
+				LOG_ERROR << "Error writing input recording" << std::endl;
+			fflush(_file);
+			writing.clear();
+		}
+
+		lock.lock();
+
+		if (shouldRun == false && _buffer.empty())
+			break;
+	}
+}
+
+// CCInputRecording
+
+CCInputRecording::CCInputRecording() : _size(0)
+{
+	memset(&_header, 0, sizeof(_header));
+}
+
+bool CCInputRecording::Open(const std::string& path, std::string& error)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+	{
+		error = "could not open " + path;
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size < (long)sizeof(CCInputRecordingHeader))
+	{
+		fclose(file);
+		error = path + " is too short to be a recording";
+		return false;
+	}
+
+	_storage.resize(PaddedSize((size_t)size) / sizeof(uint64_t));
+	_size = fread(_storage.data(), 1, (size_t)size, file);
+	fclose(file);
+
+	memcpy(&_header, _storage.data(), sizeof(_header));
+
+	if (memcmp(_header.magic, CC_INPUT_MAGIC, sizeof(_header.magic)) != 0)
+	{
+		error = path + " is not an input recording";
+		return false;
+	}
+
+	if (_header.version != CC_INPUT_VERSION || _header.headerSize != sizeof(CCInputRecordingHeader))
+	{
+		error = path + " has version " + std::to_string(_header.version) + ", expected " + std::to_string(CC_INPUT_VERSION);
+		return false;
+	}
+
+	return true;
+}
+
+bool CCInputRecording::Next(size_t& offset, CCInputEntry& entry)const
+{
+	const char* data = (const char*)_storage.data();
+
+	while (offset + sizeof(CCInputEntryHeader) <= _size)
+	{
+		const CCInputEntryHeader* header = (const CCInputEntryHeader*)(data + offset);
+
+		// cut off while it was being written, or not a recording we understand
+		if (header->size < sizeof(CCInputEntryHeader) + sizeof(uint64_t) || (header->size & 7) != 0 || offset + header->size > _size)
+			return false;
+
+		size_t entryOffset = offset;
+		offset += header->size;
+
+		if (header->kind == CC_INPUT_ENTRY_EVENT && header->size >= sizeof(CCInputEventEntry))
+		{
+			const CCInputEventEntry* event = (const CCInputEventEntry*)(data + entryOffset);
+
+			entry.kind = CC_INPUT_ENTRY_EVENT;
+			entry.timestamp = event->timestamp;
+			entry.event = CCInputUnpackEvent(*event);
+			entry.layout = NULL;
+			entry.layoutLength = 0;
+
+			return true;
+		}
+
+		if (header->kind == CC_INPUT_ENTRY_LAYOUT && header->size >= sizeof(CCInputEntryHeader) + 16)
+		{
+			const char* body = data + entryOffset + sizeof(CCInputEntryHeader);
+
+			uint32_t length = 0;
+			memcpy(&entry.timestamp, body, sizeof(uint64_t));
+			memcpy(&length, body + sizeof(uint64_t), sizeof(length));
+
+			if (length > header->size - sizeof(CCInputEntryHeader) - 16)
+				return false;
+
+			entry.kind = CC_INPUT_ENTRY_LAYOUT;
+			entry.event = OSEvent();
+			entry.layout = body + 16;
+			entry.layoutLength = length;
+
+			return true;
+		}
+
+		// a kind from a newer version, skip it
+	}
+
+	return false;
+}
@@ -0,0 +1,149 @@
+#ifndef CC_INPUT_RECORDING_H
+#define CC_INPUT_RECORDING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../OSInterface/IOSEventReceiver.h"
+#include "../OSInterface/OSTypes.h"
+
+/*
+*	Input recording layout, all values are little endian and every entry starts 8 byte aligned
+*	so a reader can map the file and point straight into it
+*
+*	header		CCInputRecordingHeader
+*	entries		CCInputEntryHeader followed by
+*				CC_INPUT_ENTRY_EVENT	the rest of CCInputEventEntry
+*				CC_INPUT_ENTRY_LAYOUT	uint64 timestamp, uint32 length, uint32 reserved, the layout JSON
+*										from CCMain::BuildLayout padded to 8 bytes
+*
+*	Timestamps are steady clock nanoseconds since the header's start. The file is only ever appended
+*	to, a recording that was cut off is read up to its last whole entry.
+*/
+
+#define CC_INPUT_MAGIC "CCIR"
+#define CC_INPUT_VERSION 2 // 2: key codes are HID usages
+
+#define CC_INPUT_ENTRY_EVENT 1
+#define CC_INPUT_ENTRY_LAYOUT 2
+
+struct CCInputRecordingHeader
+{
+	char		magic[4];
+	uint16_t	version;
+	uint16_t	headerSize;
+	uint64_t	steadyStart; // ns
+	int64_t		wallStart; // us since the epoch
+	uint64_t	reserved;
+};
+
+struct CCInputEntryHeader
+{
+	uint16_t	kind;
+	uint16_t	reserved;
+	uint32_t	size; // including this header and the padding
+};
+
+struct CCInputEventEntry
+{
+	CCInputEntryHeader	header;
+	uint64_t			timestamp;
+	int8_t				eventType;
+	int8_t				subType; // mouseEvent or keyEvent
+	int16_t				reserved;
+	int32_t				code; // mouseButton or scanCode
+	int32_t				extendButtonInfo;
+	int32_t				x;
+	int32_t				y;
+	int32_t				deltaX;
+	int32_t				deltaY;
+	int32_t				nativeScreenID;
+};
+
+static_assert(sizeof(CCInputRecordingHeader) == 32, "the recording header is part of the file format");
+static_assert(sizeof(CCInputEventEntry) == 48, "event entries are part of the file format");
+
+extern void CCInputPackEvent(const OSEvent& event, uint64_t timestamp, CCInputEventEntry& entry);
+extern OSEvent CCInputUnpackEvent(const CCInputEventEntry& entry);
+
+/*
+*	CCInputRecorder writes every event it receives to a recording. It is registered like any other
+*	IOSEventReceiver and never consumes events. The input thread only copies the entry into a buffer,
+*	a writer thread puts it on disk.
+*/
+class CCInputRecorder : public IOSEventReceiver
+{
+private:
+	FILE*					_file;
+	uint64_t				_steadyStart;
+
+	std::mutex				_mutex;
+	std::condition_variable	_condition;
+	std::string				_buffer; // entries waiting for the writer thread
+	bool					_shouldRun;
+	uint64_t				_eventCount;
+	uint64_t				_droppedCount; // entries that didn't fit in the buffer, the disk can't keep up
+
+	std::thread				_writeThread;
+
+	void WriteThread();
+	// returns false if the buffer is full or the recorder is closed
+	bool Append(const void* data, size_t size, bool isEvent);
+	uint64_t Now()const;
+
+public:
+	CCInputRecorder();
+	~CCInputRecorder();
+
+	bool Open(const std::string& path);
+	// writes what is buffered and closes the file
+	void Close();
+
+	void RecordLayout(const std::string& layout);
+
+	uint64_t GetEventCount();
+	uint64_t GetDroppedCount();
+
+	// IOSEventReceiver Implementation
+
+	virtual bool ReceivedNewInputEvent(OSEvent event)override;
+
+	// END IOSEventReceiver
+};
+
+struct CCInputEntry
+{
+	uint16_t	kind;
+	uint64_t	timestamp;
+	OSEvent		event; // CC_INPUT_ENTRY_EVENT
+	const char*	layout; // CC_INPUT_ENTRY_LAYOUT, points into the recording
+	size_t		layoutLength;
+};
+
+// a whole recording in memory
+class CCInputRecording
+{
+private:
+	std::vector<uint64_t>	_storage; // keeps the entries aligned
+	size_t					_size;
+	CCInputRecordingHeader	_header;
+
+public:
+	CCInputRecording();
+
+	// {error} says why the file can't be read
+	bool Open(const std::string& path, std::string& error);
+
+	// reads the entry at {offset} and moves {offset} past it, returns false at the end
+	bool Next(size_t& offset, CCInputEntry& entry)const;
+
+	inline size_t GetFirstOffset()const { return sizeof(CCInputRecordingHeader); }
+	inline const CCInputRecordingHeader& GetHeader()const { return _header; }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "CCKeyRepeater.h"
+#include "CCLatencyTrace.h"
+#include "CCLogger.h"
+#include "CCMetrics.h"
+
+#include "../OSInterface/OSInterface.h"
+
+#include <algorithm>
+#include <chrono>
+
+CCKeyRepeater::CCKeyRepeater() : _shouldRun(true), _nextRepeatAt(0), _repeatIntervalUs(CC_KEY_REPEAT_INTERVAL_MS * 1000), \
+_lastHeardAt(0)
+{
+	_thread = std::thread(&CCKeyRepeater::RepeatThread, this);
+}
+
+CCKeyRepeater::~CCKeyRepeater()
+{
+	Stop();
+}
+
+OSInterfaceError CCKeyRepeater::Inject(const OSEvent& event)
+{
+	int64_t now = CCLatencyNow();
+	_lastHeardAt.store(now, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	OSInterfaceError error = OSInterface::SharedInterface().SendOSEvent(event);
+	if (error != OSInterfaceError::OS_E_SUCCESS || event.eventType != OS_EVENT_KEY)
+		return error;
+
+	auto held = std::find(_heldKeys.begin(), _heldKeys.end(), event.scanCode);
+
+	if (event.keyEvent == KEY_EVENT_DOWN)
+	{
+		if (held == _heldKeys.end())
+			_heldKeys.push_back(event.scanCode);
+
+		// asked on every press so a change in the keyboard settings applies right away
+		int delayMs = CC_KEY_REPEAT_DELAY_MS;
+		int intervalMs = CC_KEY_REPEAT_INTERVAL_MS;
+		OSInterface::SharedInterface().GetKeyRepeatSettings(delayMs, intervalMs);
+
+		_repeatEvent = event;
+		_nextRepeatAt = now + (int64_t)delayMs * 1000;
+		_repeatIntervalUs = (int64_t)std::max(intervalMs, 1) * 1000;
+
+		_condition.notify_one();
+	}
+	else if (event.keyEvent == KEY_EVENT_UP)
+	{
+		if (held != _heldKeys.end())
+			_heldKeys.erase(held);
+
+		if (_repeatEvent.scanCode == event.scanCode)
+			_repeatEvent.scanCode = -1;
+	}
+
+	return error;
+}
+
+void CCKeyRepeater::Heard()
+{
+	_lastHeardAt.store(CCLatencyNow(), std::memory_order_relaxed);
+}
+
+void CCKeyRepeater::ReleaseAll()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	ReleaseAllLocked();
+}
+
+void CCKeyRepeater::ReleaseAllLocked()
+{
+	static CCCounter& released = CCMetricRegistry::registry.Counter("cc_stuck_keys_released_total", "Held keys released because the server was lost");
+
+	for (int scanCode : _heldKeys)
+	{
+		OSEvent up;
+		up.eventType = OS_EVENT_KEY;
+		up.keyEvent = KEY_EVENT_UP;
+		up.scanCode = scanCode;
+
+		OSInterface::SharedInterface().SendOSEvent(up);
+		released.Add();
+	}
+
+	_heldKeys.clear();
+	_repeatEvent.scanCode = -1;
+}
+
+void CCKeyRepeater::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		ReleaseAllLocked();
+		_shouldRun = false;
+	}
+	_condition.notify_one();
+
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void CCKeyRepeater::RepeatThread()
+{
+	static CCCounter& repeats = CCMetricRegistry::registry.Counter("cc_key_repeats_injected_total", "Repeats of held keys injected on the client");
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (_shouldRun)
+	{
+		// nothing to do until a key is pressed
+		if (_heldKeys.empty())
+		{
+			_condition.wait(lock);
+			continue;
+		}
+
+		int64_t now = CCLatencyNow();
+		int64_t silentUs = now - _lastHeardAt.load(std::memory_order_relaxed);
+
+		if (silentUs >= CC_KEY_STUCK_TIMEOUT_MS * 1000)
+		{
+			LOG_ERROR << "Nothing heard from the server for " << silentUs / 1000 << "ms, releasing " << _heldKeys.size() << " held keys" << std::endl;
+			ReleaseAllLocked();
+			continue;
+		}
+
+		int64_t wakeAt = now + CC_KEY_STUCK_TIMEOUT_MS * 1000 - silentUs;
+
+		if (_repeatEvent.scanCode != -1)
+		{
+			if (_nextRepeatAt <= now)
+			{
+				OSInterface::SharedInterface().SendOSEvent(_repeatEvent);
+				repeats.Add();
+
+				// after a stall (i.e. the computer was asleep) the missed repeats aren't made up for
+				_nextRepeatAt += _repeatIntervalUs;
+				if (_nextRepeatAt < now)
+					_nextRepeatAt = now + _repeatIntervalUs;
+				continue;
+			}
+
+			wakeAt = std::min(wakeAt, _nextRepeatAt);
+		}
+
+		_condition.wait_for(lock, std::chrono::microseconds(wakeAt - now));
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef CC_KEY_REPEATER_H
+#define CC_KEY_REPEATER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "../OSInterface/OSTypes.h"
+#include "../OSInterface/OSInterfaceError.h"
+
+/*
+*	CCKeyRepeater makes held keys repeat on the client. The server only forwards the first down and
+*	the up of a held key (see CCNetworkEntity::SendOSEvent), the repeats are injected here at the delay
+*	and rate this computer's keyboard settings ask for, so the network doesn't show in them.
+*
+*	Like a keyboard only the key pressed last repeats. Held keys are released, an up is injected for
+*	each, when the event connection drops or nothing was heard from the server for
+*	CC_KEY_STUCK_TIMEOUT_MS, so a server that vanished can't leave a key repeating.
+*
+*	Key events from the server are injected through Inject so a repeat can never land after its up.
+*/
+
+#define CC_KEY_STUCK_TIMEOUT_MS 1000
+// used when the OS has no keyboard settings
+#define CC_KEY_REPEAT_DELAY_MS 500
+#define CC_KEY_REPEAT_INTERVAL_MS 33
+
+class CCKeyRepeater
+{
+private:
+	std::mutex				_mutex;
+	std::condition_variable	_condition;
+	std::thread				_thread;
+	bool					_shouldRun;
+
+	std::vector<int>		_heldKeys; // scan codes that were pressed and not released yet
+	OSEvent					_repeatEvent; // the key pressed last, scanCode is -1 while nothing repeats
+	int64_t					_nextRepeatAt; // CCLatencyNow()
+	int64_t					_repeatIntervalUs;
+
+	std::atomic<int64_t>	_lastHeardAt; // CCLatencyNow()
+
+	void RepeatThread();
+	// _mutex must be held
+	void ReleaseAllLocked();
+
+public:
+	CCKeyRepeater();
+	~CCKeyRepeater();
+
+	// injects {event}, a key event from the server, and starts or stops its repeats
+	OSInterfaceError Inject(const OSEvent& event);
+	// something came from the server, held keys keep repeating
+	void Heard();
+	// injects an up for every held key
+	void ReleaseAll();
+	// releases the held keys and stops repeating for good
+	void Stop();
+};
+
+#endif
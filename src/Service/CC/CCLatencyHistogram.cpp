@@ -0,0 +1,129 @@
+#include "CCLatencyHistogram.h"
+
+#include <algorithm>
+#include <math.h>
+
+#define CC_HISTOGRAM_SUB_BUCKETS (1 << CC_HISTOGRAM_SUB_BUCKET_BITS)
+// values below this are their own bucket
+#define CC_HISTOGRAM_LINEAR_LIMIT (2 * CC_HISTOGRAM_SUB_BUCKETS)
+#define CC_HISTOGRAM_MAX_VALUE ((uint64_t(1) << CC_HISTOGRAM_MAX_BITS) - 1)
+// the linear buckets and then CC_HISTOGRAM_SUB_BUCKETS for every power of two above them
+#define CC_HISTOGRAM_BUCKET_COUNT (CC_HISTOGRAM_LINEAR_LIMIT + (CC_HISTOGRAM_MAX_BITS - CC_HISTOGRAM_SUB_BUCKET_BITS - 1) * CC_HISTOGRAM_SUB_BUCKETS)
+
+static int HighestBit(uint64_t value)
+{
+	int bit = 0;
+	while (value >>= 1)
+		bit++;
+
+	return bit;
+}
+
+CCLatencyHistogram::CCLatencyHistogram() : _counts(CC_HISTOGRAM_BUCKET_COUNT, 0), _totalCount(0), _min(UINT64_MAX), _max(0), _sum(0)
+{
+}
+
+size_t CCLatencyHistogram::IndexForValue(uint64_t value)
+{
+	if (value < CC_HISTOGRAM_LINEAR_LIMIT)
+		return (size_t)value;
+
+	// {value >> shift} is always in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+	int shift = HighestBit(value) - CC_HISTOGRAM_SUB_BUCKET_BITS;
+
+	return CC_HISTOGRAM_LINEAR_LIMIT + (shift - 1) * CC_HISTOGRAM_SUB_BUCKETS + (size_t)((value >> shift) - CC_HISTOGRAM_SUB_BUCKETS);
+}
+
+uint64_t CCLatencyHistogram::HighestValueAt(size_t index)
+{
+	if (index < CC_HISTOGRAM_LINEAR_LIMIT)
+		return index;
+
+	size_t above = index - CC_HISTOGRAM_LINEAR_LIMIT;
+	int shift = (int)(above / CC_HISTOGRAM_SUB_BUCKETS) + 1;
+	uint64_t lowest = (uint64_t)(above % CC_HISTOGRAM_SUB_BUCKETS + CC_HISTOGRAM_SUB_BUCKETS) << shift;
+
+	return lowest + (uint64_t(1) << shift) - 1;
+}
+
+void CCLatencyHistogram::Record(uint64_t value)
+{
+	if (value > CC_HISTOGRAM_MAX_VALUE)
+		value = CC_HISTOGRAM_MAX_VALUE;
+
+	_counts[IndexForValue(value)]++;
+	_totalCount++;
+	_sum += (double)value;
+
+	if (value < _min)
+		_min = value;
+	if (value > _max)
+		_max = value;
+}
+
+void CCLatencyHistogram::Add(const CCLatencyHistogram& other)
+{
+	if (other._totalCount == 0)
+		return;
+
+	for (size_t i = 0; i < _counts.size(); i++)
+	{
+		_counts[i] += other._counts[i];
+	}
+
+	_totalCount += other._totalCount;
+	_sum += other._sum;
+
+	if (other._min < _min)
+		_min = other._min;
+	if (other._max > _max)
+		_max = other._max;
+}
+
+void CCLatencyHistogram::Reset()
+{
+	std::fill(_counts.begin(), _counts.end(), 0);
+	_totalCount = 0;
+	_min = UINT64_MAX;
+	_max = 0;
+	_sum = 0;
+}
+
+uint64_t CCLatencyHistogram::ValueAtPercentile(double percentile)const
+{
+	if (_totalCount == 0)
+		return 0;
+
+	// the rank of the value we want, at least the first one
+	uint64_t rank = (uint64_t)ceil(percentile / 100.0 * _totalCount);
+	if (rank < 1)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < _counts.size(); i++)
+	{
+		seen += _counts[i];
+		if (seen >= rank)
+			return HighestValueAt(i) < _max ? HighestValueAt(i) : _max;
+	}
+
+	return _max;
+}
+
+double CCLatencyHistogram::FractionAtOrBelow(uint64_t value)const
+{
+	if (_totalCount == 0)
+		return 1.0;
+
+	if (value >= _max)
+		return 1.0;
+
+	// a bucket counts only if all of it is at or below {value}
+	uint64_t seen = 0;
+	for (size_t i = 0; i < _counts.size() && HighestValueAt(i) <= value; i++)
+	{
+		seen += _counts[i];
+	}
+
+	return (double)seen / _totalCount;
+}
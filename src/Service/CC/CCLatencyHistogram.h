@@ -0,0 +1,52 @@
+#ifndef CC_LATENCY_HISTOGRAM_H
+#define CC_LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// 128 linear steps per power of two, every value is kept to within 1%
+#define CC_HISTOGRAM_SUB_BUCKET_BITS 7
+// values are recorded up to 2^32 us (a bit over an hour), larger values are clamped
+#define CC_HISTOGRAM_MAX_BITS 32
+
+/*
+*	CCLatencyHistogram is an HDR histogram of microsecond values. Values below 256 get a bucket each,
+*	above that they are bucketed by their power of two and then linearly within it, so recording is a
+*	shift and an increment and nothing allocates after construction no matter how many values are
+*	recorded. Percentiles report the highest value of their bucket, they are never optimistic.
+*	Not thread safe, the owner locks.
+*/
+class CCLatencyHistogram
+{
+private:
+	std::vector<uint64_t>	_counts;
+	uint64_t				_totalCount;
+	uint64_t				_min;
+	uint64_t				_max;
+	double					_sum;
+
+	static size_t IndexForValue(uint64_t value);
+	// the highest value that lands in the bucket at {index}
+	static uint64_t HighestValueAt(size_t index);
+
+public:
+	CCLatencyHistogram();
+
+	void Record(uint64_t value);
+	// adds everything recorded in {other}
+	void Add(const CCLatencyHistogram& other);
+	void Reset();
+
+	// {percentile} is 0 - 100
+	uint64_t ValueAtPercentile(double percentile)const;
+	// the fraction of recorded values that are at most {value}
+	double FractionAtOrBelow(uint64_t value)const;
+
+	inline uint64_t GetCount()const { return _totalCount; }
+	inline uint64_t GetMin()const { return _totalCount ? _min : 0; }
+	inline uint64_t GetMax()const { return _max; }
+	inline double GetMean()const { return _totalCount ? _sum / _totalCount : 0.0; }
+};
+
+#endif
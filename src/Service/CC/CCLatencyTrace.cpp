@@ -0,0 +1,163 @@
+#include "CCLatencyTrace.h"
+
+#include <chrono>
+
+const char* LatencyStageName(LatencyStage stage)
+{
+	switch (stage)
+	{
+	case LatencyStage::ROUTE:
+		return "route";
+	case LatencyStage::SEND:
+		return "send";
+	case LatencyStage::NETWORK:
+		return "network";
+	case LatencyStage::INJECT:
+		return "inject";
+	case LatencyStage::TOTAL:
+		return "total";
+	default:
+		return "unknown";
+	}
+}
+
+int64_t CCLatencyNow()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CCLatencyTrace::CCLatencyTrace() : _clockSampleCount(0), _nextClockSample(0), _clock({ 0, 0 }), _hasPending(false), \
+_pendingCapturedAt(0), _pendingReceivedAt(0)
+{
+}
+
+void CCLatencyTrace::RecordStage(LatencyStage stage, int64_t value)
+{
+	// the clock offset is an estimate, a stage can come out slightly negative
+	_stages[(int)stage].Record(value > 0 ? (uint64_t)value : 0);
+}
+
+void CCLatencyTrace::AddClockSample(int64_t sentAt, int64_t remoteAt, int64_t receivedAt)
+{
+	if (receivedAt < sentAt)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// assumes the remote clock was read half way through the round trip
+	ClockSample sample = { remoteAt - sentAt - (receivedAt - sentAt) / 2, receivedAt - sentAt };
+
+	_clockSamples[_nextClockSample] = sample;
+	_nextClockSample = (_nextClockSample + 1) % CC_LATENCY_CLOCK_SAMPLES;
+	if (_clockSampleCount < CC_LATENCY_CLOCK_SAMPLES)
+		_clockSampleCount++;
+
+	// the quickest exchange had the least room to be asymmetric
+	_clock = _clockSamples[0];
+	for (size_t i = 1; i < _clockSampleCount; i++)
+	{
+		if (_clockSamples[i].roundTrip < _clock.roundTrip)
+			_clock = _clockSamples[i];
+	}
+}
+
+void CCLatencyTrace::EventDelivered(int64_t capturedAt, int64_t enqueuedAt, int64_t sentAt, int64_t remoteReceivedAt, int64_t remotePreviousInjectedAt)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	bool hasClock = _clockSampleCount != 0;
+
+	if (_hasPending && remotePreviousInjectedAt != 0)
+	{
+		RecordStage(LatencyStage::INJECT, remotePreviousInjectedAt - _pendingReceivedAt);
+
+		if (hasClock)
+			RecordStage(LatencyStage::TOTAL, remotePreviousInjectedAt - _clock.offset - _pendingCapturedAt);
+	}
+
+	RecordStage(LatencyStage::ROUTE, enqueuedAt - capturedAt);
+	RecordStage(LatencyStage::SEND, sentAt - enqueuedAt);
+
+	if (hasClock)
+		RecordStage(LatencyStage::NETWORK, remoteReceivedAt - _clock.offset - sentAt);
+
+	_hasPending = true;
+	_pendingCapturedAt = capturedAt;
+	_pendingReceivedAt = remoteReceivedAt;
+}
+
+void CCLatencyTrace::ConnectionReset()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_hasPending = false;
+}
+
+void CCLatencyTrace::Reset()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (auto& stage : _stages)
+	{
+		stage.Reset();
+	}
+}
+
+void CCLatencyTrace::AddStagesTo(std::vector<CCLatencyHistogram>& stages)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (int i = 0; i < (int)LatencyStage::COUNT && i < (int)stages.size(); i++)
+	{
+		stages[i].Add(_stages[i]);
+	}
+}
+
+nlohmann::json CCLatencyTrace::ToJson(uint64_t withinUs)
+{
+	std::vector<CCLatencyHistogram> stages((int)LatencyStage::COUNT);
+	AddStagesTo(stages);
+
+	nlohmann::json clock;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		clock["synced"] = _clockSampleCount != 0;
+		clock["offsetUs"] = _clock.offset;
+		clock["roundTripUs"] = _clock.roundTrip;
+	}
+
+	nlohmann::json trace;
+	trace["clock"] = std::move(clock);
+	trace["stages"] = StagesToJson(stages, withinUs);
+
+	return trace;
+}
+
+nlohmann::json CCLatencyTrace::HistogramToJson(const CCLatencyHistogram& histogram, uint64_t withinUs)
+{
+	nlohmann::json j;
+	j["count"] = histogram.GetCount();
+	j["minUs"] = histogram.GetMin();
+	j["meanUs"] = histogram.GetMean();
+	j["p50Us"] = histogram.ValueAtPercentile(50);
+	j["p90Us"] = histogram.ValueAtPercentile(90);
+	j["p99Us"] = histogram.ValueAtPercentile(99);
+	j["p999Us"] = histogram.ValueAtPercentile(99.9);
+	j["maxUs"] = histogram.GetMax();
+
+	if (withinUs != 0)
+		j["within"] = histogram.FractionAtOrBelow(withinUs);
+
+	return j;
+}
+
+nlohmann::json CCLatencyTrace::StagesToJson(const std::vector<CCLatencyHistogram>& stages, uint64_t withinUs)
+{
+	nlohmann::json j = nlohmann::json::object();
+
+	for (int i = 0; i < (int)LatencyStage::COUNT && i < (int)stages.size(); i++)
+	{
+		j[LatencyStageName((LatencyStage)i)] = HistogramToJson(stages[i], withinUs);
+	}
+
+	return j;
+}
@@ -0,0 +1,95 @@
+#ifndef CC_LATENCY_TRACE_H
+#define CC_LATENCY_TRACE_H
+
+#include <nlohmann/json.hpp>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include "CCLatencyHistogram.h"
+
+// how many heartbeats the clock offset is picked from
+#define CC_LATENCY_CLOCK_SAMPLES 8
+
+/*
+*	Every event sent to an entity is stamped when it is captured, when it reaches the entity's
+*	SendOSEvent (enqueue), once it is on the wire, when the client has received it and once the
+*	client has injected it. The client's stamps come back with the awk of the event, the injection
+*	time of an event comes with the awk of the next one so the server never waits for injection.
+*
+*	route		capture -> enqueue, the time CCMain spends routing (and any jump RPCs)
+*	send		enqueue -> on the wire, the header round trip and waiting for the socket
+*	network		on the wire -> received by the client
+*	inject		received by the client -> injected
+*	total		capture -> injected
+*
+*	The client's stamps are moved onto the server's clock with an offset estimated from the heartbeat
+*	exchange (NTP style, the sample with the smallest round trip of the last few wins), network and
+*	total are only recorded once there is one. They are off by at most half that round trip.
+*/
+
+enum class LatencyStage : int
+{
+	ROUTE,
+	SEND,
+	NETWORK,
+	INJECT,
+	TOTAL,
+	COUNT
+};
+
+extern const char* LatencyStageName(LatencyStage stage);
+
+// steady clock microseconds, comparable between the stamps of one computer only
+extern int64_t CCLatencyNow();
+
+class CCLatencyTrace
+{
+private:
+	struct ClockSample
+	{
+		int64_t offset; // remote - local
+		int64_t roundTrip;
+	};
+
+	std::mutex			_mutex;
+	CCLatencyHistogram	_stages[(int)LatencyStage::COUNT];
+
+	ClockSample			_clockSamples[CC_LATENCY_CLOCK_SAMPLES];
+	size_t				_clockSampleCount;
+	size_t				_nextClockSample;
+	ClockSample			_clock; // the best of _clockSamples
+
+	// the last delivered event, waiting for its injection time
+	bool				_hasPending;
+	int64_t				_pendingCapturedAt;
+	int64_t				_pendingReceivedAt; // client clock
+
+	void RecordStage(LatencyStage stage, int64_t value);
+
+public:
+	CCLatencyTrace();
+
+	// a heartbeat sent at {sentAt} was answered with the remote clock {remoteAt} and arrived back at {receivedAt}
+	void AddClockSample(int64_t sentAt, int64_t remoteAt, int64_t receivedAt);
+
+	// an event reached the client, {remoteReceivedAt} and {remotePreviousInjectedAt} are client clock,
+	// {remotePreviousInjectedAt} is 0 if the client hasn't injected anything on this connection yet
+	void EventDelivered(int64_t capturedAt, int64_t enqueuedAt, int64_t sentAt, int64_t remoteReceivedAt, int64_t remotePreviousInjectedAt);
+	// the connection broke, the pending event's injection time will never come
+	void ConnectionReset();
+
+	void Reset();
+	// adds every stage to {stages}, which has LatencyStage::COUNT histograms
+	void AddStagesTo(std::vector<CCLatencyHistogram>& stages);
+
+	// {clock, stages: {name: histogram}}, see HistogramToJson
+	nlohmann::json ToJson(uint64_t withinUs);
+
+	// {count, minUs, meanUs, p50Us, p90Us, p99Us, p999Us, maxUs} and within, the fraction of values
+	// at most {withinUs}, when it isn't 0
+	static nlohmann::json HistogramToJson(const CCLatencyHistogram& histogram, uint64_t withinUs);
+	static nlohmann::json StagesToJson(const std::vector<CCLatencyHistogram>& stages, uint64_t withinUs);
+};
+
+#endif
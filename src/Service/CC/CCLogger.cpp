@@ -1,23 +1,384 @@
 #include "CCLogger.h"
+#include "CCStructuredLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#define LOG_FLUSH_INTERVAL_MS 10
 
 CCLogger CCLogger::logger;
 
-CCLogger::CCLogger() : _logLevel(LogLevel::Info), _funcLogLevel(LogLevel::Info), _ostream(std::cout)
+static uint64_t LogTimestamp()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// everything a thread needs to log, created the first time that thread logs
+struct CCLogThreadState
+{
+	std::shared_ptr<CCLogRing>	ring;
+	CCLogRecordBuffer			buffer;
+	std::ostream				stream;
+	CCLogRecord					overflowRecord; // structured records go here when the ring is full
+
+	CCLogThreadState() : ring(CCLogger::logger.RegisterThread()), buffer(ring.get()), stream(&buffer) {}
+	~CCLogThreadState() { ring->Retire(); }
+};
+
+static CCLogThreadState& LogThreadState()
 {
+	static thread_local CCLogThreadState state;
+	return state;
+}
+
+// CCLogRing
 
+CCLogRing::CCLogRing() : _head(0), _tail(0), _isRetired(false)
+{
 }
 
-void CCLogger::Info()
+CCLogRecord* CCLogRing::Reserve()
 {
-	_funcLogLevel = LogLevel::Info;
+	uint32_t head = _head.load(std::memory_order_relaxed);
+	uint32_t tail = _tail.load(std::memory_order_acquire);
+
+	if (head - tail >= CC_LOG_RING_SIZE)
+		return NULL;
+
+	return &_records[head & (CC_LOG_RING_SIZE - 1)];
 }
 
-void CCLogger::Debug()
+void CCLogRing::Commit()
 {
-	_funcLogLevel = LogLevel::Debug;
+	_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
 }
 
-void CCLogger::Error()
+bool CCLogRing::Pop(CCLogRecord& record)
+{
+	uint32_t tail = _tail.load(std::memory_order_relaxed);
+	uint32_t head = _head.load(std::memory_order_acquire);
+
+	if (tail == head)
+		return false;
+
+	const CCLogRecord& slot = _records[tail & (CC_LOG_RING_SIZE - 1)];
+	record.timestamp = slot.timestamp;
+	record.length = slot.length;
+	record.site = slot.site;
+	record.level = slot.level;
+	memcpy(record.text, slot.text, slot.site ? slot.length * sizeof(int64_t) : slot.length);
+
+	_tail.store(tail + 1, std::memory_order_release);
+
+	return true;
+}
+
+// CCLogRecordBuffer
+
+CCLogRecordBuffer::CCLogRecordBuffer(CCLogRing* ring) : _ring(ring), _record(0), _level(LogLevel::Info), _timestamp(0)
+{
+}
+
+void CCLogRecordBuffer::Begin()
+{
+	_record = _ring->Reserve();
+	if (_record == NULL)
+	{
+		CCLogger::logger.RecordDropped();
+		_record = &_overflowRecord;
+	}
+
+	_record->timestamp = _timestamp;
+	_record->level = _level;
+	_record->site = 0;
+
+	setp(_record->text, _record->text + sizeof(_record->text));
+}
+
+void CCLogRecordBuffer::Start(LogLevel level)
+{
+	_level = level;
+	_timestamp = LogTimestamp();
+
+	Begin();
+}
+
+void CCLogRecordBuffer::Finish()
+{
+	_record->length = (uint16_t)(pptr() - pbase());
+
+	if (_record != &_overflowRecord && _record->length > 0)
+		_ring->Commit();
+
+	setp(0, 0);
+}
+
+CCLogRecordBuffer::int_type CCLogRecordBuffer::overflow(int_type ch)
+{
+	// record is full, send it as is and keep going in a new one
+	Finish();
+	Begin();
+
+	if (traits_type::eq_int_type(ch, traits_type::eof()) == false)
+	{
+		*pptr() = traits_type::to_char_type(ch);
+		pbump(1);
+	}
+
+	return traits_type::not_eof(ch);
+}
+
+// CCLogStream
+
+CCLogStream::CCLogStream(LogLevel level) : _ostream(LogThreadState().stream)
+{
+	CCLogThreadState& state = LogThreadState();
+	state.stream.clear();
+	state.buffer.Start(level);
+}
+
+CCLogStream::~CCLogStream()
+{
+	LogThreadState().buffer.Finish();
+}
+
+CCLogRecord* CCLogBeginRecord(LogLevel level, uint16_t site)
+{
+	CCLogThreadState& state = LogThreadState();
+
+	CCLogRecord* record = state.ring->Reserve();
+	if (record == NULL)
+	{
+		CCLogger::logger.RecordDropped();
+		record = &state.overflowRecord;
+	}
+
+	record->timestamp = LogTimestamp();
+	record->level = level;
+	record->site = site;
+	record->length = 0;
+
+	return record;
+}
+
+void CCLogCommitRecord(CCLogRecord* record)
+{
+	CCLogThreadState& state = LogThreadState();
+
+	if (record != &state.overflowRecord)
+		state.ring->Commit();
+}
+
+// CCLogger
+
+CCLogger::CCLogger() : _logLevel((int)LogLevel::Info), _ostream(std::cout), _droppedRecords(0), _flushRequests(0), \
+_shouldRun(true), _flushedRequests(0), _startTimestamp(LogTimestamp()), _binaryLogStrings(0)
 {
-	_funcLogLevel = LogLevel::Error;
+	_flushThread = std::thread(&CCLogger::FlushThread, this);
+}
+
+CCLogger::~CCLogger()
+{
+	{
+		std::lock_guard<std::mutex> lock(_flushMutex);
+		_shouldRun = false;
+	}
+	_flushCondition.notify_all();
+
+	if (_flushThread.joinable())
+		_flushThread.join();
+}
+
+std::shared_ptr<CCLogRing> CCLogger::RegisterThread()
+{
+	auto ring = std::make_shared<CCLogRing>();
+
+	std::lock_guard<std::mutex> lock(_ringsMutex);
+	_rings.push_back(ring);
+
+	return ring;
+}
+
+uint32_t CCLogger::InternString(const std::string& value)
+{
+	std::lock_guard<std::mutex> lock(_stringsMutex);
+
+	auto itr = _stringIDs.find(value);
+	if (itr != _stringIDs.end())
+		return itr->second;
+
+	uint32_t id = (uint32_t)_strings.size();
+	_strings.push_back(value);
+	_stringIDs[value] = id;
+
+	return id;
+}
+
+std::string CCLogger::GetInternedString(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(_stringsMutex);
+
+	if (id < _strings.size())
+		return _strings[id];
+
+	return "<unknown " + std::to_string(id) + ">";
+}
+
+bool CCLogger::OpenBinaryLog(const std::string& path)
+{
+	std::unique_ptr<CCBinaryLogWriter> writer(new CCBinaryLogWriter());
+	if (writer->Open(path, _startTimestamp) == false)
+		return false;
+
+	std::lock_guard<std::mutex> lock(_binaryLogMutex);
+	_binaryLog = std::move(writer);
+	_binaryLogStrings = 0;
+
+	return true;
+}
+
+void CCLogger::WriteBinaryRecords(const std::vector<CCLogRecord>& batch)
+{
+	std::lock_guard<std::mutex> lock(_binaryLogMutex);
+
+	// strings go out before any record that could reference them
+	{
+		std::lock_guard<std::mutex> stringsLock(_stringsMutex);
+		for (; _binaryLogStrings < _strings.size(); _binaryLogStrings++)
+		{
+			_binaryLog->WriteString((uint32_t)_binaryLogStrings, _strings[_binaryLogStrings]);
+		}
+	}
+
+	for (auto& record : batch)
+	{
+		if (record.site)
+			_binaryLog->WriteRecord(record);
+	}
+
+	_binaryLog->Flush();
+}
+
+void CCLogger::Flush()
+{
+	std::unique_lock<std::mutex> lock(_flushMutex);
+	uint64_t request = ++_flushRequests;
+
+	_flushCondition.notify_all();
+	_flushCondition.wait(lock, [this, request]() { return _flushedRequests >= request || _shouldRun == false; });
+}
+
+bool CCLogger::WriteBatch(std::vector<CCLogRecord>& batch)
+{
+	std::vector<std::shared_ptr<CCLogRing>> rings;
+	{
+		std::lock_guard<std::mutex> lock(_ringsMutex);
+		rings = _rings;
+
+		// rings of threads that have exited are dropped once they are drained
+		_rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const std::shared_ptr<CCLogRing>& ring) {
+			return ring->GetIsRetired() && ring->GetIsEmpty();
+		}), _rings.end());
+	}
+
+	batch.clear();
+
+	for (auto& ring : rings)
+	{
+		CCLogRecord record;
+		while (ring->Pop(record))
+		{
+			batch.push_back(record);
+		}
+	}
+
+	uint64_t dropped = _droppedRecords.exchange(0, std::memory_order_relaxed);
+
+	if (batch.empty() && dropped == 0)
+		return false;
+
+	// records from the same statement share a timestamp so a stable sort keeps split messages together
+	std::stable_sort(batch.begin(), batch.end(), [](const CCLogRecord& lh, const CCLogRecord& rh) {
+		return lh.timestamp < rh.timestamp;
+	});
+
+	bool hasBinaryLog = false;
+	{
+		std::lock_guard<std::mutex> lock(_binaryLogMutex);
+		hasBinaryLog = _binaryLog.get() != NULL;
+	}
+
+	if (hasBinaryLog)
+		WriteBinaryRecords(batch);
+
+	std::string output;
+	output.reserve(batch.size() * 64);
+
+	auto lookupString = [this](uint32_t id) { return GetInternedString(id); };
+
+	for (auto& record : batch)
+	{
+		if (record.site == 0)
+		{
+			output.append(record.text, record.length);
+		}
+		else if (hasBinaryLog == false)
+		{
+			const CCLogSiteInfo* info = CCLogSiteInfoFor(record.site);
+			if (info)
+			{
+				CCLogRenderSite(info->format, record.args, record.length, lookupString, output);
+				output += '\n';
+			}
+		}
+	}
+
+	if (dropped)
+	{
+		output += "CCLogger dropped " + std::to_string(dropped) + " log records\n";
+	}
+
+	if (output.empty() == false)
+	{
+		_ostream.write(output.c_str(), output.size());
+		_ostream.flush();
+	}
+
+	return true;
+}
+
+void CCLogger::FlushThread()
+{
+	std::vector<CCLogRecord> batch;
+	batch.reserve(CC_LOG_RING_SIZE);
+
+	while (true)
+	{
+		uint64_t requested = 0;
+		bool shouldRun = true;
+		{
+			std::unique_lock<std::mutex> lock(_flushMutex);
+			_flushCondition.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS), [this]() {
+				return _flushRequests != _flushedRequests || _shouldRun == false;
+			});
+
+			requested = _flushRequests;
+			shouldRun = _shouldRun;
+		}
+
+		while (WriteBatch(batch))
+		{
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_flushMutex);
+			_flushedRequests = requested;
+		}
+		_flushCondition.notify_all();
+
+		if (shouldRun == false)
+			break;
+	}
 }
@@ -1,6 +1,16 @@
 #ifndef CC_LOGGER_H
 #define CC_LOGGER_H
 #include <iostream>
+#include <streambuf>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
 
 enum class LogLevel :int
 {
@@ -10,46 +20,176 @@ enum class LogLevel :int
 	None =	0
 };
 
+/*
+*	CCLogger is asynchronous. Every thread that logs gets its own single producer / single consumer
+*	ring of fixed size records. A log statement formats into a record in that ring and a background
+*	thread drains all rings, orders the records by time and writes them to the output in batches.
+*
+*	Producers never lock or block. If a ring is full the record is dropped and counted.
+*	Level filtering happens in the LOG_ macros so arguments are not evaluated for disabled levels.
+*
+*	Records are either text or structured (see CCStructuredLog.h). Structured records carry a site ID
+*	and raw arguments and are rendered by the logger thread, or written to a binary log if one is open.
+*/
+
+#define CC_LOG_RECORD_SIZE	256
+#define CC_LOG_RING_SIZE	256 // must be a power of two
+#define CC_LOG_MAX_ARGS		((CC_LOG_RECORD_SIZE - 16) / 8)
+
+struct CCLogRecord
+{
+	uint64_t	timestamp;	// steady clock in nanoseconds
+	uint16_t	length;		// bytes of text or number of args for structured records
+	uint16_t	site;		// 0 for text records otherwise a CCLogSite
+	LogLevel	level;
+	union
+	{
+		char	text[CC_LOG_RECORD_SIZE - 16];
+		int64_t	args[CC_LOG_MAX_ARGS];
+	};
+};
+
+class CCLogRing
+{
+private:
+	CCLogRecord				_records[CC_LOG_RING_SIZE];
+	std::atomic<uint32_t>	_head; // next slot the producer writes, only written by producer
+	std::atomic<uint32_t>	_tail; // next slot the consumer reads, only written by consumer
+	std::atomic<bool>		_isRetired; // set when the owning thread exits
+
+public:
+	CCLogRing();
+
+	// returns a free slot or NULL if the ring is full. Only the owning thread may call this
+	CCLogRecord* Reserve();
+	// publishes the slot returned by the last Reserve
+	void Commit();
+	// copies out the oldest record, returns false if empty. Only the logger thread may call this
+	bool Pop(CCLogRecord& record);
+
+	inline void Retire() { _isRetired.store(true, std::memory_order_release); }
+	inline bool GetIsRetired()const { return _isRetired.load(std::memory_order_acquire); }
+	inline bool GetIsEmpty()const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed); }
+};
+
+// streambuf that writes straight into the reserved record, when the record fills up
+// it is committed and a new one is reserved so long messages are split instead of truncated
+class CCLogRecordBuffer : public std::streambuf
+{
+private:
+	CCLogRing*		_ring;
+	CCLogRecord*	_record;
+	CCLogRecord		_overflowRecord; // used when the ring is full, never committed
+	LogLevel		_level;
+	uint64_t		_timestamp;
+
+	void Begin();
+
+protected:
+	virtual int_type overflow(int_type ch)override;
+
+public:
+	CCLogRecordBuffer(CCLogRing* ring);
+
+	void Start(LogLevel level);
+	void Finish();
+};
+
+class CCBinaryLogWriter;
 class CCLogger
 {
 private:
-	LogLevel _logLevel;
-	LogLevel _funcLogLevel;
-	std::ostream& _ostream;
+	std::atomic<int>	_logLevel;
+	std::ostream&		_ostream;
+
+	std::mutex								_ringsMutex; // only taken when a thread logs for the first time
+	std::vector<std::shared_ptr<CCLogRing>>	_rings;
+
+	std::atomic<uint64_t>	_droppedRecords;
+	uint64_t				_flushRequests; // guarded by _flushMutex
+	std::atomic<bool>		_shouldRun;
+	std::mutex				_flushMutex;
+	std::condition_variable	_flushCondition;
+	std::thread				_flushThread;
+	uint64_t				_flushedRequests; // guarded by _flushMutex
+	uint64_t				_startTimestamp;
 
+	std::mutex									_stringsMutex;
+	std::unordered_map<std::string, uint32_t>	_stringIDs;
+	std::vector<std::string>					_strings;
+
+	std::mutex							_binaryLogMutex;
+	std::unique_ptr<CCBinaryLogWriter>	_binaryLog;
+	size_t								_binaryLogStrings; // interned strings already written to the binary log
 
 	CCLogger();
+	~CCLogger();
+
+	void FlushThread();
+	// drains every ring and writes the batch, returns false if there was nothing to write
+	bool WriteBatch(std::vector<CCLogRecord>& batch);
+	void WriteBinaryRecords(const std::vector<CCLogRecord>& batch);
+
 public:
 
-	void Info();
-	void Debug();
-	void Error();
+	inline bool IsEnabled(LogLevel level)const
+	{
+		return (int)level <= _logLevel.load(std::memory_order_relaxed);
+	}
+
+	inline void SetLogLevel(LogLevel level)
+	{_logLevel.store((int)level, std::memory_order_relaxed);}
+
+	// creates the ring for the calling thread, called once per thread
+	std::shared_ptr<CCLogRing> RegisterThread();
+	// blocks until everything logged before this call has been written
+	void Flush();
+
+	inline void RecordDropped() { _droppedRecords.fetch_add(1, std::memory_order_relaxed); }
+
+	// returns a stable ID for {value} that structured records can log with %s
+	// this locks so callers should intern once and keep the ID (i.e. entity IDs)
+	uint32_t InternString(const std::string& value);
+	std::string GetInternedString(uint32_t id);
+
+	// structured records are written to {path} instead of being rendered as text
+	bool OpenBinaryLog(const std::string& path);
+
+	static CCLogger logger;
+};
+
+// one per log statement, lives until the end of the full expression and then commits its record
+class CCLogStream
+{
+private:
+	std::ostream& _ostream;
+
+public:
+	CCLogStream(LogLevel level);
+	~CCLogStream();
 
 	template<typename t>
-	CCLogger& operator <<(const t& other)
+	CCLogStream& operator <<(const t& other)
 	{
-		if(_funcLogLevel <= _logLevel)
-			_ostream << other;
-
+		_ostream << other;
 		return *this;
 	}
 	typedef std::ostream& (*StandardEndLine)(std::ostream&);
-	CCLogger& operator <<(StandardEndLine endl)
+	CCLogStream& operator <<(StandardEndLine endl)
 	{
-		if (_funcLogLevel <= _logLevel)
-			endl(_ostream);
-
+		endl(_ostream);
 		return *this;
 	}
+};
 
-	inline void SetLogLevel(LogLevel level)
-	{_logLevel = level;}
+// used by CCLogStructured, returns a record that must be passed to CCLogCommitRecord
+extern CCLogRecord* CCLogBeginRecord(LogLevel level, uint16_t site);
+extern void CCLogCommitRecord(CCLogRecord* record);
 
-	static CCLogger logger;
-};
+#define CC_LOG(level) if (!CCLogger::logger.IsEnabled(level)) {} else CCLogStream(level)
 
-#define LOG_INFO CCLogger::logger.Info();CCLogger::logger
-#define LOG_DEBUG CCLogger::logger.Debug();CCLogger::logger
-#define LOG_ERROR CCLogger::logger.Error();CCLogger::logger
+#define LOG_INFO CC_LOG(LogLevel::Info)
+#define LOG_DEBUG CC_LOG(LogLevel::Debug)
+#define LOG_ERROR CC_LOG(LogLevel::Error)
 
-#endif
\ No newline at end of file
+#endif
@@ -1,18 +1,27 @@
 #include "CCMain.h"
 
 #include "CCLogger.h"
+#include "CCStructuredLog.h"
 #include "CCServer.h"
 #include "CCClient.h"
 #include "CCDisplay.h"
 #include "CCNetworkEntity.h"
 #include "CCBroadcastManager.h"
+#include "CCInputRecording.h"
+#include "CCLatencyTrace.h"
+#include "CCTrace.h"
+#include "CCMetrics.h"
+#include "CCBackoff.h"
 
 #include "../Socket/Socket.h"
 #include "../Socket/SocketException.h"
 #include "../OSInterface/OSInterface.h"
 
 #include <algorithm>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <stdexcept>
 #include <chrono>
 #include <thread>
 
@@ -21,6 +30,23 @@
 #define DELTA_X_MAX 200
 #define DELTA_Y_MAX 200
 
+// a client whose server is gone tries it again this often, backing off to the cap
+#define CC_SERVER_RECONNECT_BASE_MS 100
+#define CC_SERVER_RECONNECT_CAP_MS 5000
+
+// how often the server announces itself while it is in use, see CCIdleMonitor.h for idle
+#define CC_BROADCAST_INTERVAL_MS 5000
+
+// long enough to connect and probe an entity on a LAN before the cursor gets there
+#define CC_JUMP_PREDICTION_HORIZON_MS 150
+
+// several CCMain can share a process (cc_pipeline), the entity gauge is only ever moved by deltas
+static CCGauge& EntityGauge()
+{
+	static CCGauge& gauge = CCMetricRegistry::registry.Gauge("cc_entities", "Entities in the session, this one included");
+	return gauge;
+}
+
 template<typename t>
 bool operator==(std::shared_ptr<t> lh, t* rh)
 {
@@ -41,28 +67,310 @@ std::ostream& operator <<(std::ostream& os, const Point& p)
 std::string BroadcastAddressFromIPAndSubnetMask(std::string IPv4, std::string subnet);
 
 // Info uses tcp 6555
+// entity control uses tcp 1045, entity events use tcp 1048
 // gui uses tcp 1049
 // Discovery uses udp 1046
 // OSEvents use udo 1265
 
 void CCMain::SetupEntityConnections()
+{
+	SetupEntityConnections(_entites);
+}
+
+size_t CCMain::GetEntityCount()
+{
+	std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+	return _entites.size();
+}
+
+bool CCMain::StartRecording(const std::string& path)
+{
+	StopRecording();
+
+	std::unique_ptr<CCInputRecorder> recorder(new CCInputRecorder());
+	if (recorder->Open(path) == false)
+	{
+		LOG_ERROR << "Could not open input recording " << path << std::endl;
+		return false;
+	}
+
+	// a recording always starts with the layout it was made in
+	recorder->RecordLayout(BuildLayout());
+
+	OSInterfaceError error = OSInterface::SharedInterface().RegisterForOSEvents(recorder.get());
+	if (error != OSInterfaceError::OS_E_SUCCESS)
+	{
+		LOG_ERROR << "Could not record input: " << OSInterfaceErrorToString(error) << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_recorderMutex);
+	_recorder = std::move(recorder);
+
+	LOG_INFO << "Recording input to " << path << std::endl;
+	return true;
+}
+
+void CCMain::StopRecording()
+{
+	std::unique_ptr<CCInputRecorder> recorder;
+	{
+		std::lock_guard<std::mutex> lock(_recorderMutex);
+		recorder = std::move(_recorder);
+	}
+
+	if (recorder.get() == 0)
+		return;
+
+	OSInterface::SharedInterface().UnRegisterForOSEvents(recorder.get());
+	recorder->Close();
+
+	LOG_INFO << "Recorded " << recorder->GetEventCount() << " input events, " << recorder->GetDroppedCount() << " dropped" << std::endl;
+}
+
+std::string CCMain::BuildLayout()
+{
+	using nlohmann::json;
+
+	json entities = json::array();
+	{
+		std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+
+		for (auto& entity : _entites)
+		{
+			json displays = json::array();
+			for (auto& display : entity->GetAllDisplays())
+			{
+				const NativeDisplay& native = display->GetNativeDisplay();
+				displays.push_back({ native.nativeScreenID, native.posX, native.posY, native.width, native.height });
+			}
+
+			json jEntity;
+			jEntity["id"] = entity->GetID();
+			jEntity["offsets"] = { entity->GetOffsets().x, entity->GetOffsets().y };
+			jEntity["displays"] = std::move(displays);
+
+			entities.push_back(std::move(jEntity));
+		}
+	}
+
+	json layout;
+	layout["local"] = _localEntity->GetID();
+	layout["current"] = _currentEntity->GetID();
+	layout["cursor"] = { _currentMousePosition.x, _currentMousePosition.y };
+	layout["mouseOffsets"] = { _currentMouseOffsets.x, _currentMouseOffsets.y };
+	layout["entities"] = std::move(entities);
+
+	return layout.dump();
+}
+
+bool CCMain::LoadLayout(const std::string& layout)
+{
+	using nlohmann::json;
+
+	struct EntityLayout
+	{
+		std::string					id;
+		Point						offsets;
+		std::vector<NativeDisplay>	displays;
+	};
+
+	std::vector<EntityLayout> entityLayouts;
+	std::string localID;
+	std::string currentID;
+	Point cursor;
+	Point mouseOffsets;
+
+	// parsed completely before anything is touched
+	try
+	{
+		json jLayout = json::parse(layout);
+
+		localID = jLayout.at("local").get<std::string>();
+		currentID = jLayout.at("current").get<std::string>();
+		cursor = Point(jLayout.at("cursor").at(0).get<int>(), jLayout.at("cursor").at(1).get<int>());
+		mouseOffsets = Point(jLayout.at("mouseOffsets").at(0).get<int>(), jLayout.at("mouseOffsets").at(1).get<int>());
+
+		for (auto& jEntity : jLayout.at("entities"))
+		{
+			EntityLayout entityLayout;
+			entityLayout.id = jEntity.at("id").get<std::string>();
+			entityLayout.offsets = Point(jEntity.at("offsets").at(0).get<int>(), jEntity.at("offsets").at(1).get<int>());
+
+			for (auto& jDisplay : jEntity.at("displays"))
+			{
+				NativeDisplay display;
+				display.nativeScreenID = jDisplay.at(0).get<int>();
+				display.posX = jDisplay.at(1).get<int>();
+				display.posY = jDisplay.at(2).get<int>();
+				display.width = jDisplay.at(3).get<int>();
+				display.height = jDisplay.at(4).get<int>();
+
+				entityLayout.displays.push_back(display);
+			}
+
+			entityLayouts.push_back(std::move(entityLayout));
+		}
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR << "Invalid layout: " << e.what() << std::endl;
+		return false;
+	}
+
+	auto localLayout = std::find_if(entityLayouts.begin(), entityLayouts.end(), [&localID](const EntityLayout& entityLayout) {
+		return entityLayout.id == localID;
+	});
+
+	if (localLayout == entityLayouts.end())
+	{
+		LOG_ERROR << "Layout doesn't have the local entity " << localID << std::endl;
+		return false;
+	}
+
+	// the local entity stays first, SetupGlobalPositions relies on it
+	std::iter_swap(entityLayouts.begin(), localLayout);
+
+	std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+
+	EntityGauge().Add(-(int64_t)_entites.size());
+	_entites.clear();
+	_lostEntites.clear();
+	_currentEntity = _localEntity.get();
+
+	for (auto& entityLayout : entityLayouts)
+	{
+		bool isLocal = _entites.empty();
+		std::shared_ptr<CCNetworkEntity> entity = isLocal ? _localEntity : std::make_shared<CCNetworkEntity>(entityLayout.id, (Socket*)0);
+
+		if (isLocal)
+		{
+			for (auto& display : entity->GetAllDisplays())
+			{
+				entity->RemoveDisplay(display);
+			}
+		}
+
+		for (auto& display : entityLayout.displays)
+		{
+			entity->AddDisplay(std::make_shared<CCDisplay>(display));
+		}
+
+		entity->SetDisplayOffsets(entityLayout.offsets);
+		_entites.push_back(entity);
+		EntityGauge().Add(1);
+
+		if (entityLayout.id == currentID)
+			_currentEntity = entity.get();
+	}
+
+	_currentMousePosition = cursor;
+	_currentMouseOffsets = mouseOffsets;
+	_ignoreInputEvent = false;
+
+	SetupEntityConnections();
+	SetupGlobalPositions();
+
+	return true;
+}
+
+void CCMain::SetupEntityConnections(const std::vector<std::shared_ptr<CCNetworkEntity>>& entities)
 {
 	// clear everybody before reassigning
 
-	for (auto entity : _entites)
+	for (auto entity : entities)
 	{
 		entity->ClearAllEntities();
 	}
 
-	for (int i = 0; i < _entites.size(); i++)
+	for (int i = 0; i < entities.size(); i++)
+	{
+		auto entity = entities[i];
+
+		for (int l = i + 1; l < entities.size(); l++)
+		{
+			entity->AddEntityIfInProximity(entities[l].get());
+		}
+	}
+}
+
+void CCMain::UpdateEntityConnections(const std::vector<CCNetworkEntity*>& changed)
+{
+	for (auto entity : changed)
 	{
-		auto entity = _entites[i];
+		entity->DisconnectFromAll();
+	}
+
+	for (int i = 0; i < changed.size(); i++)
+	{
+		for (auto& other : _entites)
+		{
+			// pairs of changed entities are only added once
+			auto itr = std::find(changed.begin(), changed.end(), other.get());
+			if (other == changed[i] || (itr != changed.end() && itr - changed.begin() < i))
+				continue;
+
+			changed[i]->AddEntityIfInProximity(other.get());
+		}
+	}
+}
+
+void CCMain::ReloadConfig()
+{
+	std::ifstream inFile(_configFile, std::ios::binary);
+	if (inFile.good() == false)
+		return;
+
+	std::string contents((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+
+	// our own save coming back around
+	if (std::hash<std::string>()(contents) == _configPersister->GetLastWrittenHash())
+		return;
+
+	std::vector<CCNetworkEntity*> changed;
+	{
+		std::lock_guard<std::mutex> configLock(_configMutex);
+
+		if (_configManager.LoadFromString(contents) == false)
+		{
+			LOG_ERROR << "Ignoring invalid config change in " << _configFile << std::endl;
+			return;
+		}
+
+		_idleMonitor->LoadFrom(_configManager);
+		_hotkeys.LoadFrom(_configManager);
+		_acceleration.LoadFrom(_configManager);
+
+		std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+
+		for (auto& entity : _entites)
+		{
+			Point offsets = entity->GetOffsets();
+			entity->LoadFrom(_configManager);
+
+			if (entity->GetOffsets().x != offsets.x || entity->GetOffsets().y != offsets.y)
+				changed.push_back(entity.get());
+		}
 
-		for (int l = i + 1; l < _entites.size(); l++)
+		// the input thread looks up jump zones under the same lock, it never sees half of a layout
+		if (changed.empty() == false)
 		{
-			entity->AddEntityIfInProximity(_entites[l].get());
+			UpdateEntityConnections(changed);
+
+			if (std::find(changed.begin(), changed.end(), _localEntity.get()) != changed.end())
+				_currentMouseOffsets = _localEntity->GetOffsets();
+
+			SetupGlobalPositions();
 		}
 	}
+
+	LOG_INFO << "Config reloaded, " << changed.size() << " entities moved" << std::endl;
+
+	if (changed.empty())
+		return;
+
+	_guiService.OffsetsChanged(changed);
+	LayoutChanged();
 }
 
 void CCMain::RemoveLostEntites()
@@ -74,20 +382,176 @@ void CCMain::RemoveLostEntites()
 		{
 			auto itr = std::find(_entites.begin(), _entites.end(), entity);
 			if (itr != _entites.end())
+			{
 				_entites.erase(itr);
+				EntityGauge().Add(-1);
+			}
 		}
 		_lostEntites.clear();
 	}
 
 	SetupEntityConnections();
+	LayoutChanged();
 }
 
-CCMain::CCMain() : _server(new CCServer(6555, SOCKET_ANY_ADDRESS, this)), _client(new CCClient(1047)),
-_clientShouldRun(false), _serverShouldRun(false), _globalBounds({0,0,0,0}), _guiService(this), \
-_configFile("cc.json"), _ignoreInputEvent(false)
+void CCMain::EventRouted(const OSEvent& event, InputRoute route)
 {
-	auto displayList = _client->GetDisplayList();
+	static CCCounter* routed[] = {
+		&CCMetricRegistry::registry.Counter("cc_input_events_total", "Input events by where they were routed", { {"route", "skipped"} }),
+		&CCMetricRegistry::registry.Counter("cc_input_events_total", "Input events by where they were routed", { {"route", "local"} }),
+		&CCMetricRegistry::registry.Counter("cc_input_events_total", "Input events by where they were routed", { {"route", "remote"} }),
+		&CCMetricRegistry::registry.Counter("cc_input_events_total", "Input events by where they were routed", { {"route", "remote_failed"} })
+	};
+
+	routed[(int)route]->Add();
+
+	if (_routeObserver)
+		_routeObserver->EventRouted(event, _currentEntity, route);
+}
+
+void CCMain::EntityJumped(CCNetworkEntity* to)
+{
+	static CCCounter& jumps = CCMetricRegistry::registry.Counter("cc_jumps_total", "Cursor jumps between entities");
+	jumps.Add();
+
+	// fractions of a pixel don't carry over to another entity
+	_acceleration.Reset();
+
+	// the cursor was put somewhere else, an entity that comes back doesn't take it
+	_unreachableEntity = NULL;
+
+	if (_routeObserver)
+		_routeObserver->EntityJumped(_currentEntity, to);
+}
+
+void CCMain::WarmUpApproachedEntity(Point position, int64_t now)
+{
+	Point predicted = _cursorPredictor.Predict(position, now, CC_JUMP_PREDICTION_HORIZON_MS * 1000);
+	if (predicted.x == position.x && predicted.y == position.y)
+		return;
+
+	JumpDirection direction;
+	CCNetworkEntity* approachedEntity = 0;
+	if (_currentEntity->GetEntityForPointInJumpZone(predicted, &approachedEntity, direction) && approachedEntity->GetIsLocal() == false)
+		approachedEntity->WarmUp();
+}
+
+void CCMain::JumpToCenter(CCNetworkEntity* entity, int64_t capturedAt)
+{
+	if (_currentEntity != entity)
+	{
+		EntityJumped(entity);
+
+		_currentEntity->ReleaseHeldKeys(capturedAt);
+		_currentEntity->RPC_HideMouse();
+	}
+
+	_currentEntity = entity;
+	UpdateMouseCapture();
+
+	_currentEntity->RPC_UnhideMouse();
+	_currentEntity->RPC_SetMousePosition(0.5, 0.5);
+
+	Rect bounds = _currentEntity->GetBounds();
+	_currentMousePosition = bounds.topLeft + ((bounds.bottomRight - bounds.topLeft) / 2) - _currentMouseOffsets;
+}
+
+bool CCMain::UpdateMouseCapture()
+{
+	bool shouldCapture = _canCaptureMouse && _currentEntity->GetIsLocal() == false;
+	if (shouldCapture == _isMouseCaptured)
+		return _isMouseCaptured;
+
+	OSInterfaceError error = OSInterface::SharedInterface().SetRelativeMouseCapture(shouldCapture);
+	if (error != OSInterfaceError::OS_E_SUCCESS && shouldCapture)
+	{
+		LOG_ERROR << "Could not capture the mouse with " << OSInterfaceErrorToString(error) << ", warping it to the center instead" << std::endl;
+		_canCaptureMouse = false;
+		return false;
+	}
 
+	_isMouseCaptured = shouldCapture;
+	return _isMouseCaptured;
+}
+
+void CCMain::RunHotkey(const CCHotkeyChord& chord, int64_t capturedAt)
+{
+	static CCCounter* fired[] = {
+		&CCMetricRegistry::registry.Counter("cc_hotkeys_total", "Hotkeys that fired by action", { {"action", "home"} }),
+		&CCMetricRegistry::registry.Counter("cc_hotkeys_total", "Hotkeys that fired by action", { {"action", "jump_to"} }),
+		&CCMetricRegistry::registry.Counter("cc_hotkeys_total", "Hotkeys that fired by action", { {"action", "lock"} }),
+		&CCMetricRegistry::registry.Counter("cc_hotkeys_total", "Hotkeys that fired by action", { {"action", "toggle_forwarding"} })
+	};
+
+	fired[(int)chord.action]->Add();
+
+	switch (chord.action)
+	{
+	case CCHotkeyAction::HOME:
+		JumpToCenter(_localEntity.get(), capturedAt);
+		break;
+	case CCHotkeyAction::JUMP_TO:
+	{
+		CCNetworkEntity* entity = NULL;
+		{
+			std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+			for (auto& candidate : _entites)
+			{
+				if (candidate->GetID() == chord.entityID && std::find(_lostEntites.begin(), _lostEntites.end(), candidate.get()) == _lostEntites.end())
+					entity = candidate.get();
+			}
+		}
+
+		if (entity == NULL)
+			LOG_ERROR << "Hotkey can't jump to " << chord.entityID << ", it isn't in the session" << std::endl;
+		else if (_isForwardingPaused)
+			LOG_INFO << "Hotkey jump to " << chord.entityID << " ignored, forwarding is paused" << std::endl;
+		else
+			JumpToCenter(entity, capturedAt);
+		break;
+	}
+	case CCHotkeyAction::LOCK:
+		_isLockedToEntity = !_isLockedToEntity;
+		LOG_INFO << (_isLockedToEntity ? "Locked to " : "Unlocked from ") << _currentEntity->GetID() << std::endl;
+		break;
+	case CCHotkeyAction::TOGGLE_FORWARDING:
+		_isForwardingPaused = !_isForwardingPaused;
+		LOG_INFO << (_isForwardingPaused ? "Forwarding paused" : "Forwarding resumed") << std::endl;
+
+		if (_isForwardingPaused)
+			JumpToCenter(_localEntity.get(), capturedAt);
+		break;
+	}
+}
+
+void CCMain::WakeUp()
+{
+	{
+		std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+		for (auto& entity : _entites)
+		{
+			if (entity->GetIsLocal() == false)
+				entity->WakeUp();
+		}
+	}
+
+	// the broadcast loop looks at the idle state under its lock, so it can't miss this
+	{
+		std::lock_guard<std::mutex> lock(_broadcastMutex);
+	}
+	_broadcastCondition.notify_all();
+}
+
+void CCMain::LayoutChanged()
+{
+	std::lock_guard<std::mutex> lock(_recorderMutex);
+
+	if (_recorder)
+		_recorder->RecordLayout(BuildLayout());
+}
+
+std::string CCMain::LocalHostName()
+{
 	std::string hostName;
 	OSInterfaceError error = OSInterface::SharedInterface().GetLocalHostName(hostName);
 	if (error != OSInterfaceError::OS_E_SUCCESS)
@@ -96,9 +560,29 @@ _configFile("cc.json"), _ignoreInputEvent(false)
 		hostName = "Server";
 	}
 
+	return hostName;
+}
+
+CCMain::CCMain() : CCMain(LocalHostName(), SOCKET_ANY_ADDRESS)
+{
+}
+
+CCMain::CCMain(const std::string& entityID, const std::string& address) : _server(new CCServer(6555, address, this)), _client(new CCClient(1047, entityID, address)),
+_clientShouldRun(false), _serverShouldRun(false), _globalBounds({0,0,0,0}), _guiService(this), \
+_configFile("cc.json"), _ignoreInputEvent(false), _isMouseCaptured(false), _canCaptureMouse(true), _configWatcher([this]() { ReloadConfig(); }), _routeObserver(NULL), \
+_idleMonitor(std::make_shared<CCIdleMonitor>()), \
+_isLockedToEntity(false), _isForwardingPaused(false), _unreachableEntity(NULL)
+{
+	_configPersister = std::make_unique<CCConfigPersister>(_configFile, [this]() {
+		std::lock_guard<std::mutex> lock(_configMutex);
+		return _configManager.GetDocument();
+	});
+
+	auto displayList = _client->GetDisplayList();
+
 	// setup this computers entity
 
-	_localEntity = std::make_shared<CCNetworkEntity>(hostName);
+	_localEntity = std::make_shared<CCNetworkEntity>(entityID, address);
 	_currentEntity = _localEntity.get();
 
 	for (auto display : displayList)
@@ -111,10 +595,26 @@ _configFile("cc.json"), _ignoreInputEvent(false)
 
 CCMain::~CCMain()
 {
+	StopRecording();
+	_configPersister->Flush();
+
 	if(_serverShouldRun)
 		StopServer();
 	if (_clientShouldRun)
 		StopClient();
+
+	// heartbeat tasks can hold entities past this point, they must not call back into us
+	std::vector<std::shared_ptr<CCNetworkEntity>> entities;
+	{
+		std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+		entities = _entites;
+		EntityGauge().Add(-(int64_t)_entites.size());
+	}
+
+	for (auto& entity : entities)
+	{
+		entity->ShutdownThreads();
+	}
 }
 
 void CCMain::StartServerMain()
@@ -126,9 +626,12 @@ void CCMain::StartServerMain()
 
 	if (_guiService.StartGUIServer() == false)
 	{
-		throw std::exception("Could Not Start Gui Socket Server !");
+		throw std::runtime_error("Could Not Start Gui Socket Server !");
 	}
 
+	// layout edits in the config file are applied live instead of needing a restart
+	_configWatcher.Start(_configFile);
+
 	std::vector<IPAdressInfo> ipAddress;
 
 	OSInterfaceError error = OSInterface::SharedInterface().GetIPAddressList(ipAddress, {IPAddressType::UNICAST, IPAddressFamilly::IPv4});
@@ -137,12 +640,12 @@ void CCMain::StartServerMain()
 	{
 		std::string exceptionString = "Error Getting IP Address " + OSInterfaceErrorToString(error);
 		// there is nothing we can do here if we can't even get our address so exception time
-		throw std::exception(exceptionString.c_str());
+		throw std::runtime_error(exceptionString.c_str());
 	}
 
 	if (ipAddress.size() < 1)
 	{
-		throw std::exception("Could not start server because IP address could not be found");
+		throw std::runtime_error("Could not start server because IP address could not be found");
 	}
 
 	// Remove all Addresses that don't have a broadcastable address
@@ -173,7 +676,7 @@ void CCMain::StartServerMain()
 
 		exceptionString += OSInterfaceErrorToString(err);
 
-		throw std::exception(exceptionString.c_str());
+		throw std::runtime_error(exceptionString.c_str());
 	}
 #if REGISTER_OS_EVENTS
 	OSInterface::SharedInterface().RegisterForOSEvents(this);
@@ -198,7 +701,21 @@ void CCMain::StartServerMain()
 			// remove all queued lost entites
 			RemoveLostEntites();
 
-			std::this_thread::sleep_for(std::chrono::seconds(5));
+			std::unique_lock<std::mutex> lock(_broadcastMutex);
+
+			// a client waiting for us while we are idle is found as soon as somebody uses the input again
+			if (_idleMonitor->IsIdle(CCLatencyNow()))
+			{
+				_broadcastCondition.wait_for(lock, std::chrono::milliseconds(_idleMonitor->GetBroadcastIntervalMs()), [this]() {
+					return _serverShouldRun == false || _idleMonitor->GetIsIdle() == false;
+				});
+			}
+			else
+			{
+				_broadcastCondition.wait_for(lock, std::chrono::milliseconds(CC_BROADCAST_INTERVAL_MS), [this]() {
+					return _serverShouldRun == false;
+				});
+			}
 		}
 	});
 
@@ -207,6 +724,10 @@ void CCMain::StartServerMain()
 #if REGISTER_OS_EVENTS
 	OSInterface::SharedInterface().UnRegisterForOSEvents(this);
 #endif
+
+	if (_isMouseCaptured)
+		OSInterface::SharedInterface().SetRelativeMouseCapture(false);
+	_isMouseCaptured = false;
 }
 
 void CCMain::StartClientMain()
@@ -224,19 +745,73 @@ void CCMain::StartClientMain()
 	// this connection will be disconnected and the server will re-connect via the remote CCNetworkEntity
 	_client->ConnectToServer(address.first, address.second);
 
+	// a server we lose is tried again at the same address, not found through broadcasts again
+	_serverReconnectThread = std::thread(&CCMain::ServerReconnectThread, this);
+
 	OSInterface::SharedInterface().OSMainLoop();
 }
 
+void CCMain::StartClientMain(const std::string& serverAddress, int serverPort)
+{
+	_clientShouldRun = true;
+
+	// the server may still be starting, there is no broadcast to wait for and the
+	// reconnect thread keeps trying until it answers
+	_client->ConnectToServer(serverAddress, serverPort);
+	_serverReconnectThread = std::thread(&CCMain::ServerReconnectThread, this);
+
+	OSInterface::SharedInterface().OSMainLoop();
+}
+
+void CCMain::ServerReconnectThread()
+{
+	CCBackoff backoff(std::chrono::milliseconds(CC_SERVER_RECONNECT_BASE_MS), std::chrono::milliseconds(CC_SERVER_RECONNECT_CAP_MS));
+
+	std::unique_lock<std::mutex> lock(_serverReconnectMutex);
+
+	while (_clientShouldRun)
+	{
+		if (_client->GetNeedsNewServer() == false)
+		{
+			backoff.Reset();
+			_serverReconnectCondition.wait(lock);
+			continue;
+		}
+
+		// StopClient wakes us early
+		_serverReconnectCondition.wait_for(lock, backoff.Next());
+		if (_clientShouldRun == false)
+			break;
+
+		std::string address = _client->GetServerAddress();
+		int port = _client->GetServerPort();
+
+		lock.unlock();
+		LOG_INFO << "Reconnecting to server " << address << ":" << port << std::endl;
+		_client->ConnectToServer(address, port);
+		lock.lock();
+	}
+}
+
 void CCMain::StopServer()
 {
 	if (_serverShouldRun)
 		_server->StopServer();
 
-	_serverShouldRun = false;
+	{
+		std::lock_guard<std::mutex> lock(_broadcastMutex);
+		_serverShouldRun = false;
+	}
+	_broadcastCondition.notify_all();
+
+	_configWatcher.Stop();
+	_guiService.StopGUIServer();
 
 	OSInterface::SharedInterface().UnRegisterForOSEvents(this);
 
-	_serverBroadcastThread.join();
+	// not started if StartServerMain failed early
+	if (_serverBroadcastThread.joinable())
+		_serverBroadcastThread.join();
 }
 
 void CCMain::StopClient()
@@ -244,7 +819,15 @@ void CCMain::StopClient()
 	if (_clientShouldRun)
 		_client->StopClientSocket();
 
-	_clientShouldRun = false;
+	{
+		std::lock_guard<std::mutex> lock(_serverReconnectMutex);
+		_clientShouldRun = false;
+	}
+	_serverReconnectCondition.notify_all();
+
+	// not started if StartClientMain is still waiting for a broadcast
+	if (_serverReconnectThread.joinable())
+		_serverReconnectThread.join();
 }
 
 void CCMain::InstallService()
@@ -262,10 +845,17 @@ void CCMain::LoadAll(std::string path)
 	else
 	{
 		_configFile = path;
+		_configPersister->SetFilePath(path);
 	}
 
+	std::lock_guard<std::mutex> lock(_configMutex);
+
 	if (_configManager.LoadFromFile(path))
 	{
+		_idleMonitor->LoadFrom(_configManager);
+		_hotkeys.LoadFrom(_configManager);
+		_acceleration.LoadFrom(_configManager);
+
 		for (auto entity : _entites)
 		{
 			entity->LoadFrom(_configManager);
@@ -281,20 +871,23 @@ void CCMain::LoadAll(std::string path)
 
 void CCMain::SaveAll(std::string path)
 {
-	if (path == "")
+	if (path != "" && path != _configFile)
 	{
-		path = _configFile;
+		// a different target, write what is pending to the old file first
+		_configPersister->Flush();
+		_configFile = path;
+		_configPersister->SetFilePath(path);
 	}
 
-	for (auto entity : _entites)
 	{
-		entity->SaveTo(_configManager);
+		std::lock_guard<std::mutex> lock(_configMutex);
+		for (auto entity : _entites)
+		{
+			entity->SaveTo(_configManager);
+		}
 	}
 
-	if (!_configManager.SaveToFile(path))
-	{
-		LOG_ERROR << "Error Saving to file " << path << std::endl;
-	}
+	_configPersister->MarkDirty();
 }
 
 void CCMain::SetupGlobalPositions()
@@ -329,15 +922,58 @@ void CCMain::NewEntityDiscovered(std::shared_ptr<CCNetworkEntity> entity)
 {
 	LOG_INFO << "New Entity Discovered {" << entity->GetID() << "}" << std::endl;
 
-	entity->LoadFrom(_configManager);
+	{
+		std::lock_guard<std::mutex> lock(_configMutex);
+		entity->LoadFrom(_configManager);
+	}
 	entity->SetDelegate(this);
+	entity->SetIdleMonitor(_idleMonitor);
+
+	std::shared_ptr<CCNetworkEntity> replaced;
 	{
 		std::lock_guard<std::mutex> lock(_entitesAccessMutex);
-		_entites.push_back(entity);
+
+		// an entity that handshakes again takes the place of its old self
+		auto itr = std::find_if(_entites.begin(), _entites.end(), [&entity, this](const std::shared_ptr<CCNetworkEntity>& existing) {
+			return existing != _localEntity && existing->GetID() == entity->GetID();
+		});
+
+		if (itr != _entites.end())
+		{
+			replaced = *itr;
+			*itr = entity;
+			_lostEntites.erase(std::remove(_lostEntites.begin(), _lostEntites.end(), replaced.get()), _lostEntites.end());
+
+			// the cursor stays with it, or goes back to it if it was taken home while the old self was unreachable
+			CCNetworkEntity* unreachable = replaced.get();
+			if (_currentEntity == replaced.get())
+				_currentEntity = entity.get();
+			else if (_unreachableEntity.compare_exchange_strong(unreachable, NULL) && _currentEntity == _localEntity.get())
+			{
+				_localEntity->RPC_HideMouse();
+				_currentEntity = entity.get();
+				_currentEntity->RPC_UnhideMouse();
+			}
+		}
+		else
+		{
+			_entites.push_back(entity);
+			EntityGauge().Add(1);
+		}
+	}
+
+	if (replaced)
+	{
+		LOG_INFO << "Entity {" << entity->GetID() << "} rejoined" << std::endl;
+		replaced->SetDelegate(NULL);
+		replaced->ShutdownThreads();
 	}
 	
 	SetupGlobalPositions();
 	SetupEntityConnections();
+
+	_guiService.EntityJoined(entity.get());
+	LayoutChanged();
 }
 
 void CCMain::EntityLost(CCNetworkEntity* entity)
@@ -349,18 +985,64 @@ void CCMain::EntityLost(CCNetworkEntity* entity)
 	LOG_INFO << "Lost Entity " << entity->GetID() << std::endl;
 	_lostEntites.push_back(entity);
 
+	static CCCounter& lost = CCMetricRegistry::registry.Counter("cc_entities_lost_total", "Entities dropped after they couldn't be reconnected");
+	lost.Add();
+
+	_guiService.EntityLost(entity->GetID());
+
 	if (entity == _currentEntity)
 	{
 		_currentEntity = _localEntity.get();
 		_currentEntity->RPC_UnhideMouse();
 	}
+
+	CCNetworkEntity* unreachable = entity;
+	_unreachableEntity.compare_exchange_strong(unreachable, NULL);
+}
+
+void CCMain::EntityUnreachable(CCNetworkEntity* entity)
+{
+	std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+
+	if (entity != _currentEntity)
+		return;
+
+	LOG_INFO << "Entity " << entity->GetID() << " is unreachable, the cursor goes home until it's back" << std::endl;
+
+	// doesn't make it while the entity is unreachable, it's sent again once it reconnects
+	entity->RPC_HideMouse();
+
+	_currentEntity = _localEntity.get();
+	_currentEntity->RPC_UnhideMouse();
+	_unreachableEntity = entity;
+}
+
+void CCMain::EntityReachable(CCNetworkEntity* entity)
+{
+	std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+
+	// EntityJumped forgets the entity, the cursor stays where it was put since
+	CCNetworkEntity* unreachable = entity;
+	if (_unreachableEntity.compare_exchange_strong(unreachable, NULL) == false || _currentEntity != _localEntity.get())
+		return;
+
+	LOG_INFO << "Entity " << entity->GetID() << " is reachable again, the cursor goes back to it" << std::endl;
+
+	_localEntity->RPC_HideMouse();
+	_currentEntity = entity;
+	_currentEntity->RPC_UnhideMouse();
 }
 
 void CCMain::LostServer()
 {
-	// force client to re-listen for server
+	// the server didn't reconnect to us in time, handshake with it again
 	_client->StopClientSocket();
-	_client->SetNeedsNewServer();
+
+	{
+		std::lock_guard<std::mutex> lock(_serverReconnectMutex);
+		_client->SetNeedsNewServer();
+	}
+	_serverReconnectCondition.notify_all();
 }
 
 const std::vector<std::shared_ptr<CCNetworkEntity>>& CCMain::GetEntitiesToConfigure() const
@@ -378,20 +1060,65 @@ void CCMain::EntitiesFinishedConfiguration()
 	_currentMouseOffsets = _localEntity->GetOffsets();
 
 	SetupEntityConnections();
+	LayoutChanged();
 
 	SaveAll();
 }
 
+void CCMain::EntityOffsetsChanged(const std::vector<CCNetworkEntity*>& changed)
+{
+	{
+		std::lock_guard<std::mutex> lock(_entitesAccessMutex);
+		UpdateEntityConnections(changed);
+
+		if (std::find(changed.begin(), changed.end(), _localEntity.get()) != changed.end())
+			_currentMouseOffsets = _localEntity->GetOffsets();
+
+		SetupGlobalPositions();
+	}
+
+	LayoutChanged();
+	SaveAll();
+}
+
 bool CCMain::ReceivedNewInputEvent(OSEvent event)
 {
+	// the event's latency trace starts when it reaches us
+	int64_t capturedAt = CCLatencyNow();
 	bool isMove = false;
+
+	if (_idleMonitor->InputReceived(capturedAt))
+		WakeUp();
+
+	// the current entity can also change on other threads, i.e. when it's lost
+	UpdateMouseCapture();
+
+	// hotkeys see every key, an event skipped below would leave its key pressed
+	const CCHotkeyChord* chord = NULL;
+	if (event.eventType == OS_EVENT_KEY && _hotkeys.KeyEvent(event, &chord))
+	{
+		if (chord)
+			RunHotkey(*chord, capturedAt);
+
+		EventRouted(event, InputRoute::LOCAL);
+		return false;
+	}
+
+	// ReloadConfig and the GUI move entities on their own threads, the bounds and offsets can't change
+	// between finding a jump zone and jumping. Let go before the event is sent
+	std::unique_lock<std::mutex> layoutLock(_entitesAccessMutex);
+
 	Point OffsetPos = _currentMousePosition + _currentMouseOffsets;
 
-	// check if we should skep or if the mouse moved more then we think it should
-	if (_ignoreInputEvent || abs(event.deltaX) > DELTA_X_MAX || abs(event.deltaY) > DELTA_Y_MAX)
+	// check if we should skep or if the mouse moved more then we think it should, only moves are
+	// skipped as a dropped key or button would stay pressed. A captured mouse is never warped so all
+	// of its moves are real
+	bool isMouseMove = event.eventType == OS_EVENT_MOUSE && event.mouseEvent == MOUSE_EVENT_MOVE;
+	if (isMouseMove && (_ignoreInputEvent || (_isMouseCaptured == false && (abs(event.deltaX) > DELTA_X_MAX || abs(event.deltaY) > DELTA_Y_MAX))))
 	{
-		LOG_INFO << "Skipping event " << event << std::endl;
+		LOG_SITE(SkippingEvent, event);
 		_ignoreInputEvent = false;
+		EventRouted(event, InputRoute::SKIPPED);
 		return false;
 	}
 
@@ -399,8 +1126,13 @@ bool CCMain::ReceivedNewInputEvent(OSEvent event)
 	{
 		if (event.mouseEvent == MOUSE_EVENT_MOVE)
 		{
+			// this computer's cursor moves the way its OS accelerates it
+			if (_localEntity != _currentEntity)
+				_acceleration.Apply(event.deltaX, event.deltaY);
+
 			_currentMousePosition.x += event.deltaX;
 			_currentMousePosition.y += event.deltaY;
+			_cursorPredictor.AddMove(event.deltaX, event.deltaY, capturedAt);
 
 			OffsetPos = _currentMousePosition + _currentMouseOffsets;
 			if (_localEntity != _currentEntity)
@@ -411,14 +1143,14 @@ bool CCMain::ReceivedNewInputEvent(OSEvent event)
 				int x = event.x - _currentMouseOffsets.x;
 				int y = event.y - _currentMouseOffsets.y;
 
-				if (abs(x - bounds.topLeft.x) < 20 || abs(x - bounds.bottomRight.x) < 20 || \
-					abs(y - bounds.topLeft.y) < 20 || abs(y - bounds.bottomRight.y) < 20)
+				if (_isMouseCaptured == false && (abs(x - bounds.topLeft.x) < 20 || abs(x - bounds.bottomRight.x) < 20 || \
+					abs(y - bounds.topLeft.y) < 20 || abs(y - bounds.bottomRight.y) < 20))
 				{
 					_localEntity->RPC_SetMousePosition(0.5f, 0.5f);
 					_ignoreInputEvent = true;
 				}
 
-				event.x = ((OffsetPos.x - bounds.topLeft.x) + offsets.x) - ;
+				event.x = ((OffsetPos.x - bounds.topLeft.x) + offsets.x);
 				event.y = ((OffsetPos.y - bounds.topLeft.y) + offsets.y);
 			}
 
@@ -429,53 +1161,67 @@ bool CCMain::ReceivedNewInputEvent(OSEvent event)
 		OffsetPos = _currentMousePosition + _currentMouseOffsets;
 	
 
-	if (event.eventType == OS_EVENT_KEY && event.scanCode == 69 /* PAUSE/BREAK button */)
-	{
-		_currentEntity = _localEntity.get();
-		_currentEntity->RPC_UnhideMouse();
-		_currentEntity->RPC_SetMousePosition(0.5, 0.5);
-		Rect bounds = _currentEntity->GetBounds();
-		_currentMousePosition = bounds.topLeft + ((bounds.bottomRight - bounds.topLeft) / 2);
-		return false;
-	}
-	
+	// locked or paused the cursor stays where it is
+	bool canJump = _isLockedToEntity == false && _isForwardingPaused == false;
 
 	JumpDirection direction;
 	CCNetworkEntity* nextEntity = 0;
-	if (_currentEntity->GetEntityForPointInJumpZone(OffsetPos, &nextEntity, direction))
+	if (canJump && _currentEntity->GetEntityForPointInJumpZone(OffsetPos, &nextEntity, direction))
 	{
+		CC_TRACE_ENTITY_ZONE("Jump", nextEntity->GetLogID());
+
 		_currentMousePosition = OffsetPos - _currentMouseOffsets;
 
 		// we have a jump zone
-		LOG_INFO << "Jump To " << nextEntity->GetID() << std::endl;
+		LOG_SITE(JumpToEntity, nextEntity->GetLogID());
 				
+		// keys held while leaving would keep repeating there
+		_currentEntity->ReleaseHeldKeys(capturedAt);
+
 		// hide mouse
 		LOG_INFO << "Hide Mouse Current" << std::endl;
 		_currentEntity->RPC_HideMouse();
-					
-		// Force mouse to be in center of screen
-		LOG_INFO << "Warp Current Mouse To Center" << std::endl;
-		_currentEntity->RPC_SetMousePosition(0.5f,0.5f);
-		if (_currentEntity->GetIsLocal())
-			_ignoreInputEvent = true;
+
+		CCNetworkEntity* previousEntity = _currentEntity;
 
 		// unhide mouse of last entity
 		LOG_INFO << "Unhide Mouse Next" << std::endl;
 		nextEntity->RPC_UnhideMouse();
 
+		EntityJumped(nextEntity);
+
 		_currentEntity = nextEntity;
+
+		// Force mouse to be in center of screen, ours stays where it is once it's captured
+		if (UpdateMouseCapture() == false || previousEntity->GetIsLocal() == false)
+		{
+			LOG_INFO << "Warp Current Mouse To Center" << std::endl;
+			previousEntity->RPC_SetMousePosition(0.5f,0.5f);
+			if (previousEntity->GetIsLocal())
+				_ignoreInputEvent = true;
+		}
 	}
+	else if (isMove && canJump)
+		WarmUpApproachedEntity(OffsetPos, capturedAt);
 
-	if (_currentEntity->GetIsLocal()) return false;
+	layoutLock.unlock();
 
-	LOG_INFO << "Sending Event " << event << std::endl;
+	if (_currentEntity->GetIsLocal())
+	{
+		EventRouted(event, InputRoute::LOCAL);
+		return false;
+	}
 
-	SocketError error = _currentEntity->SendOSEvent(event);
+	LOG_SITE(SendingEvent, event);
+
+	SocketError error = _currentEntity->SendOSEvent(event, capturedAt);
 	if (error != SocketError::SOCKET_E_SUCCESS)
 	{
-		LOG_ERROR << "Error Sending Event To " << _currentEntity->GetID() << " Error: " << SOCK_ERR_STR(_currentEntity->GetUDPSocket(), error) << std::endl;
+		LOG_SITE(SendEventError, _currentEntity->GetLogID(), CCLogSockErr(_currentEntity->GetUDPSocket(), error));
 	}
 
+	EventRouted(event, error == SocketError::SOCKET_E_SUCCESS ? InputRoute::REMOTE : InputRoute::REMOTE_FAILED);
+
 	return true && !isMove;
 }
 
@@ -5,6 +5,8 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 #include "../OSInterface/IOSEventReceiver.h"
 #include "../OSInterface/OSTypes.h"
@@ -12,14 +14,22 @@
 #include "INetworkEntityDiscovery.h"
 #include "INetworkEntityDelegate.h"
 #include "CCConfigurationManager.h"
+#include "CCConfigPersister.h"
+#include "CCConfigWatcher.h"
 #include "IGuiServiceInterface.h"
+#include "IInputRouteObserver.h"
 #include "CCGUIService.h"
+#include "CCCursorPredictor.h"
+#include "CCIdleMonitor.h"
+#include "CCHotkeys.h"
+#include "CCAcceleration.h"
 
 #include "BasicTypes.h"
 
 class CCServer;
 class CCClient;
 class CCNetworkEntity;
+class CCInputRecorder;
 class CCMain : public INetworkEntityDiscovery, public IOSEventReceiver, public IGuiServiceInterface, public INetworkEntityDelegate
 {
 private:
@@ -30,41 +40,99 @@ private:
 
 	std::shared_ptr<CCNetworkEntity> _localEntity;
 	CCNetworkEntity*				 _currentEntity;
+	// had the cursor when it became unreachable, it gets it back unless the cursor jumped since
+	std::atomic<CCNetworkEntity*>	 _unreachableEntity;
 
 	std::thread					_serverBroadcastThread;
+	std::mutex					_broadcastMutex; // guards _serverShouldRun for the broadcast loop's wait
+	std::condition_variable		_broadcastCondition;
 	std::unique_ptr<CCServer>	_server;
 	std::unique_ptr<CCClient>	_client;
 
+	std::thread					_serverReconnectThread;
+	std::mutex					_serverReconnectMutex; // guards _clientShouldRun and the client's need for a server
+	std::condition_variable		_serverReconnectCondition;
+
 	CCGuiService				_guiService;
 
 	std::vector<int>			_globalBounds;
 	
 	Point						_currentMousePosition;
 	Point						_currentMouseOffsets;
+	CCCursorPredictor			_cursorPredictor;
+	CCAcceleration				_acceleration; // applied to moves forwarded to remote entities
+	std::shared_ptr<CCIdleMonitor>	_idleMonitor; // shared with the entities' heartbeats
 
 	bool						_serverShouldRun;
 	bool						_clientShouldRun;
 	bool						_ignoreInputEvent;
+	bool						_isMouseCaptured; // moves are the mouse's raw motion and the cursor is frozen
+	bool						_canCaptureMouse; // false once the OS couldn't capture it
+
+	CCHotkeys					_hotkeys;
+	bool						_isLockedToEntity; // jump zones are ignored
+	bool						_isForwardingPaused; // input stays on this computer
 
 	std::string					_configFile;
 	CCConfigurationManager		_configManager;
+	std::mutex					_configMutex; // guards _configManager, the persister snapshots it from its own thread
+	std::unique_ptr<CCConfigPersister>	_configPersister;
+	CCConfigWatcher				_configWatcher;
+
+	IInputRouteObserver*		_routeObserver;
+	std::unique_ptr<CCInputRecorder>	_recorder;
+	std::mutex					_recorderMutex;
 
 private:
 	void SetupEntityConnections();
+	// reconnects only {changed} entities, everything else keeps its connections
+	void UpdateEntityConnections(const std::vector<CCNetworkEntity*>& changed);
+	// called by _configWatcher, applies offsets that changed on disk
+	void ReloadConfig();
 	void RemoveLostEntites();
+	// writes the new layout to the recording, if there is one
+	void LayoutChanged();
+	// counts the event and tells the route observer
+	void EventRouted(const OSEvent& event, InputRoute route);
+	// tells the route observer and counts the jump, {to} becomes the current entity after this
+	void EntityJumped(CCNetworkEntity* to);
+	// warms up the entity the cursor at {position} will jump to within CC_JUMP_PREDICTION_HORIZON_MS
+	// if it keeps going, see CCNetworkEntity::WarmUp
+	void WarmUpApproachedEntity(Point position, int64_t now);
+	// moves the cursor to the center of {entity} and makes it the current entity
+	void JumpToCenter(CCNetworkEntity* entity, int64_t capturedAt);
+	void RunHotkey(const CCHotkeyChord& chord, int64_t capturedAt);
+	// captures the mouse while a remote entity has the cursor, so moves aren't cut short by this
+	// computer's displays and it doesn't have to be warped back to the center.
+	// Returns true if the mouse is captured, see OSInterface::SetRelativeMouseCapture
+	bool UpdateMouseCapture();
+	// the first input after being idle, heartbeats go back to the full rate and the broadcast loop
+	// announces the server again. Only submits work, the event that woke us isn't held up
+	void WakeUp();
+	// handshakes with the last server again, with backoff, whenever the client needs a new server
+	// until StopClient. The server is asked to resume our session so the displays aren't sent again
+	void ServerReconnectThread();
+
+	static std::string LocalHostName();
 
 public:
 	CCMain();
+	// an instance that is known as {entityID} and only binds {address},
+	// several of them can run in one process on different loopback addresses (i.e. cc_pipeline)
+	CCMain(const std::string& entityID, const std::string& address);
 	~CCMain();
 
 	void StartServerMain();
 	void StartClientMain();
+	// skips discovery and keeps trying {serverAddress} until it answers or the client is stopped
+	void StartClientMain(const std::string& serverAddress, int serverPort);
 
 	void StopServer();
 	void StopClient();
 	void InstallService();
 
 	void LoadAll(std::string path = "");
+	// stores every entity in the config and schedules a write, the file is written in the background
 	void SaveAll(std::string path = "");
 
 	// Sets up Global Position for network entites
@@ -73,6 +141,25 @@ public:
 	// This will eventually be a GUI interface somehow
 	void SetupGlobalPositions();
 
+	// connects every pair of {entities} that are next to each other, clearing old connections first
+	static void SetupEntityConnections(const std::vector<std::shared_ptr<CCNetworkEntity>>& entities);
+
+	// the number of entities in the session including this one
+	size_t GetEntityCount();
+
+	// writes every OS event and layout change to {path} until StopRecording (see CCInputRecording.h)
+	bool StartRecording(const std::string& path);
+	void StopRecording();
+
+	// the entities with their displays and offsets, and where the cursor is, as JSON
+	std::string BuildLayout();
+	// replaces every entity with the ones in {layout} from BuildLayout, the entity called "local" in it
+	// becomes this one. The others only have their layout and drop what is sent to them (i.e. replays)
+	bool LoadLayout(const std::string& layout);
+
+	// {observer} is told where every input event went, NULL to stop
+	inline void SetRouteObserver(IInputRouteObserver* observer) { _routeObserver = observer; }
+
 	// INetworkDiscoery Implementation
 
 	virtual void NewEntityDiscovered(std::shared_ptr<CCNetworkEntity> entity)override;
@@ -82,6 +169,8 @@ public:
 	// INetworkEntityDelegate Implmentation
 
 	virtual void EntityLost(CCNetworkEntity* entity)override;
+	virtual void EntityUnreachable(CCNetworkEntity* entity)override;
+	virtual void EntityReachable(CCNetworkEntity* entity)override;
 	virtual void LostServer()override;
 
 	// End INetworkEntityDelegate
@@ -91,6 +180,7 @@ public:
 	virtual const std::vector<std::shared_ptr<CCNetworkEntity>>& GetEntitiesToConfigure()const override;
 	virtual const std::vector<int>& GetGlobalBounds()const override;
 	virtual void EntitiesFinishedConfiguration()override;
+	virtual void EntityOffsetsChanged(const std::vector<CCNetworkEntity*>& changed)override;
 
 	// End IGuiServiceInterface
 
@@ -0,0 +1,215 @@
+#include "CCMetrics.h"
+#include "CCLogger.h"
+
+#include <algorithm>
+#include <sstream>
+
+CCMetricRegistry CCMetricRegistry::registry;
+
+// CCMetricHistogram
+
+CCMetricHistogram::CCMetricHistogram(const std::vector<uint64_t>& bounds) : _bounds(bounds), \
+_buckets(new std::atomic<uint64_t>[bounds.size() + 1]), _sumUs(0)
+{
+	for (size_t i = 0; i <= _bounds.size(); i++)
+		_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void CCMetricHistogram::Observe(uint64_t us)
+{
+	size_t index = std::lower_bound(_bounds.begin(), _bounds.end(), us) - _bounds.begin();
+
+	_buckets[index].fetch_add(1, std::memory_order_relaxed);
+	_sumUs.fetch_add(us, std::memory_order_relaxed);
+}
+
+const std::vector<uint64_t>& CCMetricHistogram::DefaultBounds()
+{
+	static const std::vector<uint64_t> bounds = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000 };
+	return bounds;
+}
+
+// CCMetricRegistry
+
+CCMetricRegistry::CCMetricRegistry()
+{
+}
+
+std::string CCMetricRegistry::EscapeLabelValue(const std::string& value)
+{
+	std::string escaped;
+	escaped.reserve(value.size());
+
+	for (char c : value)
+	{
+		if (c == '\\')
+			escaped += "\\\\";
+		else if (c == '"')
+			escaped += "\\\"";
+		else if (c == '\n')
+			escaped += "\\n";
+		else escaped += c;
+	}
+
+	return escaped;
+}
+
+std::string CCMetricRegistry::RenderLabels(const CCMetricLabels& labels)
+{
+	if (labels.empty())
+		return "";
+
+	std::string rendered = "{";
+	for (size_t i = 0; i < labels.size(); i++)
+	{
+		if (i != 0)
+			rendered += ",";
+		rendered += labels[i].first + "=\"" + EscapeLabelValue(labels[i].second) + "\"";
+	}
+	rendered += "}";
+
+	return rendered;
+}
+
+CCMetricRegistry::Series* CCMetricRegistry::GetSeries(const std::string& name, const std::string& help, MetricType type, \
+	const CCMetricLabels& labels, const std::vector<uint64_t>* bounds)
+{
+	std::string rendered = RenderLabels(labels);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto itr = std::find_if(_families.begin(), _families.end(), [&name](const std::unique_ptr<Family>& family) {
+		return family->name == name;
+	});
+
+	Family* family = NULL;
+	if (itr != _families.end())
+		family = itr->get();
+
+	std::unique_ptr<Series> series(new Series());
+	series->labels = rendered;
+
+	if (type == MetricType::COUNTER)
+		series->counter.reset(new CCCounter());
+	else if (type == MetricType::GAUGE)
+		series->gauge.reset(new CCGauge());
+	else series->histogram.reset(new CCMetricHistogram(*bounds));
+
+	if (family && family->type != type)
+	{
+		LOG_ERROR << "Metric " << name << " is already registered as another type" << std::endl;
+		_orphans.push_back(std::move(series));
+		return _orphans.back().get();
+	}
+
+	if (family == NULL)
+	{
+		_families.push_back(std::unique_ptr<Family>(new Family()));
+		family = _families.back().get();
+		family->name = name;
+		family->help = help;
+		family->type = type;
+	}
+
+	for (auto& existing : family->series)
+	{
+		if (existing->labels == rendered)
+			return existing.get();
+	}
+
+	family->series.push_back(std::move(series));
+	return family->series.back().get();
+}
+
+CCCounter& CCMetricRegistry::Counter(const std::string& name, const std::string& help, const CCMetricLabels& labels)
+{
+	return *GetSeries(name, help, MetricType::COUNTER, labels, NULL)->counter;
+}
+
+CCGauge& CCMetricRegistry::Gauge(const std::string& name, const std::string& help, const CCMetricLabels& labels)
+{
+	return *GetSeries(name, help, MetricType::GAUGE, labels, NULL)->gauge;
+}
+
+CCMetricHistogram& CCMetricRegistry::Histogram(const std::string& name, const std::string& help, const CCMetricLabels& labels, \
+	const std::vector<uint64_t>& bounds)
+{
+	return *GetSeries(name, help, MetricType::HISTOGRAM, labels, &bounds)->histogram;
+}
+
+// {labels} with {extra} added at the end, for the le label of histogram buckets
+static std::string AddLabel(const std::string& labels, const std::string& extra)
+{
+	if (labels.empty())
+		return "{" + extra + "}";
+
+	return labels.substr(0, labels.size() - 1) + "," + extra + "}";
+}
+
+static void WriteSeconds(std::ostringstream& out, uint64_t us)
+{
+	out << us / 1000000 << ".";
+
+	std::string fraction = std::to_string(us % 1000000);
+	out << std::string(6 - fraction.size(), '0') << fraction;
+}
+
+std::string CCMetricRegistry::Expose()
+{
+	std::ostringstream out;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (auto& family : _families)
+	{
+		std::string help = family->help;
+		for (size_t pos = 0; (pos = help.find_first_of("\\\n", pos)) != std::string::npos; pos += 2)
+			help.replace(pos, 1, help[pos] == '\\' ? "\\\\" : "\\n");
+
+		out << "# HELP " << family->name << " " << help << "\n";
+
+		if (family->type == MetricType::COUNTER)
+			out << "# TYPE " << family->name << " counter\n";
+		else if (family->type == MetricType::GAUGE)
+			out << "# TYPE " << family->name << " gauge\n";
+		else out << "# TYPE " << family->name << " histogram\n";
+
+		for (auto& series : family->series)
+		{
+			if (series->counter)
+			{
+				out << family->name << series->labels << " " << series->counter->Get() << "\n";
+			}
+			else if (series->gauge)
+			{
+				out << family->name << series->labels << " " << series->gauge->Get() << "\n";
+			}
+			else
+			{
+				const CCMetricHistogram& histogram = *series->histogram;
+				const std::vector<uint64_t>& bounds = histogram.GetBounds();
+
+				// the buckets are read one by one, the count is their sum so +Inf always matches it
+				uint64_t cumulative = 0;
+				for (size_t i = 0; i < bounds.size(); i++)
+				{
+					cumulative += histogram.GetBucket(i);
+
+					std::ostringstream le;
+					WriteSeconds(le, bounds[i]);
+
+					out << family->name << "_bucket" << AddLabel(series->labels, "le=\"" + le.str() + "\"") << " " << cumulative << "\n";
+				}
+				cumulative += histogram.GetBucket(bounds.size());
+
+				out << family->name << "_bucket" << AddLabel(series->labels, "le=\"+Inf\"") << " " << cumulative << "\n";
+				out << family->name << "_sum" << series->labels << " ";
+				WriteSeconds(out, histogram.GetSumUs());
+				out << "\n";
+				out << family->name << "_count" << series->labels << " " << cumulative << "\n";
+			}
+		}
+	}
+
+	return out.str();
+}
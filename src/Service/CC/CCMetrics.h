@@ -0,0 +1,147 @@
+#ifndef CC_METRICS_H
+#define CC_METRICS_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+/*
+*	CCMetricRegistry holds the service's counters, gauges and histograms and writes them in the
+*	Prometheus text exposition format (version 0.0.4), CCMetricsServer serves that to scrapers.
+*
+*	Looking a metric up takes the registry's lock, so hot paths look their metrics up once and keep
+*	the reference, metrics are never freed. Updating one is a relaxed atomic add and never blocks.
+*
+*	cc_input_events_total{route}				every event CCMain routed (see InputRoute)
+*	cc_jumps_total								cursor jumps between entities
+*	cc_hotkeys_total{action}					hotkeys that fired (see CCHotkeys.h)
+*	cc_entities									entities in the session, this one included
+*	cc_entities_lost_total						entities that couldn't be reconnected in time
+*	cc_idle_transitions_total{to}				the session going idle or becoming active again
+*	cc_events_forwarded_total{entity}			events an entity awked
+*	cc_bytes_sent_total{entity}					event and RPC bytes written to an entity
+*	cc_send_errors_total{entity}				events and RPCs that failed
+*	cc_reconnect_attempts_total{entity}			reconnects after a dropped connection
+*	cc_reconnects_total{entity}					dropped connections that came back in time
+*	cc_probes_skipped_total{entity}				heartbeats not needed because events were awked
+*	cc_warm_ups_total{entity}					connections warmed up ahead of a predicted jump
+*	cc_key_repeats_dropped_total{entity}		repeats of held keys the entity makes itself
+*	cc_late_awks_total{entity}					event awks that missed the timeout, the connection is kept
+*	cc_send_duration_seconds{entity}			sending an event until its awk
+*	cc_heartbeat_rtt_seconds{entity}			heartbeat until the client's clock came back
+*	cc_events_injected_total					client side, events handed to the OS
+*	cc_inject_errors_total						client side, events the OS refused
+*	cc_key_repeats_injected_total				client side, repeats of keys the server holds down
+*	cc_stuck_keys_released_total				client side, held keys let go because the server was lost
+*	cc_server_handshakes_total{result}			accepted, failed or rejected connections
+*	cc_server_pending_handshakes				handshakes waiting on the executor
+*	cc_server_sessions_resumed_total			handshakes that skipped the display list
+*	cc_executor_*{queue}						CCExecutor::GetMetrics, updated on every scrape
+*/
+
+typedef std::vector<std::pair<std::string, std::string>> CCMetricLabels;
+
+class CCCounter
+{
+private:
+	std::atomic<uint64_t>	_value;
+
+public:
+	CCCounter() : _value(0) {}
+
+	inline void Add(uint64_t amount = 1) { _value.fetch_add(amount, std::memory_order_relaxed); }
+	inline uint64_t Get()const { return _value.load(std::memory_order_relaxed); }
+};
+
+class CCGauge
+{
+private:
+	std::atomic<int64_t>	_value;
+
+public:
+	CCGauge() : _value(0) {}
+
+	inline void Set(int64_t value) { _value.store(value, std::memory_order_relaxed); }
+	inline void Add(int64_t amount) { _value.fetch_add(amount, std::memory_order_relaxed); }
+	inline int64_t Get()const { return _value.load(std::memory_order_relaxed); }
+};
+
+// observations are in microseconds and exported in seconds
+class CCMetricHistogram
+{
+private:
+	std::vector<uint64_t>					_bounds; // upper bounds in us, ascending
+	std::unique_ptr<std::atomic<uint64_t>[]>	_buckets; // not cumulative, the last one is +Inf
+	std::atomic<uint64_t>					_sumUs;
+
+public:
+	explicit CCMetricHistogram(const std::vector<uint64_t>& bounds);
+
+	void Observe(uint64_t us);
+
+	inline const std::vector<uint64_t>& GetBounds()const { return _bounds; }
+	inline uint64_t GetBucket(size_t index)const { return _buckets[index].load(std::memory_order_relaxed); }
+	inline uint64_t GetSumUs()const { return _sumUs.load(std::memory_order_relaxed); }
+
+	// 50us to 1s, about 2.5x apart
+	static const std::vector<uint64_t>& DefaultBounds();
+};
+
+class CCMetricRegistry
+{
+private:
+	enum class MetricType : int
+	{
+		COUNTER,
+		GAUGE,
+		HISTOGRAM
+	};
+
+	struct Series
+	{
+		std::string							labels; // already rendered, {a="b"} or empty
+		std::unique_ptr<CCCounter>			counter;
+		std::unique_ptr<CCGauge>			gauge;
+		std::unique_ptr<CCMetricHistogram>	histogram;
+	};
+
+	struct Family
+	{
+		std::string							name;
+		std::string							help;
+		MetricType							type;
+		std::vector<std::unique_ptr<Series>>	series;
+	};
+
+	std::mutex								_mutex;
+	std::vector<std::unique_ptr<Family>>	_families; // in registration order
+	std::vector<std::unique_ptr<Series>>	_orphans; // asked for with the wrong type, kept so references stay valid
+
+	CCMetricRegistry();
+
+	// the series is created on first use, bounds are only used for a new histogram
+	Series* GetSeries(const std::string& name, const std::string& help, MetricType type, const CCMetricLabels& labels, \
+		const std::vector<uint64_t>* bounds);
+
+	static std::string RenderLabels(const CCMetricLabels& labels);
+	static std::string EscapeLabelValue(const std::string& value);
+
+public:
+	// the same {name} and {labels} always return the same metric, {help} is taken from the first call.
+	// A name that is reused with another type logs an error and gets a metric that is never exported
+	CCCounter& Counter(const std::string& name, const std::string& help, const CCMetricLabels& labels = {});
+	CCGauge& Gauge(const std::string& name, const std::string& help, const CCMetricLabels& labels = {});
+	CCMetricHistogram& Histogram(const std::string& name, const std::string& help, const CCMetricLabels& labels = {}, \
+		const std::vector<uint64_t>& bounds = CCMetricHistogram::DefaultBounds());
+
+	// every metric in the text exposition format
+	std::string Expose();
+
+	static CCMetricRegistry registry;
+};
+
+#endif
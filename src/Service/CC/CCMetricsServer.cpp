@@ -0,0 +1,134 @@
+#include "CCMetricsServer.h"
+
+#include "../Socket/Socket.h"
+
+#include "CCLogger.h"
+#include "CCMetrics.h"
+#include "CCExecutor.h"
+
+#include <string.h>
+
+#define CC_METRICS_RECEIVE_TIMEOUT_MS 2000
+// scrapers send a short GET, anything past this is not read
+#define CC_METRICS_MAX_REQUEST 8192
+
+CCMetricsServer::CCMetricsServer(int port, const std::string& address) : \
+_serverSocket(new Socket(address, port, false, SocketProtocol::SOCKET_P_TCP)), _shouldRun(false)
+{
+}
+
+CCMetricsServer::~CCMetricsServer()
+{
+	Stop();
+}
+
+bool CCMetricsServer::Start()
+{
+	SocketError error = _serverSocket->Bind();
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error trying to bind to Metrics Port " << _serverSocket->GetPort() << SOCK_ERR_STR(_serverSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	error = _serverSocket->Listen();
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error trying listen on Metrics Port " << _serverSocket->GetPort() << SOCK_ERR_STR(_serverSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	_shouldRun = true;
+	_acceptThread = std::thread(&CCMetricsServer::AcceptThread, this);
+
+	return true;
+}
+
+void CCMetricsServer::Stop()
+{
+	_shouldRun = false;
+	_serverSocket->Disconnect();
+	// closing is what wakes a blocked Accept on every platform
+	_serverSocket->Close();
+
+	if (_acceptThread.joinable())
+		_acceptThread.join();
+}
+
+void CCMetricsServer::AcceptThread()
+{
+	while (_shouldRun)
+	{
+		Socket* acceptedSocket = 0;
+		SocketError error = _serverSocket->Accept(&acceptedSocket);
+		if (error != SocketError::SOCKET_E_SUCCESS)
+		{
+			if (_shouldRun == false)
+				break;
+
+			LOG_ERROR << "Error accepting Socket listen on Metrics Port " << _serverSocket->GetPort() << SOCK_ERR_STR(_serverSocket.get(), error) << std::endl;
+			if (error == SocketError::SOCKET_E_BROKEN_PIPE)continue;
+			else break;
+		}
+
+		std::unique_ptr<Socket> socket(acceptedSocket);
+		Serve(socket.get());
+	}
+}
+
+void CCMetricsServer::Serve(Socket* socket)
+{
+	socket->SetReceiveTimeout(CC_METRICS_RECEIVE_TIMEOUT_MS);
+
+	// the reply doesn't depend on the request, it only has to be read so closing doesn't reset the connection
+	std::string request;
+	char buffer[1024];
+
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < CC_METRICS_MAX_REQUEST)
+	{
+		size_t received = 0;
+		SocketError error = socket->Recv(buffer, sizeof(buffer), &received);
+		if (error != SocketError::SOCKET_E_SUCCESS || received == 0)
+			return;
+
+		request.append(buffer, received);
+	}
+
+	UpdateExecutorMetrics();
+	std::string body = CCMetricRegistry::registry.Expose();
+
+	std::string reply = "HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		"Content-Length: " + std::to_string(body.size()) + "\r\n"
+		"Connection: close\r\n\r\n";
+	reply += body;
+
+	SocketError error = socket->Send(reply);
+	if (error != SocketError::SOCKET_E_SUCCESS)
+		LOG_ERROR << "Error sending metrics " << SOCK_ERR_STR(socket, error) << std::endl;
+
+	socket->Disconnect(SocketDisconectType::SDT_SEND);
+}
+
+// only the accept thread scrapes, so nothing else moves the counter between the read and the add
+static void AdvanceCounter(CCCounter& counter, uint64_t total)
+{
+	uint64_t current = counter.Get();
+	if (total > current)
+		counter.Add(total - current);
+}
+
+void CCMetricsServer::UpdateExecutorMetrics()
+{
+	CCMetricRegistry& registry = CCMetricRegistry::registry;
+
+	for (const CCExecutorMetrics& metrics : CCExecutor::SharedExecutor().GetMetrics())
+	{
+		CCMetricLabels labels = { {"queue", metrics.name} };
+
+		registry.Gauge("cc_executor_queue_depth", "Tasks waiting to start", labels).Set((int64_t)metrics.queueDepth);
+		AdvanceCounter(registry.Counter("cc_executor_tasks_executed_total", "Tasks run since the queue was created", labels), metrics.tasksExecuted);
+		AdvanceCounter(registry.Counter("cc_executor_tasks_rejected_total", "Tasks refused because the queue was full or closed", labels), metrics.tasksRejected);
+		registry.Gauge("cc_executor_max_wait_microseconds", "Longest wait between submitting a task and starting it", labels).Set((int64_t)metrics.maxLatencyUs);
+	}
+}
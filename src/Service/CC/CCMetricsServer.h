@@ -0,0 +1,38 @@
+#ifndef CC_METRICS_SERVER_H
+#define CC_METRICS_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+class Socket;
+
+/*
+*	CCMetricsServer answers every HTTP request on its port with CCMetricRegistry::Expose, so Prometheus
+*	(or curl) can scrape the service. The request line is not looked at and the connection is closed
+*	after each reply. Scrapes are handled one at a time on the accept thread, a scraper that doesn't
+*	send its request is dropped after CC_METRICS_RECEIVE_TIMEOUT_MS.
+*/
+class CCMetricsServer
+{
+private:
+	std::unique_ptr<Socket>	_serverSocket;
+	std::thread				_acceptThread;
+	std::atomic<bool>		_shouldRun;
+
+	void AcceptThread();
+	void Serve(Socket* socket);
+
+	// copies CCExecutor::GetMetrics into the cc_executor_* gauges
+	static void UpdateExecutorMetrics();
+
+public:
+	CCMetricsServer(int port, const std::string& address = "127.0.0.1");
+	~CCMetricsServer();
+
+	bool Start();
+	void Stop();
+};
+
+#endif
@@ -10,12 +10,37 @@
 #include "CCPacketTypes.h"
 #include "CCDisplay.h"
 #include "CCLogger.h"
+#include "CCStructuredLog.h"
+#include "CCExecutor.h"
+#include "CCTrace.h"
+#include "CCMetrics.h"
 
 #include "INetworkEntityDelegate.h"
 #include "CCConfigurationManager.h"
 
 using nlohmann::json;
 
+// sent data that isn't acknowledged for this long drops the connection
+#define CC_TCP_USER_TIMEOUT_MS 2000
+// a client gives up on a server that stopped talking after about idle + interval * count seconds
+#define CC_TCP_KEEPALIVE_IDLE_S 1
+#define CC_TCP_KEEPALIVE_INTERVAL_S 1
+#define CC_TCP_KEEPALIVE_COUNT 3
+// reconnect attempts start this far apart and back off to the cap, see CCBackoff
+#define CC_RECONNECT_BACKOFF_BASE_MS 20
+#define CC_RECONNECT_BACKOFF_CAP_MS 500
+// connects give up after the failure detector's timeout but never sooner than this, a handshake on a
+// cold link can take a few round trips. A host that is gone would otherwise block for the OS SYN timeout
+#define CC_CONNECT_MIN_TIMEOUT_MS 500
+// a cursor hovering near an edge asks for a warm up on every move
+#define CC_WARM_UP_INTERVAL_MS 250
+// while the client holds keys for us it has to hear from us well within CC_KEY_STUCK_TIMEOUT_MS,
+// whatever the probe interval or idle state
+#define CC_HELD_KEYS_PROBE_INTERVAL_MS (CC_KEY_STUCK_TIMEOUT_MS / 4)
+// these should be configured somehow at some point
+#define CC_CONTROL_PORT 1045
+#define CC_EVENT_PORT 1048
+
 void to_json(json& j, const Point& p) 
 {
     j = json{ {"x", p.x}, {"y", p.y} };
@@ -47,71 +72,43 @@ SocketError CCNetworkEntity::SendRPCOfType(TCPPacketType rpcType, void* data, si
     if (_isLocalEntity)
         return SocketError::SOCKET_E_UNKOWN;
 
+    // only here for its layout, there is nobody to send to
+    if (_tcpCommSocket.get() == NULL)
+        return SocketError::SOCKET_E_SUCCESS;
+
+    // the heartbeat task reconnects, RPCs come from the input thread and must not wait for that
+    if (_tcpCommSocket->GetIsConnected() == false)
+        return SocketError::SOCKET_E_NOT_CONNECTED;
+
     NETCPPacketHeader packet((unsigned char)rpcType);
 
     SocketError error = _tcpCommSocket->Send(&packet, sizeof(packet));
-    if (error != SocketError::SOCKET_E_SUCCESS)
+    if (error == SocketError::SOCKET_E_SUCCESS)
     {
-        if (ShouldRetryRPC(error))
-        {
-            return SendRPCOfType(rpcType, data, dataSize);
-        }
-        else return error;
+        _metrics.bytesSent->Add(sizeof(packet));
+        error = WaitForAwk(_tcpCommSocket.get());
     }
 
-    error = WaitForAwk(_tcpCommSocket.get());
-    if (error != SocketError::SOCKET_E_SUCCESS)
+    if (error == SocketError::SOCKET_E_SUCCESS && data && dataSize != 0)
     {
-        if (ShouldRetryRPC(error))
+        error = _tcpCommSocket->Send(data, dataSize);
+        if (error == SocketError::SOCKET_E_SUCCESS)
         {
-            return SendRPCOfType(rpcType, data, dataSize);
+            _metrics.bytesSent->Add(dataSize);
+            error = WaitForAwk(_tcpCommSocket.get());
         }
-        else return error;
     }
 
-    if (data && dataSize != 0)
+    if (error != SocketError::SOCKET_E_SUCCESS)
     {
-        error = _tcpCommSocket->Send(data, dataSize);
-        if (error != SocketError::SOCKET_E_SUCCESS)
-        {
-            if (ShouldRetryRPC(error))
-            {
-                return SendRPCOfType(rpcType, data, dataSize);
-            }
-            else return error;
-        }
+        CC_TRACE_INSTANT("RPCFailed", _logID, error);
 
-        error = WaitForAwk(_tcpCommSocket.get());
-        if (error != SocketError::SOCKET_E_SUCCESS)
-        {
-            if (ShouldRetryRPC(error))
-            {
-                return SendRPCOfType(rpcType, data, dataSize);
-            }
-            else return error;
-        }
+        // an awk that is still coming must not answer the next RPC
+        _tcpCommSocket->Close(true);
+        Suspect();
     }
 
-    return SocketError::SOCKET_E_SUCCESS;
-}
-
-bool CCNetworkEntity::ShouldRetryRPC(SocketError error) const
-{
-    if (error == SocketError::SOCKET_E_NOT_CONNECTED)
-    {
-        SocketError error = _tcpCommSocket->Connect(); 
-        if (error != SocketError::SOCKET_E_SUCCESS)
-        {
-            return false; 
-        }
-        return true;
-    }
-    else if (error == SocketError::SOCKET_E_BROKEN_PIPE)\
-    {
-        _tcpCommSocket->Close(true); 
-        return true; 
-    }
-    else return false;
+    return error;
 }
 
 SocketError CCNetworkEntity::SendAwk(Socket* socket)
@@ -122,8 +119,25 @@ SocketError CCNetworkEntity::SendAwk(Socket* socket)
     return socket->Send(&awk, sizeof(awk));
 }
 
+// only TCPEventThread writes to the event connection, so it doesn't wait behind RPC replies on the control one
+SocketError CCNetworkEntity::SendEventAwk(Socket* socket, int64_t receivedAt, int64_t previousInjectedAt)
+{
+    NETCPPacketEventAwk awk(receivedAt, previousInjectedAt);
+    return socket->Send(&awk, sizeof(awk));
+}
+
+SocketError CCNetworkEntity::SendClock(Socket* socket)
+{
+    std::lock_guard<std::mutex> lock(_tcpMutex);
+
+    NETCPPacketClock clock(CCLatencyNow());
+    return socket->Send(&clock, sizeof(clock));
+}
+
 SocketError CCNetworkEntity::WaitForAwk(Socket* socket)
 {
+    CC_TRACE_ENTITY_ZONE("WaitForAwk", _logID);
+
     NETCPPacketAwk awk;
     size_t received;
     SocketError error = _tcpCommSocket->Recv((char*)&awk, sizeof(awk), &received);
@@ -137,26 +151,57 @@ SocketError CCNetworkEntity::WaitForAwk(Socket* socket)
     return error;
 }
 
-CCNetworkEntity::CCNetworkEntity(std::string entityID) : _entityID(entityID), _isLocalEntity(true), \
-_shouldBeRunningCommThread(true), _delegate(0)
+CCNetworkEntity::CCNetworkEntity(std::string entityID) : CCNetworkEntity(entityID, SOCKET_ANY_ADDRESS)
 {
-    // this is local so we make the server here
-    int port = 1045; // this should be configured somehow at some point
+}
 
-    _tcpCommSocket = std::make_unique<Socket>(SOCKET_ANY_ADDRESS, port, false, SocketProtocol::SOCKET_P_TCP);
+CCNetworkEntity::CCNetworkEntity(std::string entityID, const std::string& listenAddress) : _entityID(entityID), \
+_logID(CCLogger::logger.InternString(entityID)), _configPath({ "Entities", entityID }), _isLocalEntity(true), \
+_shouldBeRunningCommThread(true), _delegate(0), _metrics(), _eventTimeoutMs(0), _lateAwks(0), _isHoldingKeys(false), _reconnectingSince(0), _isUnreachable(false), \
+_reconnectBackoff(std::chrono::milliseconds(CC_RECONNECT_BACKOFF_BASE_MS), std::chrono::milliseconds(CC_RECONNECT_BACKOFF_CAP_MS)), \
+_isCursorShown(true), _cursorStateLost(false), _lastWarmUpAt(0), _heartbeatGeneration(0), _isHeartbeatIdle(false), _serverConnections(0)
+{
+    // this is local so we make the servers here
+    _tcpCommSocket = std::make_unique<Socket>(listenAddress, CC_CONTROL_PORT, false, SocketProtocol::SOCKET_P_TCP);
+    _tcpEventSocket = std::make_unique<Socket>(listenAddress, CC_EVENT_PORT, false, SocketProtocol::SOCKET_P_TCP);
+    _keyRepeater = std::make_unique<CCKeyRepeater>();
     _tcpCommThread = std::thread(&CCNetworkEntity::TCPCommThread, this);
+    _tcpEventThread = std::thread(&CCNetworkEntity::TCPEventThread, this);
 }
 
-CCNetworkEntity::CCNetworkEntity(std::string entityID, Socket* socket) : _entityID(entityID), _udpCommSocket(socket),\
-_isLocalEntity(false), _shouldBeRunningCommThread(true), _delegate(0)
+CCNetworkEntity::CCNetworkEntity(std::string entityID, Socket* socket) : _entityID(entityID), _logID(CCLogger::logger.InternString(entityID)), \
+_configPath({ "Entities", entityID }), _udpCommSocket(socket),\
+_isLocalEntity(false), _shouldBeRunningCommThread(true), _delegate(0), _metrics(), _eventTimeoutMs(0), _lateAwks(0), _isHoldingKeys(false), _reconnectingSince(0), _isUnreachable(false), \
+_reconnectBackoff(std::chrono::milliseconds(CC_RECONNECT_BACKOFF_BASE_MS), std::chrono::milliseconds(CC_RECONNECT_BACKOFF_CAP_MS)), \
+_isCursorShown(true), _cursorStateLost(false), _lastWarmUpAt(0), _heartbeatGeneration(0), _isHeartbeatIdle(false), _serverConnections(0)
 {
-    // this is a remote entity so we create a tcp client here
+    // without a socket the entity only describes a layout, nothing is ever sent to it
+    if (socket == 0)
+        return;
+
+    CCMetricRegistry& registry = CCMetricRegistry::registry;
+    CCMetricLabels labels = { {"entity", entityID} };
+
+    // an entity that reconnects keeps counting in the same series
+    _metrics.eventsForwarded = &registry.Counter("cc_events_forwarded_total", "Events sent to an entity and awked", labels);
+    _metrics.bytesSent = &registry.Counter("cc_bytes_sent_total", "Event and RPC bytes written to an entity", labels);
+    _metrics.sendErrors = &registry.Counter("cc_send_errors_total", "Events and RPCs that could not be sent to an entity", labels);
+    _metrics.reconnectAttempts = &registry.Counter("cc_reconnect_attempts_total", "Reconnects after a connection to an entity dropped", labels);
+    _metrics.reconnects = &registry.Counter("cc_reconnects_total", "Entities reached again before their reconnect window ran out", labels);
+    _metrics.warmUps = &registry.Counter("cc_warm_ups_total", "Entities connected and probed because the cursor was heading for them", labels);
+    _metrics.repeatsDropped = &registry.Counter("cc_key_repeats_dropped_total", "Repeats of held keys not sent, the entity repeats them itself", labels);
+    _metrics.lateAwks = &registry.Counter("cc_late_awks_total", "Event awks that took longer than the failure detector's timeout", labels);
+    _metrics.probesSkipped = &registry.Counter("cc_probes_skipped_total", "Heartbeats not sent because events were being awked", labels);
+    _metrics.sendDuration = &registry.Histogram("cc_send_duration_seconds", "Sending an event until its awk, waiting for the connection included", labels);
+    _metrics.heartbeatRtt = &registry.Histogram("cc_heartbeat_rtt_seconds", "Heartbeat round trips to an entity", labels);
+
+    // this is a remote entity so we create the tcp clients here
     std::string address = socket->GetAddress();
-    int port = 1045; // this should be configured somehow at some point
 
-    // this is our comm socket, we don't need to do anything else at this point with it
-    _tcpCommSocket = std::make_unique<Socket>(address, port, false, SocketProtocol::SOCKET_P_TCP);
-    _tcpCommThread = std::thread(&CCNetworkEntity::HeartbeatThread, this);
+    // this is our comm socket, it is connected by the first heartbeat
+    _tcpCommSocket = std::make_unique<Socket>(address, CC_CONTROL_PORT, false, SocketProtocol::SOCKET_P_TCP);
+    // and this one by the first event
+    _tcpEventSocket = std::make_unique<Socket>(address, CC_EVENT_PORT, false, SocketProtocol::SOCKET_P_TCP);
 }
 
 CCNetworkEntity::~CCNetworkEntity()
@@ -164,38 +209,202 @@ CCNetworkEntity::~CCNetworkEntity()
     ShutdownThreads();
 }
 
-SocketError CCNetworkEntity::SendOSEvent(const OSEvent& event)
+SocketError CCNetworkEntity::SendOSEvent(const OSEvent& event, int64_t capturedAt)
 {
+    CC_TRACE_ENTITY_ZONE("SendOSEvent", _logID);
+
     if (_isLocalEntity)
     {
         LOG_ERROR << "Trying to send Event to Local Entity !" << std::endl;
         return SocketError::SOCKET_E_SUCCESS;
     }
 
-    std::lock_guard<std::mutex> lock(_tcpMutex);
+    // waiting for the lock counts as sending
+    int64_t enqueuedAt = CCLatencyNow();
 
-    if (_tcpCommSocket->GetIsConnected() == false)
+    std::lock_guard<std::mutex> lock(_eventMutex);
+
+    if (_tcpEventSocket.get() == NULL)
+        return SocketError::SOCKET_E_SUCCESS;
+
+    bool isKey = event.eventType == OS_EVENT_KEY;
+    auto heldKey = isKey ? std::find(_heldKeys.begin(), _heldKeys.end(), event.scanCode) : _heldKeys.end();
+
+    if (isKey && event.keyEvent == KEY_EVENT_DOWN && heldKey != _heldKeys.end())
     {
-        SocketError error = _tcpCommSocket->Connect();
-        if(error != SocketError::SOCKET_E_SUCCESS)
-            return error;
+        _metrics.repeatsDropped->Add();
+        return SocketError::SOCKET_E_SUCCESS;
     }
 
-    NETCPPacketHeader header((char)TCPPacketType::OSEventHeader);
-    SocketError ret = _tcpCommSocket->Send(&header, sizeof(header));
-    if (ret != SocketError::SOCKET_E_SUCCESS)
-        return ret;
-    ret = WaitForAwk(_tcpCommSocket.get());
-    if (ret != SocketError::SOCKET_E_SUCCESS)
-        return ret;
+    // an entity that stopped awking is dropped until a probe hears from it, reconnecting to a host
+    // that is gone could hold up the input thread for seconds. A failed RPC or warm up leaves the event
+    // connection open, it's closed here so the client lets go of the keys whose up is dropped now
+    if (_failureDetector.GetIsSuspect())
+    {
+        _metrics.sendErrors->Add();
+
+        if (_tcpEventSocket->GetIsConnected())
+            _tcpEventSocket->Close(true);
+        _heldKeys.clear();
+        _isHoldingKeys = false;
+
+        return SocketError::SOCKET_E_NOT_CONNECTED;
+    }
+
+    SocketError ret = SocketError::SOCKET_E_SUCCESS;
+
+    if (_tcpEventSocket->GetIsConnected() == false)
+        ret = ConnectEvents();
+
+    uint32_t timeoutMs = _failureDetector.GetTimeoutMs();
+    if (ret == SocketError::SOCKET_E_SUCCESS && timeoutMs != _eventTimeoutMs)
+    {
+        ret = _tcpEventSocket->SetReceiveTimeout(timeoutMs);
+        _eventTimeoutMs = timeoutMs;
+    }
 
     OSInputEventPacket packet(event);
+    if (ret == SocketError::SOCKET_E_SUCCESS)
+        ret = _tcpEventSocket->Send(&packet, sizeof(packet));
+    if (ret == SocketError::SOCKET_E_SUCCESS)
+        _metrics.bytesSent->Add(sizeof(packet));
 
-    ret = _tcpCommSocket->Send(&packet, sizeof(packet));
-    if (ret != SocketError::SOCKET_E_SUCCESS)
-        return ret;
+    bool isSent = ret == SocketError::SOCKET_E_SUCCESS;
+    int64_t sentAt = CCLatencyNow();
 
-    return WaitForAwk(_tcpCommSocket.get());
+    // the awks of earlier events that were late come before this one's
+    NETCPPacketEventAwk awk;
+    while (ret == SocketError::SOCKET_E_SUCCESS && _lateAwks > 0)
+    {
+        ret = ReceiveEventAwk(awk, timeoutMs);
+        if (ret == SocketError::SOCKET_E_SUCCESS)
+            _lateAwks--;
+    }
+
+    if (ret == SocketError::SOCKET_E_SUCCESS)
+        ret = ReceiveEventAwk(awk, timeoutMs);
+
+    // the client has the event once it's sent, whether or not the awk is late
+    if (isSent)
+    {
+        if (isKey && event.keyEvent == KEY_EVENT_DOWN)
+            _heldKeys.push_back(event.scanCode);
+        else if (heldKey != _heldKeys.end())
+            _heldKeys.erase(heldKey);
+
+        // a heartbeat scheduled further out than the client waits would let the key go, a new chain
+        // probes right away. Only an entity whose heartbeats were started has one to replace
+        bool wasHoldingKeys = _isHoldingKeys.exchange(_heldKeys.empty() == false);
+        if (wasHoldingKeys == false && _isHoldingKeys && _heartbeatGeneration != 0 && \
+            _failureDetector.GetProbeIntervalMs() > CC_HELD_KEYS_PROBE_INTERVAL_MS)
+            StartHeartbeat();
+    }
+
+    if (ret == SocketError::SOCKET_E_SUCCESS)
+    {
+        int64_t now = CCLatencyNow();
+
+        _latencyTrace.EventDelivered(capturedAt, enqueuedAt, sentAt, awk.ReceivedAt, awk.PreviousInjectedAt);
+        _failureDetector.Heard(now, now - sentAt);
+        _metrics.eventsForwarded->Add();
+        _metrics.sendDuration->Observe(now - enqueuedAt);
+    }
+    // a jitter spike only delays the awk, the connection and the client's held keys are kept
+    else if (ret == SocketError::SOCKET_E_TIMEOUT && _failureDetector.Missed() == false)
+    {
+        _lateAwks++;
+        _metrics.lateAwks->Add();
+    }
+    else
+    {
+        _latencyTrace.ConnectionReset();
+        Suspect();
+        _metrics.sendErrors->Add();
+
+        // the next event starts over on a new connection, an awk that is still coming must not answer it,
+        // a failed connect leaves the socket unusable as well
+        if (_tcpEventSocket->GetIsConnected())
+            _metrics.reconnectAttempts->Add();
+        _tcpEventSocket->Close(true);
+
+        // the client lets go of its keys once the connection is gone
+        _heldKeys.clear();
+        _isHoldingKeys = false;
+    }
+
+    return ret;
+}
+
+void CCNetworkEntity::ReleaseHeldKeys(int64_t capturedAt)
+{
+    if (_isLocalEntity)
+        return;
+
+    std::vector<int> heldKeys;
+    {
+        std::lock_guard<std::mutex> lock(_eventMutex);
+        heldKeys = _heldKeys;
+    }
+
+    for (int scanCode : heldKeys)
+    {
+        OSEvent up;
+        up.eventType = OS_EVENT_KEY;
+        up.keyEvent = KEY_EVENT_UP;
+        up.scanCode = scanCode;
+
+        SendOSEvent(up, capturedAt);
+    }
+}
+
+void CCNetworkEntity::WarmUp()
+{
+    if (_isLocalEntity || _tcpEventSocket.get() == NULL)
+        return;
+
+    int64_t now = CCLatencyNow();
+    int64_t lastWarmUpAt = _lastWarmUpAt.load(std::memory_order_relaxed);
+
+    if (now - lastWarmUpAt < CC_WARM_UP_INTERVAL_MS * 1000 || _lastWarmUpAt.compare_exchange_strong(lastWarmUpAt, now) == false)
+        return;
+
+    std::weak_ptr<CCNetworkEntity> weakEntity = shared_from_this();
+    CCExecutor::SharedExecutor().Submit([weakEntity]() {
+        std::shared_ptr<CCNetworkEntity> entity = weakEntity.lock();
+        if (entity)
+            entity->WarmUpConnections();
+    });
+}
+
+void CCNetworkEntity::WarmUpConnections()
+{
+    CC_TRACE_ENTITY_ZONE("WarmUp", _logID);
+
+    // reconnecting is up to the heartbeat
+    if (_shouldBeRunningCommThread == false || _failureDetector.GetIsSuspect())
+        return;
+
+    _metrics.warmUps->Add();
+
+    {
+        std::lock_guard<std::mutex> lock(_eventMutex);
+
+        if (_tcpEventSocket->GetIsConnected() == false)
+        {
+            SocketError error = ConnectEvents();
+            if (error != SocketError::SOCKET_E_SUCCESS)
+            {
+                LOG_ERROR << "Error warming up events to " << _entityID << ": " << SOCK_ERR_STR(_tcpEventSocket.get(), error) << std::endl;
+                _tcpEventSocket->Close(true);
+                Suspect();
+                return;
+            }
+        }
+    }
+
+    // an entity that awked anything lately is known to be there and awake
+    if (_failureDetector.ShouldProbe(CCLatencyNow()))
+        Probe();
 }
 
 SocketError CCNetworkEntity::ReceiveOSEvent(Socket* socket, OSEvent& newEvent)
@@ -204,9 +413,13 @@ SocketError CCNetworkEntity::ReceiveOSEvent(Socket* socket, OSEvent& newEvent)
     size_t received = 0;
     SocketError error = socket->Recv((char*)&packet, sizeof(packet), &received);
 
-    if (error != SocketError::SOCKET_E_SUCCESS || received != sizeof(packet))
+    // a connection the server closed reads nothing
+    if (error == SocketError::SOCKET_E_SUCCESS && received != sizeof(packet))
+        error = SocketError::SOCKET_E_INVALID_PACKET;
+
+    if (error != SocketError::SOCKET_E_SUCCESS)
     {
-        LOG_ERROR << "Error Trying Receive OS Event Packet From Server !: " << SOCK_ERR_STR(socket, error) << std::endl;
+        LOG_SITE(ReceiveOSEventError, CCLogSockErr(socket, error));
         return error;
     }
 
@@ -324,15 +537,39 @@ void CCNetworkEntity::ClearAllEntities()
     _rightEntites.clear();
 }
 
+void CCNetworkEntity::RemoveEntity(CCNetworkEntity* entity)
+{
+    for (auto list : { &_leftEntites, &_topEntites, &_bottomEntites, &_rightEntites })
+    {
+        list->erase(std::remove(list->begin(), list->end(), entity), list->end());
+    }
+}
+
+void CCNetworkEntity::DisconnectFromAll()
+{
+    for (auto list : { &_leftEntites, &_topEntites, &_bottomEntites, &_rightEntites })
+    {
+        for (auto entity : *list)
+        {
+            if (entity != this)
+                entity->RemoveEntity(this);
+        }
+    }
+
+    ClearAllEntities();
+}
+
 void CCNetworkEntity::LoadFrom(const CCConfigurationManager& manager)
 {
-    manager.GetValue({ "Entities", _entityID }, _offsets);
+    manager.GetValue(_configPath, _offsets);
     SetDisplayOffsets(_offsets);
+
+    _failureDetector.LoadFrom(manager);
 }
 
 void CCNetworkEntity::SaveTo(CCConfigurationManager& manager) const
 {
-    manager.SetValue({ "Entities", _entityID }, _offsets);
+    manager.SetValue(_configPath, _offsets);
 }
 
 void CCNetworkEntity::ShutdownThreads()
@@ -342,30 +579,48 @@ void CCNetworkEntity::ShutdownThreads()
     if (_udpCommSocket.get())
         _udpCommSocket->Close();
 
+    // closing alone doesn't wake the comm threads if they are blocked in accept
     if (_tcpCommSocket.get())
+    {
+        _tcpCommSocket->Disconnect();
         _tcpCommSocket->Close();
+    }
+
+    if (_tcpEventSocket.get())
+    {
+        _tcpEventSocket->Disconnect();
+        _tcpEventSocket->Close();
+    }
 
-    _tcpCommThread.join();
+    // remote entities have no threads, their heartbeats stop once the entity is gone
+    if (_tcpCommThread.joinable())
+        _tcpCommThread.join();
+    if (_tcpEventThread.joinable())
+        _tcpEventThread.join();
+
+    // nothing is injected anymore, keys the server still held are let go
+    if (_keyRepeater)
+        _keyRepeater->Stop();
 }
 
 void CCNetworkEntity::RPC_SetMousePosition(float xPercent, float yPercent)
 {
+    CC_TRACE_ENTITY_ZONE("RPC_SetMousePosition", _logID);
+
     if (_isLocalEntity)
     {
         // warp mouse
         int x = _totalBounds.topLeft.x + (int)((_totalBounds.bottomRight.x - _totalBounds.topLeft.x) * xPercent);
         int y = _totalBounds.topLeft.y + (int)((_totalBounds.bottomRight.y - _totalBounds.topLeft.y) * yPercent);
-        LOG_ERROR << "RPC_SetMousePosition {" << x << "," << y << "}" << std::endl;
+        LOG_INFO << "RPC_SetMousePosition {" << x << "," << y << "}" << std::endl;
 
-        // spawn thread for to send input on because we don't want a dead lock with messages
+        // input is sent from another thread because we don't want a dead lock with messages
         // this is a windows issue and could be solved in OSInterface probably but for now
-        // this will work
+        // this will work, the queue keeps warps in order
 
-        std::thread thread([x,y]() {
+        CCExecutor::SharedExecutor().GetQueue("injection")->Submit([x,y]() {
             OSInterface::SharedInterface().SetMousePosition(x, y);
         });
-
-        thread.detach();
     }
     else
     {
@@ -373,6 +628,7 @@ void CCNetworkEntity::RPC_SetMousePosition(float xPercent, float yPercent)
         SocketError error = SendRPCOfType(TCPPacketType::RPC_SetMousePosition, &data, sizeof(data));
         if (error != SocketError::SOCKET_E_SUCCESS)
         {
+            _metrics.sendErrors->Add();
             LOG_ERROR << "Could not perform RPC_StartWarpingMouse!: " << SOCK_ERR_STR(_tcpCommSocket.get(), error) << std::endl;
         }
     }
@@ -380,6 +636,8 @@ void CCNetworkEntity::RPC_SetMousePosition(float xPercent, float yPercent)
 
 void CCNetworkEntity::RPC_HideMouse()
 {
+    CC_TRACE_ENTITY_ZONE("RPC_HideMouse", _logID);
+
     if (_isLocalEntity)
     {
         // hide mouse
@@ -387,9 +645,13 @@ void CCNetworkEntity::RPC_HideMouse()
     }
     else
     {
+        _isCursorShown = false;
+
         SocketError error = SendRPCOfType(TCPPacketType::RPC_HideMouse);
+        _cursorStateLost = error != SocketError::SOCKET_E_SUCCESS;
         if (error != SocketError::SOCKET_E_SUCCESS)
         {
+            _metrics.sendErrors->Add();
             LOG_ERROR << "Could not perform RPC_HideMouse!: " << SOCK_ERR_STR(_tcpCommSocket.get(), error) << std::endl;
         }
     }
@@ -397,6 +659,8 @@ void CCNetworkEntity::RPC_HideMouse()
 
 void CCNetworkEntity::RPC_UnhideMouse()
 {
+    CC_TRACE_ENTITY_ZONE("RPC_UnhideMouse", _logID);
+
     if (_isLocalEntity)
     {
         // stop hide mouse
@@ -404,9 +668,13 @@ void CCNetworkEntity::RPC_UnhideMouse()
     }
     else
     {
+        _isCursorShown = true;
+
         SocketError error = SendRPCOfType(TCPPacketType::RPC_UnhideMouse);
+        _cursorStateLost = error != SocketError::SOCKET_E_SUCCESS;
         if (error != SocketError::SOCKET_E_SUCCESS)
         {
+            _metrics.sendErrors->Add();
             LOG_ERROR << "Could not perform RPC!: " << SOCK_ERR_STR(_tcpCommSocket.get(), error) << std::endl;
         }
     }
@@ -436,6 +704,9 @@ void CCNetworkEntity::TCPCommThread()
             continue;
         }
 
+        SetupServerConnection(server);
+        uint32_t connection = ++_serverConnections;
+
         // we don't spawn a thread here because there should only ever be one server
         while (server->GetIsConnected() && _shouldBeRunningCommThread)
         {
@@ -451,12 +722,15 @@ void CCNetworkEntity::TCPCommThread()
             if (received == sizeof(packet) && packet.MagicNumber == P_MAGIC_NUMBER)
             {
                 SendAwk(server);
+                _keyRepeater->Heard();
 
-                LOG_INFO << "Received RPC ";
+                // probes come several times a second while the server is idle
+                if (packet.Type != (unsigned char)TCPPacketType::Heartbeat)
+                    LOG_SITE(ReceivedTCPPacket, packet.Type);
                 switch ((TCPPacketType)packet.Type)
                 {
                 case TCPPacketType::RPC_SetMousePosition:
-                    LOG_ERROR << "RPC_SetMousePosition" << std::endl;
+                    LOG_INFO << "RPC_SetMousePosition" << std::endl;
                     {
                         NERPCSetMouseData data;
                         error = server->Recv((char*)&data, sizeof(data), &received);
@@ -486,31 +760,7 @@ void CCNetworkEntity::TCPCommThread()
                     RPC_UnhideMouse();
                     break;
                 case TCPPacketType::Heartbeat:
-                    LOG_INFO << "Received Heartbeat from server !" << std::endl;
-                    break;
-                case TCPPacketType::OSEventHeader:
-                    LOG_INFO << "Received OS Event Header from server !" << std::endl;
-                    {
-                        OSEvent osEvent;
-
-                        error = ReceiveOSEvent(server, osEvent);
-
-                        if (error != SocketError::SOCKET_E_SUCCESS)
-                        {
-                            LOG_ERROR << "Error receiving OSEvent Data Packet from Server {" << server->GetAddress() << "} " << SOCK_ERR_STR(server, error) << std::endl;
-                            break;
-                        }
-
-                        SendAwk(server);
-
-                        LOG_INFO << osEvent << std::endl;
-
-                        auto osError = OSInterface::SharedInterface().SendOSEvent(osEvent);
-                        if (osError != OSInterfaceError::OS_E_SUCCESS)
-                        {
-                            LOG_ERROR << "Error Trying To Inject OS Event" << osEvent << " with error " << OSInterfaceErrorToString(osError) << std::endl;
-                        }
-                    }
+                    SendClock(server);
                     break;
                 }
             }
@@ -522,77 +772,412 @@ void CCNetworkEntity::TCPCommThread()
             
         }
         delete server;
-    
-        if (_delegate)
-            _delegate->LostServer();
+        CC_TRACE_INSTANT("LostServer", _logID, error);
+
+        if (_delegate && _shouldBeRunningCommThread)
+            WaitForServerToReconnect(connection);
     }
 }
 
-void CCNetworkEntity::HeartbeatThread()
+void CCNetworkEntity::WaitForServerToReconnect(uint32_t connection)
 {
-    NETCPPacketHeader hearbeat((char)TCPPacketType::Heartbeat);
+    // the server keeps reconnecting for its reconnect window, give it a backoff step longer than that
+    std::chrono::milliseconds wait(_failureDetector.GetReconnectWindowMs() + CC_RECONNECT_BACKOFF_CAP_MS);
+    std::weak_ptr<CCNetworkEntity> weakEntity;
+    try
+    {
+        weakEntity = shared_from_this();
+    }
+    catch (const std::bad_weak_ptr&)
+    {
+        // being destroyed, nobody is left to tell
+        return;
+    }
 
-    if (_tcpCommSocket->GetIsConnected() == false)
+    CCExecutor::SharedExecutor().SubmitAfter(wait, [weakEntity, connection]() {
+        std::shared_ptr<CCNetworkEntity> entity = weakEntity.lock();
+        if (entity == NULL || entity->_shouldBeRunningCommThread == false || entity->_serverConnections != connection)
+            return;
+
+        LOG_INFO << "Server did not reconnect" << std::endl;
+        if (entity->_delegate)
+            entity->_delegate->LostServer();
+    });
+}
+
+void CCNetworkEntity::TCPEventThread()
+{
+    SocketError error = _tcpEventSocket->Bind();
+    if (error != SocketError::SOCKET_E_SUCCESS)
+    {
+        LOG_ERROR << "Error Binding Network Entity TCP Event Socket: " << SOCK_ERR_STR(_tcpEventSocket.get(), error) << std::endl;
+    }
+
+    error = _tcpEventSocket->Listen();
+    if (error != SocketError::SOCKET_E_SUCCESS)
     {
-        std::lock_guard<std::mutex> lock(_tcpMutex);
-        SocketError error = _tcpCommSocket->Connect();
+        LOG_ERROR << "Error Listening From Network Entity TCP Event Socket: " << SOCK_ERR_STR(_tcpEventSocket.get(), error) << std::endl;
+    }
+
+    CCCounter& injected = CCMetricRegistry::registry.Counter("cc_events_injected_total", "Events from the server handed to the OS");
+    CCCounter& injectErrors = CCMetricRegistry::registry.Counter("cc_inject_errors_total", "Events from the server the OS refused");
+
+    while (_shouldBeRunningCommThread)
+    {
+        Socket* server = NULL;
+        error = _tcpEventSocket->Accept(&server);
         if (error != SocketError::SOCKET_E_SUCCESS)
         {
-            if (_delegate)
-            {
-                _delegate->EntityLost(this);
-                return;
-            }
+            LOG_ERROR << "Error accepting server event connection: " << SOCK_ERR_STR(_tcpEventSocket.get(), error) << std::endl;
+            continue;
         }
-    }
 
-    while (_shouldBeRunningCommThread && _tcpCommSocket->GetIsConnected())
-    {
-        auto nextHeartbeat = std::chrono::system_clock::now() + std::chrono::seconds(5);
+        // awks go out as soon as the event is read, don't let them wait for a delayed ack
+        server->SetNoDelay(true);
+        SetupServerConnection(server);
+
+        // injection times are reported with the next event's awk, they never span connections
+        int64_t lastInjectedAt = 0;
+
+        // the control connection decides when the server is lost, a dropped event connection
+        // is opened again by the server's next event
+        while (server->GetIsConnected() && _shouldBeRunningCommThread)
         {
-            std::lock_guard<std::mutex> lock(_tcpMutex);
-            SocketError error = _tcpCommSocket->Send((void*)&hearbeat, sizeof(hearbeat));
+            OSEvent osEvent;
 
-            if (error != SocketError::SOCKET_E_SUCCESS)
-            {
-                if (_delegate)
-                {
-                    _delegate->EntityLost(this);
-                    return;
-                }
-            }
+            error = ReceiveOSEvent(server, osEvent);
+            int64_t receivedAt = CCLatencyNow();
 
-            NETCPPacketAwk awk;
-            size_t received = 0;
-            error = _tcpCommSocket->Recv((char*)&awk, sizeof(awk), &received);
             if (error != SocketError::SOCKET_E_SUCCESS)
+                break;
+
+            SendEventAwk(server, receivedAt, lastInjectedAt);
+            _keyRepeater->Heard();
+
+            LOG_SITE(ReceivedOSEvent, osEvent);
+
+            CC_TRACE_ZONE("InjectOSEvent");
+            // keys go through the repeater so their repeats stay in order with them
+            auto osError = osEvent.eventType == OS_EVENT_KEY ? _keyRepeater->Inject(osEvent) : OSInterface::SharedInterface().SendOSEvent(osEvent);
+            if (osError != OSInterfaceError::OS_E_SUCCESS)
             {
-                if (_delegate)
-                {
-                    _delegate->EntityLost(this);
-                    return;
-                }
+                injectErrors.Add();
+                LOG_SITE(InjectOSEventError, osEvent, osError);
+                // the server shouldn't count an event that never made it
+                lastInjectedAt = 0;
             }
-            if (received != sizeof(awk) || awk.MagicNumber != P_MAGIC_NUMBER)
+            else
             {
-                if (_delegate)
-                {
-                    _delegate->EntityLost(this);
-                    return;
-                }
+                injected.Add();
+                lastInjectedAt = CCLatencyNow();
             }
         }
+        delete server;
 
-        std::this_thread::sleep_until(nextHeartbeat);
+        // a key can't be let go through a connection that is gone, the server sends its downs again
+        _keyRepeater->ReleaseAll();
     }
 }
 
-bool CCNetworkEntity::GetEntityForPointInJumpZone(Point& p, CCNetworkEntity** jumpEntity, JumpDirection& direction)const
+uint32_t CCNetworkEntity::GetConnectTimeoutMs()
 {
-    Rect collision = _totalBounds;
+    uint32_t timeoutMs = std::max<uint32_t>(_failureDetector.GetTimeoutMs(), CC_CONNECT_MIN_TIMEOUT_MS);
+    return std::min(timeoutMs, _failureDetector.GetReconnectWindowMs());
+}
 
-    collision.topLeft = collision.topLeft + _offsets;
-    collision.bottomRight = collision.bottomRight + _offsets;
+SocketError CCNetworkEntity::ConnectTCP()
+{
+    CC_TRACE_ENTITY_ZONE("ConnectTCP", _logID);
+
+    SocketError error = _tcpCommSocket->ConnectWithTimeout(GetConnectTimeoutMs());
+    if (error != SocketError::SOCKET_E_SUCCESS)
+        return error;
+
+    // not every OS has it, the receive timeout still catches a silent peer
+    _tcpCommSocket->SetUserTimeout(CC_TCP_USER_TIMEOUT_MS);
+
+    // awks are answered right away, anything slower is treated as a lost connection
+    return _tcpCommSocket->SetReceiveTimeout(_failureDetector.GetTimeoutMs());
+}
+
+SocketError CCNetworkEntity::ConnectEvents()
+{
+    CC_TRACE_ENTITY_ZONE("ConnectEvents", _logID);
+
+    SocketError error = _tcpEventSocket->ConnectWithTimeout(GetConnectTimeoutMs());
+    if (error == SocketError::SOCKET_E_SUCCESS)
+        error = _tcpEventSocket->SetNoDelay(true);
+
+    if (error == SocketError::SOCKET_E_SUCCESS)
+        _tcpEventSocket->SetUserTimeout(CC_TCP_USER_TIMEOUT_MS);
+
+    // a new socket starts without a receive timeout or awks still coming
+    _eventTimeoutMs = 0;
+    _lateAwks = 0;
+
+    return error;
+}
+
+SocketError CCNetworkEntity::ReceiveEventAwk(NETCPPacketEventAwk& awk, uint32_t timeoutMs)
+{
+    // a receive timeout running out can leave the connection unusable (on Windows), waiting first doesn't
+    SocketError error = _tcpEventSocket->WaitForData(timeoutMs);
+    if (error != SocketError::SOCKET_E_SUCCESS)
+        return error;
+
+    size_t received = 0;
+    error = _tcpEventSocket->Recv((char*)&awk, sizeof(awk), &received);
+
+    if (error == SocketError::SOCKET_E_SUCCESS && (received != sizeof(awk) || awk.MagicNumber != P_MAGIC_NUMBER))
+    {
+        LOG_ERROR << "Error Receiving Event Awk, Invalid Packet received" << std::endl;
+        error = SocketError::SOCKET_E_INVALID_PACKET;
+    }
+
+    return error;
+}
+
+void CCNetworkEntity::SetupServerConnection(Socket* server)
+{
+    SocketError error = server->SetKeepAlive(true, CC_TCP_KEEPALIVE_IDLE_S, CC_TCP_KEEPALIVE_INTERVAL_S, CC_TCP_KEEPALIVE_COUNT);
+    if (error != SocketError::SOCKET_E_SUCCESS)
+        LOG_ERROR << "Error enabling keepalive on server connection: " << SOCK_ERR_STR(server, error) << std::endl;
+
+    server->SetUserTimeout(CC_TCP_USER_TIMEOUT_MS);
+}
+
+void CCNetworkEntity::StartHeartbeat()
+{
+    ScheduleHeartbeat(shared_from_this(), ++_heartbeatGeneration, CCExecutorClock::now());
+}
+
+void CCNetworkEntity::WakeUp()
+{
+    // the heartbeat waiting for the tick is dropped when it fires
+    if (_isHeartbeatIdle.exchange(false))
+        StartHeartbeat();
+}
+
+void CCNetworkEntity::ScheduleHeartbeat(std::weak_ptr<CCNetworkEntity> weakEntity, uint32_t generation, CCExecutorClock::time_point at)
+{
+    // the task only holds the entity while it runs, a destroyed entity ends the heartbeats
+    CCExecutor::SharedExecutor().SubmitAt(at, [weakEntity, generation]() {
+        std::shared_ptr<CCNetworkEntity> entity = weakEntity.lock();
+        if (entity == NULL)
+            return;
+
+        CCExecutorClock::time_point next;
+        if (entity->RunHeartbeat(generation, next))
+            ScheduleHeartbeat(weakEntity, generation, next);
+    });
+}
+
+bool CCNetworkEntity::RunHeartbeat(uint32_t generation, CCExecutorClock::time_point& next)
+{
+    std::lock_guard<std::mutex> lock(_heartbeatMutex);
+
+    if (generation != _heartbeatGeneration)
+        return false;
+
+    std::chrono::milliseconds delay = Heartbeat();
+    if (delay.count() < 0)
+        return false;
+
+    // set before looking so a WakeUp in between can't be missed, it starts a new chain at worst
+    _isHeartbeatIdle = true;
+
+    // the client only keeps held keys pressed while it hears from us, so an entity holding keys never idles
+    if (_reconnectingSince == 0 && _isHoldingKeys == false && _idleMonitor && _idleMonitor->IsIdle(CCLatencyNow()))
+    {
+        next = _idleMonitor->NextTick();
+        return true;
+    }
+
+    _isHeartbeatIdle = false;
+    next = CCExecutorClock::now() + delay;
+
+    return true;
+}
+
+std::chrono::milliseconds CCNetworkEntity::Heartbeat()
+{
+    CC_TRACE_ENTITY_ZONE("Heartbeat", _logID);
+
+    if (_shouldBeRunningCommThread == false)
+        return std::chrono::milliseconds(-1);
+
+    SocketError error = SocketError::SOCKET_E_SUCCESS;
+
+    // the cursor goes home while the entity is in doubt, instead of being stuck on it until it's lost
+    if (_isUnreachable == false && _failureDetector.GetIsSuspect() && _delegate)
+    {
+        _isUnreachable = true;
+        _delegate->EntityUnreachable(this);
+    }
+
+    if (_reconnectingSince != 0)
+    {
+        _metrics.reconnectAttempts->Add();
+        error = Probe();
+    }
+    // events are being awked, they already tell us the entity is there. Held keys aren't repeated over
+    // the network, the client needs the probe to know we are still there
+    else if (_isHoldingKeys || _failureDetector.ShouldProbe(CCLatencyNow()))
+        error = Probe();
+    else _metrics.probesSkipped->Add();
+
+    if (error == SocketError::SOCKET_E_SUCCESS)
+    {
+        if (_reconnectingSince != 0)
+            Reconnected();
+
+        // after the cursor state was resent, the delegate gives the cursor back if it wasn't moved since
+        if (_isUnreachable)
+        {
+            _isUnreachable = false;
+            if (_delegate)
+                _delegate->EntityReachable(this);
+        }
+
+        uint32_t intervalMs = _failureDetector.GetProbeIntervalMs();
+        if (_isHoldingKeys)
+            intervalMs = std::min<uint32_t>(intervalMs, CC_HELD_KEYS_PROBE_INTERVAL_MS);
+
+        return std::chrono::milliseconds(intervalMs);
+    }
+
+    int64_t now = CCLatencyNow();
+
+    if (_reconnectingSince == 0)
+    {
+        LOG_ERROR << "Heartbeat to " << _entityID << " failed, reconnecting: " << SOCK_ERR_STR(_tcpCommSocket.get(), error) << std::endl;
+        CC_TRACE_INSTANT("Reconnecting", _logID, error);
+
+        _reconnectingSince = now;
+        _latencyTrace.ConnectionReset();
+
+        if (_isUnreachable == false && _delegate)
+        {
+            _isUnreachable = true;
+            _delegate->EntityUnreachable(this);
+        }
+
+        // the first event after reconnecting opens a new event connection as well
+        std::lock_guard<std::mutex> lock(_eventMutex);
+        if (_tcpEventSocket->GetIsConnected())
+            _tcpEventSocket->Close(true);
+        _heldKeys.clear();
+        _isHoldingKeys = false;
+    }
+
+    int64_t windowUs = (int64_t)_failureDetector.GetReconnectWindowMs() * 1000;
+    if (now - _reconnectingSince >= windowUs)
+    {
+        LOG_ERROR << "Could not reconnect to " << _entityID << ": " << SOCK_ERR_STR(_tcpCommSocket.get(), error) << std::endl;
+        CC_TRACE_INSTANT("EntityLost", _logID, error);
+
+        if (_delegate && _shouldBeRunningCommThread)
+            _delegate->EntityLost(this);
+
+        return std::chrono::milliseconds(-1);
+    }
+
+    // the last attempt lands at the end of the window
+    std::chrono::milliseconds remaining((windowUs - (now - _reconnectingSince) + 999) / 1000);
+    return std::min(_reconnectBackoff.Next(), remaining);
+}
+
+void CCNetworkEntity::Reconnected()
+{
+    int64_t downMs = (CCLatencyNow() - _reconnectingSince) / 1000;
+
+    LOG_INFO << "Reconnected to " << _entityID << " after " << downMs << "ms" << std::endl;
+    CC_TRACE_INSTANT("Reconnected", _logID, downMs);
+
+    _reconnectingSince = 0;
+    _reconnectBackoff.Reset();
+    _metrics.reconnects->Add();
+
+    // a jump while we were away couldn't hide or show the cursor, the client still has the old state.
+    // The resend clears _cursorStateLost once it goes through
+    if (_cursorStateLost)
+    {
+        if (_isCursorShown)
+            RPC_UnhideMouse();
+        else RPC_HideMouse();
+    }
+}
+
+void CCNetworkEntity::Suspect()
+{
+    // the heartbeat would only notice at its next tick, which can be a probe interval or an idle tick away
+    bool wasSuspect = _failureDetector.GetIsSuspect();
+    _failureDetector.Suspect();
+
+    if (wasSuspect == false && _heartbeatGeneration != 0)
+        StartHeartbeat();
+}
+
+SocketError CCNetworkEntity::Probe()
+{
+    NETCPPacketHeader hearbeat((char)TCPPacketType::Heartbeat);
+    SocketError error = SocketError::SOCKET_E_SUCCESS;
+
+    std::lock_guard<std::mutex> lock(_tcpMutex);
+
+    if (_tcpCommSocket->GetIsConnected() == false)
+        error = ConnectTCP();
+    else
+        error = _tcpCommSocket->SetReceiveTimeout(_failureDetector.GetTimeoutMs());
+
+    int64_t sentAt = CCLatencyNow();
+
+    if (error == SocketError::SOCKET_E_SUCCESS)
+        error = _tcpCommSocket->Send((void*)&hearbeat, sizeof(hearbeat));
+
+    if (error == SocketError::SOCKET_E_SUCCESS)
+    {
+        NETCPPacketAwk awk;
+        size_t received = 0;
+        error = _tcpCommSocket->Recv((char*)&awk, sizeof(awk), &received);
+
+        if (error == SocketError::SOCKET_E_SUCCESS && (received != sizeof(awk) || awk.MagicNumber != P_MAGIC_NUMBER))
+            error = SocketError::SOCKET_E_INVALID_PACKET;
+    }
+
+    // the client follows the awk with its clock
+    if (error == SocketError::SOCKET_E_SUCCESS)
+    {
+        NETCPPacketClock clock;
+        size_t received = 0;
+        error = _tcpCommSocket->Recv((char*)&clock, sizeof(clock), &received);
+
+        if (error == SocketError::SOCKET_E_SUCCESS && (received != sizeof(clock) || clock.MagicNumber != P_MAGIC_NUMBER))
+            error = SocketError::SOCKET_E_INVALID_PACKET;
+
+        if (error == SocketError::SOCKET_E_SUCCESS)
+        {
+            int64_t now = CCLatencyNow();
+            _latencyTrace.AddClockSample(sentAt, clock.Time, now);
+            _failureDetector.Heard(now, now - sentAt);
+            _metrics.heartbeatRtt->Observe(now - sentAt);
+        }
+    }
+
+    if (error != SocketError::SOCKET_E_SUCCESS)
+    {
+        // a failed connect leaves the socket unusable as well, the next probe starts on a new one
+        _tcpCommSocket->Close(true);
+        _failureDetector.Suspect();
+    }
+
+    return error;
+}
+
+bool CCNetworkEntity::GetEntityForPointInJumpZone(Point& p, CCNetworkEntity** jumpEntity, JumpDirection& direction)const
+{
+    // the displays' offsets are already in _totalBounds
+    const Rect& collision = _totalBounds;
 
     if (p.y < (collision.topLeft.y + _jumpBuffer))
     {
@@ -639,7 +1224,7 @@ bool CCNetworkEntity::GetEntityForPointInJumpZone(Point& p, CCNetworkEntity** ju
         {
             if (entity->PointIntersectsEntity({ p.x + _jumpBuffer, p.y }))
             {
-                p.y = +_jumpBuffer;
+                p.x += _jumpBuffer;
                 *jumpEntity = entity;
                 direction = JumpDirection::RIGHT;
                 return true;
@@ -648,5 +1233,5 @@ bool CCNetworkEntity::GetEntityForPointInJumpZone(Point& p, CCNetworkEntity** ju
     }
 
     // no jump zone
-    return nullptr;
+    return false;
 }
@@ -3,28 +3,49 @@
 
 #include "BasicTypes.h"
 #include "../Socket/SocketError.h"
-
+#include "CCConfigPath.h"
+#include "CCLatencyTrace.h"
+#include "CCFailureDetector.h"
+#include "CCBackoff.h"
+#include "CCIdleMonitor.h"
+#include "CCExecutor.h"
+#include "CCKeyRepeater.h"
+
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <chrono>
 
 /*
 *
 *   A CCNetworkEntity represent a computer connected to this Session. It contains the monitor information
 *   about this computer as well as a way to communicate with this computer.
 *
+*   Every entity has two tcp connections. The control connection carries heartbeats and RPCs, each one
+*   a NETCPPacketHeader that is awked. The event connection only carries OSInputEventPackets, each
+*   answered by a NETCPPacketEventAwk, so a heartbeat waiting on its awk never holds up the mouse.
+*   Each connection has its own lock, events are only ever sent from the thread delivering input.
+*
+*   Sends never reconnect. A failed send or probe leaves the entity to its heartbeat task, which
+*   reconnects with backoff and only gives up on the entity after the failure detector's reconnect
+*   window, so a short network drop keeps the entity in the layout and the cursor where it was.
+*
 *   Note: If the socket becomes invalid all "Send" functions will fail
 *
 */
 
 struct OSEvent;
+struct NETCPPacketEventAwk;
 
 class Socket;
 class CCDisplay;
 class CCConfigurationManager;
 class INetworkEntityDelegate;
+class CCCounter;
+class CCMetricHistogram;
 
 enum class TCPPacketType : int
 {
@@ -36,10 +57,26 @@ enum class TCPPacketType : int
     // Monitoring Types
     Heartbeat               = 3,
 
-    // Events
+    // no longer sent, events have their own connection
     OSEventHeader           = 4
 };
 
+// an entity's series in CCMetricRegistry::registry, only set on remote entities that have a socket
+struct CCEntityMetrics
+{
+    CCCounter*          eventsForwarded;
+    CCCounter*          bytesSent;
+    CCCounter*          sendErrors;
+    CCCounter*          reconnectAttempts;
+    CCCounter*          reconnects;
+    CCCounter*          probesSkipped;
+    CCCounter*          warmUps;
+    CCCounter*          repeatsDropped;
+    CCCounter*          lateAwks;
+    CCMetricHistogram*  sendDuration;
+    CCMetricHistogram*  heartbeatRtt;
+};
+
 enum class JumpDirection : int
 {
     UP,
@@ -48,20 +85,51 @@ enum class JumpDirection : int
     RIGHT
 };
 
-class CCNetworkEntity
+class CCNetworkEntity : public std::enable_shared_from_this<CCNetworkEntity>
 {
 private:
     std::unique_ptr<Socket> _udpCommSocket;
-    std::unique_ptr<Socket> _tcpCommSocket; // is a server on local entities and a client for remote
+    std::unique_ptr<Socket> _tcpCommSocket; // control, is a server on local entities and a client for remote
+    std::unique_ptr<Socket> _tcpEventSocket; // events, the same
     std::vector<std::shared_ptr<CCDisplay>> _displays;
     std::string _entityID;
+    uint32_t    _logID; // interned entity ID for structured logs
+    CCConfigPath _configPath; // {"Entities", _entityID}
     bool _isLocalEntity;
 
-    std::mutex      _tcpMutex;
+    std::mutex      _tcpMutex; // control connection
+    std::mutex      _eventMutex; // event connection
+
+    CCLatencyTrace  _latencyTrace; // only filled server side
+    CCEntityMetrics _metrics;
+    CCFailureDetector   _failureDetector; // only used server side
+    uint32_t        _eventTimeoutMs; // the event socket's receive timeout, only set again when it changes
+    uint32_t        _lateAwks; // event awks that timed out and are still coming, read before the next one
+    std::vector<int> _heldKeys; // keys whose down was sent and up wasn't, guarded by _eventMutex
+    std::atomic<bool> _isHoldingKeys; // _heldKeys isn't empty, read by the heartbeat without the lock
+    int64_t         _reconnectingSince; // CCLatencyNow() of the failure, 0 while connected. Heartbeat task only
+    bool            _isUnreachable; // the delegate was told with EntityUnreachable. Heartbeat task only
+    CCBackoff       _reconnectBackoff;
+
+    // what the server last asked of this entity's cursor, sent again after a reconnect if it didn't make it
+    std::atomic<bool>   _isCursorShown;
+    std::atomic<bool>   _cursorStateLost;
+
+    std::atomic<int64_t> _lastWarmUpAt; // CCLatencyNow() of the last WarmUp that was submitted
+
+    // heartbeats of an idle session wait for the monitor's tick, WakeUp starts a new chain of heartbeats
+    // and the old one ends when its task sees that the generation moved on
+    std::shared_ptr<CCIdleMonitor> _idleMonitor;
+    std::mutex              _heartbeatMutex; // the old chain's task may still be running
+    std::atomic<uint32_t>   _heartbeatGeneration;
+    std::atomic<bool>       _isHeartbeatIdle; // the next heartbeat waits for the idle tick
 
     // only used client side
     std::thread _tcpCommThread;
+    std::thread _tcpEventThread;
     bool _shouldBeRunningCommThread;
+    std::atomic<uint32_t> _serverConnections; // accepted control connections, tells LostServer if the server came back
+    std::unique_ptr<CCKeyRepeater> _keyRepeater; // repeats the keys the server holds down
 
     // only used server side
     
@@ -79,18 +147,59 @@ private:
 
 private:
     // Some Helper Functions
-    bool ShouldRetryRPC(SocketError error)const;
+    // fails with SOCKET_E_NOT_CONNECTED while the control connection is down, a failed RPC closes it
+    // and marks the entity as suspect so the next heartbeat reconnects
     SocketError SendRPCOfType(TCPPacketType rpcType, void* data = 0, size_t dataSize = 0);
     SocketError ReceiveOSEvent(Socket* socket, OSEvent& newEvent);
     SocketError SendAwk(Socket* socket);
+    SocketError SendEventAwk(Socket* socket, int64_t receivedAt, int64_t previousInjectedAt);
+    SocketError SendClock(Socket* socket);
     SocketError WaitForAwk(Socket* socket);
+    // connects the tcp comm socket with a receive timeout so a silent peer can't block forever
+    SocketError ConnectTCP();
+    // the same for the event socket, which also has Nagle's algorithm turned off
+    SocketError ConnectEvents();
+    // connects wait at most this long so a host that is gone can't hold up a worker or the input thread
+    uint32_t GetConnectTimeoutMs();
+    // waits at most {timeoutMs} for the next event awk, SOCKET_E_TIMEOUT if it's late
+    SocketError ReceiveEventAwk(NETCPPacketEventAwk& awk, uint32_t timeoutMs);
+    // connects the control connection if needed, sends a heartbeat and waits for the awk and the
+    // client's clock. A failure closes the connection and marks the entity as suspect
+    SocketError Probe();
+    // probes the entity unless events have been awked recently (see CCFailureDetector.h) and reconnects
+    // it after a failure. Returns the delay until the next heartbeat, negative once the entity is lost
+    std::chrono::milliseconds Heartbeat();
+    // the heartbeat reached the entity again after a failure
+    void Reconnected();
+    // marks the entity as suspect, the first time a new heartbeat chain tells the delegate it's unreachable
+    // and probes right away instead of at the next tick
+    void Suspect();
+    // the executor task of WarmUp
+    void WarmUpConnections();
+    // keepalive and a user timeout for the connections a client accepts, so it notices a server that vanished
+    static void SetupServerConnection(Socket* server);
+    // runs a heartbeat of the chain started as {generation}, false once the chain ends. {next} is when
+    // the next one is due
+    bool RunHeartbeat(uint32_t generation, CCExecutorClock::time_point& next);
+    static void ScheduleHeartbeat(std::weak_ptr<CCNetworkEntity> entity, uint32_t generation, CCExecutorClock::time_point at);
 
 public:
     CCNetworkEntity(std::string entityID);
+    // a local entity whose comm server only listens on {listenAddress}
+    CCNetworkEntity(std::string entityID, const std::string& listenAddress);
+    // {socket} can be NULL for an entity that is only used for its layout (i.e. cc_bench, replays),
+    // everything sent to it is dropped
     CCNetworkEntity(std::string entityID, Socket* socket);
     ~CCNetworkEntity();
     // converts event into the appropriate packet and sends it over with a header
-    SocketError SendOSEvent(const OSEvent& event);
+    // {capturedAt} is CCLatencyNow() when the event was captured, it starts the event's latency trace
+    // the repeats of a held key are dropped, the client repeats it until the up (see CCKeyRepeater.h)
+    SocketError SendOSEvent(const OSEvent& event, int64_t capturedAt);
+    // sends an up for every key held down on this entity, the cursor is leaving it
+    void ReleaseHeldKeys(int64_t capturedAt);
+    // the cursor is about to jump here, connects the event connection and probes the entity on the
+    // executor unless that was done recently, so the first events after the jump don't wait for it
+    void WarmUp();
 
     // This will add the display to the internal displays vector
     void AddDisplay(std::shared_ptr<CCDisplay> display);
@@ -109,6 +218,10 @@ public:
     void AddEntityIfInProximity(CCNetworkEntity* entity);
     // clears out all connected entities
     void ClearAllEntities();
+    // removes {entity} from the connected entities
+    void RemoveEntity(CCNetworkEntity* entity);
+    // clears out all connected entities and removes this entity from theirs
+    void DisconnectFromAll();
 
     void LoadFrom(const CCConfigurationManager& manager);
     void SaveTo(CCConfigurationManager& manager)const;
@@ -123,10 +236,19 @@ public:
 
     // Client Functions
     void TCPCommThread();
+    // tells the delegate the server is lost unless it connects again within its reconnect window,
+    // {connection} is the _serverConnections count of the connection that dropped
+    void WaitForServerToReconnect(uint32_t connection);
+    // injects the events the server sends on the event connection
+    void TCPEventThread();
 
     // Server Functions
-    // this is a bad way to do this because it's a thread per NetworkEntity but for now, it will work
-    void HeartbeatThread();
+    // heartbeats run as tasks on the shared executor every probe interval until the entity is lost
+    // or destroyed, the entity must be owned by a shared_ptr
+    void StartHeartbeat();
+    // the session is no longer idle, a heartbeat waiting for the idle tick is sent now instead and
+    // the ones after it are at the full rate again
+    void WakeUp();
 
     // return a list of all displays accosiated with this entity
     // This is currently just used for hardcoding coords for testing
@@ -142,14 +264,19 @@ public:
     // gettters
 
     inline const std::string& GetID()const { return _entityID; }
+    inline uint32_t GetLogID()const { return _logID; }
     inline bool GetIsLocal()const {return _isLocalEntity;};
     inline const Point& GetOffsets()const { return _offsets; }
     inline const Rect& GetBounds()const { return _totalBounds; }
     inline const Socket* GetUDPSocket()const { return _udpCommSocket.get(); }
+    inline CCLatencyTrace& GetLatencyTrace() { return _latencyTrace; }
+    inline CCFailureDetector& GetFailureDetector() { return _failureDetector; }
 
     // setters
 
     inline void SetDelegate(INetworkEntityDelegate* newDelegate) { _delegate = newDelegate; }
+    // only read by heartbeats, set before StartHeartbeat
+    inline void SetIdleMonitor(std::shared_ptr<CCIdleMonitor> monitor) { _idleMonitor = monitor; }
 
     // operators
 
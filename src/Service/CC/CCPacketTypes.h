@@ -1,6 +1,10 @@
 #ifndef CC_PACKET_TYPES_H
 #define CC_PACKET_TYPES_H
 
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
 #define P_MAGIC_NUMBER 48884003
 
 #define INVALID_PACKET_ADDRESS "DONT USE"
@@ -35,7 +39,7 @@ struct EntityIDPacket
 	size_t IDLength;
 	char EntityID[256];
 	EntityIDPacket() : MagicNumber(P_MAGIC_NUMBER), IDLength(0) {}
-	EntityIDPacket(std::string id) : MagicNumber(P_MAGIC_NUMBER), IDLength(id.size()) { memset(EntityID,0,256); strcpy_s(EntityID, id.c_str()); }
+	EntityIDPacket(std::string id) : MagicNumber(P_MAGIC_NUMBER), IDLength(id.size()) { memset(EntityID,0,256); strncpy(EntityID, id.c_str(), 255); }
 };
 
 /*
@@ -68,6 +72,31 @@ struct DisplayListDisplayPacket
 	{}
 };
 
+/*
+ * SessionResumePacket follows the AddressPacket. {Token} is the one the server gave this client last time,
+ * 0 if it never had one, and {DisplayHash} is CCDisplay::HashNativeDisplays of the displays it has now.
+ * The server answers with a SessionReplyPacket, if {Resumed} is set it still knows the displays and
+ * the client doesn't send them
+ */
+
+struct SessionResumePacket
+{
+	unsigned int MagicNumber;
+	uint64_t Token;
+	uint64_t DisplayHash;
+	SessionResumePacket() : MagicNumber(P_MAGIC_NUMBER), Token(0), DisplayHash(0) {}
+	SessionResumePacket(uint64_t Token, uint64_t DisplayHash) : MagicNumber(P_MAGIC_NUMBER), Token(Token), DisplayHash(DisplayHash) {}
+};
+
+struct SessionReplyPacket
+{
+	unsigned int MagicNumber;
+	uint64_t Token; // the token to resume with next time
+	int Resumed;
+	SessionReplyPacket() : MagicNumber(P_MAGIC_NUMBER), Token(0), Resumed(0) {}
+	SessionReplyPacket(uint64_t Token, bool Resumed) : MagicNumber(P_MAGIC_NUMBER), Token(Token), Resumed(Resumed ? 1 : 0) {}
+};
+
 // RPC Packets
 
 struct NETCPPacketHeader
@@ -94,4 +123,35 @@ struct NETCPPacketAwk
 	NETCPPacketAwk() : MagicNumber(P_MAGIC_NUMBER) {}
 };
 
+// Latency Packets
+
+/*
+ * NETCPPacketClock follows the awk of a heartbeat, it is the client's steady clock in microseconds
+ * so the server can estimate how far apart their clocks are
+ */
+
+struct NETCPPacketClock
+{
+	unsigned int MagicNumber;
+	int64_t Time;
+	NETCPPacketClock() : MagicNumber(P_MAGIC_NUMBER), Time(0) {}
+	NETCPPacketClock(int64_t Time) : MagicNumber(P_MAGIC_NUMBER), Time(Time) {}
+};
+
+/*
+ * NETCPPacketEventAwk answers an OSInputEventPacket instead of a NETCPPacketAwk. It carries when the
+ * client received the event and when it injected the one before it (0 if it didn't), both client clock
+ */
+
+struct NETCPPacketEventAwk
+{
+	unsigned int MagicNumber;
+	int64_t ReceivedAt;
+	int64_t PreviousInjectedAt;
+	NETCPPacketEventAwk() : MagicNumber(P_MAGIC_NUMBER), ReceivedAt(0), PreviousInjectedAt(0) {}
+	NETCPPacketEventAwk(int64_t ReceivedAt, int64_t PreviousInjectedAt) : MagicNumber(P_MAGIC_NUMBER), \
+		ReceivedAt(ReceivedAt), PreviousInjectedAt(PreviousInjectedAt)
+	{}
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef CC_PENDING_SWAP_H
+#define CC_PENDING_SWAP_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+/*
+*	CCPendingSwap hands a value built on one thread (i.e. compiled by LoadFrom) to the thread that
+*	uses it. Offer can be called from any thread, only the consumer calls Take, which swaps the
+*	value in between two uses so the consumer never takes a lock. While nothing is pending Take is
+*	a relaxed load.
+*
+*	A value that was offered and never taken is deleted by the next Offer or the destructor.
+*/
+template <typename T>
+class CCPendingSwap
+{
+private:
+	std::atomic<T*>	_pending;
+
+public:
+	CCPendingSwap() : _pending(NULL) {}
+	~CCPendingSwap() { delete _pending.exchange(NULL); }
+
+	CCPendingSwap(const CCPendingSwap&) = delete;
+	CCPendingSwap& operator=(const CCPendingSwap&) = delete;
+
+	// takes ownership of {value}, an older value that was never taken isn't needed anymore
+	inline void Offer(T* value) { delete _pending.exchange(value); }
+
+	// moves the last offered value into {current}, returns false if nothing was offered since the last Take
+	inline bool Take(std::unique_ptr<T>& current)
+	{
+		if (_pending.load(std::memory_order_relaxed) == NULL)
+			return false;
+
+		T* pending = _pending.exchange(NULL);
+		if (pending == NULL)
+			return false;
+
+		current.reset(pending);
+		return true;
+	}
+};
+
+#endif
@@ -12,8 +12,18 @@
 #include "CCDisplay.h"
 
 #include "CCLogger.h"
+#include "CCExecutor.h"
+#include "CCMetrics.h"
 
-CCServer::CCServer(int port, std::string listenAddress, INetworkEntityDiscovery* discoverer) : _discoverer(discoverer), _isRunning(false)
+#include <algorithm>
+#include <string.h>
+
+// a connecting entity sends its whole handshake at once
+#define CC_HANDSHAKE_TIMEOUT_MS 5000
+#define CC_MAX_PENDING_HANDSHAKES 4
+
+CCServer::CCServer(int port, std::string listenAddress, INetworkEntityDiscovery* discoverer) : _discoverer(discoverer), \
+_isRunning(false), _handshakesInFlight(0), _pendingHandshakes(NULL), _tokenGenerator(std::random_device()())
 {
 	_internalSocket = std::make_unique<Socket>(listenAddress, port, false, SocketProtocol::SOCKET_P_TCP);
 }
@@ -47,9 +57,13 @@ void CCServer::StopServer()
 	_isRunning = false;
 	_internalSocket->Disconnect();
 
-	_accpetThread.join();
+	// not started if StartServer threw
+	if (_accpetThread.joinable())
+		_accpetThread.join();
 
-	
+	// handshakes hold {this}, let them finish or time out
+	std::unique_lock<std::mutex> lock(_handshakeMutex);
+	_handshakeCondition.wait(lock, [this]() { return _handshakesInFlight == 0; });
 }
 
 bool CCServer::GetServerIsRunning()
@@ -59,6 +73,19 @@ bool CCServer::GetServerIsRunning()
 
 void CCServer::ServerAcceptThread()
 {
+	CCMetricRegistry& registry = CCMetricRegistry::registry;
+	// handshakes can outlive this thread, they get pointers to the counters
+	CCCounter* accepted = &registry.Counter("cc_server_handshakes_total", "Entity connections by how their handshake ended", { {"result", "accepted"} });
+	CCCounter* failed = &registry.Counter("cc_server_handshakes_total", "Entity connections by how their handshake ended", { {"result", "failed"} });
+	CCCounter* rejected = &registry.Counter("cc_server_handshakes_total", "Entity connections by how their handshake ended", { {"result", "rejected"} });
+	// created here so it is exposed before the first resume
+	registry.Counter("cc_server_sessions_resumed_total", "Handshakes that skipped the display list");
+	_pendingHandshakes = &registry.Gauge("cc_server_pending_handshakes", "Handshakes waiting for or running on the executor");
+
+	// a handshake blocks its worker until the receive timeout, one worker is always left for
+	// heartbeats, GUI writes and everything else on the shared executor (it has at least two)
+	int maxHandshakes = std::min<int>(CC_MAX_PENDING_HANDSHAKES, (int)CCExecutor::SharedExecutor().GetWorkerCount() - 1);
+
 	while (_isRunning)
 	{
 		Socket* newSocket = 0;
@@ -70,119 +97,252 @@ void CCServer::ServerAcceptThread()
 			continue;
 		}
 
-		// me being lazy about memory management
-		std::unique_ptr<Socket> acceptedSocket(newSocket);
-
-		// AddressPacket is currently just used here to get the desired port
-		// but we may use it for the actuall conection address later
-
-		AddressPacket addPacket;
-		EntityIDPacket idPacket;
-		DisplayListHeaderPacket listHeaderPacket;
-
-		size_t received = 0;
-		error = acceptedSocket->Recv((char*)&idPacket, sizeof(EntityIDPacket), &received);
-		if (error != SocketError::SOCKET_E_SUCCESS)
+		// handshakes run on the executor, a client that connects and never sends anything
+		// only holds a worker until the receive timeout
+		if (_handshakesInFlight >= maxHandshakes)
 		{
-			LOG_ERROR << "Error Receiving EntityIDPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+			LOG_ERROR << "Too many pending handshakes, dropping client " << newSocket->GetAddress() << std::endl;
+			rejected->Add();
+			delete newSocket;
 			continue;
 		}
 
-		if (received != sizeof(EntityIDPacket) || idPacket.MagicNumber != P_MAGIC_NUMBER)
-		{
-			LOG_ERROR << "Invalid EntityIDPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-			continue;
-		}
-		
-		error = acceptedSocket->Recv((char*)&addPacket, sizeof(AddressPacket), &received);
+		newSocket->SetReceiveTimeout(CC_HANDSHAKE_TIMEOUT_MS);
+		_handshakesInFlight++;
+		_pendingHandshakes->Add(1);
 
-		if (error != SocketError::SOCKET_E_SUCCESS)
-		{
-			LOG_ERROR << "Error Receiving AddressPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-			continue;
-		}
+		bool submitted = CCExecutor::SharedExecutor().Submit([this, newSocket, accepted, failed]() {
+			if (Handshake(newSocket))
+				accepted->Add();
+			else failed->Add();
+			FinishedHandshake();
+		});
 
-		if (received != sizeof(AddressPacket) || addPacket.MagicNumber != P_MAGIC_NUMBER)
+		if (submitted == false)
 		{
-			LOG_ERROR << "Invalid AddressPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-			continue;
+			rejected->Add();
+			delete newSocket;
+			FinishedHandshake();
 		}
+	}
+}
+
+void CCServer::FinishedHandshake()
+{
+	{
+		std::lock_guard<std::mutex> lock(_handshakeMutex);
+		_handshakesInFlight--;
+		_pendingHandshakes->Add(-1);
+	}
+	_handshakeCondition.notify_all();
+}
+
+bool CCServer::Handshake(Socket* newSocket)
+{
+	SocketError error = SocketError::SOCKET_E_SUCCESS;
+
+	// me being lazy about memory management
+	std::unique_ptr<Socket> acceptedSocket(newSocket);
+
+	// AddressPacket is currently just used here to get the desired port
+	// but we may use it for the actuall conection address later
+
+	AddressPacket addPacket;
+	EntityIDPacket idPacket;
+	DisplayListHeaderPacket listHeaderPacket;
+
+	size_t received = 0;
+	error = acceptedSocket->Recv((char*)&idPacket, sizeof(EntityIDPacket), &received);
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Receiving EntityIDPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	if (received != sizeof(EntityIDPacket) || idPacket.MagicNumber != P_MAGIC_NUMBER)
+	{
+		LOG_ERROR << "Invalid EntityIDPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
+	
+	error = acceptedSocket->Recv((char*)&addPacket, sizeof(AddressPacket), &received);
+
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Receiving AddressPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	if (received != sizeof(AddressPacket) || addPacket.MagicNumber != P_MAGIC_NUMBER)
+	{
+		LOG_ERROR << "Invalid AddressPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	// entities sharing a machine tell us which loopback address they listen on,
+	// the address is only trusted from the loopback
+	std::string address = acceptedSocket->GetAddress();
+	addPacket.Address[sizeof(addPacket.Address) - 1] = 0;
+	if (address.compare(0, 4, "127.") == 0 && strncmp(addPacket.Address, "127.", 4) == 0)
+		address = addPacket.Address;
+
+	SessionResumePacket resumePacket;
+	received = 0;
+	error = acceptedSocket->Recv((char*)&resumePacket, sizeof(SessionResumePacket), &received);
+
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Receiving SessionResumePacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	if (received != sizeof(SessionResumePacket) || resumePacket.MagicNumber != P_MAGIC_NUMBER)
+	{
+		LOG_ERROR << "Invalid SessionResumePacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
 
-		// socket is owned by entity as a uniqe_ptr so no delete needed
-		Socket* udpRemoteClientSocket = new Socket(acceptedSocket->GetAddress(), addPacket.Port, acceptedSocket->GetCanUseIPV6(), SocketProtocol::SOCKET_P_UDP);
-		std::shared_ptr<CCNetworkEntity> entity(new CCNetworkEntity(idPacket.EntityID, udpRemoteClientSocket));
+	idPacket.EntityID[sizeof(idPacket.EntityID) - 1] = 0;
+	std::string entityID = idPacket.EntityID;
 
+	std::vector<NativeDisplay> displays;
+	SessionReplyPacket replyPacket;
+	bool resumed = ResumeSession(entityID, resumePacket, displays, replyPacket);
+
+	error = acceptedSocket->Send((char*)&replyPacket, sizeof(SessionReplyPacket));
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Sending SessionReplyPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+		return false;
+	}
+
+	// socket is owned by entity as a uniqe_ptr so no delete needed
+	Socket* udpRemoteClientSocket = new Socket(address, addPacket.Port, acceptedSocket->GetCanUseIPV6(), SocketProtocol::SOCKET_P_UDP);
+	std::shared_ptr<CCNetworkEntity> entity(new CCNetworkEntity(entityID, udpRemoteClientSocket));
+
+	bool failed = false;
+
+	if (resumed)
+	{
+		static CCCounter& resumedSessions = CCMetricRegistry::registry.Counter("cc_server_sessions_resumed_total", "Handshakes that skipped the display list");
+		resumedSessions.Add();
+
+		LOG_INFO << "Resumed session of " << entityID << ", " << displays.size() << " displays" << std::endl;
+		listHeaderPacket.NumberOfDisplays = 0;
+	}
+	else
+	{
 		received = 0;
 		error = acceptedSocket->Recv((char*)&listHeaderPacket, sizeof(DisplayListHeaderPacket), &received);
 
 		if (error != SocketError::SOCKET_E_SUCCESS)
 		{
 			LOG_ERROR << "Error Receiving DisplayListHeaderPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-			continue;
+			return false;
 		}
 
 		if (received != sizeof(DisplayListHeaderPacket) || listHeaderPacket.MagicNumber != P_MAGIC_NUMBER)
 		{
 			LOG_ERROR << "Invalid DisplayListHeaderPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-			continue;
+			return false;
 		}
+	}
+
+	// we now know that there will be {listHeaderPacket.NumberOfDisplays} number of displays about to be sent over
+	// tcp is garunteed delivery so we don't have to be so picky about handshakes / acks ourselves
 
-		// we now know that there will be {listHeaderPacket.NumberOfDisplays} number of displays about to be sent over
-		// tcp is garunteed delivery so we don't have to be so picky about handshakes / acks ourselves
+	for (int i = 0; i < listHeaderPacket.NumberOfDisplays; i++)
+	{
+		DisplayListDisplayPacket displayPacket;
+		NativeDisplay nativeDisplay;
 
-		bool failed = false;
+		received = 0;
+		error = acceptedSocket->Recv((char*)&displayPacket, sizeof(DisplayListDisplayPacket), &received);
 
-		for (int i = 0; i < listHeaderPacket.NumberOfDisplays; i++)
+		if (error != SocketError::SOCKET_E_SUCCESS)
 		{
-			DisplayListDisplayPacket displayPacket;
-			NativeDisplay nativeDisplay;
-
-			received = 0;
-			error = acceptedSocket->Recv((char*)&displayPacket, sizeof(DisplayListDisplayPacket), &received);
-
-			if (error != SocketError::SOCKET_E_SUCCESS)
-			{
-				LOG_ERROR << "Error Receiving DisplayListPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-				failed = true;
-				break;
-			}
-
-			if (received != sizeof(DisplayListDisplayPacket) || displayPacket.MagicNumber != P_MAGIC_NUMBER)
-			{
-				LOG_ERROR << "Invalid DisplayListDisplayPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-				failed = true;
-				break;
-			}
-
-			nativeDisplay.height = displayPacket.Height;
-			nativeDisplay.width = displayPacket.Width;
-			nativeDisplay.nativeScreenID = displayPacket.NativeDisplayID;
-			nativeDisplay.posX = displayPacket.Left;
-			nativeDisplay.posY = displayPacket.Top;
-
-			std::shared_ptr<CCDisplay> newDisplay(new CCDisplay(nativeDisplay));
-
-			entity->AddDisplay(newDisplay);
+			LOG_ERROR << "Error Receiving DisplayListPacket " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+			failed = true;
+			break;
 		}
 
-		error = udpRemoteClientSocket->Connect();
-		if (error != SocketError::SOCKET_E_SUCCESS)
+		if (received != sizeof(DisplayListDisplayPacket) || displayPacket.MagicNumber != P_MAGIC_NUMBER)
 		{
-			LOG_ERROR << "Error Trying To Connect UDP Socket: " << SOCK_ERR_STR(udpRemoteClientSocket, error) << std::endl;
+			LOG_ERROR << "Invalid DisplayListDisplayPacket Received " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
 			failed = true;
+			break;
 		}
-		// if we failed getting the display list, give up on this client / let them retry with a new connection
 
-		if (failed)
-			continue;
+		nativeDisplay.height = displayPacket.Height;
+		nativeDisplay.width = displayPacket.Width;
+		nativeDisplay.nativeScreenID = displayPacket.NativeDisplayID;
+		nativeDisplay.posX = displayPacket.Left;
+		nativeDisplay.posY = displayPacket.Top;
 
-		_discoverer->NewEntityDiscovered(entity);
+		displays.push_back(nativeDisplay);
+	}
 
-		error = acceptedSocket->Close();
-		if (error != SocketError::SOCKET_E_SUCCESS)
-		{
-			// very strange if we hit here.
-			LOG_ERROR << "Error Closing Accepted Socket: " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
-		}
+	for (auto& display : displays)
+	{
+		entity->AddDisplay(std::make_shared<CCDisplay>(display));
 	}
-}
\ No newline at end of file
+
+	error = udpRemoteClientSocket->Connect();
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		LOG_ERROR << "Error Trying To Connect UDP Socket: " << SOCK_ERR_STR(udpRemoteClientSocket, error) << std::endl;
+		failed = true;
+	}
+	// if we failed getting the display list, give up on this client / let them retry with a new connection
+
+	if (failed)
+		return false;
+
+	// a handshake that finishes while stopping must not add anything
+	if (_isRunning == false)
+		return false;
+
+	if (resumed == false)
+	{
+		std::lock_guard<std::mutex> lock(_sessionMutex);
+
+		CCServerSession& session = _sessions[entityID];
+		session.token = replyPacket.Token;
+		session.displayHash = CCDisplay::HashNativeDisplays(displays);
+		session.displays = displays;
+	}
+
+	_discoverer->NewEntityDiscovered(entity);
+	entity->StartHeartbeat();
+
+	error = acceptedSocket->Close();
+	if (error != SocketError::SOCKET_E_SUCCESS)
+	{
+		// very strange if we hit here.
+		LOG_ERROR << "Error Closing Accepted Socket: " << SOCK_ERR_STR(acceptedSocket.get(), error) << std::endl;
+	}
+
+	return true;
+}
+
+bool CCServer::ResumeSession(const std::string& entityID, const SessionResumePacket& resume, std::vector<NativeDisplay>& displays, \
+	SessionReplyPacket& reply)
+{
+	std::lock_guard<std::mutex> lock(_sessionMutex);
+
+	auto itr = _sessions.find(entityID);
+	if (resume.Token != 0 && itr != _sessions.end() && itr->second.token == resume.Token && itr->second.displayHash == resume.DisplayHash)
+	{
+		displays = itr->second.displays;
+		reply = SessionReplyPacket(resume.Token, true);
+		return true;
+	}
+
+	// 0 means no session
+	uint64_t token = 0;
+	while (token == 0)
+		token = _tokenGenerator();
+
+	reply = SessionReplyPacket(token, false);
+	return false;
+}
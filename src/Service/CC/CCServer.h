@@ -1,13 +1,32 @@
 #ifndef CC_SERVER_H
 #define CC_SERVER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "../OSInterface/OSTypes.h"
+
 class Socket;
 class INetworkEntityDiscovery;
+class CCGauge;
+struct SessionResumePacket;
+struct SessionReplyPacket;
+
+// what the server remembers about an entity so it can skip the display list when it comes back
+struct CCServerSession
+{
+    uint64_t                    token;
+    uint64_t                    displayHash;
+    std::vector<NativeDisplay>  displays;
+};
+
 class CCServer
 {
 private:
@@ -18,6 +37,24 @@ private:
 
     bool                                            _isRunning;
 
+    std::atomic<int>                                _handshakesInFlight;
+    std::mutex                                      _handshakeMutex;
+    std::condition_variable                         _handshakeCondition;
+    CCGauge*                                        _pendingHandshakes; // set by the accept thread before any handshake starts
+
+    std::map<std::string, CCServerSession>          _sessions; // by entity ID, kept for the life of the server
+    std::mutex                                      _sessionMutex;
+    std::mt19937_64                                 _tokenGenerator;
+
+    // receives an entity's id, address and displays on an executor worker,
+    // returns true if the entity joined the session
+    bool Handshake(Socket* newSocket);
+    void FinishedHandshake();
+    // the displays of {entityID}'s session if {resume} matches it, otherwise false and a new token
+    // to give the entity in {reply}
+    bool ResumeSession(const std::string& entityID, const SessionResumePacket& resume, std::vector<NativeDisplay>& displays, \
+        SessionReplyPacket& reply);
+
 public:
     CCServer(int port, std::string listenAddress = "127.0.0.1", INetworkEntityDiscovery* discoverer = 0);
     void SetDiscoverer(INetworkEntityDiscovery* discoverer);
@@ -0,0 +1,240 @@
+#include "CCStructuredLog.h"
+
+#include "../Socket/Socket.h"
+#include "../OSInterface/OSInterfaceError.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const CCLogSiteInfo siteInfos[] =
+{
+	{ "None", LogLevel::None, "" },
+#define CC_LOG_SITE_INFO(name, level, format) { #name, level, format },
+	CC_LOG_SITES(CC_LOG_SITE_INFO)
+#undef CC_LOG_SITE_INFO
+};
+
+const CCLogSiteInfo* CCLogSiteInfoFor(uint16_t site)
+{
+	if (site == 0 || site >= (uint16_t)CCLogSite::Count)
+		return NULL;
+
+	return &siteInfos[site];
+}
+
+CCLogSocketError CCLogSockErr(const Socket* socket, SocketError error)
+{
+	CCLogSocketError ret;
+	ret.error = error;
+	ret.osError = socket ? socket->lastOSErr : 0;
+	return ret;
+}
+
+static const char* MouseButtonName(int64_t button)
+{
+	static const char* names[] = { "MOUSE_BUTTON_LEFT", "MOUSE_BUTTON_RIGHT", "MOUSE_BUTTON_MIDDLE", "MOUSE_BUTTON_EXTENDED" };
+	if (button >= 0 && button < 4)
+		return names[button];
+	return "MOUSE_BUTTON_INVALID";
+}
+
+// matches operator<<(std::ostream&, const OSEvent&) so text and structured logs read the same
+static void RenderOSEvent(const int64_t* event, std::string& out)
+{
+	int64_t type = event[0], subType = event[1], code = event[2], extended = event[3];
+	int64_t x = event[4], y = event[5], deltaX = event[6], deltaY = event[7];
+
+	if (type == OS_EVENT_MOUSE && subType == MOUSE_EVENT_MOVE)
+	{
+		out += "{ type: Mouse Move Event pos {" + std::to_string(x) + "," + std::to_string(y) + "} delta {" + \
+			std::to_string(deltaX) + "," + std::to_string(deltaY) + "}";
+	}
+	else if (type == OS_EVENT_MOUSE && (subType == MOUSE_EVENT_DOWN || subType == MOUSE_EVENT_UP))
+	{
+		out += "{ type: Mouse Button Event {isDown: ";
+		out += subType == MOUSE_EVENT_DOWN ? " True " : "False ";
+		out += " button: ";
+		out += MouseButtonName(code);
+		out += "}";
+	}
+	else if (type == OS_EVENT_MOUSE && subType == MOUSE_EVENT_SCROLL)
+	{
+		out += "{ type: Mouse Wheel Event { wheelData: " + std::to_string(extended) + "}";
+	}
+	else if (type == OS_EVENT_KEY)
+	{
+		out += "{type:Key Event subType:";
+		out += subType == KEY_EVENT_DOWN ? "KEY_EVENT_DOWN" : (subType == KEY_EVENT_UP ? "KEY_EVENT_UP" : "KEY_EVENT_INVALID");
+		out += " scaneCode:" + std::to_string(code);
+	}
+	else
+	{
+		out += "Invalid Event";
+	}
+}
+
+void CCLogRenderSite(const char* format, const int64_t* args, size_t argCount,
+	const std::function<std::string(uint32_t)>& lookupString, std::string& out)
+{
+	size_t arg = 0;
+
+	for (const char* c = format; *c; c++)
+	{
+		if (*c != '%' || c[1] == 0)
+		{
+			out += *c;
+			continue;
+		}
+
+		c++;
+
+		switch (*c)
+		{
+		case 'd':
+			out += arg < argCount ? std::to_string(args[arg]) : "?";
+			arg += 1;
+			break;
+		case 's':
+			out += arg < argCount ? lookupString((uint32_t)args[arg]) : "?";
+			arg += 1;
+			break;
+		case 'e':
+			if (arg + 1 < argCount)
+			{
+				SocketError error = (SocketError)args[arg];
+				out += SockErrorToString(error);
+				if (error == SocketError::SOCKET_E_OS_ERROR)
+					out += " With Internal Error:  " + OSErrorToString((int)args[arg + 1]);
+			}
+			arg += 2;
+			break;
+		case 'i':
+			out += arg < argCount ? OSInterfaceErrorToString((OSInterfaceError)args[arg]) : "?";
+			arg += 1;
+			break;
+		case 'v':
+			if (arg + 7 < argCount)
+				RenderOSEvent(args + arg, out);
+			arg += 8;
+			break;
+		case '%':
+			out += '%';
+			break;
+		default:
+			out += '%';
+			out += *c;
+			break;
+		}
+	}
+}
+
+// CCBinaryLogWriter
+
+static void PutLE(std::string& buffer, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+	{
+		buffer += (char)((value >> (i * 8)) & 0xFF);
+	}
+}
+
+CCBinaryLogWriter::CCBinaryLogWriter() : _file(NULL), _lastTimestamp(0)
+{
+}
+
+CCBinaryLogWriter::~CCBinaryLogWriter()
+{
+	if (_file)
+	{
+		Flush();
+		fclose(_file);
+	}
+}
+
+void CCBinaryLogWriter::PutVarint(uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		_buffer += (char)((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	_buffer += (char)value;
+}
+
+void CCBinaryLogWriter::PutSigned(int64_t value)
+{
+	PutVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+bool CCBinaryLogWriter::Open(const std::string& path, uint64_t steadyStart)
+{
+	_file = fopen(path.c_str(), "wb");
+	if (_file == NULL)
+		return false;
+
+	int64_t wallStart = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	uint64_t steadyNow = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	// wall clock of the steady start so the decoder can print absolute times
+	wallStart -= (int64_t)((steadyNow - steadyStart) / 1000);
+
+	_buffer.append(CC_BLOG_MAGIC, 4);
+	PutLE(_buffer, CC_BLOG_VERSION, 2);
+	PutLE(_buffer, (uint16_t)CCLogSite::Count - 1, 2);
+	PutLE(_buffer, steadyStart, 8);
+	PutLE(_buffer, (uint64_t)wallStart, 8);
+
+	for (uint16_t site = 1; site < (uint16_t)CCLogSite::Count; site++)
+	{
+		const CCLogSiteInfo* info = CCLogSiteInfoFor(site);
+		size_t length = strlen(info->format);
+
+		PutLE(_buffer, site, 2);
+		PutLE(_buffer, (uint32_t)info->level, 4);
+		PutLE(_buffer, length, 2);
+		_buffer.append(info->format, length);
+	}
+
+	_lastTimestamp = steadyStart;
+
+	Flush();
+
+	return true;
+}
+
+void CCBinaryLogWriter::WriteString(uint32_t id, const std::string& value)
+{
+	size_t length = std::min<size_t>(value.size(), 0xFFFF);
+
+	_buffer += (char)CC_BLOG_STRING;
+	PutLE(_buffer, id, 4);
+	PutLE(_buffer, length, 2);
+	_buffer.append(value.c_str(), length);
+}
+
+void CCBinaryLogWriter::WriteRecord(const CCLogRecord& record)
+{
+	_buffer += (char)CC_BLOG_RECORD;
+	PutLE(_buffer, record.site, 2);
+	PutLE(_buffer, record.length, 1);
+	PutSigned((int64_t)(record.timestamp - _lastTimestamp));
+
+	for (uint16_t i = 0; i < record.length; i++)
+	{
+		PutSigned(record.args[i]);
+	}
+
+	_lastTimestamp = record.timestamp;
+}
+
+void CCBinaryLogWriter::Flush()
+{
+	if (_file == NULL || _buffer.empty())
+		return;
+
+	fwrite(_buffer.data(), 1, _buffer.size(), _file);
+	fflush(_file);
+
+	_buffer.clear();
+}
@@ -0,0 +1,162 @@
+#ifndef CC_STRUCTURED_LOG_H
+#define CC_STRUCTURED_LOG_H
+
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#include "CCLogger.h"
+#include "../Socket/SocketError.h"
+#include "../OSInterface/OSTypes.h"
+
+/*
+*	Structured logging is used on the hot paths. Instead of formatting text, a log site records
+*	its static site ID and the raw argument values. The text is only built later, either by the
+*	logger thread when writing to the console or offline by CCLogDecode when a binary log is used.
+*
+*	Format placeholders
+*	%d	integer argument
+*	%s	string interned with CCLogger::InternString
+*	%e	socket error, takes the SocketError and the OS error (see CCLogSocketError)
+*	%i	OSInterfaceError
+*	%v	OSEvent, takes the 8 values packed by CCLogPack(OSEvent)
+*/
+
+#define CC_LOG_SITES(SITE) \
+	SITE(SkippingEvent,			LogLevel::Info,		"Skipping event %v") \
+	SITE(JumpToEntity,			LogLevel::Info,		"Jump To %s") \
+	SITE(SendingEvent,			LogLevel::Info,		"Sending Event %v") \
+	SITE(SendEventError,		LogLevel::Error,	"Error Sending Event To %s Error: %e") \
+	SITE(ReceivedTCPPacket,		LogLevel::Info,		"Received TCP Packet Type %d") \
+	SITE(ReceivedOSEvent,		LogLevel::Info,		"Received OS Event %v") \
+	SITE(ReceiveOSEventError,	LogLevel::Error,	"Error Trying Receive OS Event Packet From Server !: %e") \
+	SITE(InjectOSEventError,	LogLevel::Error,	"Error Trying To Inject OS Event %v with error %i")
+
+enum class CCLogSite : uint16_t
+{
+	None = 0, // text records
+#define CC_LOG_SITE_ENUM(name, level, format) name,
+	CC_LOG_SITES(CC_LOG_SITE_ENUM)
+#undef CC_LOG_SITE_ENUM
+	Count
+};
+
+struct CCLogSiteInfo
+{
+	const char*	name;
+	LogLevel	level;
+	const char*	format;
+};
+
+// returns the site info or NULL for an unknown site
+extern const CCLogSiteInfo* CCLogSiteInfoFor(uint16_t site);
+
+inline constexpr LogLevel CCLogSiteLevel(CCLogSite site)
+{
+#define CC_LOG_SITE_LEVEL(name, level, format) site == CCLogSite::name ? level :
+	return CC_LOG_SITES(CC_LOG_SITE_LEVEL) LogLevel::None;
+#undef CC_LOG_SITE_LEVEL
+}
+
+// renders {format} with {args}, {lookupString} resolves %s arguments
+extern void CCLogRenderSite(const char* format, const int64_t* args, size_t argCount,
+	const std::function<std::string(uint32_t)>& lookupString, std::string& out);
+
+// socket errors are logged with the OS error so %e can render the same text as SOCK_ERR_STR
+struct CCLogSocketError
+{
+	SocketError error;
+	int			osError;
+};
+
+extern CCLogSocketError CCLogSockErr(const Socket* socket, SocketError error);
+
+// argument packing, every value is stored as a 64 bit integer
+
+template<typename t>
+inline typename std::enable_if<std::is_integral<t>::value || std::is_enum<t>::value>::type CCLogPack(CCLogRecord& record, const t& value)
+{
+	if (record.length < CC_LOG_MAX_ARGS)
+		record.args[record.length++] = (int64_t)value;
+}
+
+inline void CCLogPack(CCLogRecord& record, const CCLogSocketError& error)
+{
+	CCLogPack(record, error.error);
+	CCLogPack(record, error.osError);
+}
+
+inline void CCLogPack(CCLogRecord& record, const OSEvent& event)
+{
+	CCLogPack(record, event.eventType);
+	CCLogPack(record, event.mouseEvent);
+	CCLogPack(record, event.scanCode);
+	CCLogPack(record, event.extendButtonInfo);
+	CCLogPack(record, event.x);
+	CCLogPack(record, event.y);
+	CCLogPack(record, event.deltaX);
+	CCLogPack(record, event.deltaY);
+}
+
+inline void CCLogPackArgs(CCLogRecord& record)
+{
+}
+
+template<typename first, typename... rest>
+inline void CCLogPackArgs(CCLogRecord& record, const first& value, const rest&... others)
+{
+	CCLogPack(record, value);
+	CCLogPackArgs(record, others...);
+}
+
+template<typename... t>
+inline void CCLogStructured(CCLogSite site, const t&... args)
+{
+	CCLogRecord* record = CCLogBeginRecord(CCLogSiteLevel(site), (uint16_t)site);
+	CCLogPackArgs(*record, args...);
+	CCLogCommitRecord(record);
+}
+
+#define LOG_SITE(site, ...) if (!CCLogger::logger.IsEnabled(CCLogSiteLevel(CCLogSite::site))) {} else CCLogStructured(CCLogSite::site, __VA_ARGS__)
+
+/*
+*	Binary log file layout, all values are little endian
+*
+*	header		"CCBL" uint16 version, uint16 site count, uint64 steady start ns, int64 wall start us
+*	sites		uint16 id, int32 level, uint16 format length, format bytes (repeated site count times)
+*	entries		uint8 tag followed by
+*				CC_BLOG_STRING	uint32 id, uint16 length, bytes
+*				CC_BLOG_RECORD	uint16 site, uint8 arg count, zigzag varint timestamp delta, zigzag varint args
+*/
+
+#define CC_BLOG_MAGIC "CCBL"
+#define CC_BLOG_VERSION 1
+
+#define CC_BLOG_STRING 1
+#define CC_BLOG_RECORD 2
+
+class CCBinaryLogWriter
+{
+private:
+	FILE*		_file;
+	std::string	_buffer;
+	uint64_t	_lastTimestamp;
+
+	void PutVarint(uint64_t value);
+	void PutSigned(int64_t value);
+
+public:
+	CCBinaryLogWriter();
+	~CCBinaryLogWriter();
+
+	bool Open(const std::string& path, uint64_t steadyStart);
+	void WriteString(uint32_t id, const std::string& value);
+	void WriteRecord(const CCLogRecord& record);
+	// writes everything buffered since the last flush to the file
+	void Flush();
+
+	inline bool GetIsOpen()const { return _file != NULL; }
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "CCTrace.h"
+#include "CCLogger.h"
+
+#include <chrono>
+
+#define CC_TRACE_RING_MASK (CC_TRACE_RING_SIZE - 1)
+
+static_assert((CC_TRACE_RING_SIZE & CC_TRACE_RING_MASK) == 0, "the trace ring size must be a power of two");
+
+CCTracer CCTracer::tracer;
+
+CCTracer::CCTracer() : _isEnabled(false), _next(0), _startTimestamp(0)
+{
+}
+
+uint32_t CCTracer::ThreadID()
+{
+	static std::atomic<uint32_t> nextThread(1);
+	thread_local uint32_t thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+
+	return thread;
+}
+
+bool CCTracer::Start()
+{
+#ifndef CC_TRACING
+	LOG_ERROR << "Tracing was compiled out, build with CC_TRACING" << std::endl;
+	return false;
+#else
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_isEnabled.store(false, std::memory_order_relaxed);
+
+	if (!_events)
+		_events.reset(new CCTraceEvent[CC_TRACE_RING_SIZE]);
+
+	for (size_t i = 0; i < CC_TRACE_RING_SIZE; i++)
+	{
+		_events[i].sequence.store(0, std::memory_order_relaxed);
+	}
+
+	_next.store(0, std::memory_order_relaxed);
+	_startTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	// publishes the ring to the threads that see the tracer enabled
+	_isEnabled.store(true, std::memory_order_release);
+
+	return true;
+#endif
+}
+
+void CCTracer::Stop()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_isEnabled.store(false, std::memory_order_relaxed);
+}
+
+uint64_t CCTracer::Now()const
+{
+	uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return now - _startTimestamp;
+}
+
+void CCTracer::Record(const char* name, uint64_t start, uint64_t duration, uint32_t entity, int64_t value)
+{
+	// a zone that started before Stop still ends after it
+	if (_isEnabled.load(std::memory_order_acquire) == false)
+		return;
+
+	uint64_t index = _next.fetch_add(1, std::memory_order_relaxed);
+	CCTraceEvent& event = _events[index & CC_TRACE_RING_MASK];
+
+	// the exporter skips the event while it is being written
+	event.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+	event.thread = ThreadID();
+	event.entity = entity;
+	event.value = value;
+
+	event.sequence.store(index + 1, std::memory_order_release);
+}
+
+nlohmann::json CCTracer::ToChromeTrace()
+{
+	using namespace nlohmann;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	json events = json::array();
+	uint64_t next = _next.load(std::memory_order_acquire);
+	uint64_t first = next > CC_TRACE_RING_SIZE ? next - CC_TRACE_RING_SIZE : 0;
+	uint64_t skipped = 0;
+
+	for (uint64_t index = first; _events && index < next; index++)
+	{
+		CCTraceEvent& slot = _events[index & CC_TRACE_RING_MASK];
+
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		const char* name = slot.name;
+		uint64_t start = slot.start;
+		uint64_t duration = slot.duration;
+		uint32_t thread = slot.thread;
+		uint32_t entity = slot.entity;
+		int64_t value = slot.value;
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// still being written or already overwritten by a newer event
+		if (sequence != index + 1 || slot.sequence.load(std::memory_order_relaxed) != sequence)
+		{
+			skipped++;
+			continue;
+		}
+
+		json event;
+		event["name"] = name;
+		event["cat"] = "cc";
+		event["pid"] = 1;
+		event["tid"] = thread;
+		event["ts"] = start / 1000.0;
+
+		if (duration == UINT64_MAX)
+		{
+			event["ph"] = "i";
+			event["s"] = "t";
+			event["args"]["value"] = value;
+		}
+		else
+		{
+			event["ph"] = "X";
+			event["dur"] = duration / 1000.0;
+		}
+
+		if (entity != CC_TRACE_NO_ENTITY)
+			event["args"]["entity"] = CCLogger::logger.GetInternedString(entity);
+
+		events.push_back(std::move(event));
+	}
+
+	json trace;
+	trace["traceEvents"] = std::move(events);
+	trace["displayTimeUnit"] = "ms";
+	trace["otherData"]["recorded"] = next;
+	trace["otherData"]["dropped"] = first + skipped;
+
+	return trace;
+}
@@ -0,0 +1,112 @@
+#ifndef CC_TRACE_H
+#define CC_TRACE_H
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+/*
+*	CCTracer keeps the last CC_TRACE_RING_SIZE zones and instants in a ring and exports them in the
+*	Chrome trace event format (chrome://tracing, Perfetto), so a slow jump can be looked at as a
+*	timeline of the RPCs, awks and reconnects it was made of on every thread.
+*
+*	Tracing is started and stopped at runtime (the startTrace / stopTrace GUI messages, see
+*	CCGuiSession.h). A zone on a stopped tracer costs one relaxed load. Without CC_TRACING defined
+*	(the CC_TRACING CMake option) the macros compile to nothing.
+*
+*	CC_TRACE_ZONE(name)					times the rest of the enclosing scope
+*	CC_TRACE_ENTITY_ZONE(name, logID)	the same for an entity, {logID} is CCNetworkEntity::GetLogID()
+*	CC_TRACE_INSTANT(name, logID, value)	a point in time with a value (i.e. a SocketError)
+*
+*	{name} must be a string literal, it is stored as a pointer.
+*/
+
+// a power of two
+#define CC_TRACE_RING_SIZE (64 * 1024)
+#define CC_TRACE_NO_ENTITY UINT32_MAX
+
+struct CCTraceEvent
+{
+	std::atomic<uint64_t>	sequence; // index in the ring + 1 once written, 0 while being written
+	const char*				name;
+	uint64_t				start; // ns since the tracer started
+	uint64_t				duration; // ns, UINT64_MAX for instants
+	uint32_t				thread;
+	uint32_t				entity; // interned with CCLogger::InternString or CC_TRACE_NO_ENTITY
+	int64_t					value; // instants only
+};
+
+class CCTracer
+{
+private:
+	std::atomic<bool>				_isEnabled;
+	std::atomic<uint64_t>			_next; // index of the next event
+	std::unique_ptr<CCTraceEvent[]>	_events; // allocated on the first Start and never freed
+	uint64_t						_startTimestamp;
+	std::mutex						_mutex; // Start, Stop and exporting
+
+	CCTracer();
+
+	static uint32_t ThreadID();
+
+public:
+	inline bool IsEnabled()const { return _isEnabled.load(std::memory_order_relaxed); }
+
+	// clears the ring and starts recording, returns false if tracing was compiled out
+	bool Start();
+	void Stop();
+
+	uint64_t Now()const;
+	void Record(const char* name, uint64_t start, uint64_t duration, uint32_t entity, int64_t value);
+
+	// {traceEvents, displayTimeUnit, otherData: {recorded, dropped}}, the oldest events are dropped
+	// once the ring wraps
+	nlohmann::json ToChromeTrace();
+
+	static CCTracer tracer;
+};
+
+class CCTraceZone
+{
+private:
+	const char*	_name;
+	uint32_t	_entity;
+	uint64_t	_start;
+	bool		_isActive;
+
+public:
+	inline CCTraceZone(const char* name, uint32_t entity = CC_TRACE_NO_ENTITY) : _name(name), _entity(entity), \
+		_start(0), _isActive(CCTracer::tracer.IsEnabled())
+	{
+		if (_isActive)
+			_start = CCTracer::tracer.Now();
+	}
+
+	inline ~CCTraceZone()
+	{
+		if (_isActive)
+			CCTracer::tracer.Record(_name, _start, CCTracer::tracer.Now() - _start, _entity, 0);
+	}
+};
+
+#define CC_TRACE_CONCAT_INNER(a, b) a##b
+#define CC_TRACE_CONCAT(a, b) CC_TRACE_CONCAT_INNER(a, b)
+
+#ifdef CC_TRACING
+
+#define CC_TRACE_ZONE(name) CCTraceZone CC_TRACE_CONCAT(_traceZone, __LINE__)(name)
+#define CC_TRACE_ENTITY_ZONE(name, logID) CCTraceZone CC_TRACE_CONCAT(_traceZone, __LINE__)(name, logID)
+#define CC_TRACE_INSTANT(name, logID, value) if (!CCTracer::tracer.IsEnabled()) {} else \
+	CCTracer::tracer.Record(name, CCTracer::tracer.Now(), UINT64_MAX, logID, (int64_t)(value))
+
+#else
+
+#define CC_TRACE_ZONE(name)
+#define CC_TRACE_ENTITY_ZONE(name, logID)
+#define CC_TRACE_INSTANT(name, logID, value)
+
+#endif
+
+#endif
@@ -15,6 +15,9 @@ public:
 	// Called when Gui Sends Offsets for Configuration and Entites have had them applied
 	// Note: this is generally called on a background thread. So watchout for thread safety
 	virtual void EntitiesFinishedConfiguration() = 0;
+	// Called when a GUI moved some entities while still editing, {changed} already have their new offsets
+	// Note: this is called on a GUI session thread
+	virtual void EntityOffsetsChanged(const std::vector<CCNetworkEntity*>& changed) = 0;
 };
 
 #endif
\ No newline at end of file
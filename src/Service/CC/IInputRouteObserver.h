@@ -0,0 +1,23 @@
+#ifndef IINPUT_ROUTE_OBSERVER_H
+#define IINPUT_ROUTE_OBSERVER_H
+
+struct OSEvent;
+class CCNetworkEntity;
+
+enum class InputRoute : int
+{
+	SKIPPED,		// dropped while the cursor was being warped or the delta was too large
+	LOCAL,			// left to this computer
+	REMOTE,			// sent to another entity
+	REMOTE_FAILED	// sending to another entity failed
+};
+
+// told about every routing decision CCMain makes, on the thread that delivered the event
+class IInputRouteObserver
+{
+public:
+	virtual void EventRouted(const OSEvent& event, const CCNetworkEntity* target, InputRoute route) = 0;
+	virtual void EntityJumped(const CCNetworkEntity* from, const CCNetworkEntity* to) = 0;
+};
+
+#endif
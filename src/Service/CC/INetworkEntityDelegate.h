@@ -6,6 +6,10 @@ class INetworkEntityDelegate
 {
 public:
 	virtual void EntityLost(CCNetworkEntity* entity) = 0;
+	// the entity is suspect or reconnecting, called from its heartbeat before it's lost or reachable again
+	virtual void EntityUnreachable(CCNetworkEntity* entity) = 0;
+	// a probe got through to the entity after EntityUnreachable
+	virtual void EntityReachable(CCNetworkEntity* entity) = 0;
 	virtual void LostServer() = 0;
 };
 
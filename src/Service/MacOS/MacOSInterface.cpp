@@ -1,4 +1,5 @@
 #include "../OSInterface/NativeInterface.h"
+#include "../OSInterface/KeyCodes.h"
 
 #include <ApplicationServices/ApplicationServices.h>
 
@@ -35,6 +36,7 @@ void myHIDKeyboardCallback( void* context,  IOReturn result,  void* sender,  IOH
             if(scancode <= kHIDUsage_KeyboardErrorUndefined || scancode > kHIDUsage_KeyboardRightGUI)
                 return;
             
+            // the HID usage is already what OSEvent carries, see KeyCodes.h
             event.eventButton.scanCode = scancode;
             
             event.eventType = OS_EVENT_KEY;
@@ -168,6 +170,9 @@ void NativeUnhookAllEvents()
     IOHIDManagerRegisterInputValueCallback(hidManager, nullptr, nullptr);
 #pragma clang diagnostic pop
     
+    // a captured cursor would stay frozen without us
+    CGAssociateMouseAndMouseCursorPosition(true);
+    
     IOHIDManagerUnscheduleFromRunLoop(hidManager, CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
     IOHIDManagerClose(hidManager, kIOHIDOptionsTypeNone);
     CFRelease(hidManager);
@@ -275,16 +280,43 @@ int GetAllDisplays(std::list<NativeDisplay>& outDisplays)
 
 int SendKeyEvent(const OSEvent keyEvent)
 {
-    CGKeyCode code;
-    bool keydown;
+    int code = HID_TO_MAC[keyEvent.scanCode];
+    
+    // no key on this keyboard types it
+    if(code == KEY_CODE_NONE)
+        return 0;
     
-    CGEventRef event = CGEventCreateKeyboardEvent(NULL, code, keydown);
+    bool keydown = keyEvent.keyEvent == KEY_EVENT_DOWN;
+    
+    CGEventRef event = CGEventCreateKeyboardEvent(NULL, (CGKeyCode)code, keydown);
     CGEventPost(kCGHIDEventTap, event);
     CFRelease(event);
     
     return 0;
 }
 
+int SetRelativeMouseCapture(bool isCaptured)
+{
+    // the HID callback already reports the device's own motion, only the cursor needs to stop
+    return CGAssociateMouseAndMouseCursorPosition(isCaptured ? false : true);
+}
+
+int GetKeyRepeatSettings(int& delayMs, int& intervalMs)
+{
+    Boolean isValid = false;
+    
+    // both are in ticks of 15ms and only there once the user changed them
+    CFIndex initialRepeat = CFPreferencesGetAppIntegerValue(CFSTR("InitialKeyRepeat"), kCFPreferencesAnyApplication, &isValid);
+    if(isValid)
+        delayMs = (int)initialRepeat * 15;
+    
+    CFIndex repeat = CFPreferencesGetAppIntegerValue(CFSTR("KeyRepeat"), kCFPreferencesAnyApplication, &isValid);
+    if(isValid)
+        intervalMs = (int)repeat * 15;
+    
+    return 0;
+}
+
 int ConvertEventCoordsToNative(const OSEvent inEvent, OSEvent& outEvent)
 {
     outEvent = inEvent;
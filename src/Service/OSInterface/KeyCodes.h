@@ -0,0 +1,239 @@
+#ifndef KEY_CODES_H
+#define KEY_CODES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    OSEvent::scanCode is a USB HID usage ID of the keyboard page (0x07) everywhere past the native
+    interface, so a key captured on one OS is typed as the same key on another. The native interface
+    translates once when it captures a key and once when it injects one.
+
+    The tables are generated at compile time from KEY_CODE_ROWS, one row per key. A code without a
+    counterpart is KEY_CODE_NONE, keys that translate to it are neither forwarded nor injected.
+
+    Windows codes are the scan codes of KBDLLHOOKSTRUCT with 0x100 set when LLKHF_EXTENDED is.
+    The hook reports PAUSE as 0x45 and NUM LOCK as 0x45 extended, which is what the table uses.
+    macOS codes are CGKeyCode virtual key codes, Linux codes are evdev KEY_* codes.
+*/
+
+#define KEY_CODE_NONE -1
+
+#define KEY_CODE_HID_COUNT 0x100
+#define KEY_CODE_WINDOWS_COUNT 0x200
+#define KEY_CODE_MAC_COUNT 0x80
+#define KEY_CODE_EVDEV_COUNT 0x100
+
+// HID usages the service itself refers to
+#define KEY_CODE_HID_PAUSE 0x48
+
+struct KeyCodeRow
+{
+    int hid;
+    int windows;
+    int mac;
+    int evdev;
+};
+
+#define N KEY_CODE_NONE
+constexpr KeyCodeRow KEY_CODE_ROWS[] =
+{
+    // hid   windows  mac     evdev
+    { 0x04,  0x01E,   0x00,   30  }, // A
+    { 0x05,  0x030,   0x0B,   48  }, // B
+    { 0x06,  0x02E,   0x08,   46  }, // C
+    { 0x07,  0x020,   0x02,   32  }, // D
+    { 0x08,  0x012,   0x0E,   18  }, // E
+    { 0x09,  0x021,   0x03,   33  }, // F
+    { 0x0A,  0x022,   0x05,   34  }, // G
+    { 0x0B,  0x023,   0x04,   35  }, // H
+    { 0x0C,  0x017,   0x22,   23  }, // I
+    { 0x0D,  0x024,   0x26,   36  }, // J
+    { 0x0E,  0x025,   0x28,   37  }, // K
+    { 0x0F,  0x026,   0x25,   38  }, // L
+    { 0x10,  0x032,   0x2E,   50  }, // M
+    { 0x11,  0x031,   0x2D,   49  }, // N
+    { 0x12,  0x018,   0x1F,   24  }, // O
+    { 0x13,  0x019,   0x23,   25  }, // P
+    { 0x14,  0x010,   0x0C,   16  }, // Q
+    { 0x15,  0x013,   0x0F,   19  }, // R
+    { 0x16,  0x01F,   0x01,   31  }, // S
+    { 0x17,  0x014,   0x11,   20  }, // T
+    { 0x18,  0x016,   0x20,   22  }, // U
+    { 0x19,  0x02F,   0x09,   47  }, // V
+    { 0x1A,  0x011,   0x0D,   17  }, // W
+    { 0x1B,  0x02D,   0x07,   45  }, // X
+    { 0x1C,  0x015,   0x10,   21  }, // Y
+    { 0x1D,  0x02C,   0x06,   44  }, // Z
+    { 0x1E,  0x002,   0x12,   2   }, // 1
+    { 0x1F,  0x003,   0x13,   3   }, // 2
+    { 0x20,  0x004,   0x14,   4   }, // 3
+    { 0x21,  0x005,   0x15,   5   }, // 4
+    { 0x22,  0x006,   0x17,   6   }, // 5
+    { 0x23,  0x007,   0x16,   7   }, // 6
+    { 0x24,  0x008,   0x1A,   8   }, // 7
+    { 0x25,  0x009,   0x1C,   9   }, // 8
+    { 0x26,  0x00A,   0x19,   10  }, // 9
+    { 0x27,  0x00B,   0x1D,   11  }, // 0
+    { 0x28,  0x01C,   0x24,   28  }, // ENTER
+    { 0x29,  0x001,   0x35,   1   }, // ESCAPE
+    { 0x2A,  0x00E,   0x33,   14  }, // BACKSPACE
+    { 0x2B,  0x00F,   0x30,   15  }, // TAB
+    { 0x2C,  0x039,   0x31,   57  }, // SPACE
+    { 0x2D,  0x00C,   0x1B,   12  }, // MINUS
+    { 0x2E,  0x00D,   0x18,   13  }, // EQUAL
+    { 0x2F,  0x01A,   0x21,   26  }, // LEFT BRACKET
+    { 0x30,  0x01B,   0x1E,   27  }, // RIGHT BRACKET
+    { 0x31,  0x02B,   0x2A,   43  }, // BACKSLASH, the non US # (0x32) is the same key on every OS
+    { 0x33,  0x027,   0x29,   39  }, // SEMICOLON
+    { 0x34,  0x028,   0x27,   40  }, // APOSTROPHE
+    { 0x35,  0x029,   0x32,   41  }, // GRAVE
+    { 0x36,  0x033,   0x2B,   51  }, // COMMA
+    { 0x37,  0x034,   0x2F,   52  }, // PERIOD
+    { 0x38,  0x035,   0x2C,   53  }, // SLASH
+    { 0x39,  0x03A,   0x39,   58  }, // CAPS LOCK
+    { 0x3A,  0x03B,   0x7A,   59  }, // F1
+    { 0x3B,  0x03C,   0x78,   60  }, // F2
+    { 0x3C,  0x03D,   0x63,   61  }, // F3
+    { 0x3D,  0x03E,   0x76,   62  }, // F4
+    { 0x3E,  0x03F,   0x60,   63  }, // F5
+    { 0x3F,  0x040,   0x61,   64  }, // F6
+    { 0x40,  0x041,   0x62,   65  }, // F7
+    { 0x41,  0x042,   0x64,   66  }, // F8
+    { 0x42,  0x043,   0x65,   67  }, // F9
+    { 0x43,  0x044,   0x6D,   68  }, // F10
+    { 0x44,  0x057,   0x67,   87  }, // F11
+    { 0x45,  0x058,   0x6F,   88  }, // F12
+    { 0x46,  0x137,   N,      99  }, // PRINT SCREEN
+    { 0x47,  0x046,   N,      70  }, // SCROLL LOCK
+    { 0x48,  0x045,   N,      119 }, // PAUSE
+    { 0x49,  0x152,   0x72,   110 }, // INSERT, HELP on macOS
+    { 0x4A,  0x147,   0x73,   102 }, // HOME
+    { 0x4B,  0x149,   0x74,   104 }, // PAGE UP
+    { 0x4C,  0x153,   0x75,   111 }, // DELETE
+    { 0x4D,  0x14F,   0x77,   107 }, // END
+    { 0x4E,  0x151,   0x79,   109 }, // PAGE DOWN
+    { 0x4F,  0x14D,   0x7C,   106 }, // RIGHT
+    { 0x50,  0x14B,   0x7B,   105 }, // LEFT
+    { 0x51,  0x150,   0x7D,   108 }, // DOWN
+    { 0x52,  0x148,   0x7E,   103 }, // UP
+    { 0x53,  0x145,   0x47,   69  }, // NUM LOCK, CLEAR on macOS
+    { 0x54,  0x135,   0x4B,   98  }, // KEYPAD /
+    { 0x55,  0x037,   0x43,   55  }, // KEYPAD *
+    { 0x56,  0x04A,   0x4E,   74  }, // KEYPAD -
+    { 0x57,  0x04E,   0x45,   78  }, // KEYPAD +
+    { 0x58,  0x11C,   0x4C,   96  }, // KEYPAD ENTER
+    { 0x59,  0x04F,   0x53,   79  }, // KEYPAD 1
+    { 0x5A,  0x050,   0x54,   80  }, // KEYPAD 2
+    { 0x5B,  0x051,   0x55,   81  }, // KEYPAD 3
+    { 0x5C,  0x04B,   0x56,   75  }, // KEYPAD 4
+    { 0x5D,  0x04C,   0x57,   76  }, // KEYPAD 5
+    { 0x5E,  0x04D,   0x58,   77  }, // KEYPAD 6
+    { 0x5F,  0x047,   0x59,   71  }, // KEYPAD 7
+    { 0x60,  0x048,   0x5B,   72  }, // KEYPAD 8
+    { 0x61,  0x049,   0x5C,   73  }, // KEYPAD 9
+    { 0x62,  0x052,   0x52,   82  }, // KEYPAD 0
+    { 0x63,  0x053,   0x41,   83  }, // KEYPAD .
+    { 0x64,  0x056,   0x0A,   86  }, // NON US BACKSLASH, SECTION on macOS
+    { 0x65,  0x15D,   0x6E,   127 }, // APPLICATION
+    { 0x66,  0x15E,   N,      116 }, // POWER
+    { 0x67,  0x059,   0x51,   117 }, // KEYPAD =
+    { 0x68,  0x064,   0x69,   183 }, // F13
+    { 0x69,  0x065,   0x6B,   184 }, // F14
+    { 0x6A,  0x066,   0x71,   185 }, // F15
+    { 0x6B,  0x067,   0x6A,   186 }, // F16
+    { 0x6C,  0x068,   0x40,   187 }, // F17
+    { 0x6D,  0x069,   0x4F,   188 }, // F18
+    { 0x6E,  0x06A,   0x50,   189 }, // F19
+    { 0x6F,  0x06B,   0x5A,   190 }, // F20
+    { 0x70,  0x06C,   N,      191 }, // F21
+    { 0x71,  0x06D,   N,      192 }, // F22
+    { 0x72,  0x06E,   N,      193 }, // F23
+    { 0x73,  0x076,   N,      194 }, // F24
+    { 0x7F,  0x120,   0x4A,   113 }, // MUTE
+    { 0x80,  0x130,   0x48,   115 }, // VOLUME UP
+    { 0x81,  0x12E,   0x49,   114 }, // VOLUME DOWN
+    { 0x85,  0x07E,   0x5F,   121 }, // KEYPAD COMMA
+    { 0x87,  0x073,   0x5E,   89  }, // INTERNATIONAL 1, RO
+    { 0x88,  0x070,   N,      93  }, // INTERNATIONAL 2, KATAKANA/HIRAGANA
+    { 0x89,  0x07D,   0x5D,   124 }, // INTERNATIONAL 3, YEN
+    { 0x8A,  0x079,   N,      92  }, // INTERNATIONAL 4, HENKAN
+    { 0x8B,  0x07B,   N,      94  }, // INTERNATIONAL 5, MUHENKAN
+    { 0x90,  N,       0x68,   122 }, // LANG 1, KANA on macOS, HANGEUL on Linux
+    { 0x91,  N,       0x66,   123 }, // LANG 2, EISU on macOS, HANJA on Linux
+    { 0xE0,  0x01D,   0x3B,   29  }, // LEFT CONTROL
+    { 0xE1,  0x02A,   0x38,   42  }, // LEFT SHIFT
+    { 0xE2,  0x038,   0x3A,   56  }, // LEFT ALT
+    { 0xE3,  0x15B,   0x37,   125 }, // LEFT GUI
+    { 0xE4,  0x11D,   0x3E,   97  }, // RIGHT CONTROL
+    { 0xE5,  0x036,   0x3C,   54  }, // RIGHT SHIFT
+    { 0xE6,  0x138,   0x3D,   100 }, // RIGHT ALT
+    { 0xE7,  0x15C,   0x36,   126 }  // RIGHT GUI
+};
+#undef N
+
+template<size_t Count>
+struct KeyCodeTable
+{
+    int16_t codes[Count];
+
+    // KEY_CODE_NONE for codes the table doesn't have
+    constexpr int operator[](int code) const { return code >= 0 && code < (int)Count ? codes[code] : KEY_CODE_NONE; }
+};
+
+// {Count} entries indexed by the row's {from} column, holding its {to} column
+template<size_t Count>
+constexpr KeyCodeTable<Count> MakeKeyCodeTable(int KeyCodeRow::* from, int KeyCodeRow::* to)
+{
+    KeyCodeTable<Count> table = {};
+    for (size_t i = 0; i < Count; i++)
+        table.codes[i] = KEY_CODE_NONE;
+
+    for (const KeyCodeRow& row : KEY_CODE_ROWS)
+    {
+        if (row.*from != KEY_CODE_NONE && row.*to != KEY_CODE_NONE)
+            table.codes[row.*from] = (int16_t)(row.*to);
+    }
+
+    return table;
+}
+
+constexpr KeyCodeTable<KEY_CODE_WINDOWS_COUNT> WINDOWS_TO_HID = MakeKeyCodeTable<KEY_CODE_WINDOWS_COUNT>(&KeyCodeRow::windows, &KeyCodeRow::hid);
+constexpr KeyCodeTable<KEY_CODE_HID_COUNT> HID_TO_WINDOWS = MakeKeyCodeTable<KEY_CODE_HID_COUNT>(&KeyCodeRow::hid, &KeyCodeRow::windows);
+constexpr KeyCodeTable<KEY_CODE_MAC_COUNT> MAC_TO_HID = MakeKeyCodeTable<KEY_CODE_MAC_COUNT>(&KeyCodeRow::mac, &KeyCodeRow::hid);
+constexpr KeyCodeTable<KEY_CODE_HID_COUNT> HID_TO_MAC = MakeKeyCodeTable<KEY_CODE_HID_COUNT>(&KeyCodeRow::hid, &KeyCodeRow::mac);
+constexpr KeyCodeTable<KEY_CODE_EVDEV_COUNT> EVDEV_TO_HID = MakeKeyCodeTable<KEY_CODE_EVDEV_COUNT>(&KeyCodeRow::evdev, &KeyCodeRow::hid);
+constexpr KeyCodeTable<KEY_CODE_HID_COUNT> HID_TO_EVDEV = MakeKeyCodeTable<KEY_CODE_HID_COUNT>(&KeyCodeRow::hid, &KeyCodeRow::evdev);
+
+// true if every code of {column} is in range and in one row only, so translating there and back is lossless
+constexpr bool KeyCodeColumnIsValid(int KeyCodeRow::* column, int count)
+{
+    for (const KeyCodeRow& row : KEY_CODE_ROWS)
+    {
+        int code = row.*column;
+        if (code == KEY_CODE_NONE)
+            continue;
+
+        if (code < 0 || code >= count)
+            return false;
+
+        int rows = 0;
+        for (const KeyCodeRow& other : KEY_CODE_ROWS)
+        {
+            if (other.*column == code)
+                rows++;
+        }
+
+        if (rows != 1)
+            return false;
+    }
+
+    return true;
+}
+
+static_assert(KeyCodeColumnIsValid(&KeyCodeRow::hid, KEY_CODE_HID_COUNT), "a HID usage is in two rows of KEY_CODE_ROWS");
+static_assert(KeyCodeColumnIsValid(&KeyCodeRow::windows, KEY_CODE_WINDOWS_COUNT), "a Windows scan code is in two rows of KEY_CODE_ROWS");
+static_assert(KeyCodeColumnIsValid(&KeyCodeRow::mac, KEY_CODE_MAC_COUNT), "a macOS key code is in two rows of KEY_CODE_ROWS");
+static_assert(KeyCodeColumnIsValid(&KeyCodeRow::evdev, KEY_CODE_EVDEV_COUNT), "an evdev code is in two rows of KEY_CODE_ROWS");
+
+#endif
@@ -114,6 +114,22 @@ extern int SetMousePosition(int x,int y);
     Gets the mouse position and stores it in {xPos} and {yPos}
 */
 extern int GetMousePosition(int& xPos, int& yPos);
+/*
+    Freezes the cursor where it is if {isCaptured} is true and reports mouse moves with the motion
+    of the device itself, before the OS accelerated it or stopped it at the edge of a display.
+    x and y of those moves are where the cursor was frozen. If {isCaptured} is false the cursor
+    moves again and moves report where it went, like before.
+
+    return 0 on success or an OS specific error if the OS can't capture the mouse
+*/
+extern int SetRelativeMouseCapture(bool isCaptured);
+/*
+    Gets the keyboard's repeat delay and the time between repeats in milliseconds and stores them
+    in {delayMs} and {intervalMs}, both are left alone if the OS has no setting for them
+
+    Returns OS error or 0 on success
+*/
+extern int GetKeyRepeatSettings(int& delayMs, int& intervalMs);
 /*
     Gets the local computer host name and stores it in {hostName}
 
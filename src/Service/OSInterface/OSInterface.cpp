@@ -3,7 +3,9 @@
 #include "PacketTypes.h"
 #include "OSInterface.h"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <thread>
 
 #define SLEEPM(a) std::this_thread::sleep_for(std::chrono::milliseconds(a));
@@ -21,7 +23,7 @@ OSInterface::OSInterface() :shouldRunMainloop(true), hasHookedEvents(false)
     if (ret != 0)
     {
         std::string errorString = "Could no Start Connection To OS " + std::to_string(ret);
-        throw std::exception(errorString.c_str());
+        throw std::runtime_error(errorString.c_str());
     }
 }
 
@@ -168,6 +170,24 @@ OSInterfaceError OSInterface::GetMousePosition(int& xPos, int& yPos)
     return OSInterfaceError::OS_E_SUCCESS;
 }
 
+OSInterfaceError OSInterface::SetRelativeMouseCapture(bool isCaptured)
+{
+    int ret = ::SetRelativeMouseCapture(isCaptured);
+    if(ret != 0)
+        return OSErrorToOSInterfaceError(ret);
+
+    return OSInterfaceError::OS_E_SUCCESS;
+}
+
+OSInterfaceError OSInterface::GetKeyRepeatSettings(int& delayMs, int& intervalMs)
+{
+    int ret = ::GetKeyRepeatSettings(delayMs, intervalMs);
+    if(ret != 0)
+        return OSErrorToOSInterfaceError(ret);
+
+    return OSInterfaceError::OS_E_SUCCESS;
+}
+
 OSInterfaceError OSInterface::GetProcessExitCode(int processID, unsigned long* exitCode)
 {
     int ret = ::GetProcessExitCode(processID, exitCode);
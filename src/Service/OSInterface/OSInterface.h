@@ -85,6 +85,20 @@ public:
      * Returns an OSInterfaceError on failure or OS_E_SUCCESS if succesful
      */
     OSInterfaceError GetMousePosition(int& xPos, int& yPos);
+    /*
+     * Freezes the cursor and reports the mouse's raw relative motion if {isCaptured} is true,
+     * see NativeInterface.h. Moves captured this way are never cut short by a display's edge
+     *
+     * Returns an OSInterfaceError on failure or OS_E_SUCCESS if succesful
+     */
+    OSInterfaceError SetRelativeMouseCapture(bool isCaptured);
+    /*
+     * Gets how long a key is held before it repeats and the time between repeats, as set by the user
+     * {delayMs} and {intervalMs} are left as they are if the OS has no such setting
+     *
+     * Returns an OSInterfaceError on failure or OS_E_SUCCESS if succesful
+     */
+    OSInterfaceError GetKeyRepeatSettings(int& delayMs, int& intervalMs);
     /*
      *  Gets the exit code for process with id {processID} and stores it in {*exitCode}
      *
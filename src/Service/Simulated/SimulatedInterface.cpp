@@ -0,0 +1,261 @@
+#include "SimulatedInterface.h"
+#include "../OSInterface/NativeInterface.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// injected events are dropped past this many so a run nobody reads can't grow forever
+#define SIMULATED_MAX_RECORDED_EVENTS (1 << 20)
+
+#define SIMULATED_DISPLAY_WIDTH 1920
+#define SIMULATED_DISPLAY_HEIGHT 1080
+
+OSInterface* simulatedOSI = 0;
+
+std::mutex simulatedMutex;
+std::vector<NativeDisplay> simulatedDisplays;
+std::vector<SimulatedEventRecord> simulatedInjected;
+
+int simulatedMouseX = SIMULATED_DISPLAY_WIDTH / 2;
+int simulatedMouseY = SIMULATED_DISPLAY_HEIGHT / 2;
+bool simulatedMouseHidden = false;
+bool simulatedMouseCaptured = false;
+
+uint64_t SimulatedNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SimulatedRecordInjected(const OSEvent& event)
+{
+    uint64_t timestamp = SimulatedNow();
+
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+
+    if (simulatedInjected.size() < SIMULATED_MAX_RECORDED_EVENTS)
+        simulatedInjected.push_back({ event, timestamp });
+}
+
+void SimulatedSetDisplays(const std::vector<NativeDisplay>& displays)
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+
+    simulatedDisplays = displays;
+
+    if (displays.empty() == false)
+    {
+        simulatedMouseX = displays[0].posX + displays[0].width / 2;
+        simulatedMouseY = displays[0].posY + displays[0].height / 2;
+    }
+}
+
+int SimulatedGenerateEvents(const std::function<OSEvent(uint32_t index)>& makeEvent, uint32_t count, int rate, \
+    std::vector<SimulatedEventRecord>* delivered)
+{
+    if (simulatedOSI == 0)
+        return SIMULATED_E_NOT_REGISTERED;
+
+    auto interval = std::chrono::nanoseconds(rate > 0 ? 1000000000LL / rate : 0);
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (rate > 0)
+            std::this_thread::sleep_until(start + interval * i);
+
+        OSEvent event = makeEvent(i);
+        uint64_t timestamp = SimulatedNow();
+
+        // the same path a device hook takes
+        simulatedOSI->ConsumeInputEvent(event);
+
+        if (delivered)
+            delivered->push_back({ event, timestamp });
+    }
+
+    return 0;
+}
+
+void SimulatedTakeInjectedEvents(std::vector<SimulatedEventRecord>& injected)
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+
+    injected.insert(injected.end(), simulatedInjected.begin(), simulatedInjected.end());
+    simulatedInjected.clear();
+}
+
+size_t SimulatedGetInjectedCount()
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+    return simulatedInjected.size();
+}
+
+// NativeInterface
+
+int StartupOSConnection()
+{
+    // runs during static initialization, the simulated state is set up on first use instead
+    return 0;
+}
+
+int ShutdownOSConnection()
+{
+    simulatedOSI = 0;
+    return 0;
+}
+
+int GetProcessExitCode(int processID, unsigned long* exitCode)
+{
+    return SIMULATED_E_NOT_SUPPORTED;
+}
+
+int GetIsProcessActive(int processID, bool* isActive)
+{
+    return SIMULATED_E_NOT_SUPPORTED;
+}
+
+int StartProcessAsDesktopUser(std::string process, std::string args, std::string workingDir, bool isVisible, ProccessInfo* processInfo)
+{
+    return SIMULATED_E_NOT_SUPPORTED;
+}
+
+int NativeRegisterForOSEvents(OSInterface* osi)
+{
+    simulatedOSI = osi;
+    return 0;
+}
+
+void OSMainLoop(bool& shouldRun)
+{
+    // there are no native messages, events are delivered by SimulatedGenerateEvents
+    while (shouldRun)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void NativeUnhookAllEvents()
+{
+    simulatedOSI = 0;
+}
+
+int SetMouseHidden(bool isHidden)
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+    simulatedMouseHidden = isHidden;
+
+    return 0;
+}
+
+int SendMouseEvent(const OSEvent mouseEvent)
+{
+    SimulatedRecordInjected(mouseEvent);
+    return 0;
+}
+
+int SendKeyEvent(const OSEvent keyEvent)
+{
+    SimulatedRecordInjected(keyEvent);
+    return 0;
+}
+
+int GetAllDisplays(std::vector<NativeDisplay>& outDisplays)
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+
+    if (simulatedDisplays.empty())
+    {
+        NativeDisplay display;
+        display.nativeScreenID = 0;
+        display.posX = 0;
+        display.posY = 0;
+        display.width = SIMULATED_DISPLAY_WIDTH;
+        display.height = SIMULATED_DISPLAY_HEIGHT;
+
+        outDisplays.push_back(display);
+        return 0;
+    }
+
+    outDisplays.insert(outDisplays.end(), simulatedDisplays.begin(), simulatedDisplays.end());
+
+    return 0;
+}
+
+int GetIPAddressList(std::vector<IPAdressInfo>& outAddresses, const IPAdressInfoHints& hints)
+{
+    // every simulated entity lives on the loopback
+    if ((hints.familly & IPAddressFamilly::IPv4) == IPAddressFamilly::NONE || (hints.type & IPAddressType::UNICAST) == IPAddressType::NONE)
+        return 0;
+
+    IPAdressInfo info;
+    info.address = "127.0.0.1";
+    info.subnetMask = "255.0.0.0";
+    info.adaptorName = "simulated";
+    info.addressFamilly = IPAddressFamilly::IPv4;
+    info.addressType = IPAddressType::UNICAST;
+
+    outAddresses.push_back(info);
+
+    return 0;
+}
+
+int ConvertEventCoordsToNative(const OSEvent inEvent, OSEvent& outEvent)
+{
+    outEvent = inEvent;
+    return 0;
+}
+
+int SetMousePosition(int x, int y)
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+    simulatedMouseX = x;
+    simulatedMouseY = y;
+
+    return 0;
+}
+
+int GetMousePosition(int& xPos, int& yPos)
+{
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+    xPos = simulatedMouseX;
+    yPos = simulatedMouseY;
+
+    return 0;
+}
+
+int SetRelativeMouseCapture(bool isCaptured)
+{
+    // the simulated cursor never moves by itself, generated moves are relative either way
+    std::lock_guard<std::mutex> lock(simulatedMutex);
+    simulatedMouseCaptured = isCaptured;
+
+    return 0;
+}
+
+int GetKeyRepeatSettings(int& delayMs, int& intervalMs)
+{
+    // the simulated keyboard has no settings, the service's defaults are used
+    return 0;
+}
+
+int GetHostName(std::string& hostName)
+{
+    hostName = "simulated";
+    return 0;
+}
+
+OSInterfaceError OSErrorToOSInterfaceError(int OSError)
+{
+    switch (OSError)
+    {
+    case 0:
+        return OSInterfaceError::OS_E_SUCCESS;
+    case SIMULATED_E_NOT_SUPPORTED:
+        return OSInterfaceError::OS_E_NOT_IMPLEMENTED;
+    case SIMULATED_E_NOT_REGISTERED:
+        return OSInterfaceError::OS_E_NOT_REGISTERED;
+    default:
+        return OSInterfaceError::OS_E_UNKOWN;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SIMULATED_INTERFACE_H
+#define SIMULATED_INTERFACE_H
+
+#include "../OSInterface/OSTypes.h"
+
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+/*
+    The simulated backend implements NativeInterface without touching the OS so the whole service
+    can run on any machine, it is built instead of the native backend with -DCC_SIMULATED_OS=ON.
+
+    Input comes from SimulatedGenerateEvents instead of device hooks and injected events are
+    recorded instead of being sent to the OS. The cursor only moves through SetMousePosition,
+    injected events belong to the remote side and are only recorded.
+*/
+
+#define SIMULATED_E_NOT_SUPPORTED 1
+#define SIMULATED_E_NOT_REGISTERED 2
+
+struct SimulatedEventRecord
+{
+    OSEvent     event;
+    uint64_t    timestamp; // steady clock nanoseconds
+};
+
+/*
+    Replaces the displays reported by GetAllDisplays, one 1920x1080 display at 0,0 until set.
+    The cursor is moved to the center of the first display.
+*/
+extern void SimulatedSetDisplays(const std::vector<NativeDisplay>& displays);
+/*
+    Calls {makeEvent} {count} times and hands every event to the registered OSInterface as if it
+    came from a device, paced at {rate} events a second or as fast as the receivers allow if {rate} is 0.
+    Blocks until every event was delivered.
+
+    {delivered} if not NULL is appended with every event and the time it was handed over
+
+    returns 0 on success or SIMULATED_E_NOT_REGISTERED if nothing registered for events
+*/
+extern int SimulatedGenerateEvents(const std::function<OSEvent(uint32_t index)>& makeEvent, uint32_t count, int rate, \
+    std::vector<SimulatedEventRecord>* delivered);
+/*
+    Moves every event injected since the last call to the end of {injected}
+*/
+extern void SimulatedTakeInjectedEvents(std::vector<SimulatedEventRecord>& injected);
+/*
+    returns the number of events injected and not taken yet
+*/
+extern size_t SimulatedGetInjectedCount();
+/*
+    returns the steady clock in nanoseconds, the same clock the records use
+*/
+extern uint64_t SimulatedNow();
+
+#endif
@@ -5,15 +5,25 @@
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <mstcpip.h>
 #else
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
 #ifndef SOCKET_ERROR
 #define SOCKET_ERROR -1
 #endif
@@ -27,15 +37,15 @@
 #endif
 
 #ifndef SD_SEND
-#define SD_SEND SDT_SEND
+#define SD_SEND SHUT_WR
 #endif
 
 #ifndef SD_RECEIVE
-#define SD_RECEIVE SDT_RECEIVE
+#define SD_RECEIVE SHUT_RD
 #endif
 
 #ifndef SD_BOTH
-#define SD_BOTH SDT_ALL
+#define SD_BOTH SHUT_RDWR
 #endif
 
 #ifndef _WIN32
@@ -174,7 +184,7 @@ _internalSockInfo(0), _useIPV6(false), _isBindable(false), lastOSErr(0), port(0)
 #ifdef _WIN32
     if(hasBeenInitialized == false)
     {
-        throw std::exception("Must Call OSSocketStartup before creating a socket !");
+        throw std::runtime_error("Must Call OSSocketStartup before creating a socket !");
     }
 #endif
 }
@@ -193,7 +203,7 @@ _internalSockInfo(0), _useIPV6(useIPV6), _isBindable(false), protocol(protocol),
 #ifdef _WIN32
     if(hasBeenInitialized == false)
     {
-        throw std::exception("Must Call OSSocketStartup before creating a socket !");
+        throw std::runtime_error("Must Call OSSocketStartup before creating a socket !");
     }
 #endif
 
@@ -211,7 +221,7 @@ port(port), sfd(0), isBound(false), isConnected(false)
 #ifdef _WIN32
     if (hasBeenInitialized == false)
     {
-        throw std::exception("Must Call OSSocketStartup before creating a socket !");
+        throw std::runtime_error("Must Call OSSocketStartup before creating a socket !");
     }
 #endif
 
@@ -256,6 +266,113 @@ SocketError Socket::Connect()
     return SocketError::SOCKET_E_SUCCESS;
 }
 
+SocketError Socket::ConnectWithTimeout(size_t milliseconds)
+{
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+
+    SocketError error = SetIsBlocking(false);
+    if (error != SocketError::SOCKET_E_SUCCESS)
+        return error;
+
+    // attempt to connect with all results, sharing the deadline
+    struct addrinfo* addrInfo = static_cast<struct addrinfo*>(_internalSockInfo);
+    error = SocketError::SOCKET_E_NOT_CONNECTED;
+
+    for (; addrInfo; addrInfo = addrInfo->ai_next)
+    {
+        if (connect((SOCKET)sfd, addrInfo->ai_addr, (int)addrInfo->ai_addrlen) != SOCKET_ERROR)
+        {
+            error = SocketError::SOCKET_E_SUCCESS;
+            break;
+        }
+
+        lastOSErr = OSGetLastError();
+#ifdef _WIN32
+        if (lastOSErr != WSAEWOULDBLOCK)
+#else
+        if (lastOSErr != EINPROGRESS)
+#endif
+        {
+            error = SOCK_ERR(lastOSErr);
+            continue;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        int remainingMs = (int)std::max<int64_t>(remaining.count(), 0);
+
+#ifdef _WIN32
+        // WSAPoll doesn't report a refused connect on older Windows, select does in exceptfds
+        fd_set writeSet, exceptSet;
+        FD_ZERO(&writeSet);
+        FD_ZERO(&exceptSet);
+        FD_SET((SOCKET)sfd, &writeSet);
+        FD_SET((SOCKET)sfd, &exceptSet);
+        timeval timeout = { remainingMs / 1000, (remainingMs % 1000) * 1000 };
+        int res = select(0, NULL, &writeSet, &exceptSet, &timeout);
+#else
+        struct pollfd pfd = { 0 };
+        pfd.fd = (SOCKET)sfd;
+        pfd.events = POLLOUT;
+        int res = poll(&pfd, 1, remainingMs);
+#endif
+
+        if (res == SOCKET_ERROR)
+        {
+            lastOSErr = OSGetLastError();
+            error = SOCK_ERR(lastOSErr);
+            break;
+        }
+
+        if (res == 0)
+        {
+            error = SocketError::SOCKET_E_TIMEOUT;
+            break;
+        }
+
+        int connectError = 0;
+        socklen_t length = sizeof(connectError);
+        if (getsockopt((SOCKET)sfd, SOL_SOCKET, SO_ERROR, (char*)&connectError, &length) == SOCKET_ERROR)
+            connectError = OSGetLastError();
+
+        if (connectError == 0)
+        {
+            error = SocketError::SOCKET_E_SUCCESS;
+            break;
+        }
+
+        lastOSErr = connectError;
+        error = SOCK_ERR(lastOSErr);
+    }
+
+    if (error != SocketError::SOCKET_E_SUCCESS)
+        return error;
+
+    error = SetIsBlocking(true);
+    if (error != SocketError::SOCKET_E_SUCCESS)
+        return error;
+
+    isConnected = true;
+
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
+SocketError Socket::SetIsBlocking(bool isBlocking)
+{
+#ifdef _WIN32
+    u_long mode = isBlocking ? 0 : 1;
+    if (ioctlsocket((SOCKET)sfd, FIONBIO, &mode) == SOCKET_ERROR)
+#else
+    int flags = fcntl((SOCKET)sfd, F_GETFL, 0);
+    if (flags == -1 || fcntl((SOCKET)sfd, F_SETFL, isBlocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) == -1)
+#endif
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
 SocketError Socket::Connect(int _port)
 {
     if(_port != -1)
@@ -460,7 +577,7 @@ SocketError Socket::RecvFrom(std::string address, int port, char* buff, size_t b
     struct addrinfo* result = static_cast<struct addrinfo*>(this->_internalSockInfo);
 
     struct sockaddr_in recv_addr;
-    int recvAddrSize = sizeof(recv_addr);
+    socklen_t recvAddrSize = sizeof(recv_addr);
 
     recv_addr.sin_family = result->ai_family;
     recv_addr.sin_port = htons(port);
@@ -489,6 +606,36 @@ SocketError Socket::RecvFrom(char* buff, size_t buffLength, size_t* receivedLeng
     return RecvFrom(address, port, buff, buffLength, receivedLength);
 }
 
+SocketError Socket::WaitForData(size_t milliseconds)
+{
+    if (isConnected == false && protocol != SocketProtocol::SOCKET_P_UDP)
+        return SocketError::SOCKET_E_NOT_CONNECTED;
+
+#ifdef _WIN32
+    WSAPOLLFD pfd = { 0 };
+    pfd.fd = (SOCKET)sfd;
+    pfd.events = POLLRDNORM;
+    int res = WSAPoll(&pfd, 1, (INT)milliseconds);
+#else
+    struct pollfd pfd = { 0 };
+    pfd.fd = (SOCKET)sfd;
+    pfd.events = POLLIN;
+    int res = poll(&pfd, 1, (int)milliseconds);
+#endif
+
+    if (res == SOCKET_ERROR)
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    if (res == 0)
+        return SocketError::SOCKET_E_TIMEOUT;
+
+    // a closed or reset connection is readable as well, Recv reports it
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
 SocketError Socket::WaitForServer()
 {
     if(isConnected == false && protocol != SocketProtocol::SOCKET_P_UDP)
@@ -520,6 +667,8 @@ SocketError Socket::Close(bool reCreate)
     }
 
     sfd = (NativeSocketHandle)INVALID_SOCKET;
+    // a recreated socket has to be connected again
+    isConnected = false;
     
     if (reCreate)
     {
@@ -556,9 +705,115 @@ SocketError Socket::SetIsBroadcastable(bool _isBroadcastable)
     return SocketError::SOCKET_E_SUCCESS;
 }
 
+SocketError Socket::SetReceiveTimeout(size_t milliseconds)
+{
+#ifdef _WIN32
+    DWORD timeout = (DWORD)milliseconds;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = (long)(milliseconds / 1000);
+    timeout.tv_usec = (long)((milliseconds % 1000) * 1000);
+#endif
+
+    int res = setsockopt((SOCKET)sfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    if (res < 0)
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
+SocketError Socket::SetNoDelay(bool noDelay)
+{
+    int value = noDelay ? 1 : 0;
+
+    int res = setsockopt((SOCKET)sfd, IPPROTO_TCP, TCP_NODELAY, (const char*)&value, sizeof(value));
+    if (res < 0)
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
+SocketError Socket::SetKeepAlive(bool enable, int idleSeconds, int intervalSeconds, int count)
+{
+    int value = enable ? 1 : 0;
+
+    int res = setsockopt((SOCKET)sfd, SOL_SOCKET, SO_KEEPALIVE, (const char*)&value, sizeof(value));
+    if (res < 0)
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    if (enable == false)
+        return SocketError::SOCKET_E_SUCCESS;
+
+#if defined(_WIN32) && !defined(TCP_KEEPCNT)
+    tcp_keepalive values;
+    values.onoff = 1;
+    values.keepalivetime = (ULONG)idleSeconds * 1000;
+    values.keepaliveinterval = (ULONG)intervalSeconds * 1000;
+
+    DWORD returned = 0;
+    res = WSAIoctl((SOCKET)sfd, SIO_KEEPALIVE_VALS, &values, sizeof(values), NULL, 0, &returned, NULL, NULL);
+#else
+#ifdef __APPLE__
+    int idleOption = TCP_KEEPALIVE;
+#else
+    int idleOption = TCP_KEEPIDLE;
+#endif
+    res = setsockopt((SOCKET)sfd, IPPROTO_TCP, idleOption, (const char*)&idleSeconds, sizeof(idleSeconds));
+    if (res >= 0)
+        res = setsockopt((SOCKET)sfd, IPPROTO_TCP, TCP_KEEPINTVL, (const char*)&intervalSeconds, sizeof(intervalSeconds));
+    if (res >= 0)
+        res = setsockopt((SOCKET)sfd, IPPROTO_TCP, TCP_KEEPCNT, (const char*)&count, sizeof(count));
+#endif
+
+    if (res < 0)
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
+SocketError Socket::SetUserTimeout(size_t milliseconds)
+{
+    int res = 0;
+
+#if defined(TCP_USER_TIMEOUT)
+    unsigned int value = (unsigned int)milliseconds;
+    res = setsockopt((SOCKET)sfd, IPPROTO_TCP, TCP_USER_TIMEOUT, (const char*)&value, sizeof(value));
+#elif defined(_WIN32) && defined(TCP_MAXRT)
+    // -1 would mean never give up, 0 is the default
+    int value = (int)((milliseconds + 999) / 1000);
+    res = setsockopt((SOCKET)sfd, IPPROTO_TCP, TCP_MAXRT, (const char*)&value, sizeof(value));
+#elif defined(TCP_RXT_CONNDROPTIME)
+    int value = (int)((milliseconds + 999) / 1000);
+    res = setsockopt((SOCKET)sfd, IPPROTO_TCP, TCP_RXT_CONNDROPTIME, (const char*)&value, sizeof(value));
+#else
+    return SocketError::SOCKET_E_NOT_IMPLEMENTED;
+#endif
+
+    if (res < 0)
+    {
+        lastOSErr = OSGetLastError();
+        return SOCK_ERR(lastOSErr);
+    }
+
+    return SocketError::SOCKET_E_SUCCESS;
+}
+
 SocketError Socket::Disconnect(SocketDisconectType sdt)
 {
-    if(isConnected == false)
+    // shutting down a listening socket wakes a thread blocked in Accept
+    if(isConnected == false && isListening == false)
         return SocketError::SOCKET_E_NOT_CONNECTED;
 
     int dt;
@@ -636,6 +891,16 @@ SocketError Socket::Bind()
         }
     }
 
+#ifndef _WIN32
+    // a restarted listener would otherwise fail while its old connections sit in TIME_WAIT,
+    // on windows the same option lets another process take the port so it is left off there
+    if (protocol == SocketProtocol::SOCKET_P_TCP)
+    {
+        int reuse = 1;
+        setsockopt((SOCKET)sfd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    }
+#endif
+
     iresult = bind((SOCKET)sfd, (sockaddr*)&addr_in, sizeof(addr_in));
     if(iresult == SOCKET_ERROR)
     {
@@ -61,6 +61,8 @@ private:
     SocketError Accept(NativeSocketHandle* acceptedSocket);
     /* User internally with timeout NOT FULLY IMPLEMENTED*/
     SocketError Accept(NativeSocketHandle* acceptedSocket, size_t timeout);
+    /* Used internally by ConnectWithTimeout */
+    SocketError SetIsBlocking(bool isBlocking);
 
 public:
     int lastOSErr; // The last error returned by the OS that was not succesful
@@ -77,6 +79,9 @@ public:
     SocketError Connect(int port);
     // can be used to change address / port to connect to w/o creating a new socket
     SocketError Connect(const std::string& address, int port = -1);
+    // like Connect but gives up with SOCKET_E_TIMEOUT after {milliseconds} instead of waiting for the OS,
+    // which takes 20s or more for a host that doesn't answer. Close(true) the socket after a failure
+    SocketError ConnectWithTimeout(size_t milliseconds);
     // similiar to posix send tp but uses originally passed in address and port for destination
     SocketError SendTo(const void* bytes, size_t length);
     // similiar to posix sendto. Useful for udp sockets
@@ -93,6 +98,9 @@ public:
     SocketError RecvFrom(std::string address, int port, char* buff, size_t buffLength, size_t* receivedLength);
     // Receive From Socket similiar to posix recvfrom, uses {this->address} and {this->port} as address to receive from
     SocketError RecvFrom(char* buff, size_t buffLength, size_t* receivedLength);
+    // waits up to {milliseconds} for something to Recv, SOCKET_E_TIMEOUT if nothing came.
+    // Unlike a receive timeout running out, the connection can still be used after it
+    SocketError WaitForData(size_t milliseconds);
     // binds to a port using {this->port} as the port to bind to
     SocketError Bind();
     // can be used to change port to bind to w/o creating a new socket
@@ -127,6 +135,18 @@ public:
 
     // sets the stats of this socket to be able to multicast if true or disables them if false
     SocketError SetIsBroadcastable(bool);
+    // makes Recv fail instead of blocking once {milliseconds} pass without data, 0 waits forever
+    // lasts until the socket is closed
+    SocketError SetReceiveTimeout(size_t milliseconds);
+    // disables Nagle's algorithm on tcp sockets so small writes go out immediately
+    SocketError SetNoDelay(bool noDelay);
+    // turns tcp keepalive on or off, once the connection has been idle for {idleSeconds} a probe is sent
+    // every {intervalSeconds} and the connection is dropped after {count} go unanswered
+    // (Windows SDKs without TCP_KEEPCNT always send 10)
+    SocketError SetKeepAlive(bool enable, int idleSeconds = 1, int intervalSeconds = 1, int count = 3);
+    // drops the connection once sent data has gone unacknowledged for {milliseconds}, 0 is the OS default.
+    // Windows and macOS round up to whole seconds
+    SocketError SetUserTimeout(size_t milliseconds);
 
     // Getters
 
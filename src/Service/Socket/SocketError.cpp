@@ -5,6 +5,7 @@
 #else
 #include <sys/socket.h>
 #include <errno.h>
+#include <string.h>
 #endif
 
 #include "Socket.h"
@@ -34,6 +35,9 @@
 #ifndef WSAESHUTDOWN
 #define WSAESHUTDOWN ESHUTDOWN
 #endif
+#ifndef WSAETIMEDOUT
+#define WSAETIMEDOUT ETIMEDOUT
+#endif
 
 int OSGetLastError()
 {
@@ -82,6 +86,8 @@ const std::string SockErrorToString(SocketError err)
             return "Error Not Implemented";
         case SocketError::SOCKET_E_INVALID_PACKET:
             return "Error Invalid Packet Received";
+        case SocketError::SOCKET_E_TIMEOUT:
+            return "Error Timed Out";
         case SocketError::SOCKET_E_UNKOWN:
             return "Unkown Error";
 
@@ -115,6 +121,15 @@ SocketError OSErrorToSocketError(int os_err)
         return SocketError::SOCKET_E_CONN_REFUSED;
     case WSAENOTCONN:
         return SocketError::SOCKET_E_NOT_CONNECTED;
+    case WSAETIMEDOUT:
+#ifndef _WIN32
+    // a receive timeout
+    case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:
+#endif
+#endif
+        return SocketError::SOCKET_E_TIMEOUT;
     case WSAESHUTDOWN:
 #ifdef _WIN32
     case WSANOTINITIALISED:
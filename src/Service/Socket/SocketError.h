@@ -24,6 +24,7 @@ enum class SocketError
     SOCKET_E_OS_ERROR,
     SOCKET_E_NOT_IMPLEMENTED,
     SOCKET_E_INVALID_PACKET,
+    SOCKET_E_TIMEOUT,
     SOCKET_E_UNKOWN
 };
 
@@ -0,0 +1,429 @@
+/*
+*	cc_bench measures the hot paths of the service and prints the results as JSON so runs can be
+*	compared release to release
+*
+*	usage: cc_bench [--filter <text>] [--out <file>] [--min-time <ms>]
+*	--filter	only runs benchmarks whose name contains <text>
+*	--out		writes the JSON to <file> instead of stdout
+*	--min-time	time spent measuring each benchmark, split across the samples (default 250)
+*
+*	Every benchmark is calibrated until one sample takes long enough to time, then run for a fixed
+*	number of samples. nsPerOp is the median sample, nsPerOpMin the fastest.
+*/
+
+#include "../CC/CCLogger.h"
+#include "../CC/CCStructuredLog.h"
+#include "../CC/CCMain.h"
+#include "../CC/CCNetworkEntity.h"
+#include "../CC/CCDisplay.h"
+#include "../CC/CCConfigurationManager.h"
+#include "../CC/CCConfigPath.h"
+#include "../OSInterface/PacketTypes.h"
+#include "../OSInterface/OSTypes.h"
+
+#include <args.hxx>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#define CC_BENCH_SAMPLES 7
+#define CC_BENCH_SCHEMA 1
+
+using nlohmann::json;
+typedef std::chrono::steady_clock BenchClock;
+
+// keeps results alive so the measured work isn't optimized away
+static volatile int64_t benchSink = 0;
+
+template<typename t>
+inline void Consume(const t& value)
+{
+	benchSink = benchSink + (int64_t)value;
+}
+
+// swallows the logger's output while the logger benchmarks run
+class NullBuffer : public std::streambuf
+{
+protected:
+	virtual int_type overflow(int_type ch)override { return ch; }
+	virtual std::streamsize xsputn(const char* s, std::streamsize count)override { return count; }
+};
+
+class CCBench
+{
+private:
+	std::string						_filter;
+	std::chrono::nanoseconds		_minTime;
+	json							_results;
+
+	template<typename Body>
+	static std::chrono::nanoseconds Time(Body& body, uint64_t iterations)
+	{
+		auto start = BenchClock::now();
+		body(iterations);
+		return BenchClock::now() - start;
+	}
+
+public:
+	CCBench(const std::string& filter, std::chrono::milliseconds minTime) : _filter(filter), _minTime(minTime), \
+		_results(json::array())
+	{
+	}
+
+	inline bool ShouldRun(const std::string& name)const
+	{
+		return _filter.empty() || name.find(_filter) != std::string::npos;
+	}
+
+	// {body} runs the measured operation {iterations} times
+	template<typename Body>
+	void Run(const std::string& name, const json& params, Body body)
+	{
+		if (ShouldRun(name) == false)
+			return;
+
+		std::cerr << "running " << name << " " << params.dump() << std::endl;
+
+		std::chrono::nanoseconds sampleTime = _minTime / CC_BENCH_SAMPLES;
+
+		// grow until a run is long enough to time, then scale to the sample time
+		uint64_t iterations = 1;
+		std::chrono::nanoseconds elapsed = Time(body, iterations);
+		while (elapsed < sampleTime / 10 && iterations < ((uint64_t)1 << 40))
+		{
+			iterations *= 2;
+			elapsed = Time(body, iterations);
+		}
+
+		if (elapsed.count() > 0 && elapsed < sampleTime)
+			iterations = std::max<uint64_t>(1, (uint64_t)((double)iterations * sampleTime.count() / elapsed.count()));
+
+		std::vector<double> samples;
+		for (int i = 0; i < CC_BENCH_SAMPLES; i++)
+		{
+			samples.push_back((double)Time(body, iterations).count() / iterations);
+		}
+		std::sort(samples.begin(), samples.end());
+
+		json result;
+		result["name"] = name;
+		result["params"] = params;
+		result["iterations"] = iterations;
+		result["samples"] = CC_BENCH_SAMPLES;
+		result["nsPerOp"] = samples[samples.size() / 2];
+		result["nsPerOpMin"] = samples.front();
+		result["opsPerSecond"] = samples[samples.size() / 2] > 0 ? 1e9 / samples[samples.size() / 2] : 0;
+
+		_results.push_back(std::move(result));
+	}
+
+	json GetReport()const
+	{
+		json report;
+		report["schema"] = CC_BENCH_SCHEMA;
+		report["timestamp"] = (int64_t)std::time(0);
+#if defined(_WIN32)
+		report["platform"] = "Windows";
+#elif defined(__APPLE__)
+		report["platform"] = "MacOS";
+#else
+		report["platform"] = "Linux";
+#endif
+#ifdef NDEBUG
+		report["build"] = "release";
+#else
+		report["build"] = "debug";
+#endif
+		report["benchmarks"] = _results;
+
+		return report;
+	}
+};
+
+// Fixtures
+
+// {count} remote entities without sockets, one 1920x1080 display each, laid out in a square grid
+std::vector<std::shared_ptr<CCNetworkEntity>> MakeEntityGrid(int count)
+{
+	std::vector<std::shared_ptr<CCNetworkEntity>> entities;
+
+	int columns = 1;
+	while (columns * columns < count)
+	{
+		columns++;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		NativeDisplay display;
+		display.nativeScreenID = 0;
+		display.posX = 0;
+		display.posY = 0;
+		display.width = 1920;
+		display.height = 1080;
+
+		auto entity = std::make_shared<CCNetworkEntity>("Entity-" + std::to_string(i), (Socket*)0);
+		entity->AddDisplay(std::make_shared<CCDisplay>(display));
+		entity->SetDisplayOffsets(Point((i % columns) * 1920, (i / columns) * 1080));
+
+		entities.push_back(entity);
+	}
+
+	return entities;
+}
+
+std::vector<OSEvent> MakeEvents()
+{
+	std::vector<OSEvent> events;
+
+	for (int i = 0; i < 64; i++)
+	{
+		OSEvent event;
+		event.nativeScreenID = i % 3;
+
+		switch (i % 4)
+		{
+		case 0:
+		case 1:
+			event.eventType = OS_EVENT_MOUSE;
+			event.mouseEvent = MOUSE_EVENT_MOVE;
+			event.x = i * 17;
+			event.y = i * 9;
+			event.deltaX = i % 5 - 2;
+			event.deltaY = i % 7 - 3;
+			break;
+		case 2:
+			event.eventType = OS_EVENT_KEY;
+			event.keyEvent = i % 8 < 4 ? KEY_EVENT_DOWN : KEY_EVENT_UP;
+			event.scanCode = 4 + i;
+			break;
+		case 3:
+			event.eventType = OS_EVENT_MOUSE;
+			event.mouseEvent = i % 8 < 4 ? MOUSE_EVENT_DOWN : MOUSE_EVENT_UP;
+			event.mouseButton = MOUSE_BUTTON_LEFT;
+			break;
+		}
+
+		events.push_back(event);
+	}
+
+	return events;
+}
+
+// Benchmarks
+
+void BenchPackets(CCBench& bench)
+{
+	std::vector<OSEvent> events = MakeEvents();
+	std::vector<OSInputEventPacket> packets;
+	for (auto& event : events)
+	{
+		packets.push_back(OSInputEventPacket(event));
+	}
+
+	bench.Run("packet/encode", json::object(), [&events](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			OSInputEventPacket packet(events[i & 63]);
+			Consume(packet.data1 ^ packet.data2 ^ packet.data3);
+		}
+	});
+
+	bench.Run("packet/decode", json::object(), [&packets](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			OSEvent event = packets[i & 63].AsOSEvent();
+			Consume(event.x ^ event.scanCode ^ event.deltaY);
+		}
+	});
+}
+
+void BenchEntities(CCBench& bench)
+{
+	for (int count : { 10, 100, 1000 })
+	{
+		json params = { { "entities", count } };
+
+		auto entities = MakeEntityGrid(count);
+
+		bench.Run("entity/setup_connections", params, [&entities](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				CCMain::SetupEntityConnections(entities);
+			}
+		});
+
+		// points just inside the right edge of each entity, most of them jump to a neighbour
+		bench.Run("entity/jump_zone", params, [&entities](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				const CCNetworkEntity* entity = entities[i % entities.size()].get();
+				Point point(entity->GetBounds().bottomRight.x - 1, (entity->GetBounds().topLeft.y + entity->GetBounds().bottomRight.y) / 2);
+
+				CCNetworkEntity* jumpEntity = 0;
+				JumpDirection direction;
+				Consume(entity->GetEntityForPointInJumpZone(point, &jumpEntity, direction));
+			}
+		});
+	}
+
+	for (int count : { 1, 4, 8 })
+	{
+		json params = { { "displays", count } };
+
+		auto entity = std::make_shared<CCNetworkEntity>("Entity", (Socket*)0);
+		for (int i = 0; i < count; i++)
+		{
+			NativeDisplay display;
+			display.nativeScreenID = i;
+			display.posX = i * 1920;
+			display.posY = 0;
+			display.width = 1920;
+			display.height = 1080;
+
+			entity->AddDisplay(std::make_shared<CCDisplay>(display));
+		}
+		entity->SetDisplayOffsets(Point(0, 0));
+
+		// the last display is the worst case for the linear search
+		bench.Run("entity/display_for_point", params, [&entity, count](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				Point point((count - 1) * 1920 + (int)(i % 1920), (int)(i % 1080));
+				Consume(entity->DisplayForPoint(point).get() != 0);
+			}
+		});
+	}
+}
+
+void BenchConfig(CCBench& bench)
+{
+	for (int count : { 10, 1000 })
+	{
+		json params = { { "entities", count } };
+
+		CCConfigurationManager manager;
+		std::vector<CCConfigPath> paths;
+
+		for (int i = 0; i < count; i++)
+		{
+			paths.push_back(CCConfigPath({ "Entities", "Entity-" + std::to_string(i), "x" }));
+			manager.SetValue(paths.back(), i);
+		}
+
+		bench.Run("config/get", params, [&manager, &paths](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				int value = 0;
+				manager.GetValue(paths[i % paths.size()], value);
+				Consume(value);
+			}
+		});
+
+		bench.Run("config/set", params, [&manager, &paths](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				Consume(manager.SetValue(paths[i % paths.size()], (int)i));
+			}
+		});
+	}
+}
+
+void BenchLogger(CCBench& bench)
+{
+	if (bench.ShouldRun("logger/") == false)
+		return;
+
+	// the logger writes to std::cout, keep it out of the report
+	NullBuffer nullBuffer;
+	std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+	CCLogger::logger.SetLogLevel(LogLevel::Info);
+
+	// flushed in batches smaller than a ring so nothing is dropped and the logger thread's
+	// work is included in the time
+	const uint64_t batch = CC_LOG_RING_SIZE / 2;
+
+	bench.Run("logger/text", json::object(), [batch](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			LOG_INFO << "Bench record " << i << " of " << iterations << std::endl;
+			if (i % batch == batch - 1)
+				CCLogger::logger.Flush();
+		}
+		CCLogger::logger.Flush();
+	});
+
+	bench.Run("logger/structured", json::object(), [batch](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			LOG_SITE(ReceivedTCPPacket, (int)i);
+			if (i % batch == batch - 1)
+				CCLogger::logger.Flush();
+		}
+		CCLogger::logger.Flush();
+	});
+
+	CCLogger::logger.SetLogLevel(LogLevel::Error);
+	std::cout.rdbuf(coutBuffer);
+}
+
+int main(int argc, char* argv[])
+{
+	args::ArgumentParser parser("cc_bench, microbenchmarks for the CommunistCursor service");
+	args::HelpFlag help(parser, "help", "Display this help menu", { 'h', "help" });
+	args::ValueFlag<std::string> filter(parser, "filter", "only run benchmarks whose name contains this", { "filter" });
+	args::ValueFlag<std::string> out(parser, "out", "write the JSON report to this file instead of stdout", { "out" });
+	args::ValueFlag<int> minTime(parser, "minTime", "milliseconds spent measuring each benchmark", { "min-time" });
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (args::Help)
+	{
+		std::cerr << parser;
+		return 0;
+	}
+	catch (args::Error e)
+	{
+		std::cerr << e.what() << std::endl << parser;
+		return 1;
+	}
+
+	// only errors from the code under test, the report owns stdout
+	CCLogger::logger.SetLogLevel(LogLevel::Error);
+
+	CCBench bench(filter ? args::get(filter) : "", std::chrono::milliseconds(minTime ? args::get(minTime) : 250));
+
+	BenchPackets(bench);
+	BenchEntities(bench);
+	BenchConfig(bench);
+	BenchLogger(bench);
+
+	std::string report = bench.GetReport().dump(4);
+
+	if (out)
+	{
+		std::ofstream file(args::get(out));
+		if (file.good() == false)
+		{
+			std::cerr << "Could not open " << args::get(out) << std::endl;
+			return 1;
+		}
+		file << report << std::endl;
+	}
+	else
+	{
+		std::cout << report << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,216 @@
+/*
+*	CCLogDecode renders a binary log written with --binary-log back into text
+*
+*	usage: CCLogDecode <file> [--raw]
+*	--raw prints the site name and argument values instead of the rendered text
+*/
+
+#include "../CC/CCStructuredLog.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+struct BinaryLogSite
+{
+	LogLevel	level;
+	std::string	format;
+};
+
+class BinaryLogReader
+{
+private:
+	std::vector<char>	_data;
+	size_t				_offset;
+
+public:
+	BinaryLogReader() : _offset(0) {}
+
+	bool Load(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (file.good() == false)
+			return false;
+
+		_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	inline bool GetIsAtEnd()const { return _offset >= _data.size(); }
+
+	bool ReadLE(uint64_t& value, int bytes)
+	{
+		if (_offset + bytes > _data.size())
+			return false;
+
+		value = 0;
+		for (int i = 0; i < bytes; i++)
+		{
+			value |= (uint64_t)(unsigned char)_data[_offset++] << (i * 8);
+		}
+
+		return true;
+	}
+
+	bool ReadVarint(uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64 && _offset < _data.size(); shift += 7)
+		{
+			unsigned char byte = (unsigned char)_data[_offset++];
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	bool ReadSigned(int64_t& value)
+	{
+		uint64_t raw = 0;
+		if (ReadVarint(raw) == false)
+			return false;
+
+		value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+		return true;
+	}
+
+	bool ReadString(std::string& value, size_t length)
+	{
+		if (_offset + length > _data.size())
+			return false;
+
+		value.assign(&_data[_offset], length);
+		_offset += length;
+		return true;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: CCLogDecode <file> [--raw]" << std::endl;
+		return 1;
+	}
+
+	bool raw = argc > 2 && std::string(argv[2]) == "--raw";
+
+	BinaryLogReader reader;
+	if (reader.Load(argv[1]) == false)
+	{
+		std::cerr << "Could not open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::string magic;
+	uint64_t version = 0, siteCount = 0, steadyStart = 0, wallStart = 0;
+
+	if (!reader.ReadString(magic, 4) || magic != CC_BLOG_MAGIC || !reader.ReadLE(version, 2) || version != CC_BLOG_VERSION)
+	{
+		std::cerr << argv[1] << " is not a CC binary log or has an unsupported version" << std::endl;
+		return 1;
+	}
+
+	if (!reader.ReadLE(siteCount, 2) || !reader.ReadLE(steadyStart, 8) || !reader.ReadLE(wallStart, 8))
+	{
+		std::cerr << "Truncated header" << std::endl;
+		return 1;
+	}
+
+	// formats come from the file so logs from older builds still decode
+	std::map<uint64_t, BinaryLogSite> sites;
+	for (uint64_t i = 0; i < siteCount; i++)
+	{
+		uint64_t id = 0, level = 0, length = 0;
+		BinaryLogSite site;
+
+		if (!reader.ReadLE(id, 2) || !reader.ReadLE(level, 4) || !reader.ReadLE(length, 2) || !reader.ReadString(site.format, (size_t)length))
+		{
+			std::cerr << "Truncated site table" << std::endl;
+			return 1;
+		}
+
+		site.level = (LogLevel)level;
+		sites[id] = site;
+	}
+
+	std::map<uint32_t, std::string> strings;
+	auto lookupString = [&strings](uint32_t id) {
+		auto itr = strings.find(id);
+		return itr != strings.end() ? itr->second : "<unknown " + std::to_string(id) + ">";
+	};
+
+	uint64_t timestamp = steadyStart;
+	int64_t args[CC_LOG_MAX_ARGS];
+
+	while (reader.GetIsAtEnd() == false)
+	{
+		uint64_t tag = 0;
+		reader.ReadLE(tag, 1);
+
+		if (tag == CC_BLOG_STRING)
+		{
+			uint64_t id = 0, length = 0;
+			std::string value;
+			if (!reader.ReadLE(id, 4) || !reader.ReadLE(length, 2) || !reader.ReadString(value, (size_t)length))
+				break;
+
+			strings[(uint32_t)id] = value;
+		}
+		else if (tag == CC_BLOG_RECORD)
+		{
+			uint64_t siteID = 0, argCount = 0;
+			int64_t delta = 0;
+			if (!reader.ReadLE(siteID, 2) || !reader.ReadLE(argCount, 1) || !reader.ReadSigned(delta) || argCount > CC_LOG_MAX_ARGS)
+				break;
+
+			bool complete = true;
+			for (uint64_t i = 0; i < argCount && complete; i++)
+			{
+				complete = reader.ReadSigned(args[i]);
+			}
+
+			if (complete == false)
+				break;
+
+			timestamp += delta;
+
+			// microseconds since the unix epoch
+			uint64_t wallTime = wallStart + (timestamp - steadyStart) / 1000;
+			std::string line = std::to_string(wallTime / 1000000) + "." + std::to_string(1000000 + wallTime % 1000000).substr(1) + " ";
+
+			auto site = sites.find(siteID);
+			if (site == sites.end())
+			{
+				line += "<unknown site " + std::to_string(siteID) + ">";
+			}
+			else if (raw)
+			{
+				const CCLogSiteInfo* info = CCLogSiteInfoFor((uint16_t)siteID);
+				line += info ? info->name : std::to_string(siteID);
+				for (uint64_t i = 0; i < argCount; i++)
+				{
+					line += " " + std::to_string(args[i]);
+				}
+			}
+			else
+			{
+				CCLogRenderSite(site->second.format.c_str(), args, (size_t)argCount, lookupString, line);
+			}
+
+			std::cout << line << "\n";
+		}
+		else
+		{
+			std::cerr << "Unknown entry tag " << tag << ", stopping" << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
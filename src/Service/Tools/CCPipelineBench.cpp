@@ -0,0 +1,519 @@
+/*
+*	cc_pipeline runs a CCMain server and several CCMain clients in one process on the simulated OS
+*	backend and measures the whole capture, route, send, receive and inject path over the loopback.
+*	It is only built with -DCC_SIMULATED_OS=ON.
+*
+*	usage: cc_pipeline [--clients <n>] [--events <n>] [--rate <n>] [--out <file>] [--trace <file>]
+*	--clients	number of clients, client i listens on 127.0.0.(i + 1) (default 2)
+*	--events	key events streamed to each client (default 2000)
+*	--rate		key events a second, 0 is as fast as the pipeline allows (default 0)
+*	--out		writes the JSON to <file> instead of stdout
+*	--trace		traces the run and writes it to <file> as a Chrome trace (see CC/CCTrace.h)
+*
+*	The entities are laid out in a row with the server on the left. Mouse moves walk the cursor
+*	through every jump zone and each time it lands on a client a stream of key events is sent to
+*	it. Every key is pressed and released again, like typing, both carry the key's sequence number
+*	as their scan code so their injection on the client can be matched to their capture on the
+*	server. A key that was never released would keep repeating on the client (see CC/CCKeyRepeater.h). routed is how many of them the server sent
+*	to the phase's client, anything else went to the wrong entity.
+*
+*	Every 127.0.0.x address must reach the loopback, which is the default on Linux.
+*/
+
+#include "../CC/CCLogger.h"
+#include "../CC/CCMain.h"
+#include "../CC/CCNetworkEntity.h"
+#include "../CC/CCTrace.h"
+#include "../CC/IInputRouteObserver.h"
+#include "../OSInterface/KeyCodes.h"
+#include "../OSInterface/OSInterface.h"
+#include "../OSInterface/OSTypes.h"
+#include "../Simulated/SimulatedInterface.h"
+
+#include <args.hxx>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CC_PIPELINE_SCHEMA 1
+
+#define CC_PIPELINE_SERVER_ADDRESS "127.0.0.1"
+#define CC_PIPELINE_SERVER_PORT 6555
+#define CC_PIPELINE_CONFIG "cc_pipeline.json"
+
+#define CC_PIPELINE_DISPLAY_WIDTH 1920
+#define CC_PIPELINE_DISPLAY_HEIGHT 1080
+// divides the display width so the cursor lands exactly on every edge between entities
+#define CC_PIPELINE_MOVE_STEP 160
+
+#define CC_PIPELINE_CONNECT_TIMEOUT_MS 10000
+// injection is done once nothing new arrived for this long
+#define CC_PIPELINE_DRAIN_IDLE_MS 200
+
+#define CC_PIPELINE_PAUSE_SCAN_CODE KEY_CODE_HID_PAUSE // switches back to the server, see CCMain::ReceivedNewInputEvent
+
+using nlohmann::json;
+
+// scan codes go over the network as 16 bits, the pause key is skipped
+int ScanCodeForIndex(uint32_t index)
+{
+	int scanCode = 1 + (int)(index % 65534);
+	if (scanCode >= CC_PIPELINE_PAUSE_SCAN_CODE)
+		scanCode++;
+
+	return scanCode;
+}
+
+double Percentile(const std::vector<uint64_t>& sorted, double percentile)
+{
+	if (sorted.empty())
+		return 0;
+
+	size_t index = (size_t)(percentile * (sorted.size() - 1));
+	return sorted[index] / 1000.0;
+}
+
+// waits until the clients stop injecting and returns what they injected
+std::vector<SimulatedEventRecord> DrainInjected()
+{
+	size_t count = SimulatedGetInjectedCount();
+
+	while (true)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(CC_PIPELINE_DRAIN_IDLE_MS));
+
+		size_t newCount = SimulatedGetInjectedCount();
+		if (newCount == count)
+			break;
+
+		count = newCount;
+	}
+
+	std::vector<SimulatedEventRecord> injected;
+	SimulatedTakeInjectedEvents(injected);
+
+	return injected;
+}
+
+// counts the events the server sent to each entity
+class PipelineRouteCounter : public IInputRouteObserver
+{
+private:
+	std::mutex						_mutex;
+	std::map<std::string, uint64_t>	_sent;
+
+public:
+	virtual void EventRouted(const OSEvent& event, const CCNetworkEntity* target, InputRoute route)override
+	{
+		if (route != InputRoute::REMOTE)
+			return;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_sent[target->GetID()]++;
+	}
+
+	virtual void EntityJumped(const CCNetworkEntity* from, const CCNetworkEntity* to)override
+	{
+	}
+
+	uint64_t GetSent(const std::string& entityID)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _sent[entityID];
+	}
+};
+
+class CCPipelineBench
+{
+private:
+	int											_clientCount;
+	uint32_t									_eventsPerClient;
+	int											_rate;
+
+	std::unique_ptr<CCMain>						_server;
+	std::vector<std::unique_ptr<CCMain>>		_clients;
+	std::vector<std::thread>					_threads;
+	std::atomic<bool>							_serverFailed;
+	PipelineRouteCounter						_routes;
+
+	int											_cursorX; // where the server believes the cursor is
+
+	bool WriteLayout()const;
+	// moves the cursor right until it is on the next entity and clear of its jump zone
+	void WalkToNextEntity();
+	// streams to the entity the cursor is on, the totals are added to {allLatencies}, {totalSent} and {totalElapsedNs}
+	json StreamKeys(const std::string& entityID, std::vector<uint64_t>& allLatencies, uint64_t& totalSent, uint64_t& totalElapsedNs);
+
+	static json Summarize(uint64_t sent, std::vector<uint64_t>& latencies, uint64_t elapsedNs);
+
+public:
+	CCPipelineBench(int clientCount, uint32_t eventsPerClient, int rate);
+
+	bool Start(json& report);
+	void Run(json& report);
+	void Stop();
+};
+
+CCPipelineBench::CCPipelineBench(int clientCount, uint32_t eventsPerClient, int rate) : _clientCount(clientCount), \
+	_eventsPerClient(eventsPerClient), _rate(rate), _serverFailed(false), _cursorX(CC_PIPELINE_DISPLAY_WIDTH / 2)
+{
+}
+
+bool CCPipelineBench::WriteLayout()const
+{
+	json layout;
+	layout["Entities"]["server"] = { {"x", 0}, {"y", 0} };
+
+	for (int i = 1; i <= _clientCount; i++)
+	{
+		layout["Entities"]["client-" + std::to_string(i)] = { {"x", CC_PIPELINE_DISPLAY_WIDTH * i}, {"y", 0} };
+	}
+
+	std::ofstream file(CC_PIPELINE_CONFIG);
+	if (file.good() == false)
+		return false;
+
+	file << layout.dump(4);
+	return file.good();
+}
+
+bool CCPipelineBench::Start(json& report)
+{
+	NativeDisplay display;
+	display.nativeScreenID = 0;
+	display.posX = 0;
+	display.posY = 0;
+	display.width = CC_PIPELINE_DISPLAY_WIDTH;
+	display.height = CC_PIPELINE_DISPLAY_HEIGHT;
+
+	SimulatedSetDisplays({ display });
+
+	if (WriteLayout() == false)
+	{
+		std::cerr << "Could not write " << CC_PIPELINE_CONFIG << std::endl;
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	_server = std::make_unique<CCMain>("server", CC_PIPELINE_SERVER_ADDRESS);
+	_server->LoadAll(CC_PIPELINE_CONFIG);
+	_server->SetRouteObserver(&_routes);
+
+	// the service doesn't hook input yet, the bench stands in for the hook
+	OSInterface::SharedInterface().RegisterForOSEvents(_server.get());
+
+	_threads.push_back(std::thread([this]() {
+		try
+		{
+			_server->StartServerMain();
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << "Server failed: " << e.what() << std::endl;
+			_serverFailed = true;
+		}
+	}));
+
+	auto deadline = start + std::chrono::milliseconds(CC_PIPELINE_CONNECT_TIMEOUT_MS);
+
+	// one at a time, the server drops connections past a few pending handshakes and a dropped
+	// client doesn't notice
+	for (int i = 1; i <= _clientCount; i++)
+	{
+		std::string address = "127.0.0." + std::to_string(i + 1);
+		_clients.push_back(std::make_unique<CCMain>("client-" + std::to_string(i), address));
+
+		CCMain* client = _clients.back().get();
+		_threads.push_back(std::thread([client]() {
+			client->StartClientMain(CC_PIPELINE_SERVER_ADDRESS, CC_PIPELINE_SERVER_PORT);
+		}));
+
+		while (_server->GetEntityCount() < (size_t)i + 1)
+		{
+			if (_serverFailed || std::chrono::steady_clock::now() > deadline)
+			{
+				std::cerr << "Only " << _server->GetEntityCount() - 1 << " of " << _clientCount << " clients connected" << std::endl;
+				return false;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	report["connectMs"] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+void CCPipelineBench::WalkToNextEntity()
+{
+	int edge = (_cursorX / CC_PIPELINE_DISPLAY_WIDTH + 1) * CC_PIPELINE_DISPLAY_WIDTH;
+
+	// one move onto the edge to jump, one more so the cursor isn't left in the new entity's jump zone.
+	// The server captures the mouse when it leaves (see CCMain::UpdateMouseCapture), none are dropped
+	uint32_t moves = (edge - _cursorX) / CC_PIPELINE_MOVE_STEP + 1;
+	_cursorX += moves * CC_PIPELINE_MOVE_STEP;
+
+	int x = 0;
+	int y = 0;
+	OSInterface::SharedInterface().GetMousePosition(x, y);
+
+	SimulatedGenerateEvents([x, y](uint32_t index) {
+		OSEvent event;
+		event.eventType = OS_EVENT_MOUSE;
+		event.mouseEvent = MOUSE_EVENT_MOVE;
+		event.deltaX = CC_PIPELINE_MOVE_STEP;
+		// the local cursor stays frozen while a client has control
+		event.x = x;
+		event.y = y;
+
+		return event;
+	}, moves, 0, NULL);
+
+	// the moves themselves aren't measured
+	DrainInjected();
+}
+
+json CCPipelineBench::StreamKeys(const std::string& entityID, std::vector<uint64_t>& allLatencies, uint64_t& totalSent, uint64_t& totalElapsedNs)
+{
+	std::vector<SimulatedEventRecord> delivered;
+	delivered.reserve(_eventsPerClient);
+
+	// every client injects into the same simulated backend, only the server knows where an event went
+	uint64_t routedBefore = _routes.GetSent(entityID);
+
+	SimulatedGenerateEvents([](uint32_t index) {
+		OSEvent event;
+		event.eventType = OS_EVENT_KEY;
+		event.keyEvent = index % 2 == 0 ? KEY_EVENT_DOWN : KEY_EVENT_UP;
+		event.scanCode = ScanCodeForIndex(index / 2);
+
+		return event;
+	}, _eventsPerClient, _rate, &delivered);
+
+	std::vector<SimulatedEventRecord> injected = DrainInjected();
+
+	// keyed by scan code and down or up
+	std::map<int, uint64_t> captured;
+	for (auto& record : delivered)
+	{
+		captured[record.event.scanCode * 2 + record.event.keyEvent] = record.timestamp;
+	}
+
+	std::vector<uint64_t> latencies;
+	uint64_t lastInjected = 0;
+
+	for (auto& record : injected)
+	{
+		if (record.event.eventType != OS_EVENT_KEY)
+			continue;
+
+		auto itr = captured.find(record.event.scanCode * 2 + record.event.keyEvent);
+		if (itr == captured.end())
+			continue;
+
+		latencies.push_back(record.timestamp - itr->second);
+		lastInjected = std::max(lastInjected, record.timestamp);
+		captured.erase(itr);
+	}
+
+	allLatencies.insert(allLatencies.end(), latencies.begin(), latencies.end());
+	totalSent += delivered.size();
+
+	uint64_t firstCaptured = delivered.empty() ? 0 : delivered.front().timestamp;
+	uint64_t elapsedNs = lastInjected > firstCaptured ? lastInjected - firstCaptured : 0;
+	totalElapsedNs += elapsedNs;
+
+	json phase = Summarize(delivered.size(), latencies, elapsedNs);
+	phase["entity"] = entityID;
+	phase["routed"] = _routes.GetSent(entityID) - routedBefore;
+
+	if (phase["routed"] != delivered.size())
+		std::cerr << "only " << phase["routed"] << " of " << delivered.size() << " events were sent to " << entityID << std::endl;
+
+	return phase;
+}
+
+json CCPipelineBench::Summarize(uint64_t sent, std::vector<uint64_t>& latencies, uint64_t elapsedNs)
+{
+	std::sort(latencies.begin(), latencies.end());
+
+	json summary;
+	summary["sent"] = sent;
+	summary["injected"] = latencies.size();
+	summary["lost"] = sent - latencies.size();
+	summary["eventsPerSecond"] = elapsedNs ? latencies.size() * 1e9 / elapsedNs : 0;
+	summary["latencyUs"] = {
+		{"p50", Percentile(latencies, 0.5)},
+		{"p99", Percentile(latencies, 0.99)},
+		{"p999", Percentile(latencies, 0.999)},
+		{"max", latencies.empty() ? 0 : latencies.back() / 1000.0}
+	};
+
+	return summary;
+}
+
+void CCPipelineBench::Run(json& report)
+{
+	json phases = json::array();
+	std::vector<uint64_t> allLatencies;
+	uint64_t totalSent = 0;
+	uint64_t totalElapsedNs = 0;
+
+	for (int i = 1; i <= _clientCount; i++)
+	{
+		std::string entityID = "client-" + std::to_string(i);
+		std::cerr << "streaming to " << entityID << std::endl;
+
+		WalkToNextEntity();
+		phases.push_back(StreamKeys(entityID, allLatencies, totalSent, totalElapsedNs));
+	}
+
+	// the walks between streams aren't counted
+	report["phases"] = phases;
+	report["total"] = Summarize(totalSent, allLatencies, totalElapsedNs);
+
+	// the service's own view of the same events, stage by stage
+	json traces = json::object();
+	for (auto& entity : _server->GetEntitiesToConfigure())
+	{
+		if (entity->GetIsLocal() == false)
+			traces[entity->GetID()] = entity->GetLatencyTrace().ToJson(0);
+	}
+
+	report["latencyTrace"] = traces;
+}
+
+void CCPipelineBench::Stop()
+{
+	// the broadcast thread reads locals of StartServerMain so the server is stopped before its main loop
+	if (_server)
+		_server->StopServer();
+
+	OSInterface::SharedInterface().StopMainLoop();
+
+	for (auto& client : _clients)
+	{
+		client->StopClient();
+	}
+
+	for (auto& thread : _threads)
+	{
+		thread.join();
+	}
+
+	// the server goes first, its connections closing is what releases the clients' comm threads
+	_server.reset();
+	_clients.clear();
+
+	remove(CC_PIPELINE_CONFIG);
+}
+
+int main(int argc, char* argv[])
+{
+	args::ArgumentParser parser("cc_pipeline, end to end benchmark of a server and clients on the simulated OS");
+	args::HelpFlag help(parser, "help", "Display this help menu", { 'h', "help" });
+	args::ValueFlag<int> clients(parser, "clients", "number of clients", { "clients" });
+	args::ValueFlag<int> events(parser, "events", "key events streamed to each client", { "events" });
+	args::ValueFlag<int> rate(parser, "rate", "key events a second, 0 is unlimited", { "rate" });
+	args::ValueFlag<std::string> out(parser, "out", "write the JSON report to this file instead of stdout", { "out" });
+	args::ValueFlag<std::string> trace(parser, "trace", "write a Chrome trace of the run to this file", { "trace" });
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (args::Help)
+	{
+		std::cerr << parser;
+		return 0;
+	}
+	catch (args::Error e)
+	{
+		std::cerr << e.what() << std::endl << parser;
+		return 1;
+	}
+
+	int clientCount = clients ? args::get(clients) : 2;
+	int eventCount = events ? args::get(events) : 2000;
+	int eventRate = rate ? args::get(rate) : 0;
+
+	// scan codes have to stay unique within a stream, client addresses within 127.0.0.x
+	if (clientCount < 1 || clientCount > 250 || eventCount < 1 || eventCount > 65534 || eventRate < 0)
+	{
+		std::cerr << "--clients must be 1-250, --events 1-65534 and --rate positive" << std::endl << parser;
+		return 1;
+	}
+
+	// only errors from the code under test, the logger writes to std::cout so they go to stderr
+	// until the report is written
+	std::streambuf* coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+	CCLogger::logger.SetLogLevel(LogLevel::Error);
+
+	json report;
+	report["schema"] = CC_PIPELINE_SCHEMA;
+	report["timestamp"] = (int64_t)std::time(0);
+	report["clients"] = clientCount;
+	report["eventsPerClient"] = eventCount;
+	report["rate"] = eventRate;
+
+	if (trace && CCTracer::tracer.Start() == false)
+		return 1;
+
+	CCPipelineBench bench(clientCount, (uint32_t)eventCount, eventRate);
+
+	bool started = bench.Start(report);
+	if (started)
+		bench.Run(report);
+
+	bench.Stop();
+	CCTracer::tracer.Stop();
+	CCLogger::logger.Flush();
+	std::cout.rdbuf(coutBuffer);
+
+	if (started == false)
+		return 1;
+
+	std::string output = report.dump(4);
+
+	if (out)
+	{
+		std::ofstream file(args::get(out));
+		if (file.good() == false)
+		{
+			std::cerr << "Could not open " << args::get(out) << std::endl;
+			return 1;
+		}
+		file << output << std::endl;
+	}
+	else
+	{
+		std::cout << output << std::endl;
+	}
+
+	if (trace)
+	{
+		std::ofstream file(args::get(trace));
+		if (file.good() == false)
+		{
+			std::cerr << "Could not open " << args::get(trace) << std::endl;
+			return 1;
+		}
+		file << CCTracer::tracer.ToChromeTrace().dump() << std::endl;
+	}
+
+	return 0;
+}
@@ -1,5 +1,6 @@
 #ifdef _WIN32
 #include "../OSInterface/OSInterface.h"
+#include "../OSInterface/KeyCodes.h"
 
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -8,6 +9,7 @@
 #include <WtsApi32.h>
 
 #include <windows.h>
+#include <atomic>
 #include <functional>
 #include <vector>
 
@@ -25,9 +27,45 @@ HHOOK mouseHook=0, keyboardHook=0;
 POINT lastMousePoint = {0};
 
 HWND windowHandle = (HWND)INVALID_HANDLE_VALUE;
+// receives WM_INPUT on the thread that runs the hooks, NULL if raw input isn't available
+HWND rawInputHandle = NULL;
+
+// while captured the cursor is clipped to capturedMousePoint and moves come from raw input
+std::atomic<bool> isMouseCaptured(false);
+POINT capturedMousePoint = {0};
+
+void RawMouseInput(LPARAM lParam)
+{
+    RAWINPUT input;
+    UINT size = sizeof(input);
+
+    if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &input, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1)
+        return;
+
+    // absolute devices (pens, remote desktop) have no motion of their own to report
+    if (input.header.dwType != RIM_TYPEMOUSE || (input.data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE) != 0)
+        return;
+
+    if (input.data.mouse.lLastX == 0 && input.data.mouse.lLastY == 0)
+        return;
+
+    OSEvent event;
+    event.eventType = OS_EVENT_MOUSE;
+    event.mouseEvent = MOUSE_EVENT_MOVE;
+    event.deltaX = input.data.mouse.lLastX;
+    event.deltaY = input.data.mouse.lLastY;
+    event.x = capturedMousePoint.x;
+    event.y = capturedMousePoint.y;
+
+    osi->ConsumeInputEvent(event);
+}
 
 LRESULT CALLBACK MainWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
+    if (uMsg == WM_INPUT && osi && isMouseCaptured)
+        RawMouseInput(lParam);
+
+    // WM_INPUT must reach DefWindowProc as well so the system can clean up
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
@@ -92,6 +130,18 @@ LRESULT CALLBACK LowLevelMouseProc(_In_ int nCode,_In_ WPARAM wParam,_In_ LPARAM
 
         lastMousePoint = msHook->pt;
 
+        if (wParam == WM_MOUSEMOVE && isMouseCaptured)
+        {
+            // the clip is lost when i.e. another window takes the foreground, the move itself comes from raw input
+            if (msHook->pt.x != capturedMousePoint.x || msHook->pt.y != capturedMousePoint.y)
+            {
+                RECT clip = { capturedMousePoint.x, capturedMousePoint.y, capturedMousePoint.x + 1, capturedMousePoint.y + 1 };
+                ClipCursor(&clip);
+            }
+
+            return CallNextHookEx(0, nCode, wParam, lParam);
+        }
+
         switch (wParam) {
 		case WM_LBUTTONDOWN:
 			event.mouseButton = MOUSE_BUTTON_LEFT;
@@ -148,7 +198,12 @@ LRESULT CALLBACK LowLevelKeyboardProc(_In_ int nCode,_In_ WPARAM wParam,_In_ LPA
         event.eventType = OS_EVENT_KEY;
 
         KBDLLHOOKSTRUCT* msHook = (KBDLLHOOKSTRUCT*)lParam;
-        event.scanCode = msHook->scanCode;
+        int scanCode = msHook->scanCode | ((msHook->flags & LLKHF_EXTENDED) ? 0x100 : 0);
+        event.scanCode = WINDOWS_TO_HID[scanCode];
+
+        // keys other OSes have no code for stay here
+        if (event.scanCode == KEY_CODE_NONE)
+            return CallNextHookEx(0, nCode, wParam, lParam);
 
         switch(wParam)
         {
@@ -526,7 +581,28 @@ int NativeRegisterForOSEvents(OSInterface* _osi)
         return GetLastError();
     }
 
-    return GetLastError();
+    // a message only window on this thread so raw input arrives with the hooks' events,
+    // without it SetRelativeMouseCapture fails and the mouse is kept off the edges by warping
+    rawInputHandle = CreateWindow(WINDOW_CLASS_NAME, "CC Raw Input", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, GetModuleHandle(NULL), NULL);
+    if (rawInputHandle != NULL)
+    {
+        RAWINPUTDEVICE device = {0};
+        device.usUsagePage = 0x01; // generic desktop
+        device.usUsage = 0x02; // mouse
+        device.dwFlags = RIDEV_INPUTSINK;
+        device.hwndTarget = rawInputHandle;
+
+        if (RegisterRawInputDevices(&device, 1, sizeof(device)) == FALSE)
+        {
+            std::cout << "Error registering for raw mouse input: " << GetLastError() << std::endl;
+            DestroyWindow(rawInputHandle);
+            rawInputHandle = NULL;
+        }
+    }
+    else std::cout << "Error creating the raw input window: " << GetLastError() << std::endl;
+
+    // both hooks are installed, raw input is optional
+    return 0;
 }
 
 int GetHostName(std::string& hostName)
@@ -576,6 +652,47 @@ int SetMousePosition(int x, int y)
     return 0;
 }
 
+int SetRelativeMouseCapture(bool isCaptured)
+{
+    if (isCaptured == false)
+    {
+        isMouseCaptured = false;
+        return ClipCursor(NULL) == FALSE ? GetLastError() : 0;
+    }
+
+    if (rawInputHandle == NULL)
+        return ERROR_NOT_SUPPORTED;
+
+    if (GetCursorPos(&capturedMousePoint) == FALSE)
+        return GetLastError();
+
+    // a clip of one pixel keeps the cursor still while the hooks and raw input still see the device
+    RECT clip = { capturedMousePoint.x, capturedMousePoint.y, capturedMousePoint.x + 1, capturedMousePoint.y + 1 };
+    if (ClipCursor(&clip) == FALSE)
+        return GetLastError();
+
+    isMouseCaptured = true;
+    return 0;
+}
+
+int GetKeyRepeatSettings(int& delayMs, int& intervalMs)
+{
+    int delay = 0;
+    DWORD speed = 0;
+
+    if (SystemParametersInfo(SPI_GETKEYBOARDDELAY, 0, &delay, 0) == FALSE)
+        return GetLastError();
+    if (SystemParametersInfo(SPI_GETKEYBOARDSPEED, 0, &speed, 0) == FALSE)
+        return GetLastError();
+
+    // 0 is about 250ms and 3 about 1s
+    delayMs = (delay + 1) * 250;
+    // 0 is about 2.5 repeats a second and 31 about 30
+    intervalMs = (int)(1000 / (2.5 + speed * 27.5 / 31));
+
+    return 0;
+}
+
 int GetMousePosition(int& xPos, int& yPos)
 {
     POINT p;
@@ -597,6 +714,20 @@ void NativeUnhookAllEvents()
 
     mouseHook = 0;
     keyboardHook = 0;
+
+    if (rawInputHandle)
+    {
+        RAWINPUTDEVICE device = {0};
+        device.usUsagePage = 0x01;
+        device.usUsage = 0x02;
+        device.dwFlags = RIDEV_REMOVE;
+
+        RegisterRawInputDevices(&device, 1, sizeof(device));
+        DestroyWindow(rawInputHandle);
+        rawInputHandle = NULL;
+    }
+
+    SetRelativeMouseCapture(false);
 }
 
 int SetMouseHidden(bool isHidden)
@@ -656,16 +787,35 @@ int SendKeyEvent(const OSEvent keyEvent)
 
     newInput.type = INPUT_KEYBOARD;
 
-    newInput.ki.wScan = keyEvent.scanCode;
+    int scanCode = HID_TO_WINDOWS[keyEvent.scanCode];
+
+    // no key on this keyboard types it
+    if(scanCode == KEY_CODE_NONE)
+        return 0;
+
+    if(keyEvent.scanCode == KEY_CODE_HID_PAUSE)
+    {
+        // PAUSE has no single scan code SendInput takes, its virtual key does the same
+        newInput.ki.wVk = VK_PAUSE;
+    }
+    else
+    {
+        // the hook reports NUM LOCK as extended, SendInput wants it without
+        if(scanCode == 0x145)
+            scanCode = 0x45;
+
+        newInput.ki.wScan = scanCode & 0xFF;
+        eventType = KEYEVENTF_SCANCODE | ((scanCode & 0x100) ? KEYEVENTF_EXTENDEDKEY : 0);
+    }
 
     switch(keyEvent.keyEvent)
     {
     case KEY_EVENT_UP:
-        eventType = KEYEVENTF_KEYUP;
+        eventType |= KEYEVENTF_KEYUP;
         break;
     }
 
-    newInput.mi.dwFlags = KEYEVENTF_SCANCODE | eventType;
+    newInput.ki.dwFlags = eventType;
 
     if(SendInput(1, &newInput, sizeof(INPUT)) != 1)
         return GetLastError();
@@ -2,6 +2,17 @@
 #include <args.hxx>
 
 #include <string>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <set>
+#include <map>
+#include <thread>
+#include <fstream>
 
 #include "Socket/Socket.h"
 #include "Socket/SocketException.h"
@@ -9,6 +20,7 @@
 #include "OSInterface/NativeInterface.h"
 #include "OSInterface/IOSEventReceiver.h"
 #include "OSInterface/OSTypes.h"
+#include "OSInterface/KeyCodes.h"
 
 #include "CC/CCLogger.h"
 
@@ -16,6 +28,11 @@
 #include "CC/CCDisplay.h"
 #include "CC/CCNetworkEntity.h"
 #include "CC/CCConfigurationManager.h"
+#include "CC/CCGuiSession.h"
+#include "CC/CCGuiFrameReader.h"
+#include "CC/CCExecutor.h"
+#include "CC/CCInputRecording.h"
+#include "CC/CCMetricsServer.h"
 
 class TestEventReceiver : public IOSEventReceiver
 {
@@ -27,12 +44,36 @@ class TestEventReceiver : public IOSEventReceiver
 };
 
 int EventTest();
-int SocketTest(bool isServer);
+struct SocketTestOptions
+{
+    bool            isServer;
+    bool            isLoopback; // runs the server on a thread in this process
+    bool            isStream; // sends without waiting for echoes instead of ping pong
+    bool            noDelay;
+    SocketProtocol  protocol;
+    std::string     address; // server address for the client, where udp echoes go for the server
+    int             port; // udp echoes use port + 1
+    size_t          payloadSize;
+    int             rate; // messages per second, 0 is as fast as possible
+    int             duration; // seconds
+};
+
+int SocketTest(SocketTestOptions options);
 int KeyTest();
 int MouseMoveTest();
+int ConfigBenchmark(int entityCount);
+int GuiReaderTest(int entityCount);
+int ExecutorTest(int taskCount);
+int KeyCodeTest();
+int ReplayInput(const std::string& path, double speed);
+int LatencyReport(uint64_t withinUs, bool reset);
+int TraceService(int seconds, const std::string& path);
 int ParaseArguments(int argc, char* argv[]);
 
 bool shouldPause = false;
+std::string recordPath;
+int metricsPort = 9105; // 0 turns the metrics endpoint off
+std::string metricsAddress = "127.0.0.1";
 
 int main(int argc, char* argv[])
 {
@@ -47,6 +88,18 @@ int main(int argc, char* argv[])
         CCMain main;
         main.LoadAll();
 
+        if (recordPath.empty() == false)
+            main.StartRecording(recordPath);
+
+        std::unique_ptr<CCMetricsServer> metricsServer;
+        if (metricsPort != 0)
+        {
+            metricsServer = std::make_unique<CCMetricsServer>(metricsPort, metricsAddress);
+            // the service is still useful without its metrics
+            if (metricsServer->Start())
+                LOG_INFO << "Serving metrics on " << metricsAddress << ":" << metricsPort << std::endl;
+        }
+
         if (res == -1)
         {
             LOG_INFO << "Starting Server\n";
@@ -67,6 +120,7 @@ int main(int argc, char* argv[])
     if(shouldPause)
     {
         LOG_INFO << "waiting for input:";
+        CCLogger::logger.Flush();
         std::string val;
         std::cin >> val;
     }
@@ -81,15 +135,41 @@ int ParaseArguments(int argc, char* argv[])
     args::ArgumentParser parser("CommunistCursor shares the Mouse and Keyboard input between multiple computers", "");
     args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
     args::Group commandGroup(parser, "commands");
-    args::Command testSocket(commandGroup, "test-socket", "perform a simple socket test, if -s is specified it will run as a server");
+    args::Command testSocket(commandGroup, "test-socket", "measure socket latency and throughput, -s runs the echo server, --loopback runs both sides in this process");
     args::Command testEvent(commandGroup, "test-event", "perform event hooking tests, outputs all events found to stdout");
-    args::Command testKey(commandGroup, "test-key", "perform key injection test, will inject scan code 20 into the OS");
+    args::Command testKey(commandGroup, "test-key", "perform key injection test, will inject a T down into the OS");
     args::Command testMouseMove(commandGroup, "test-mousemove", "Perform mouse injection tests, will move mouse to random location on screen");
+    args::Command benchConfig(commandGroup, "bench-config", "benchmark configuration lookups, compares copying key walks with compiled CCConfigPath handles");
+    args::Command testGuiReader(commandGroup, "test-gui-reader", "feeds large framed setOffsets messages through the GUI frame reader in random sized reads and checks every offset");
+    args::Command testExecutor(commandGroup, "test-executor", "runs tasks, stolen tasks, serial queues and timers on the shared executor and prints its metrics");
+    args::Command testKeyCodes(commandGroup, "test-key-codes", "checks every key code table translates each key to HID and back to the key it came from");
+    args::Command replayInput(commandGroup, "replay-input", "feeds a recording made with --record through the input routing and reports where the events went, the local cursor is warped and hidden like in a live session");
+    args::Command latency(commandGroup, "latency", "asks the running service for its per entity latency histograms (capture, enqueue, wire, client receive, injection) over the GUI port and prints them as JSON");
+    args::Command trace(commandGroup, "trace", "traces the running service's jumps, RPCs, awks and reconnects for --duration seconds and writes a Chrome trace (chrome://tracing, Perfetto) to --out");
     args::Command run(commandGroup, "run", "Run in standard mode.");
     args::Command iservice(commandGroup, "service", "Install as a service");
     args::Group arguments(parser, "arguments", args::Group::Validators::DontCare, args::Options::Global);
     args::Flag isServer(arguments, "isServer", "forces program to run in server mode, can me used in {run} and {teset-socket} commands", {'s', "server"});
     args::Flag shouldPause(arguments, "shouldPause", "Pauses at tend of execution", {'p', "pause"});
+    args::ValueFlag<int> logLevel(arguments, "logLevel", "sets the log level, 0 none, 1 error, 2 debug, 3 info (default)", {'l', "log-level"});
+    args::Flag loopback(arguments, "loopback", "test-socket: run the echo server in this process", {"loopback"});
+    args::ValueFlag<std::string> socketProtocol(arguments, "protocol", "test-socket: tcp (default) or udp", {"protocol"});
+    args::ValueFlag<std::string> socketMode(arguments, "mode", "test-socket: ping waits for every echo (default), stream keeps sending", {"mode"});
+    args::ValueFlag<std::string> socketAddress(arguments, "address", "test-socket: server address, or where a udp server sends echoes (default 127.0.0.1)", {"address"});
+    args::ValueFlag<int> socketPort(arguments, "port", "test-socket: port, udp echoes use the next one (default 6555)", {"port"});
+    args::ValueFlag<int> socketPayload(arguments, "payload", "test-socket: bytes per message, at least 24 (default 64)", {"payload"});
+    args::ValueFlag<int> socketRate(arguments, "rate", "test-socket: messages per second, 0 is unlimited (default 0)", {"rate"});
+    args::ValueFlag<int> socketDuration(arguments, "duration", "test-socket: seconds to send for, trace: seconds to trace for (default 5)", {"duration"});
+    args::Flag socketNoDelay(arguments, "noDelay", "test-socket: disable Nagle's algorithm on tcp", {"no-delay"});
+    args::ValueFlag<std::string> binaryLog(arguments, "binaryLog", "writes structured hot path logs to a binary file, decode it with CCLogDecode", {"binary-log"});
+    args::ValueFlag<std::string> record(arguments, "record", "run: records input events and layout changes to this file for replay-input", {"record"});
+    args::ValueFlag<std::string> recording(arguments, "recording", "replay-input: the recording to replay", {"recording"});
+    args::ValueFlag<double> replaySpeed(arguments, "speed", "replay-input: 1 keeps the recorded timing (default), 2 is twice as fast, 0 is as fast as possible", {"speed"});
+    args::ValueFlag<double> latencyWithin(arguments, "withinMs", "latency: also report the fraction of every stage at or below this many milliseconds", {"within-ms"});
+    args::Flag latencyReset(arguments, "resetLatency", "latency: clear the histograms once they have been reported", {"reset-latency"});
+    args::ValueFlag<std::string> traceOut(arguments, "out", "trace: where the trace is written (default cc_trace.json)", {"out"});
+    args::ValueFlag<int> metricsPortFlag(arguments, "metricsPort", "run: serves Prometheus metrics on this port, 0 turns it off (default 9105)", {"metrics-port"});
+    args::ValueFlag<std::string> metricsAddressFlag(arguments, "metricsAddress", "run: the address metrics are served on, 0.0.0.0 lets other hosts scrape (default 127.0.0.1)", {"metrics-address"});
 
     try
     {
@@ -97,9 +177,31 @@ int ParaseArguments(int argc, char* argv[])
 
         ::shouldPause = shouldPause;
 
+        if(logLevel)
+        {
+            CCLogger::logger.SetLogLevel((LogLevel)args::get(logLevel));
+        }
+
+        if(binaryLog && CCLogger::logger.OpenBinaryLog(args::get(binaryLog)) == false)
+        {
+            LOG_ERROR << "Could not open binary log " << args::get(binaryLog) << std::endl;
+        }
+
         if(testSocket)
         {
-            return SocketTest(isServer);
+            SocketTestOptions options;
+            options.isServer = isServer;
+            options.isLoopback = loopback;
+            options.isStream = socketMode && args::get(socketMode) == "stream";
+            options.noDelay = socketNoDelay;
+            options.protocol = socketProtocol && args::get(socketProtocol) == "udp" ? SocketProtocol::SOCKET_P_UDP : SocketProtocol::SOCKET_P_TCP;
+            options.address = socketAddress ? args::get(socketAddress) : "127.0.0.1";
+            options.port = socketPort ? args::get(socketPort) : 6555;
+            options.payloadSize = socketPayload ? args::get(socketPayload) : 64;
+            options.rate = socketRate ? args::get(socketRate) : 0;
+            options.duration = socketDuration ? args::get(socketDuration) : 5;
+
+            return SocketTest(options);
         }
         else if(testKey)
         {
@@ -113,6 +215,40 @@ int ParaseArguments(int argc, char* argv[])
         {
             return EventTest();
         }
+        else if(benchConfig)
+        {
+            return ConfigBenchmark(500);
+        }
+        else if(testGuiReader)
+        {
+            return GuiReaderTest(5000);
+        }
+        else if(testExecutor)
+        {
+            return ExecutorTest(100000);
+        }
+        else if(testKeyCodes)
+        {
+            return KeyCodeTest();
+        }
+        else if(replayInput)
+        {
+            if (!recording)
+            {
+                LOG_ERROR << "replay-input needs --recording" << std::endl;
+                return 1;
+            }
+
+            return ReplayInput(args::get(recording), replaySpeed ? args::get(replaySpeed) : 1.0);
+        }
+        else if(latency)
+        {
+            return LatencyReport(latencyWithin ? (uint64_t)(args::get(latencyWithin) * 1000.0) : 0, latencyReset);
+        }
+        else if(trace)
+        {
+            return TraceService(socketDuration ? args::get(socketDuration) : 5, traceOut ? args::get(traceOut) : "cc_trace.json");
+        }
         else if(iservice)
         {
             // install service
@@ -121,6 +257,13 @@ int ParaseArguments(int argc, char* argv[])
         else if(run)
         {
             // perform standard operation
+            if (record)
+                recordPath = args::get(record);
+            if (metricsPortFlag)
+                metricsPort = args::get(metricsPortFlag);
+            if (metricsAddressFlag)
+                metricsAddress = args::get(metricsAddressFlag);
+
             return isServer ? -1 : -2;
         }
     }
@@ -179,7 +322,7 @@ int KeyTest()
     event.eventType = OS_EVENT_KEY;
     event.keyEvent = KEY_EVENT_DOWN;
 
-    event.scanCode = 20;
+    event.scanCode = 0x17; // T
 
     //std::cin.get();
 
@@ -202,6 +345,401 @@ int KeyTest()
     return 0;
 }
 
+struct BenchOffsets
+{
+    int x;
+    int y;
+};
+
+void to_json(nlohmann::json& j, const BenchOffsets& o)
+{
+    j = nlohmann::json{ {"x", o.x}, {"y", o.y} };
+}
+
+void from_json(const nlohmann::json& j, BenchOffsets& o)
+{
+    j.at("x").get_to(o.x);
+    j.at("y").get_to(o.y);
+}
+
+int ConfigBenchmark(int entityCount)
+{
+    LOG_INFO << "ConfigBenchmark with " << entityCount << " entities" << std::endl;
+
+    const int rounds = 20;
+
+    CCConfigurationManager manager;
+    nlohmann::json document;
+    std::vector<std::string> entityIDs;
+    std::vector<CCConfigPath> paths;
+
+    for (int i = 0; i < entityCount; i++)
+    {
+        std::string entityID = "Entity-" + std::to_string(i);
+        BenchOffsets offsets = { i, -i };
+
+        entityIDs.push_back(entityID);
+        paths.push_back(CCConfigPath({ "Entities", entityID }));
+
+        manager.SetValue(paths.back(), offsets);
+        document["Entities"][entityID] = offsets;
+    }
+
+    // what GetValue used to do, copy the document and every level on the way down
+    auto copyingGet = [&document](std::vector<std::string> keys, BenchOffsets& out) {
+        nlohmann::json currentObj = document;
+        for (auto key : keys)
+        {
+            if (currentObj.contains(key) == false)
+                return false;
+            currentObj = currentObj[key];
+        }
+        out = currentObj.get<BenchOffsets>();
+        return true;
+    };
+
+    auto timeRounds = [rounds, entityCount](const std::function<void()>& round) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++)
+        {
+            round();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return (double)elapsed / (rounds * entityCount);
+    };
+
+    BenchOffsets offsets;
+    long long checksum = 0;
+
+    double copying = timeRounds([&]() {
+        for (auto& entityID : entityIDs)
+        {
+            copyingGet({ "Entities", entityID }, offsets);
+            checksum += offsets.x;
+        }
+    });
+
+    double temporaryPath = timeRounds([&]() {
+        for (auto& entityID : entityIDs)
+        {
+            manager.GetValue({ "Entities", entityID }, offsets);
+            checksum += offsets.x;
+        }
+    });
+
+    double compiledPath = timeRounds([&]() {
+        for (auto& path : paths)
+        {
+            manager.GetValue(path, offsets);
+            checksum += offsets.x;
+        }
+    });
+
+    LOG_INFO << "copying key walk       " << copying << " ns/lookup" << std::endl;
+    LOG_INFO << "temporary CCConfigPath " << temporaryPath << " ns/lookup" << std::endl;
+    LOG_INFO << "compiled CCConfigPath  " << compiledPath << " ns/lookup" << std::endl;
+    LOG_INFO << "checksum " << checksum << std::endl;
+
+    return 0;
+}
+
+// feeds {stream} to {reader} in reads of at most {maxRead} bytes, parsing frames as they complete
+// returns the number of offsets that matched what was generated or -1 on error
+int FeedGuiReader(CCGuiFrameReader& reader, const std::string& stream, size_t maxRead, std::mt19937& random)
+{
+    int matched = 0;
+    int failed = 0;
+    size_t offset = 0;
+
+    while (true)
+    {
+        const char* payload = 0;
+        size_t length = 0;
+        CCGuiFrameResult result = reader.NextFrame(payload, length);
+
+        if (result == CCGuiFrameResult::FRAME_TOO_LARGE)
+            return -1;
+
+        if (result == CCGuiFrameResult::FRAME_READY)
+        {
+            CCGuiOffsetsSax sax([&matched, &failed](const std::string& entityID, const Point& point) {
+                int index = std::stoi(entityID.substr(7));
+                if (point.x == index * 3 && point.y == -index)
+                    matched++;
+                else
+                    failed++;
+            });
+
+            if (nlohmann::json::sax_parse(payload, payload + length, &sax) == false || sax.type != "setOffsets")
+                return -1;
+            continue;
+        }
+
+        if (offset == stream.size())
+            break;
+
+        size_t available = 0;
+        char* buffer = reader.GetWriteBuffer(available);
+
+        size_t chunk = std::min<size_t>({ available, stream.size() - offset, 1 + random() % maxRead });
+        memcpy(buffer, stream.data() + offset, chunk);
+        reader.CommitWrite(chunk);
+        offset += chunk;
+    }
+
+    return failed ? -1 : matched;
+}
+
+int GuiReaderTest(int entityCount)
+{
+    LOG_INFO << "GuiReaderTest with " << entityCount << " entities" << std::endl;
+
+    const int frames = 10;
+
+    nlohmann::json offsets;
+    for (int i = 0; i < entityCount; i++)
+    {
+        offsets["Entity-" + std::to_string(i)] = { i * 3, -i };
+    }
+
+    nlohmann::json message;
+    message["type"] = "setOffsets";
+    message["offsets"] = offsets;
+    message["final"] = false;
+
+    std::string frame = CCGuiSession::Frame(message.dump());
+    std::string stream;
+    for (int i = 0; i < frames; i++)
+    {
+        stream += frame;
+    }
+
+    std::mt19937 random(1049);
+    int failures = 0;
+
+    for (size_t maxRead : { (size_t)1 << 16, (size_t)4096, (size_t)7 })
+    {
+        CCGuiFrameReader reader(CC_GUI_MAX_FRAME_SIZE, 1024);
+
+        auto start = std::chrono::steady_clock::now();
+        int matched = FeedGuiReader(reader, stream, maxRead, random);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        bool passed = matched == entityCount * frames;
+        failures += passed ? 0 : 1;
+
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " reads up to " << maxRead << " bytes: " << matched << "/" << entityCount * frames \
+            << " offsets, " << stream.size() << " bytes in " << elapsed << "us, buffer grew to " << reader.GetCapacity() << std::endl;
+    }
+
+    // a frame claiming to be larger than the limit must be rejected instead of buffered
+    {
+        CCGuiFrameReader reader(1024);
+        bool passed = FeedGuiReader(reader, CCGuiSession::Frame(std::string(2048, ' ')), 4096, random) == -1;
+        failures += passed ? 0 : 1;
+
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " oversized frame rejected" << std::endl;
+    }
+
+    return failures;
+}
+
+// waits for {done} to reach {expected}, returns false after 10 seconds
+bool WaitForCount(const std::atomic<int>& done, int expected)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (done < expected && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return done == expected;
+}
+
+int ExecutorTest(int taskCount)
+{
+    CCExecutor& executor = CCExecutor::SharedExecutor();
+    LOG_INFO << "ExecutorTest with " << taskCount << " tasks on " << executor.GetWorkerCount() << " workers" << std::endl;
+
+    int failures = 0;
+
+    // tasks from outside the pool, spread round robin, throttled to stay under the pending limit
+    {
+        std::atomic<int> done(0);
+        int rejected = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < taskCount; i++)
+        {
+            while (i - done > 1024)
+            {
+                std::this_thread::yield();
+            }
+
+            if (executor.Submit([&done]() { done++; }) == false)
+                rejected++;
+        }
+        bool passed = WaitForCount(done, taskCount - rejected) && rejected == 0;
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        failures += passed ? 0 : 1;
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " " << done << "/" << taskCount << " tasks in " << elapsed << "us" << std::endl;
+    }
+
+    // one task fans out onto its own worker, idle workers have to steal to help
+    {
+        const int children = 2000;
+        std::atomic<int> done(0);
+        std::mutex threadsMutex;
+        std::set<std::thread::id> threads;
+
+        executor.Submit([&]() {
+            for (int i = 0; i < children; i++)
+            {
+                executor.Submit([&]() {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    {
+                        std::lock_guard<std::mutex> lock(threadsMutex);
+                        threads.insert(std::this_thread::get_id());
+                    }
+                    done++;
+                });
+            }
+        });
+
+        bool passed = WaitForCount(done, children);
+        failures += passed ? 0 : 1;
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " " << done << "/" << children << " nested tasks ran on " << threads.size() << " workers" << std::endl;
+    }
+
+    // a serial queue keeps order and never runs two tasks at once
+    {
+        const int tasks = 10000;
+        std::shared_ptr<CCSerialQueue> queue = executor.MakeQueue("test-serial");
+        std::atomic<int> done(0);
+        std::atomic<bool> isRunning(false);
+        int next = 0;
+        int outOfOrder = 0;
+
+        for (int i = 0; i < tasks; i++)
+        {
+            queue->Submit([&, i]() {
+                if (isRunning.exchange(true) || next != i)
+                    outOfOrder++;
+                next = i + 1;
+                isRunning = false;
+                done++;
+            });
+        }
+
+        bool passed = WaitForCount(done, tasks) && outOfOrder == 0;
+        failures += passed ? 0 : 1;
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " serial queue ran " << done << "/" << tasks << " tasks, " << outOfOrder << " out of order" << std::endl;
+
+        queue->Close();
+        passed = queue->Submit([]() {}) == false;
+        failures += passed ? 0 : 1;
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " closed queue rejects tasks" << std::endl;
+    }
+
+    // delayed tasks never run early
+    {
+        std::atomic<int> done(0);
+        std::atomic<long long> elapsed(0);
+        auto start = std::chrono::steady_clock::now();
+
+        executor.SubmitAfter(std::chrono::milliseconds(50), [&]() {
+            elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            done++;
+        });
+
+        bool passed = WaitForCount(done, 1) && elapsed >= 50;
+        failures += passed ? 0 : 1;
+        LOG_INFO << (passed ? "PASS" : "FAIL") << " delayed task ran after " << elapsed << "ms" << std::endl;
+    }
+
+    for (const CCExecutorMetrics& metrics : executor.GetMetrics())
+    {
+        LOG_INFO << metrics.name << ": depth " << metrics.queueDepth << ", executed " << metrics.tasksExecuted << ", rejected " << metrics.tasksRejected \
+            << ", latency avg " << metrics.averageLatencyUs << "us max " << metrics.maxLatencyUs << "us" << std::endl;
+    }
+
+    return failures;
+}
+
+// checks {toHID} and {fromHID} against each other and against {column} of every KEY_CODE_ROWS row
+template<size_t NativeCount>
+int KeyCodeTableTest(const char* name, const KeyCodeTable<NativeCount>& toHID, const KeyCodeTable<KEY_CODE_HID_COUNT>& fromHID, int KeyCodeRow::* column)
+{
+    int failures = 0;
+    int keys = 0;
+
+    for (const KeyCodeRow& row : KEY_CODE_ROWS)
+    {
+        int native = row.*column;
+        if (native == KEY_CODE_NONE)
+        {
+            if (fromHID[row.hid] != KEY_CODE_NONE)
+            {
+                LOG_ERROR << name << ": HID " << row.hid << " has no key but translates to " << fromHID[row.hid] << std::endl;
+                failures++;
+            }
+            continue;
+        }
+
+        keys++;
+        if (toHID[native] != row.hid || fromHID[row.hid] != native)
+        {
+            LOG_ERROR << name << ": " << native << " translates to HID " << toHID[native] << ", HID " << row.hid << " translates to " << fromHID[row.hid] << std::endl;
+            failures++;
+        }
+    }
+
+    // every code the tables have must come back as itself
+    for (int native = 0; native < (int)NativeCount; native++)
+    {
+        int hid = toHID[native];
+        if (hid != KEY_CODE_NONE && fromHID[hid] != native)
+        {
+            LOG_ERROR << name << ": " << native << " comes back as " << fromHID[hid] << std::endl;
+            failures++;
+        }
+    }
+
+    for (int hid = 0; hid < KEY_CODE_HID_COUNT; hid++)
+    {
+        int native = fromHID[hid];
+        if (native != KEY_CODE_NONE && toHID[native] != hid)
+        {
+            LOG_ERROR << name << ": HID " << hid << " comes back as " << toHID[native] << std::endl;
+            failures++;
+        }
+    }
+
+    // codes past the tables don't translate
+    if (toHID[-1] != KEY_CODE_NONE || toHID[(int)NativeCount] != KEY_CODE_NONE || fromHID[KEY_CODE_HID_COUNT] != KEY_CODE_NONE)
+    {
+        LOG_ERROR << name << ": a code out of range translates" << std::endl;
+        failures++;
+    }
+
+    LOG_INFO << (failures == 0 ? "PASS " : "FAIL ") << name << " with " << keys << " keys" << std::endl;
+    return failures;
+}
+
+int KeyCodeTest()
+{
+    LOG_INFO << "KeyCodeTest with " << sizeof(KEY_CODE_ROWS) / sizeof(KEY_CODE_ROWS[0]) << " keys" << std::endl;
+
+    int failures = 0;
+
+    failures += KeyCodeTableTest("windows", WINDOWS_TO_HID, HID_TO_WINDOWS, &KeyCodeRow::windows);
+    failures += KeyCodeTableTest("mac", MAC_TO_HID, HID_TO_MAC, &KeyCodeRow::mac);
+    failures += KeyCodeTableTest("evdev", EVDEV_TO_HID, HID_TO_EVDEV, &KeyCodeRow::evdev);
+
+    return failures;
+}
+
 int EventTest()
 {
     LOG_INFO << "EventTest" << std::endl;
@@ -217,82 +755,591 @@ int EventTest()
     return 0;
 }
 
-int SocketTest(bool isServer)
+// every test message starts with this header, the rest of the payload is padding
+struct SocketTestHeader
 {
-    LOG_INFO << "SocketTest" << std::endl;
-    
+    uint32_t magic;
+    uint32_t sequence;
+    uint64_t timestamp; // client steady clock in nanoseconds, echoed back unchanged
+    uint32_t length; // whole message including this header
+    uint32_t isEnd; // sent by a udp client when it is done, tcp clients close the connection
+};
 
-    std::string toSend = "Hello !";
+#define SOCKET_TEST_MAGIC 0x43435354
+#define SOCKET_TEST_MAX_UDP_PAYLOAD 65507
+#define SOCKET_TEST_MAX_TCP_PAYLOAD (1024 * 1024)
 
-    char type = isServer ? 's' : 'c';
+uint64_t SocketTestNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    Socket socket("0.0.0.0", 6555, false, SocketProtocol::SOCKET_P_TCP);
+// tcp is a stream so a message can arrive in any number of pieces
+bool RecvExactly(Socket& socket, char* buffer, size_t length)
+{
+    size_t offset = 0;
+    while (offset < length)
+    {
+        size_t received = 0;
+        SocketError e = socket.Recv(buffer + offset, length - offset, &received);
+        if (e != SocketError::SOCKET_E_SUCCESS || received == 0)
+            return false;
 
-    switch(type)
+        offset += received;
+    }
+
+    return true;
+}
+
+// receives one whole message into {buffer}, for udp that is one datagram
+bool RecvTestMessage(Socket& socket, const SocketTestOptions& options, std::vector<char>& buffer)
+{
+    SocketTestHeader* header = (SocketTestHeader*)buffer.data();
+
+    if (options.protocol == SocketProtocol::SOCKET_P_UDP)
     {
-    case 'c':
+        size_t received = 0;
+        SocketError e = socket.Recv(buffer.data(), buffer.size(), &received);
+        return e == SocketError::SOCKET_E_SUCCESS && received >= sizeof(SocketTestHeader) && header->magic == SOCKET_TEST_MAGIC;
+    }
+
+    if (RecvExactly(socket, buffer.data(), sizeof(SocketTestHeader)) == false || header->magic != SOCKET_TEST_MAGIC)
+        return false;
+
+    if (header->length < sizeof(SocketTestHeader) || header->length > buffer.size())
+        return false;
+
+    return RecvExactly(socket, buffer.data() + sizeof(SocketTestHeader), header->length - sizeof(SocketTestHeader));
+}
+
+// echoes every message back until the client is done
+// {state} is set to 1 once the client can start or -1 if the server failed
+int SocketTestServer(const SocketTestOptions& options, std::atomic<int>* state)
+{
+    std::vector<char> buffer(options.protocol == SocketProtocol::SOCKET_P_UDP ? SOCKET_TEST_MAX_UDP_PAYLOAD : SOCKET_TEST_MAX_TCP_PAYLOAD);
+    SocketTestHeader* header = (SocketTestHeader*)buffer.data();
+    uint64_t echoed = 0;
+
+    if (options.protocol == SocketProtocol::SOCKET_P_UDP)
     {
-        SocketError e = socket.Connect("127.0.0.1");
-        if(e != SocketError::SOCKET_E_SUCCESS)
+        // replies go to {address} one port up, Recv doesn't report who sent a datagram
+        Socket receiver(SOCKET_ANY_ADDRESS, options.port, false, SocketProtocol::SOCKET_P_UDP);
+        Socket sender(options.address, options.port + 1, false, SocketProtocol::SOCKET_P_UDP);
+
+        SocketError e = receiver.Bind();
+        if (e != SocketError::SOCKET_E_SUCCESS)
         {
-            LOG_ERROR << "Error connecting to server " << SOCK_ERR_STR(&socket, e);
-            break;
+            LOG_ERROR << "Error binding socket " << SOCK_ERR_STR(&receiver, e) << std::endl;
+            if (state)
+                *state = -1;
+            return 1;
         }
 
-        e = socket.Send(toSend);
-        if(e != SocketError::SOCKET_E_SUCCESS)
+        // in process the client is already running, a lost end must not keep the server waiting
+        if (state)
         {
-            LOG_ERROR << "Error sending from client " << SOCK_ERR_STR(&socket, e);
-            break;
+            receiver.SetReceiveTimeout(5000);
+            *state = 1;
         }
 
-        e = socket.WaitForServer();
-        if(e != SocketError::SOCKET_E_SUCCESS)
+        while (RecvTestMessage(receiver, options, buffer) && header->isEnd == 0)
         {
-            LOG_ERROR << "Error sending from client " << SOCK_ERR_STR(&socket, e);
-            break;
+            sender.SendTo(buffer.data(), header->length);
+            echoed++;
         }
     }
-        break;
-    case 's':
+    else
     {
-            SocketError e = socket.Bind("127.0.0.1");
-            if(e != SocketError::SOCKET_E_SUCCESS)
-            {
-                LOG_ERROR << "Error binding socket " << SOCK_ERR_STR(&socket, e);
-                break;
-            }
+        Socket socket(SOCKET_ANY_ADDRESS, options.port, false, SocketProtocol::SOCKET_P_TCP);
+
+        SocketError e = socket.Bind();
+        if (e == SocketError::SOCKET_E_SUCCESS)
             e = socket.Listen();
-            if(e != SocketError::SOCKET_E_SUCCESS)
-            {
-                LOG_ERROR << "Error listening on socket " << SOCK_ERR_STR(&socket, e);
-                break;
-            }
-            Socket* client = 0;
-            e = socket.Accept(&client);
-            if(e != SocketError::SOCKET_E_SUCCESS)
-            {
-                LOG_ERROR << "Error accepting client " << SOCK_ERR_STR(client, e);
+        if (e != SocketError::SOCKET_E_SUCCESS)
+        {
+            LOG_ERROR << "Error listening on socket " << SOCK_ERR_STR(&socket, e) << std::endl;
+            if (state)
+                *state = -1;
+            return 1;
+        }
+
+        if (state)
+            *state = 1;
+
+        Socket* acceptedSocket = 0;
+        e = socket.Accept(&acceptedSocket);
+        if (e != SocketError::SOCKET_E_SUCCESS)
+        {
+            LOG_ERROR << "Error accepting client " << SOCK_ERR_STR(&socket, e) << std::endl;
+            return 1;
+        }
+
+        std::unique_ptr<Socket> client(acceptedSocket);
+        if (options.noDelay)
+            client->SetNoDelay(true);
+
+        // runs until the client closes so the TIME_WAIT ends up on the client's port
+        while (RecvTestMessage(*client, options, buffer))
+        {
+            if (client->Send(buffer.data(), header->length) != SocketError::SOCKET_E_SUCCESS)
                 break;
-            }
-            char buf[256] = {0};
-            size_t received = 0;
-            e = client->Recv(buf,sizeof(buf), &received);
-            if(e != SocketError::SOCKET_E_SUCCESS)
-            {
-                LOG_ERROR << "Error recieving from client " << SOCK_ERR_STR(client, e);
-            }
-            else
+            echoed++;
+        }
+    }
+
+    LOG_INFO << "Server echoed " << echoed << " messages" << std::endl;
+
+    return 0;
+}
+
+// {sorted} in microseconds at percentile {p}
+double Percentile(const std::vector<uint64_t>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+
+    size_t index = (size_t)std::ceil(p * sorted.size());
+    index = index == 0 ? 0 : index - 1;
+
+    return sorted[std::min(index, sorted.size() - 1)] / 1000.0;
+}
+
+// sends messages for {options.duration} and measures the round trip of every echo
+int SocketTestClient(const SocketTestOptions& options)
+{
+    bool isUDP = options.protocol == SocketProtocol::SOCKET_P_UDP;
+
+    std::unique_ptr<Socket> sender;
+    std::unique_ptr<Socket> receiver;
+
+    if (isUDP)
+    {
+        sender = std::make_unique<Socket>(options.address, options.port, false, SocketProtocol::SOCKET_P_UDP);
+        receiver = std::make_unique<Socket>(SOCKET_ANY_ADDRESS, options.port + 1, false, SocketProtocol::SOCKET_P_UDP);
+
+        SocketError e = receiver->Bind();
+        if (e != SocketError::SOCKET_E_SUCCESS)
+        {
+            LOG_ERROR << "Error binding socket " << SOCK_ERR_STR(receiver.get(), e) << std::endl;
+            return 1;
+        }
+
+        // a lost datagram must not stall the test
+        receiver->SetReceiveTimeout(1000);
+    }
+    else
+    {
+        sender = std::make_unique<Socket>(options.address, options.port, false, SocketProtocol::SOCKET_P_TCP);
+
+        SocketError e = sender->Connect();
+        if (e != SocketError::SOCKET_E_SUCCESS)
+        {
+            LOG_ERROR << "Error connecting to server " << SOCK_ERR_STR(sender.get(), e) << std::endl;
+            return 1;
+        }
+
+        if (options.noDelay)
+            sender->SetNoDelay(true);
+    }
+
+    Socket& replies = isUDP ? *receiver : *sender;
+
+    std::vector<char> message(options.payloadSize, 0);
+    SocketTestHeader* header = (SocketTestHeader*)message.data();
+    header->magic = SOCKET_TEST_MAGIC;
+    header->length = (uint32_t)options.payloadSize;
+    header->isEnd = 0;
+
+    auto send = [&](uint32_t sequence) {
+        header->sequence = sequence;
+        header->timestamp = SocketTestNow();
+        return isUDP ? sender->SendTo(message.data(), message.size()) : sender->Send(message.data(), message.size());
+    };
+
+    std::vector<uint64_t> roundTrips;
+    uint64_t lastEcho = 0;
+    std::atomic<uint32_t> sent(0);
+    std::atomic<bool> isSending(true);
+
+    std::vector<char> buffer(message.size());
+    SocketTestHeader* reply = (SocketTestHeader*)buffer.data();
+
+    // in stream mode echoes are collected on their own thread while sending continues
+    std::thread receiveThread;
+    if (options.isStream)
+    {
+        receiveThread = std::thread([&]() {
+            while (isSending || roundTrips.size() < sent)
             {
-                buf[received] = 0;
-                LOG_INFO << "Server Received {" << buf << "} From Client !" << std::endl;
+                if (RecvTestMessage(replies, options, buffer))
+                {
+                    lastEcho = SocketTestNow();
+                    roundTrips.push_back(lastEcho - reply->timestamp);
+                }
+                // a udp timeout after the last send means the rest were lost
+                else if (isUDP == false || isSending == false)
+                    break;
             }
-            
-            delete client;
+        });
+    }
+
+    auto interval = std::chrono::nanoseconds(options.rate > 0 ? 1000000000LL / options.rate : 0);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startTimestamp = SocketTestNow();
+    auto end = start + std::chrono::seconds(options.duration);
+    auto nextSend = start;
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        if (options.rate > 0)
+        {
+            std::this_thread::sleep_until(nextSend);
+            nextSend += interval;
+        }
+
+        uint32_t sequence = sent;
+        SocketError e = send(sequence);
+        if (e != SocketError::SOCKET_E_SUCCESS)
+        {
+            LOG_ERROR << "Error sending " << SOCK_ERR_STR(sender.get(), e) << std::endl;
+            break;
+        }
+        sent++;
+
+        if (options.isStream)
+            continue;
+
+        // ping pong waits for every echo, a lost udp datagram only costs the receive timeout
+        bool isEchoed = false;
+        while (RecvTestMessage(replies, options, buffer))
+        {
+            // a late udp echo of an earlier message
+            if (reply->sequence != sequence)
+                continue;
+
+            lastEcho = SocketTestNow();
+            roundTrips.push_back(lastEcho - reply->timestamp);
+            isEchoed = true;
+            break;
+        }
+
+        if (isEchoed == false && isUDP == false)
+            break;
+    }
+
+    auto sendElapsed = std::chrono::steady_clock::now() - start;
+    isSending = false;
+
+    if (receiveThread.joinable())
+        receiveThread.join();
+
+    // udp has no connection to close, repeat the end in case one is dropped
+    header->isEnd = 1;
+    for (int i = 0; isUDP && i < 3; i++)
+    {
+        send(sent);
+    }
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+
+    // echoes are counted up to the last one, not the time spent waiting for lost ones
+    double seconds = lastEcho > startTimestamp ? (lastEcho - startTimestamp) / 1000000000.0 : 0;
+    double sendSeconds = std::chrono::duration_cast<std::chrono::microseconds>(sendElapsed).count() / 1000000.0;
+
+    LOG_INFO << (isUDP ? "udp " : "tcp ") << (options.isStream ? "stream" : "ping-pong") << ", " << options.payloadSize << " byte messages, rate " \
+        << (options.rate > 0 ? std::to_string(options.rate) + "/s" : std::string("unlimited")) << (options.noDelay ? ", no delay" : "") << std::endl;
+    LOG_INFO << "sent " << sent << " received " << roundTrips.size() << " lost " << (sent - roundTrips.size()) << " in " << seconds << "s" << std::endl;
+    LOG_INFO << "sent " << (sendSeconds > 0 ? sent / sendSeconds : 0) << " events/s, echoed " << (seconds > 0 ? roundTrips.size() / seconds : 0) << " events/s, " \
+        << (seconds > 0 ? roundTrips.size() * options.payloadSize / seconds / (1024 * 1024) : 0) << " MiB/s" << std::endl;
+    LOG_INFO << "round trip us p50 " << Percentile(roundTrips, 0.5) << " p99 " << Percentile(roundTrips, 0.99) << " p999 " << Percentile(roundTrips, 0.999) \
+        << " max " << Percentile(roundTrips, 1.0) << std::endl;
+
+    return 0;
+}
+
+int SocketTest(SocketTestOptions options)
+{
+    LOG_INFO << "SocketTest" << std::endl;
+
+    size_t maxPayload = options.protocol == SocketProtocol::SOCKET_P_UDP ? SOCKET_TEST_MAX_UDP_PAYLOAD : SOCKET_TEST_MAX_TCP_PAYLOAD;
+    if (options.payloadSize < sizeof(SocketTestHeader) || options.payloadSize > maxPayload)
+    {
+        LOG_ERROR << "Payload must be between " << sizeof(SocketTestHeader) << " and " << maxPayload << " bytes" << std::endl;
+        return 1;
+    }
+
+    if (options.isLoopback)
+    {
+        options.address = "127.0.0.1";
+
+        std::atomic<int> state(0);
+        std::thread server([&options, &state]() { SocketTestServer(options, &state); });
+
+        while (state == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        int res = state == 1 ? SocketTestClient(options) : 1;
+        server.join();
+
+        return res;
+    }
+
+    return options.isServer ? SocketTestServer(options, 0) : SocketTestClient(options);
+}
+
+// counts what CCMain did with every replayed event
+class ReplayRouteCounter : public IInputRouteObserver
+{
+public:
+    struct Counts
+    {
+        uint64_t local = 0;
+        uint64_t remote = 0;
+        uint64_t failed = 0;
+        uint64_t skipped = 0;
+    };
+
+    struct Jump
+    {
+        uint64_t    timestamp;
+        std::string from;
+        std::string to;
+    };
+
+    std::map<std::string, Counts>   counts;
+    std::vector<Jump>               jumps;
+    uint64_t                        timestamp = 0; // of the event being replayed
+
+    virtual void EventRouted(const OSEvent& event, const CCNetworkEntity* target, InputRoute route)override
+    {
+        Counts& entityCounts = counts[target->GetID()];
+
+        switch (route)
+        {
+        case InputRoute::LOCAL:         entityCounts.local++; break;
+        case InputRoute::REMOTE:        entityCounts.remote++; break;
+        case InputRoute::REMOTE_FAILED: entityCounts.failed++; break;
+        case InputRoute::SKIPPED:       entityCounts.skipped++; break;
+        }
+    }
+
+    virtual void EntityJumped(const CCNetworkEntity* from, const CCNetworkEntity* to)override
+    {
+        jumps.push_back({ timestamp, from->GetID(), to->GetID() });
+    }
+};
+
+int ReplayInput(const std::string& path, double speed)
+{
+    LOG_INFO << "ReplayInput " << path << " at speed " << speed << std::endl;
+
+    if (speed < 0)
+    {
+        LOG_ERROR << "--speed can't be negative" << std::endl;
+        return 1;
+    }
+
+    CCInputRecording inputRecording;
+    std::string error;
+    if (inputRecording.Open(path, error) == false)
+    {
+        LOG_ERROR << error << std::endl;
+        return 1;
+    }
+
+    size_t offset = inputRecording.GetFirstOffset();
+    CCInputEntry entry;
+    if (inputRecording.Next(offset, entry) == false || entry.kind != CC_INPUT_ENTRY_LAYOUT)
+    {
+        LOG_ERROR << path << " doesn't start with a layout" << std::endl;
+        return 1;
+    }
+
+    std::string layout(entry.layout, entry.layoutLength);
+
+    std::string localID;
+    try
+    {
+        localID = nlohmann::json::parse(layout).at("local").get<std::string>();
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR << "Invalid layout in " << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    // named like the recording's computer, only bound to the loopback so a replay can run next to the real service
+    CCMain main(localID, "127.0.0.1");
+    if (main.LoadLayout(layout) == false)
+        return 1;
+
+    ReplayRouteCounter counter;
+    main.SetRouteObserver(&counter);
+
+    std::vector<uint64_t> handling; // ns spent in ReceivedNewInputEvent
+    uint64_t layouts = 1;
+    uint64_t firstTimestamp = entry.timestamp;
+    int64_t maxLateNs = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (inputRecording.Next(offset, entry))
+    {
+        if (entry.kind == CC_INPUT_ENTRY_LAYOUT)
+        {
+            main.LoadLayout(std::string(entry.layout, entry.layoutLength));
+            layouts++;
+            continue;
         }
-        break;
+
+        if (speed > 0)
+        {
+            auto due = start + std::chrono::nanoseconds((int64_t)((entry.timestamp - firstTimestamp) / speed));
+            std::this_thread::sleep_until(due);
+
+            maxLateNs = std::max(maxLateNs, (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - due).count());
+        }
+
+        counter.timestamp = entry.timestamp;
+
+        auto before = std::chrono::steady_clock::now();
+        main.ReceivedNewInputEvent(entry.event);
+        handling.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
     }
 
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000000.0;
+
+    main.SetRouteObserver(NULL);
+    // a replay that ends on another entity would leave the cursor hidden
+    OSInterface::SharedInterface().SetMouseHidden(false);
+
+    std::sort(handling.begin(), handling.end());
+
+    LOG_INFO << "replayed " << handling.size() << " events and " << layouts << " layouts in " << seconds << "s, " << (seconds > 0 ? handling.size() / seconds : 0) << " events/s" << std::endl;
+    LOG_INFO << "routing us p50 " << Percentile(handling, 0.5) << " p99 " << Percentile(handling, 0.99) << " p999 " << Percentile(handling, 0.999) \
+        << " max " << Percentile(handling, 1.0) << std::endl;
+    if (speed > 0)
+        LOG_INFO << "at most " << maxLateNs / 1000 << "us behind the recorded timing" << std::endl;
+
+    for (auto& entityCounts : counter.counts)
+    {
+        LOG_INFO << entityCounts.first << ": " << entityCounts.second.local << " local, " << entityCounts.second.remote << " sent, " \
+            << entityCounts.second.failed << " failed, " << entityCounts.second.skipped << " skipped" << std::endl;
+    }
+
+    LOG_INFO << counter.jumps.size() << " jumps" << std::endl;
+    for (auto& jump : counter.jumps)
+    {
+        LOG_INFO << "  " << (jump.timestamp - firstTimestamp) / 1000000 << "ms " << jump.from << " -> " << jump.to << std::endl;
+    }
+
+    return 0;
+}
+
+// sends {request} to the running service over the GUI port and waits for its {replyType} answer
+bool ServiceRequest(const nlohmann::json& request, const std::string& replyType, nlohmann::json& reply)
+{
+    Socket socket("127.0.0.1", 1049, false, SocketProtocol::SOCKET_P_TCP);
+
+    SocketError error = socket.Connect();
+    if (error != SocketError::SOCKET_E_SUCCESS)
+    {
+        LOG_ERROR << "Could not connect to the service's GUI port: " << SOCK_ERR_STR(&socket, error) << std::endl;
+        return false;
+    }
+
+    socket.SetReceiveTimeout(5000);
+
+    error = socket.Send(CCGuiSession::Frame(request.dump()));
+    if (error != SocketError::SOCKET_E_SUCCESS)
+    {
+        LOG_ERROR << "Could not send " << request["type"] << ": " << SOCK_ERR_STR(&socket, error) << std::endl;
+        return false;
+    }
+
+    CCGuiFrameReader reader(CC_GUI_MAX_FRAME_SIZE);
+
+    while (true)
+    {
+        const char* payload = 0;
+        size_t length = 0;
+        CCGuiFrameResult result = reader.NextFrame(payload, length);
+
+        if (result == CCGuiFrameResult::FRAME_TOO_LARGE)
+        {
+            LOG_ERROR << "The service sent a frame that is too large" << std::endl;
+            return false;
+        }
+
+        if (result == CCGuiFrameResult::FRAME_READY)
+        {
+            // every session starts with a snapshot and deltas can come before the answer
+            reply = nlohmann::json::parse(payload, payload + length, nullptr, false);
+            if (reply.is_object() && reply.value("type", "") == replyType)
+                return true;
+            continue;
+        }
+
+        size_t available = 0;
+        size_t received = 0;
+        char* buffer = reader.GetWriteBuffer(available);
+
+        error = socket.Recv(buffer, available, &received);
+        if (error != SocketError::SOCKET_E_SUCCESS || received == 0)
+        {
+            LOG_ERROR << "No " << replyType << " answer from the service: " << SOCK_ERR_STR(&socket, error) << std::endl;
+            return false;
+        }
+
+        reader.CommitWrite(received);
+    }
+}
+
+// asks the service for its latency histograms the way the GUI does and prints the answer
+int LatencyReport(uint64_t withinUs, bool reset)
+{
+    nlohmann::json request;
+    request["type"] = "getLatency";
+    request["withinUs"] = withinUs;
+    request["reset"] = reset;
+
+    nlohmann::json report;
+    if (ServiceRequest(request, "latency", report) == false)
+        return 1;
+
+    std::cout << report.dump(4) << std::endl;
+    return 0;
+}
+
+int TraceService(int seconds, const std::string& path)
+{
+    nlohmann::json reply;
+    if (ServiceRequest({ {"type", "startTrace"} }, "trace", reply) == false)
+        return 1;
+
+    if (reply.value("enabled", false) == false)
+    {
+        LOG_ERROR << "The service was built without CC_TRACING" << std::endl;
+        return 1;
+    }
+
+    LOG_INFO << "Tracing for " << seconds << " seconds" << std::endl;
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+    if (ServiceRequest({ {"type", "stopTrace"} }, "trace", reply) == false)
+        return 1;
+
+    std::ofstream file(path);
+    file << reply["trace"].dump();
+
+    if (file.good() == false)
+    {
+        LOG_ERROR << "Could not write " << path << std::endl;
+        return 1;
+    }
 
+    LOG_INFO << "Wrote " << reply["trace"]["traceEvents"].size() << " trace events to " << path << std::endl;
     return 0;
 }